@@ -0,0 +1,1256 @@
+#include "BenchmarkHarness.h"
+#include "../Utils/GltfUtils.h"
+#include "../Utils/MeshUtils.h"
+#include "../Utils/TextureUtils.h"
+#include "../Utils/BlockCompression.h"
+#include "../Utils/TextureContainer.h"
+#include "../JobSystem/JobSystem.h"
+#include "yaml-cpp/yaml.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+// The tinygltf and stb implementations live in the SceneAssetLoader.cpp of the renderer, which isn't part of this target.
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "../ThirdParty/TinyGltf/tiny_gltf.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    constexpr uint32_t RandomSeed = 20240731;
+
+    std::vector<fs::path> CollectFiles(const std::string& rootPath, const std::string& extension)
+    {
+        std::vector<fs::path> files;
+        if (!fs::exists(rootPath))
+        {
+            return files;
+        }
+
+        for (const auto& entry : fs::recursive_directory_iterator(rootPath))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == extension)
+            {
+                files.push_back(entry.path());
+            }
+        }
+
+        // The directory iteration order isn't specified. Sort it so every run does the same work.
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    uint64_t CountYamlNodes(const YAML::Node& node)
+    {
+        uint64_t cnt = 1;
+        if (node.IsMap())
+        {
+            for (const auto& itr : node)
+            {
+                cnt += CountYamlNodes(itr.second);
+            }
+        }
+        else if (node.IsSequence())
+        {
+            for (const auto& itr : node)
+            {
+                cnt += CountYamlNodes(itr);
+            }
+        }
+        return cnt;
+    }
+
+    // ============================================================================================================
+    void RunYamlBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        // Read the files up front so only the parsing is measured.
+        std::vector<std::string> sceneTexts;
+        for (const fs::path& scenePath : CollectFiles(assetRootPath, ".yaml"))
+        {
+            std::ifstream sceneFile(scenePath);
+            std::stringstream sceneText;
+            sceneText << sceneFile.rdbuf();
+            sceneTexts.push_back(sceneText.str());
+        }
+
+        if (sceneTexts.empty())
+        {
+            std::cout << "No scene yaml under " << assetRootPath << ". Skip the yaml benchmarks." << std::endl;
+            return;
+        }
+
+        runner.Run("yaml/parse_sample_scenes", sceneTexts.size(), [&sceneTexts]()
+        {
+            uint64_t nodeCnt = 0;
+            for (const std::string& sceneText : sceneTexts)
+            {
+                nodeCnt += CountYamlNodes(YAML::Load(sceneText));
+            }
+            DoNotOptimize(nodeCnt);
+        });
+    }
+
+    // ============================================================================================================
+    void RunGltfBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        std::vector<fs::path> gltfPaths = CollectFiles(assetRootPath, ".gltf");
+        if (gltfPaths.empty())
+        {
+            std::cout << "No glTF under " << assetRootPath << ". Skip the glTF benchmarks." << std::endl;
+            return;
+        }
+
+        std::vector<tinygltf::Model> models(gltfPaths.size());
+        uint64_t accessorCnt = 0;
+        runner.Run("gltf/load_sample_models", gltfPaths.size(), [&]()
+        {
+            tinygltf::TinyGLTF loader;
+            accessorCnt = 0;
+            for (uint32_t i = 0; i < gltfPaths.size(); i++)
+            {
+                std::string err;
+                std::string warn;
+                models[i] = tinygltf::Model();
+                loader.LoadASCIIFromFile(&models[i], &err, &warn, gltfPaths[i].string());
+                accessorCnt += models[i].accessors.size();
+            }
+        });
+
+        std::vector<unsigned char> dstBuffer;
+        runner.Run("gltf/read_accessors", accessorCnt, [&]()
+        {
+            uint64_t byteCnt = 0;
+            for (tinygltf::Model& model : models)
+            {
+                for (const tinygltf::Accessor& accessor : model.accessors)
+                {
+                    if (accessor.bufferView < 0)
+                    {
+                        continue;
+                    }
+                    const uint32_t accessorBytes = GetAccessorDataBytes(accessor);
+                    if (dstBuffer.size() < accessorBytes)
+                    {
+                        dstBuffer.resize(accessorBytes);
+                    }
+                    ReadOutAccessorData(dstBuffer.data(), accessor, model.bufferViews, model.buffers);
+                    byteCnt += accessorBytes;
+                }
+            }
+            DoNotOptimize(byteCnt);
+        });
+    }
+
+    // ============================================================================================================
+    // Synthetic scene graphs, deep and wide. The chain turns 1/N of a circle and steps 1 along its x per node, so its
+    // leaf closes the polygon back at the origin without a rotation. The wide tree's nodes are column major matrices of
+    // the translations, which add up along the path.
+    void RunGltfNodeBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t ChainNodeCnt = 4096;
+        constexpr uint32_t WideFanout = 64;
+
+        tinygltf::Model chainModel;
+        chainModel.nodes.resize(ChainNodeCnt);
+        const double halfStep = 3.14159265358979 / ChainNodeCnt;
+        for (uint32_t i = 0; i < ChainNodeCnt; i++)
+        {
+            chainModel.nodes[i].translation = { 1.0, 0.0, 0.0 };
+            chainModel.nodes[i].rotation = { 0.0, 0.0, sin(halfStep), cos(halfStep) };
+            if (i + 1 < ChainNodeCnt)
+            {
+                chainModel.nodes[i].children = { static_cast<int>(i + 1) };
+            }
+        }
+        chainModel.scenes.resize(1);
+        chainModel.scenes[0].nodes = { 0 };
+
+        tinygltf::Model wideModel;
+        wideModel.nodes.resize(1 + WideFanout + WideFanout * WideFanout);
+        for (uint32_t i = 0; i < wideModel.nodes.size(); i++)
+        {
+            wideModel.nodes[i].matrix = { 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0,
+                                          static_cast<double>(i), 1.0, 0.0, 1.0 };
+        }
+        for (uint32_t i = 0; i < WideFanout; i++)
+        {
+            const int child = static_cast<int>(1 + i);
+            wideModel.nodes[0].children.push_back(child);
+            for (uint32_t j = 0; j < WideFanout; j++)
+            {
+                wideModel.nodes[child].children.push_back(static_cast<int>(1 + WideFanout + i * WideFanout + j));
+            }
+        }
+        wideModel.scenes.resize(1);
+        wideModel.scenes[0].nodes = { 0 };
+
+        GltfFlatNodes flatNodes;
+        FlattenGltfNodes(chainModel, -1, flatNodes);
+        const float* pLeafMat = &flatNodes.worldMats[16 * (ChainNodeCnt - 1)];
+        const float leafRotError = std::max(std::max(fabsf(pLeafMat[0] - 1.f), fabsf(pLeafMat[1])), std::max(fabsf(pLeafMat[4]), fabsf(pLeafMat[5] - 1.f)));
+        const float leafPosError = std::max(fabsf(pLeafMat[3]), fabsf(pLeafMat[7]));
+        std::cout << "Node chain of " << flatNodes.nodeIdxs.size() << ": the leaf is " << leafPosError << " off the origin and "
+                  << leafRotError << " off the identity rotation." << std::endl;
+        if (flatNodes.nodeIdxs.size() != ChainNodeCnt || leafRotError > 1e-3f || leafPosError > 0.5f)
+        {
+            std::cerr << "The node chain's world matrices are wrong." << std::endl;
+            std::abort();
+        }
+
+        FlattenGltfNodes(wideModel, -1, flatNodes);
+        if (flatNodes.nodeIdxs.size() != wideModel.nodes.size())
+        {
+            std::cerr << "The wide node tree lost nodes." << std::endl;
+            std::abort();
+        }
+        for (uint32_t flatIdx = 0; flatIdx < flatNodes.nodeIdxs.size(); flatIdx++)
+        {
+            float pathSum = 0.f;
+            for (uint32_t ancestor = flatIdx; ancestor != UINT32_MAX; ancestor = flatNodes.parents[ancestor])
+            {
+                pathSum += static_cast<float>(flatNodes.nodeIdxs[ancestor]);
+            }
+            if (flatNodes.parents[flatIdx] != UINT32_MAX && flatNodes.parents[flatIdx] >= flatIdx)
+            {
+                std::cerr << "A child of the wide node tree is flattened before its parent." << std::endl;
+                std::abort();
+            }
+            if (flatNodes.worldMats[16 * flatIdx + 3] != pathSum)
+            {
+                std::cerr << "The wide node tree's world matrices are wrong." << std::endl;
+                std::abort();
+            }
+        }
+
+        runner.Run("gltf/flatten_nodes_chain_4k", ChainNodeCnt, [&]()
+        {
+            FlattenGltfNodes(chainModel, -1, flatNodes);
+            DoNotOptimize(static_cast<uint64_t>(flatNodes.worldMats.back()));
+        });
+
+        runner.Run("gltf/flatten_nodes_wide_4k", wideModel.nodes.size(), [&]()
+        {
+            FlattenGltfNodes(wideModel, -1, flatNodes);
+            DoNotOptimize(static_cast<uint64_t>(flatNodes.worldMats.back()));
+        });
+    }
+
+    // ============================================================================================================
+    void RunInterleaveBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t VertCnt = 100000;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> valueDist(-1.f, 1.f);
+        std::vector<float> posData(VertCnt * 3), normalData(VertCnt * 3), tangentData(VertCnt * 4), texCoordData(VertCnt * 2);
+        for (float& value : posData) { value = valueDist(rng); }
+        for (float& value : normalData) { value = valueDist(rng); }
+        for (float& value : tangentData) { value = valueDist(rng); }
+        for (float& value : texCoordData) { value = valueDist(rng); }
+        std::vector<float> vertData(VertCnt * VERT_SIZE_FLOAT);
+
+        runner.Run("mesh/interleave_vertices_100k", VertCnt, [&]()
+        {
+            InterleaveVertexData(posData.data(), normalData.data(), tangentData.data(), texCoordData.data(), VertCnt, vertData.data());
+            DoNotOptimize(static_cast<uint64_t>(vertData[VertCnt]));
+        });
+    }
+
+    // ============================================================================================================
+    // The unit normals and tangents, and the positions and texture coordinates of a large mesh, through the compact
+    // layout and back. The decode errors are checked against the documented bounds.
+    void RunCompactVertexBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t VertCnt = 100000;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> posDist(-50.f, 50.f);
+        std::uniform_real_distribution<float> texCoordDist(-4.f, 4.f);
+        std::normal_distribution<float> dirDist;
+        std::vector<float> posData(VertCnt * 3), normalData(VertCnt * 3), tangentData(VertCnt * 4), texCoordData(VertCnt * 2);
+        for (float& value : posData) { value = posDist(rng); }
+        for (float& value : texCoordData) { value = texCoordDist(rng); }
+        for (uint32_t i = 0; i < VertCnt; i++)
+        {
+            float* pDirs[2] = { &normalData[i * 3], &tangentData[i * 4] };
+            for (float* pDir : pDirs)
+            {
+                for (uint32_t k = 0; k < 3; k++) { pDir[k] = dirDist(rng); }
+                const float len = sqrtf(pDir[0] * pDir[0] + pDir[1] * pDir[1] + pDir[2] * pDir[2]);
+                for (uint32_t k = 0; k < 3; k++) { pDir[k] /= len; }
+            }
+            tangentData[i * 4 + 3] = (i % 2 == 0) ? 1.f : -1.f;
+        }
+
+        float aabbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float aabbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t i = 0; i < VertCnt * 3; i++)
+        {
+            aabbMin[i % 3] = std::min(aabbMin[i % 3], posData[i]);
+            aabbMax[i % 3] = std::max(aabbMax[i % 3], posData[i]);
+        }
+
+        std::vector<uint8_t> compactData(VertCnt * COMPACT_VERT_SIZE_BYTE);
+        runner.Run("mesh/compact_vertices_100k", VertCnt, [&]()
+        {
+            CompactVertexData(posData.data(), normalData.data(), tangentData.data(), texCoordData.data(), VertCnt, aabbMin, aabbMax, compactData.data());
+            DoNotOptimize(compactData[VertCnt]);
+        });
+
+        std::vector<float> decodedData(VertCnt * VERT_SIZE_FLOAT);
+        CompactVertexData(posData.data(), normalData.data(), tangentData.data(), texCoordData.data(), VertCnt, aabbMin, aabbMax, compactData.data());
+        runner.Run("mesh/decode_compact_vertices_100k", VertCnt, [&]()
+        {
+            DecodeCompactVertexData(compactData.data(), VertCnt, aabbMin, aabbMax, decodedData.data());
+            DoNotOptimize(static_cast<uint64_t>(decodedData[VertCnt]));
+        });
+
+        // The angle between unit vectors by the atan2, since the acos of a dot product near 1 is below float precision.
+        auto angleDegrees = [](const float* pA, const float* pB)
+        {
+            const double cross[3] = { static_cast<double>(pA[1]) * pB[2] - static_cast<double>(pA[2]) * pB[1],
+                                      static_cast<double>(pA[2]) * pB[0] - static_cast<double>(pA[0]) * pB[2],
+                                      static_cast<double>(pA[0]) * pB[1] - static_cast<double>(pA[1]) * pB[0] };
+            const double dot = static_cast<double>(pA[0]) * pB[0] + static_cast<double>(pA[1]) * pB[1] + static_cast<double>(pA[2]) * pB[2];
+            return atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot) * 180.0 / 3.14159265358979;
+        };
+
+        DecodeCompactVertexData(compactData.data(), VertCnt, aabbMin, aabbMax, decodedData.data());
+        double maxPosError = 0.0;
+        double maxDirError = 0.0;
+        double maxTexCoordError = 0.0;
+        uint32_t flippedHandednessCnt = 0;
+        for (uint32_t i = 0; i < VertCnt; i++)
+        {
+            const float* pDecoded = &decodedData[i * VERT_SIZE_FLOAT];
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                const double error = fabs(pDecoded[axis] - posData[i * 3 + axis]) / (aabbMax[axis] - aabbMin[axis]);
+                maxPosError = std::max(maxPosError, error);
+            }
+            maxDirError = std::max(maxDirError, angleDegrees(pDecoded + 3, &normalData[i * 3]));
+            maxDirError = std::max(maxDirError, angleDegrees(pDecoded + 6, &tangentData[i * 4]));
+            flippedHandednessCnt += (pDecoded[9] != tangentData[i * 4 + 3]) ? 1 : 0;
+            for (uint32_t k = 0; k < 2; k++)
+            {
+                const double error = fabs(pDecoded[10 + k] - texCoordData[i * 2 + k]) / std::max(fabs(texCoordData[i * 2 + k]), 1e-3);
+                maxTexCoordError = std::max(maxTexCoordError, error);
+            }
+        }
+
+        // The float math of the decode itself adds a little on top of the quantization.
+        const bool isWithinBounds = maxPosError <= COMPACT_POS_MAX_ERROR * 1.01 && maxDirError <= COMPACT_DIR_MAX_ERROR_DEGREES &&
+                                    maxTexCoordError <= COMPACT_UV_MAX_RELATIVE_ERROR && flippedHandednessCnt == 0;
+        std::cout << "    " << VERT_SIZE_FLOAT * sizeof(float) << " -> " << COMPACT_VERT_SIZE_BYTE << " bytes per vertex. Max errors: position "
+                  << maxPosError << " of the extent, direction " << maxDirError << " degrees, texcoord " << maxTexCoordError
+                  << " relative, " << flippedHandednessCnt << " flipped handedness." << std::endl;
+        if (!isWithinBounds)
+        {
+            std::cerr << "mesh/compact_vertices_100k: the decoded vertices are out of the compact format's error bounds." << std::endl;
+            std::abort();
+        }
+    }
+
+    // ============================================================================================================
+    void PrintMPixelsPerSec(const BenchmarkRunner& runner, const std::string& name)
+    {
+        const std::vector<BenchmarkResult>& results = runner.GetResults();
+        if (!results.empty() && results.back().name == name)
+        {
+            const double nsPerPix = results.back().p50Ns / static_cast<double>(results.back().itemCnt);
+            std::cout << "    " << 1e3 / nsPerPix << " MPixels/s" << std::endl;
+        }
+    }
+
+    const BenchmarkResult* FindResult(const BenchmarkRunner& runner, const std::string& name)
+    {
+        for (const BenchmarkResult& result : runner.GetResults())
+        {
+            if (result.name == name)
+            {
+                return &result;
+            }
+        }
+        return nullptr;
+    }
+
+    // ============================================================================================================
+    void PrintMsPerMTriangle(const BenchmarkRunner& runner, const std::string& name)
+    {
+        const BenchmarkResult* pResult = FindResult(runner, name);
+        if (pResult != nullptr)
+        {
+            std::cout << "    " << pResult->p50Ns / 1e6 / (pResult->itemCnt / 1e6) << " ms per MTriangle" << std::endl;
+        }
+    }
+
+    void PrintVertexCacheStats(const char* pLabel, const std::vector<uint32_t>& indices, uint32_t vertCnt)
+    {
+        const VertexCacheStats stats = AnalyzeVertexCache(indices.data(), static_cast<uint32_t>(indices.size()), vertCnt);
+        std::cout << "    " << pLabel << ": ACMR " << stats.acmr << ", ATVR " << stats.atvr << std::endl;
+    }
+
+    // A UV sphere, whose triangles are shuffled like a mesh exported without any care for the vertex cache.
+    void RunMeshOptimizeBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t RingCnt = 256;
+        constexpr uint32_t SegmentCnt = 256;
+        const uint32_t vertCnt = (RingCnt + 1) * (SegmentCnt + 1);
+        std::vector<float> posData;
+        std::vector<uint32_t> sphereIndices;
+        MakeUvSphere(RingCnt, SegmentCnt, posData, sphereIndices);
+
+        std::vector<uint32_t> triOrder(RingCnt * SegmentCnt * 2);
+        for (uint32_t i = 0; i < triOrder.size(); i++)
+        {
+            triOrder[i] = i;
+        }
+        std::shuffle(triOrder.begin(), triOrder.end(), std::mt19937(RandomSeed));
+
+        std::vector<uint32_t> shuffledIndices(triOrder.size() * 3);
+        for (uint32_t i = 0; i < triOrder.size(); i++)
+        {
+            memcpy(&shuffledIndices[i * 3], &sphereIndices[triOrder[i] * 3], sizeof(uint32_t) * 3);
+        }
+
+        // The item is a triangle.
+        const uint64_t triCnt = triOrder.size();
+        std::vector<uint32_t> indices;
+        const std::string cacheName = "mesh/optimize_vertex_cache_131k_tris";
+        runner.Run(cacheName, triCnt, [&]()
+        {
+            indices = shuffledIndices;
+            OptimizeVertexCache(indices.data(), static_cast<uint32_t>(indices.size()), vertCnt);
+            DoNotOptimize(indices[0]);
+        });
+        PrintMsPerMTriangle(runner, cacheName);
+        if (FindResult(runner, cacheName) != nullptr)
+        {
+            PrintVertexCacheStats("Shuffled", shuffledIndices, vertCnt);
+            PrintVertexCacheStats("Optimized", indices, vertCnt);
+        }
+
+        std::vector<uint32_t> cacheOptimizedIndices = shuffledIndices;
+        OptimizeVertexCache(cacheOptimizedIndices.data(), static_cast<uint32_t>(cacheOptimizedIndices.size()), vertCnt);
+        const std::string overdrawName = "mesh/optimize_overdraw_131k_tris";
+        runner.Run(overdrawName, triCnt, [&]()
+        {
+            indices = cacheOptimizedIndices;
+            OptimizeOverdraw(indices.data(), static_cast<uint32_t>(indices.size()), posData.data(), vertCnt);
+            DoNotOptimize(indices[0]);
+        });
+        PrintMsPerMTriangle(runner, overdrawName);
+        if (FindResult(runner, overdrawName) != nullptr)
+        {
+            PrintVertexCacheStats("Overdraw sorted", indices, vertCnt);
+        }
+
+        std::vector<uint32_t> remap;
+        const std::string fetchName = "mesh/optimize_vertex_fetch_131k_tris";
+        runner.Run(fetchName, triCnt, [&]()
+        {
+            indices = cacheOptimizedIndices;
+            DoNotOptimize(OptimizeVertexFetchRemap(indices.data(), static_cast<uint32_t>(indices.size()), vertCnt, remap));
+        });
+        PrintMsPerMTriangle(runner, fetchName);
+    }
+
+    struct SourceMesh
+    {
+        std::string           name;
+        std::vector<float>    posData;
+        std::vector<float>    normalData;
+        std::vector<float>    texCoordData;
+        std::vector<float>    tangentData;
+        std::vector<uint32_t> indices;
+    };
+
+    // The first primitive of the first glTF with the file name, or false without it.
+    bool LoadGltfMesh(const std::string& assetRootPath, const std::string& fileName, SourceMesh& oMesh)
+    {
+        for (const fs::path& gltfPath : CollectFiles(assetRootPath, ".gltf"))
+        {
+            if (gltfPath.filename() != fileName)
+            {
+                continue;
+            }
+
+            tinygltf::TinyGLTF loader;
+            tinygltf::Model model;
+            std::string err;
+            std::string warn;
+            if (!loader.LoadASCIIFromFile(&model, &err, &warn, gltfPath.string()) || model.meshes.empty() ||
+                model.meshes[0].primitives.empty())
+            {
+                return false;
+            }
+
+            const tinygltf::Primitive& primitive = model.meshes[0].primitives[0];
+            if (primitive.indices < 0 || primitive.attributes.count("POSITION") == 0)
+            {
+                return false;
+            }
+
+            auto readAttribute = [&model, &primitive](const char* pName, uint32_t componentCnt, std::vector<float>& oData)
+            {
+                auto attributeItr = primitive.attributes.find(pName);
+                if (attributeItr != primitive.attributes.end())
+                {
+                    const tinygltf::Accessor& accessor = model.accessors[attributeItr->second];
+                    oData.resize(accessor.count * componentCnt);
+                    ReadOutAccessorData(oData.data(), accessor, model.bufferViews, model.buffers);
+                }
+            };
+            readAttribute("POSITION", 3, oMesh.posData);
+            readAttribute("NORMAL", 3, oMesh.normalData);
+            readAttribute("TEXCOORD_0", 2, oMesh.texCoordData);
+            readAttribute("TANGENT", 4, oMesh.tangentData);
+
+            const tinygltf::Accessor& idxAccessor = model.accessors[primitive.indices];
+            oMesh.indices.resize(idxAccessor.count);
+            if (idxAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+            {
+                std::vector<uint16_t> indices16(idxAccessor.count);
+                ReadOutAccessorData(indices16.data(), idxAccessor, model.bufferViews, model.buffers);
+                std::copy(indices16.begin(), indices16.end(), oMesh.indices.begin());
+            }
+            else
+            {
+                ReadOutAccessorData(oMesh.indices.data(), idxAccessor, model.bufferViews, model.buffers);
+            }
+            oMesh.name = fileName;
+            return true;
+        }
+        return false;
+    }
+
+    // The UV sphere and the flat shaded icosphere of the sample scenes, which has no shared vertices.
+    std::vector<SourceMesh> LoadSourceMeshes(const std::string& assetRootPath)
+    {
+        std::vector<SourceMesh> meshes(1);
+        meshes[0].name = "uv_sphere_131k_tris";
+        MakeUvSphere(256, 256, meshes[0].posData, meshes[0].indices);
+
+        SourceMesh isoSphere;
+        if (LoadGltfMesh(assetRootPath, "isoSphereHighFaceNum.gltf", isoSphere))
+        {
+            isoSphere.name = "iso_sphere_" + std::to_string(isoSphere.indices.size() / 3 / 1000) + "k_tris";
+            meshes.push_back(std::move(isoSphere));
+        }
+        else
+        {
+            std::cout << "No isoSphereHighFaceNum.gltf under " << assetRootPath << ". Skip its benchmarks." << std::endl;
+        }
+        return meshes;
+    }
+
+    // ============================================================================================================
+    void RunMeshSimplifyBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        // The icosphere's normals are welded, so it still simplifies.
+        const std::vector<SourceMesh> meshes = LoadSourceMeshes(assetRootPath);
+        std::vector<uint32_t> lodIndices;
+        for (const SourceMesh& mesh : meshes)
+        {
+            const uint32_t vertCnt = static_cast<uint32_t>(mesh.posData.size() / 3);
+            const uint32_t idxCnt = static_cast<uint32_t>(mesh.indices.size());
+            const float* pNormalData = mesh.normalData.empty() ? nullptr : mesh.normalData.data();
+            const float* pTexCoordData = mesh.texCoordData.empty() ? nullptr : mesh.texCoordData.data();
+
+            // The item is a source triangle.
+            const std::string halfName = "mesh/simplify_half_" + mesh.name;
+            runner.Run(halfName, idxCnt / 3, [&]()
+            {
+                DoNotOptimize(SimplifyMesh(mesh.indices.data(), idxCnt, mesh.posData.data(), pNormalData, pTexCoordData, vertCnt,
+                                           idxCnt / 2, FLT_MAX, lodIndices));
+            });
+            PrintMsPerMTriangle(runner, halfName);
+            if (FindResult(runner, halfName) == nullptr)
+            {
+                continue;
+            }
+
+            // The LOD chain the loader makes, each level from the previous one.
+            std::vector<uint32_t> indices = mesh.indices;
+            float error = 0.0f;
+            std::cout << "    LOD 0: " << idxCnt / 3 << " triangles" << std::endl;
+            for (uint32_t lod = 1; lod < MAX_MESH_LOD_CNT; lod++)
+            {
+                error += SimplifyMesh(indices.data(), static_cast<uint32_t>(indices.size()), mesh.posData.data(), pNormalData, pTexCoordData,
+                                      vertCnt, static_cast<uint32_t>(indices.size() / 2 / 3 * 3), MESH_LOD_MAX_ERROR - error, lodIndices);
+                if (lodIndices.size() * 10 > indices.size() * 9)
+                {
+                    break;
+                }
+                std::cout << "    LOD " << lod << ": " << lodIndices.size() / 3 << " triangles, error " << error << " of the extent"
+                          << std::endl;
+                indices.swap(lodIndices);
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void RunMeshletBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        const std::vector<SourceMesh> meshes = LoadSourceMeshes(assetRootPath);
+        std::vector<uint32_t> indices;
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshletBounds> bounds;
+        std::vector<uint32_t> meshletVerts;
+        std::vector<uint8_t> meshletTris;
+        for (const SourceMesh& mesh : meshes)
+        {
+            const uint32_t vertCnt = static_cast<uint32_t>(mesh.posData.size() / 3);
+            const uint32_t idxCnt = static_cast<uint32_t>(mesh.indices.size());
+
+            // The item is a triangle. The bounds are part of the build, as in the loader.
+            const std::string buildName = "mesh/build_meshlets_" + mesh.name;
+            runner.Run(buildName, idxCnt / 3, [&]()
+            {
+                indices = mesh.indices;
+                BuildMeshlets(indices.data(), idxCnt, mesh.posData.data(), vertCnt, meshlets, meshletVerts, meshletTris);
+                bounds.resize(meshlets.size());
+                for (uint32_t i = 0; i < meshlets.size(); i++)
+                {
+                    ComputeMeshletBounds(meshlets[i], meshletVerts.data(), meshletTris.data(), mesh.posData.data(), bounds[i]);
+                }
+                DoNotOptimize(meshlets.size());
+            });
+            PrintMsPerMTriangle(runner, buildName);
+            if (meshlets.empty())
+            {
+                continue;
+            }
+
+            uint32_t cullableConeCnt = 0;
+            for (const MeshletBounds& meshletBounds : bounds)
+            {
+                cullableConeCnt += meshletBounds.coneCutoff < 1.0f ? 1 : 0;
+            }
+            std::cout << "    " << meshlets.size() << " meshlets of " << static_cast<double>(meshletVerts.size()) / meshlets.size()
+                      << " vertices and " << static_cast<double>(idxCnt / 3) / meshlets.size() << " triangles on average ("
+                      << 100.0 * (idxCnt / 3) / (meshlets.size() * MESHLET_MAX_TRI_CNT) << "% of the triangle limit), "
+                      << 100.0 * cullableConeCnt / meshlets.size() << "% with a backface cone" << std::endl;
+        }
+    }
+
+    // ============================================================================================================
+    void RunTangentBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        // The sphere's normals are its positions, and its texture wraps around once, so the seam is the only split.
+        constexpr uint32_t RingCnt = 256;
+        constexpr uint32_t SegmentCnt = 256;
+        SourceMesh sphere;
+        MakeUvSphere(RingCnt, SegmentCnt, sphere.posData, sphere.indices);
+        sphere.normalData = sphere.posData;
+        for (uint32_t v = 0; v < sphere.posData.size() / 3; v++)
+        {
+            sphere.texCoordData.push_back(static_cast<float>(v % (SegmentCnt + 1)) / SegmentCnt);
+            sphere.texCoordData.push_back(static_cast<float>(v / (SegmentCnt + 1)) / RingCnt);
+        }
+
+        std::vector<uint32_t> indices;
+        std::vector<float> tangentData;
+        std::vector<uint32_t> srcVerts;
+        const uint32_t vertCnt = static_cast<uint32_t>(sphere.posData.size() / 3);
+        const uint32_t idxCnt = static_cast<uint32_t>(sphere.indices.size());
+
+        // The item is a triangle.
+        for (bool useJobs : { false, true })
+        {
+            if (useJobs)
+            {
+                JobSystem::Create();
+            }
+            const std::string name = std::string("mesh/generate_tangents_uv_sphere_131k_tris_") + (useJobs ? "all_threads" : "1_thread");
+            runner.Run(name, idxCnt / 3, [&]()
+            {
+                indices = sphere.indices;
+                DoNotOptimize(GenerateTangents(indices.data(), idxCnt, sphere.posData.data(), sphere.normalData.data(),
+                                               sphere.texCoordData.data(), vertCnt, tangentData, srcVerts));
+            });
+            PrintMsPerMTriangle(runner, name);
+            if (useJobs)
+            {
+                JobSystem::Destroy();
+            }
+        }
+
+        // A strip of 3 quads in the z = 0 plane facing +z. The left quad's texture is the middle one's mirrored about
+        // x = 0, and they share the 2 vertices there, so those must split. The right quad continues the middle one
+        // across a texture seam at x = 1, where the vertices are already separate, and must keep the same tangents.
+        // A triangle's tangent is its +u direction, and the w is -1 unless its texture is mirrored.
+        {
+            const float stripPosData[10 * 3] = { -1, 0, 0,  -1, 1, 0,  0, 0, 0,  0, 1, 0,  1, 0, 0,
+                                                  1, 1, 0,   1, 0, 0,  1, 1, 0,  2, 0, 0,  2, 1, 0 };
+            const float stripTexCoordData[10 * 2] = { 1, 0,  1, 1,  0, 0,  0, 1,  1, 0,  1, 1,  0, 0,  0, 1,  1, 0,  1, 1 };
+            const uint32_t stripIndices[6 * 3] = { 0, 2, 3,  0, 3, 1,  2, 4, 5,  2, 5, 3,  6, 8, 9,  6, 9, 7 };
+            const float expectedTriTangents[6] = { -1.0f, -1.0f, 1.0f, 1.0f, 1.0f, 1.0f }; // The x. The y and z are 0.
+            const float expectedTriSigns[6] = { 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f };
+            std::vector<float> stripNormalData(10 * 3, 0.0f);
+            for (uint32_t v = 0; v < 10; v++)
+            {
+                stripNormalData[v * 3 + 2] = 1.0f;
+            }
+
+            indices.assign(stripIndices, stripIndices + 6 * 3);
+            const uint32_t newVertCnt = GenerateTangents(indices.data(), 6 * 3, stripPosData, stripNormalData.data(), stripTexCoordData,
+                                                         10, tangentData, srcVerts);
+            bool isExpected = newVertCnt == 12;
+            for (uint32_t c = 0; c < 6 * 3 && isExpected; c++)
+            {
+                const float* pTangent = &tangentData[indices[c] * 4];
+                isExpected = srcVerts[indices[c]] == stripIndices[c] && fabsf(pTangent[0] - expectedTriTangents[c / 3]) < 1e-5f &&
+                             fabsf(pTangent[1]) < 1e-5f && fabsf(pTangent[2]) < 1e-5f && pTangent[3] == expectedTriSigns[c / 3];
+            }
+            if (!isExpected)
+            {
+                std::cerr << "mesh/generate_tangents gave wrong tangents around a mirrored texture island and a seam" << std::endl;
+                std::abort();
+            }
+        }
+
+        // The sample assets that ship their tangents, for how close the generated ones come. The generated tangents
+        // stand in for the shipped ones at their source vertices, so a split vertex is compared to its one reference.
+        // Nearly all must be within 5 degrees, and the bitangent signs must all match, or the normal maps would flip.
+        for (const char* pFileName : { "Avocado.gltf", "BarramundiFish.gltf", "WaterBottle.gltf" })
+        {
+            SourceMesh mesh;
+            if (!LoadGltfMesh(assetRootPath, pFileName, mesh) || mesh.tangentData.empty() || mesh.normalData.empty() ||
+                mesh.texCoordData.empty())
+            {
+                std::cout << "No " << pFileName << " with the tangents under " << assetRootPath << ". Skip its comparison." << std::endl;
+                continue;
+            }
+
+            const uint32_t meshVertCnt = static_cast<uint32_t>(mesh.posData.size() / 3);
+            indices = mesh.indices;
+            const uint32_t newVertCnt = GenerateTangents(indices.data(), static_cast<uint32_t>(indices.size()), mesh.posData.data(),
+                                                         mesh.normalData.data(), mesh.texCoordData.data(), meshVertCnt, tangentData, srcVerts);
+            double angleSum = 0.0;
+            uint32_t within5DegreesCnt = 0;
+            uint32_t sameSignCnt = 0;
+            for (uint32_t v = 0; v < newVertCnt; v++)
+            {
+                const float* pGenerated = &tangentData[v * 4];
+                const float* pReference = &mesh.tangentData[srcVerts[v] * 4];
+                const float referenceLen = sqrtf(pReference[0] * pReference[0] + pReference[1] * pReference[1] + pReference[2] * pReference[2]);
+                const float dot = (pGenerated[0] * pReference[0] + pGenerated[1] * pReference[1] + pGenerated[2] * pReference[2]) /
+                                  std::max(referenceLen, FLT_MIN);
+                const double angle = acos(std::clamp(dot, -1.0f, 1.0f)) * 180.0 / 3.14159265358979;
+                angleSum += angle;
+                within5DegreesCnt += angle <= 5.0 ? 1 : 0;
+                sameSignCnt += (pGenerated[3] < 0.0f) == (pReference[3] < 0.0f) ? 1 : 0;
+            }
+            std::cout << "    " << pFileName << ": " << newVertCnt << " vertices of " << meshVertCnt << ", " << angleSum / newVertCnt
+                      << " degrees off the shipped tangents on average, " << 100.0 * within5DegreesCnt / newVertCnt
+                      << "% within 5 degrees, " << 100.0 * sameSignCnt / newVertCnt << "% with the same bitangent sign" << std::endl;
+            if (within5DegreesCnt < 0.95 * newVertCnt || sameSignCnt != newVertCnt)
+            {
+                std::cerr << "mesh/generate_tangents: " << pFileName << " is too far off its shipped tangents" << std::endl;
+                std::abort();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void RunNormalBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        constexpr float SmoothCreaseDegrees = 60.0f;
+        constexpr uint32_t RingCnt = 256;
+        constexpr uint32_t SegmentCnt = 256;
+        SourceMesh sphere;
+        MakeUvSphere(RingCnt, SegmentCnt, sphere.posData, sphere.indices);
+
+        std::vector<uint32_t> indices;
+        std::vector<float> normalData;
+        std::vector<uint32_t> srcVerts;
+        const uint32_t vertCnt = static_cast<uint32_t>(sphere.posData.size() / 3);
+        const uint32_t idxCnt = static_cast<uint32_t>(sphere.indices.size());
+
+        // The item is a triangle. The flat shading splits every vertex, so it also measures the splits.
+        for (bool useJobs : { false, true })
+        {
+            if (useJobs)
+            {
+                JobSystem::Create();
+            }
+            const std::string threadStr = useJobs ? "all_threads" : "1_thread";
+            for (float creaseDegrees : { SmoothCreaseDegrees, 0.0f })
+            {
+                const std::string name = std::string("mesh/generate_normals_") + (creaseDegrees > 0.0f ? "smooth" : "flat") +
+                                         "_uv_sphere_131k_tris_" + threadStr;
+                runner.Run(name, idxCnt / 3, [&]()
+                {
+                    indices = sphere.indices;
+                    DoNotOptimize(GenerateNormals(indices.data(), idxCnt, sphere.posData.data(), vertCnt, creaseDegrees, normalData, srcVerts));
+                });
+                PrintMsPerMTriangle(runner, name);
+            }
+            if (useJobs)
+            {
+                JobSystem::Destroy();
+            }
+        }
+
+        // The angles between the generated normals and the reference ones at their source vertices.
+        auto printNormalError = [&normalData, &srcVerts](const std::string& meshName, uint32_t meshVertCnt, uint32_t newVertCnt, const float* pReference)
+        {
+            double angleSum = 0.0;
+            double maxAngle = 0.0;
+            uint32_t within5DegreesCnt = 0;
+            for (uint32_t v = 0; v < newVertCnt; v++)
+            {
+                const float* pGenerated = &normalData[v * 3];
+                const float* pRefNormal = &pReference[srcVerts[v] * 3];
+                const float referenceLen = sqrtf(pRefNormal[0] * pRefNormal[0] + pRefNormal[1] * pRefNormal[1] + pRefNormal[2] * pRefNormal[2]);
+                const float dot = (pGenerated[0] * pRefNormal[0] + pGenerated[1] * pRefNormal[1] + pGenerated[2] * pRefNormal[2]) /
+                                  std::max(referenceLen, FLT_MIN);
+                const double angle = acos(std::clamp(dot, -1.0f, 1.0f)) * 180.0 / 3.14159265358979;
+                angleSum += angle;
+                maxAngle = std::max(maxAngle, angle);
+                within5DegreesCnt += angle <= 5.0 ? 1 : 0;
+            }
+            std::cout << "    " << meshName << ": " << newVertCnt << " vertices of " << meshVertCnt << ", " << angleSum / newVertCnt
+                      << " degrees off on average, " << maxAngle << " at most, " << 100.0 * within5DegreesCnt / newVertCnt
+                      << "% within 5 degrees" << std::endl;
+        };
+
+        // The sphere's triangles wind clockwise from the outside, so its normals are its negated positions. The seam copy
+        // of the bottom pole is only on a sliver, so it keeps the fallback normal.
+        std::vector<float> sphereNormalData(sphere.posData.size());
+        std::transform(sphere.posData.begin(), sphere.posData.end(), sphereNormalData.begin(), [](float coord) { return -coord; });
+        indices = sphere.indices;
+        uint32_t newVertCnt = GenerateNormals(indices.data(), idxCnt, sphere.posData.data(), vertCnt, SmoothCreaseDegrees, normalData, srcVerts);
+        printNormalError("uv_sphere_131k_tris", vertCnt, newVertCnt, sphereNormalData.data());
+
+        // A cube on its 8 corners splits into a vertex per face corner below the 90 degree crease, and stays whole above.
+        const float cubePosData[8 * 3] = { -1, -1, -1,  1, -1, -1,  1, 1, -1,  -1, 1, -1,  -1, -1, 1,  1, -1, 1,  1, 1, 1,  -1, 1, 1 };
+        const uint32_t cubeIndices[12 * 3] = { 0, 2, 1,  0, 3, 2,  4, 5, 6,  4, 6, 7,  0, 1, 5,  0, 5, 4,
+                                               3, 7, 6,  3, 6, 2,  0, 4, 7,  0, 7, 3,  1, 2, 6,  1, 6, 5 };
+        for (float creaseDegrees : { SmoothCreaseDegrees, 120.0f })
+        {
+            indices.assign(cubeIndices, cubeIndices + 12 * 3);
+            newVertCnt = GenerateNormals(indices.data(), 12 * 3, cubePosData, 8, creaseDegrees, normalData, srcVerts);
+            const uint32_t expectedVertCnt = creaseDegrees < 90.0f ? 24 : 8;
+            bool isExpected = newVertCnt == expectedVertCnt;
+            for (uint32_t c = 0; c < 12 * 3 && isExpected; c++)
+            {
+                // Split, each corner's normal is its face's. Whole, it's the corner's diagonal.
+                const float* pTriPos[3] = { &cubePosData[cubeIndices[c - c % 3] * 3], &cubePosData[cubeIndices[c - c % 3 + 1] * 3],
+                                            &cubePosData[cubeIndices[c - c % 3 + 2] * 3] };
+                float expected[3];
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    // The cube's faces are axis aligned, so the face normal is the axis its corners share, signed by it.
+                    const bool isFaceAxis = pTriPos[0][i] == pTriPos[1][i] && pTriPos[0][i] == pTriPos[2][i];
+                    expected[i] = creaseDegrees < 90.0f ? (isFaceAxis ? pTriPos[0][i] : 0.0f) : cubePosData[cubeIndices[c] * 3 + i] / sqrtf(3.0f);
+                }
+                const float* pNormal = &normalData[indices[c] * 3];
+                isExpected = fabsf(pNormal[0] - expected[0]) < 1e-5f && fabsf(pNormal[1] - expected[1]) < 1e-5f &&
+                             fabsf(pNormal[2] - expected[2]) < 1e-5f;
+            }
+            if (!isExpected)
+            {
+                std::cerr << "mesh/generate_normals gave a wrong cube at a " << creaseDegrees << " degree crease" << std::endl;
+                std::abort();
+            }
+        }
+
+        // The sample assets that ship their normals.
+        for (const char* pFileName : { "Avocado.gltf", "BarramundiFish.gltf", "WaterBottle.gltf", "Duck.gltf" })
+        {
+            SourceMesh mesh;
+            if (!LoadGltfMesh(assetRootPath, pFileName, mesh) || mesh.normalData.empty())
+            {
+                std::cout << "No " << pFileName << " with the normals under " << assetRootPath << ". Skip its comparison." << std::endl;
+                continue;
+            }
+
+            const uint32_t meshVertCnt = static_cast<uint32_t>(mesh.posData.size() / 3);
+            indices = mesh.indices;
+            newVertCnt = GenerateNormals(indices.data(), static_cast<uint32_t>(indices.size()), mesh.posData.data(), meshVertCnt,
+                                         SmoothCreaseDegrees, normalData, srcVerts);
+            printNormalError(pFileName, meshVertCnt, newVertCnt, mesh.normalData.data());
+        }
+    }
+
+    // Noise over gradients, so the filters and encoders see texture like detail instead of a flat color.
+    std::vector<uint8_t> MakeNoisyGradientTexture(uint32_t texSize)
+    {
+        std::mt19937 rng(RandomSeed);
+        std::uniform_int_distribution<int> noiseDist(-24, 24);
+        std::vector<uint8_t> texels(static_cast<size_t>(texSize) * texSize * 4);
+        for (uint32_t y = 0; y < texSize; y++)
+        {
+            for (uint32_t x = 0; x < texSize; x++)
+            {
+                uint8_t* pTexel = &texels[(static_cast<size_t>(y) * texSize + x) * 4];
+                pTexel[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(x * 255 / texSize) + noiseDist(rng), 0, 255));
+                pTexel[1] = static_cast<uint8_t>(std::clamp(static_cast<int>(y * 255 / texSize) + noiseDist(rng), 0, 255));
+                pTexel[2] = static_cast<uint8_t>(std::clamp(224 + noiseDist(rng), 0, 255));
+                pTexel[3] = 255;
+            }
+        }
+        return texels;
+    }
+
+    // ============================================================================================================
+    void RunTextureBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t TexSize = 2048;
+        const uint32_t mipCnt = CalcMipLevelCnt(TexSize, TexSize);
+        const std::vector<uint8_t> level0 = MakeNoisyGradientTexture(TexSize);
+
+        std::vector<uint8_t> mipChain;
+        mipChain.reserve(CalcMipChainBytes(TexSize, TexSize, mipCnt));
+
+        struct MipCase
+        {
+            const char* pName;
+            MipContent  content;
+            MipFilter   filter;
+        };
+        const MipCase mipCases[] = { { "box_linear", MipContent::Linear, MipFilter::Box },
+                                     { "box_srgb", MipContent::SRgb, MipFilter::Box },
+                                     { "box_normal", MipContent::Normal, MipFilter::Box },
+                                     { "kaiser_srgb", MipContent::SRgb, MipFilter::Kaiser } };
+
+        // The item is a level 0 pixel.
+        for (bool useJobs : { false, true })
+        {
+            if (useJobs)
+            {
+                JobSystem::Create();
+            }
+            const std::string threadStr = useJobs ? "all_threads" : "1_thread";
+            for (const MipCase& mipCase : mipCases)
+            {
+                MipGenDesc desc;
+                desc.content = mipCase.content;
+                desc.filter = mipCase.filter;
+                const std::string name = std::string("texture/gen_mips_") + mipCase.pName + "_2k_" + threadStr;
+                runner.Run(name, static_cast<uint64_t>(TexSize) * TexSize, [&]()
+                {
+                    mipChain.assign(level0.begin(), level0.end());
+                    DoNotOptimize(GenerateMipChain(mipChain, TexSize, TexSize, desc));
+                });
+                PrintMPixelsPerSec(runner, name);
+            }
+            if (useJobs)
+            {
+                JobSystem::Destroy();
+            }
+        }
+
+        // The content hash of the texture cache runs over every uploaded chain, and must stay well below the upload cost.
+        // The item is a byte.
+        mipChain.assign(level0.begin(), level0.end());
+        GenerateMipChain(mipChain, TexSize, TexSize, MipGenDesc());
+        const std::string hashName = "texture/hash_mip_chain_2k";
+        runner.Run(hashName, mipChain.size(), [&]()
+        {
+            DoNotOptimize(HashTextureData(mipChain.data(), mipChain.size(), 0));
+        });
+        const BenchmarkResult* pHashResult = FindResult(runner, hashName);
+        if (pHashResult != nullptr)
+        {
+            std::cout << "    " << pHashResult->itemCnt / pHashResult->p50Ns << " GB/s" << std::endl;
+        }
+
+        // A surface minified 8x, sampled with the 2x2 bilinear footprints. From the level 0 the footprints of the
+        // neighbor pixels are 8 texels apart, so nearly every one pulls in its own cache lines. The level 3 is the
+        // one a mip sampler picks, where the neighbors share the lines.
+        constexpr uint32_t MinifyScale = 8;
+        constexpr uint32_t MinifyLevel = 3;
+        constexpr uint32_t ScreenSize = TexSize / MinifyScale;
+        constexpr uint32_t CacheLineBytes = 64;
+        mipChain.assign(level0.begin(), level0.end());
+        GenerateMipChain(mipChain, TexSize, TexSize, MipGenDesc());
+        for (uint32_t level : { 0u, MinifyLevel })
+        {
+            const uint8_t* pLevel = mipChain.data() + CalcMipChainBytes(TexSize, TexSize, level);
+            const uint32_t levelSize = TexSize >> level;
+            const uint32_t texelStep = MinifyScale >> level;
+            auto footprintOffset = [=](uint32_t x, uint32_t y, uint32_t corner)
+            {
+                const uint32_t texX = std::min(x * texelStep + (corner & 1), levelSize - 1);
+                const uint32_t texY = std::min(y * texelStep + (corner >> 1), levelSize - 1);
+                return (static_cast<size_t>(texY) * levelSize + texX) * 4;
+            };
+
+            std::vector<bool> touchedLines(static_cast<size_t>(levelSize) * levelSize * 4 / CacheLineBytes, false);
+            uint64_t touchedLineCnt = 0;
+            for (uint32_t y = 0; y < ScreenSize; y++)
+            {
+                for (uint32_t x = 0; x < ScreenSize; x++)
+                {
+                    for (uint32_t corner = 0; corner < 4; corner++)
+                    {
+                        const size_t line = footprintOffset(x, y, corner) / CacheLineBytes;
+                        touchedLineCnt += touchedLines[line] ? 0 : 1;
+                        touchedLines[line] = true;
+                    }
+                }
+            }
+
+            const std::string name = "texture/sample_minified_8x_level" + std::to_string(level);
+            runner.Run(name, static_cast<uint64_t>(ScreenSize) * ScreenSize, [&]()
+            {
+                uint64_t sum = 0;
+                for (uint32_t y = 0; y < ScreenSize; y++)
+                {
+                    for (uint32_t x = 0; x < ScreenSize; x++)
+                    {
+                        for (uint32_t corner = 0; corner < 4; corner++)
+                        {
+                            sum += pLevel[footprintOffset(x, y, corner)];
+                        }
+                    }
+                }
+                DoNotOptimize(sum);
+            });
+            std::cout << "    " << touchedLineCnt * CacheLineBytes / 1024 << " KB of cache lines fetched per frame" << std::endl;
+        }
+    }
+
+    // ============================================================================================================
+    void RunBlockCompressionBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t TexSize = 1024;
+        const std::vector<uint8_t> texels = MakeNoisyGradientTexture(TexSize);
+        std::vector<uint8_t> blocks;
+        std::vector<uint8_t> decoded;
+
+        // The floors are about 1.5 dB under what the encoders reach on this texture, so a regression fails the run.
+        struct CompressCase
+        {
+            const char*       pName;
+            BlockCompressDesc desc;
+            double            minPsnr;
+        };
+        const CompressCase compressCases[] = { { "bc1", { BlockFormat::BC1 }, 26.5 },
+                                               { "bc3", { BlockFormat::BC3 }, 28.0 },
+                                               { "bc4", { BlockFormat::BC4 }, 42.0 },
+                                               { "bc5", { BlockFormat::BC5 }, 42.0 },
+                                               { "bc7", { BlockFormat::BC7 }, 28.5 } };
+
+        // The item is a pixel. The PSNR is over the channels the format keeps.
+        for (bool useJobs : { false, true })
+        {
+            if (useJobs)
+            {
+                JobSystem::Create();
+            }
+            const std::string threadStr = useJobs ? "all_threads" : "1_thread";
+            for (const CompressCase& compressCase : compressCases)
+            {
+                const std::string name = std::string("texture/compress_") + compressCase.pName + "_1k_" + threadStr;
+                blocks.clear();
+                runner.Run(name, static_cast<uint64_t>(TexSize) * TexSize, [&]()
+                {
+                    CompressMipChain(texels.data(), TexSize, TexSize, 1, compressCase.desc, blocks);
+                    DoNotOptimize(blocks[0]);
+                });
+                PrintMPixelsPerSec(runner, name);
+
+                // Checked even when the filter skipped the timing.
+                if (!useJobs)
+                {
+                    if (blocks.empty())
+                    {
+                        CompressMipChain(texels.data(), TexSize, TexSize, 1, compressCase.desc, blocks);
+                    }
+                    DecompressMipChain(blocks.data(), TexSize, TexSize, 1, compressCase.desc, decoded);
+                    const double psnr = CalcPsnr(texels.data(), decoded.data(), static_cast<uint64_t>(TexSize) * TexSize,
+                                                 GetBlockChannelMask(compressCase.desc));
+                    std::cout << "    " << psnr << " dB PSNR, " << blocks.size() / 1024 << " KB from " << texels.size() / 1024
+                              << " KB" << std::endl;
+                    if (psnr < compressCase.minPsnr)
+                    {
+                        std::cerr << name << ": " << psnr << " dB PSNR is under the " << compressCase.minPsnr << " dB floor" << std::endl;
+                        std::abort();
+                    }
+                }
+            }
+            if (useJobs)
+            {
+                JobSystem::Destroy();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void RunTextureContainerBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+    {
+        std::vector<fs::path> imagePaths = CollectFiles(assetRootPath, ".png");
+        const std::vector<fs::path> jpgPaths = CollectFiles(assetRootPath, ".jpg");
+        imagePaths.insert(imagePaths.end(), jpgPaths.begin(), jpgPaths.end());
+
+        // Bake every sample image once into a DDS, the way an offline texture pipeline would. The BC7 needs the 4
+        // multiple sizes, and the rest stay R8G8B8A8.
+        const fs::path bakeDir = fs::temp_directory_path() / "DX12MiniRendererBenchmark";
+        std::error_code dirErr;
+        fs::create_directories(bakeDir, dirErr);
+
+        std::vector<std::string> encodedImages;
+        std::vector<std::string> ddsPaths;
+        uint64_t srcPixCnt = 0;
+        const auto bakeStartTime = std::chrono::high_resolution_clock::now();
+        for (const fs::path& imagePath : imagePaths)
+        {
+            std::ifstream imageFile(imagePath, std::ios::binary);
+            std::stringstream imageBytes;
+            imageBytes << imageFile.rdbuf();
+
+            int width = 0;
+            int height = 0;
+            int componentCnt = 0;
+            const std::string encoded = imageBytes.str();
+            stbi_uc* pPixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()), static_cast<int>(encoded.size()),
+                                                     &width, &height, &componentCnt, 4);
+            if (pPixels == nullptr)
+            {
+                continue;
+            }
+            std::vector<uint8_t> texels(pPixels, pPixels + static_cast<size_t>(width) * height * 4);
+            stbi_image_free(pPixels);
+
+            const uint32_t mipCnt = GenerateMipChain(texels, width, height, MipGenDesc());
+            BlockFormat format = BlockFormat::None;
+            if (width % 4 == 0 && height % 4 == 0)
+            {
+                format = BlockFormat::BC7;
+                std::vector<uint8_t> blocks;
+                CompressMipChain(texels.data(), width, height, mipCnt, { format }, blocks);
+                texels.swap(blocks);
+            }
+
+            const std::string ddsPath = (bakeDir / imagePath.filename()).replace_extension(".dds").string();
+            if (WriteDdsFile(ddsPath, texels.data(), width, height, mipCnt, format))
+            {
+                encodedImages.push_back(encoded);
+                ddsPaths.push_back(ddsPath);
+                srcPixCnt += static_cast<uint64_t>(width) * height;
+            }
+        }
+
+        if (ddsPaths.empty())
+        {
+            std::cout << "No PNG/JPEG under " << assetRootPath << ". Skip the texture container benchmarks." << std::endl;
+            return;
+        }
+        const double bakeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - bakeStartTime).count();
+        std::cout << "Baked " << ddsPaths.size() << " sample images into DDS files in " << bakeMs << " ms." << std::endl;
+
+        // The loader path of a PNG/JPEG texture up to the upload: decode and generate the mips.
+        const std::string decodeName = "texture/sample_images_png_decode_mips";
+        runner.Run(decodeName, srcPixCnt, [&]()
+        {
+            for (const std::string& encoded : encodedImages)
+            {
+                int width = 0;
+                int height = 0;
+                int componentCnt = 0;
+                stbi_uc* pPixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encoded.data()), static_cast<int>(encoded.size()),
+                                                         &width, &height, &componentCnt, 4);
+                std::vector<uint8_t> texels(pPixels, pPixels + static_cast<size_t>(width) * height * 4);
+                stbi_image_free(pPixels);
+                GenerateMipChain(texels, width, height, MipGenDesc());
+                DoNotOptimize(texels[0]);
+            }
+        });
+        PrintMPixelsPerSec(runner, decodeName);
+
+        // The container path: map the file and copy the levels once, like the upload buffer copy does.
+        std::vector<uint8_t> stagingBuffer;
+        const std::string mappedName = "texture/sample_images_dds_mapped";
+        runner.Run(mappedName, srcPixCnt, [&]()
+        {
+            for (const std::string& ddsPath : ddsPaths)
+            {
+                std::string err;
+                const std::shared_ptr<TextureContainer> pContainer = OpenTextureContainer(ddsPath, err);
+                uint64_t offset = 0;
+                for (const TextureContainerLevel& level : pContainer->levels)
+                {
+                    if (stagingBuffer.size() < offset + level.bytes)
+                    {
+                        stagingBuffer.resize(offset + level.bytes);
+                    }
+                    memcpy(stagingBuffer.data() + offset, level.pData, level.bytes);
+                    offset += level.bytes;
+                }
+                DoNotOptimize(stagingBuffer[0]);
+            }
+        });
+        PrintMPixelsPerSec(runner, mappedName);
+
+        const BenchmarkResult* pDecodeResult = FindResult(runner, decodeName);
+        const BenchmarkResult* pMappedResult = FindResult(runner, mappedName);
+        if (pDecodeResult != nullptr && pMappedResult != nullptr)
+        {
+            std::cout << "    " << pDecodeResult->p50Ns / pMappedResult->p50Ns << "x faster than the PNG/JPEG path" << std::endl;
+        }
+
+        for (const std::string& ddsPath : ddsPaths)
+        {
+            fs::remove(ddsPath, dirErr);
+        }
+    }
+}
+
+// ================================================================================================================
+void MakeUvSphere(uint32_t ringCnt, uint32_t segmentCnt, std::vector<float>& oPosData, std::vector<uint32_t>& oIndices)
+{
+    constexpr float Pi = 3.14159265f;
+    oPosData.clear();
+    oPosData.reserve((ringCnt + 1) * (segmentCnt + 1) * 3);
+    for (uint32_t ring = 0; ring <= ringCnt; ring++)
+    {
+        for (uint32_t segment = 0; segment <= segmentCnt; segment++)
+        {
+            const float theta = Pi * ring / ringCnt;
+            const float phi = 2.0f * Pi * segment / segmentCnt;
+            oPosData.push_back(sinf(theta) * cosf(phi));
+            oPosData.push_back(cosf(theta));
+            oPosData.push_back(sinf(theta) * sinf(phi));
+        }
+    }
+
+    oIndices.resize(ringCnt * segmentCnt * 6);
+    for (uint32_t quad = 0; quad < ringCnt * segmentCnt; quad++)
+    {
+        const uint32_t v0 = (quad / segmentCnt) * (segmentCnt + 1) + quad % segmentCnt;
+        const uint32_t v2 = v0 + segmentCnt + 1;
+        const uint32_t quadIndices[6] = { v0, v2, v0 + 1, v0 + 1, v2, v2 + 1 };
+        memcpy(&oIndices[quad * 6], quadIndices, sizeof(quadIndices));
+    }
+}
+
+// ================================================================================================================
+void RunAssetBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath)
+{
+    RunYamlBenchmarks(runner, assetRootPath);
+    RunGltfBenchmarks(runner, assetRootPath);
+    RunGltfNodeBenchmarks(runner);
+    RunInterleaveBenchmarks(runner);
+    RunMeshOptimizeBenchmarks(runner);
+    RunMeshSimplifyBenchmarks(runner, assetRootPath);
+    RunMeshletBenchmarks(runner, assetRootPath);
+    RunNormalBenchmarks(runner, assetRootPath);
+    RunTangentBenchmarks(runner, assetRootPath);
+    RunCompactVertexBenchmarks(runner);
+    RunTextureBenchmarks(runner);
+    RunBlockCompressionBenchmarks(runner);
+    RunTextureContainerBenchmarks(runner, assetRootPath);
+}
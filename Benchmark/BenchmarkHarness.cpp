@@ -0,0 +1,190 @@
+#include "BenchmarkHarness.h"
+#include "yaml-cpp/yaml.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+volatile uint64_t g_benchmarkSink = 0;
+
+namespace
+{
+    // Nearest rank percentile of the sorted samples.
+    double Percentile(const std::vector<double>& sortedSamples, double percent)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(sortedSamples.size())));
+        return sortedSamples[std::clamp(rank, static_cast<size_t>(1), sortedSamples.size()) - 1];
+    }
+
+    std::string JsonEscape(const std::string& str)
+    {
+        std::string escaped;
+        for (char c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+// ================================================================================================================
+BenchmarkRunner::BenchmarkRunner(uint32_t warmupCnt, uint32_t sampleCnt, const std::string& filter)
+    : m_warmupCnt(warmupCnt),
+      m_sampleCnt(std::max(sampleCnt, 1u)),
+      m_filter(filter)
+{
+}
+
+// ================================================================================================================
+void BenchmarkRunner::Run(const std::string& name, uint64_t itemCnt, const std::function<void()>& func)
+{
+    if (!m_filter.empty() && name.find(m_filter) == std::string::npos)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_warmupCnt; i++)
+    {
+        func();
+    }
+
+    std::vector<double> samples(m_sampleCnt);
+    for (uint32_t i = 0; i < m_sampleCnt; i++)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        func();
+        auto endTime = std::chrono::steady_clock::now();
+        samples[i] = std::chrono::duration<double, std::nano>(endTime - startTime).count();
+    }
+
+    double sum = 0.0;
+    for (double sample : samples)
+    {
+        sum += sample;
+    }
+    const double mean = sum / static_cast<double>(m_sampleCnt);
+
+    double variance = 0.0;
+    for (double sample : samples)
+    {
+        variance += (sample - mean) * (sample - mean);
+    }
+    variance /= static_cast<double>(m_sampleCnt);
+
+    std::sort(samples.begin(), samples.end());
+
+    BenchmarkResult result;
+    result.name = name;
+    result.sampleCnt = m_sampleCnt;
+    result.itemCnt = std::max(itemCnt, static_cast<uint64_t>(1));
+    result.minNs = samples.front();
+    result.meanNs = mean;
+    result.p50Ns = Percentile(samples, 50.0);
+    result.p90Ns = Percentile(samples, 90.0);
+    result.p99Ns = Percentile(samples, 99.0);
+    result.maxNs = samples.back();
+    result.stdDevNs = std::sqrt(variance);
+    m_results.push_back(result);
+
+    printf("%-48s p50 %12.1f ns  p99 %12.1f ns  %10.2f ns/item\n", name.c_str(), result.p50Ns, result.p99Ns,
+           result.p50Ns / static_cast<double>(result.itemCnt));
+}
+
+// ================================================================================================================
+void BenchmarkRunner::PrintSummary(std::ostream& os) const
+{
+    os << m_results.size() << " benchmarks, " << m_sampleCnt << " samples each.\n";
+}
+
+// ================================================================================================================
+void BenchmarkRunner::WriteJson(std::ostream& os) const
+{
+#if defined(_MSC_VER)
+    const std::string compiler = "MSVC " + std::to_string(_MSC_VER);
+#elif defined(__clang__)
+    const std::string compiler = "Clang " + std::to_string(__clang_major__) + "." + std::to_string(__clang_minor__);
+#elif defined(__GNUC__)
+    const std::string compiler = "GCC " + std::to_string(__GNUC__) + "." + std::to_string(__GNUC_MINOR__);
+#else
+    const std::string compiler = "Unknown";
+#endif
+
+#if defined(NDEBUG)
+    const char* pBuildType = "Release";
+#else
+    const char* pBuildType = "Debug";
+#endif
+
+    os << "{\n";
+    os << "  \"schemaVersion\": 1,\n";
+    os << "  \"compiler\": \"" << JsonEscape(compiler) << "\",\n";
+    os << "  \"buildType\": \"" << pBuildType << "\",\n";
+    os << "  \"warmupCnt\": " << m_warmupCnt << ",\n";
+    os << "  \"sampleCnt\": " << m_sampleCnt << ",\n";
+    os << "  \"results\": [";
+
+    char numberBuffer[64];
+    auto toStr = [&numberBuffer](double value) -> const char*
+    {
+        snprintf(numberBuffer, sizeof(numberBuffer), "%.1f", value);
+        return numberBuffer;
+    };
+
+    for (uint32_t i = 0; i < m_results.size(); i++)
+    {
+        const BenchmarkResult& result = m_results[i];
+        os << (i == 0 ? "\n" : ",\n");
+        os << "    {\"name\": \"" << JsonEscape(result.name) << "\", \"samples\": " << result.sampleCnt << ", \"items\": " << result.itemCnt;
+        os << ", \"minNs\": " << toStr(result.minNs);
+        os << ", \"meanNs\": " << toStr(result.meanNs);
+        os << ", \"p50Ns\": " << toStr(result.p50Ns);
+        os << ", \"p90Ns\": " << toStr(result.p90Ns);
+        os << ", \"p99Ns\": " << toStr(result.p99Ns);
+        os << ", \"maxNs\": " << toStr(result.maxNs);
+        os << ", \"stdDevNs\": " << toStr(result.stdDevNs);
+        os << ", \"p50NsPerItem\": " << toStr(result.p50Ns / static_cast<double>(result.itemCnt)) << "}";
+    }
+    os << "\n  ]\n}\n";
+}
+
+// ================================================================================================================
+void BenchmarkRunner::PrintBaselineDiff(const std::string& baselineJsonPath, std::ostream& os) const
+{
+    // JSON is a subset of the YAML flow style, so the yaml-cpp already used by the scene loader can read it.
+    std::unordered_map<std::string, double> baselineP50s;
+    try
+    {
+        YAML::Node baseline = YAML::LoadFile(baselineJsonPath);
+        for (const auto& result : baseline["results"])
+        {
+            baselineP50s[result["name"].as<std::string>()] = result["p50Ns"].as<double>();
+        }
+    }
+    catch (const YAML::Exception& e)
+    {
+        os << "Cannot read the baseline " << baselineJsonPath << ": " << e.what() << "\n";
+        return;
+    }
+
+    os << "p50 change against " << baselineJsonPath << ":\n";
+    for (const BenchmarkResult& result : m_results)
+    {
+        auto itr = baselineP50s.find(result.name);
+        char line[256];
+        if (itr == baselineP50s.end() || itr->second <= 0.0)
+        {
+            snprintf(line, sizeof(line), "  %-48s new\n", result.name.c_str());
+        }
+        else
+        {
+            const double change = (result.p50Ns - itr->second) / itr->second * 100.0;
+            snprintf(line, sizeof(line), "  %-48s %+7.1f%%\n", result.name.c_str(), change);
+        }
+        os << line;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+
+// Headless benchmark harness. Every benchmark runs a fixed number of warm up and measured samples, so two runs on
+// the same machine do the same work and their results can be diffed.
+
+struct BenchmarkResult
+{
+    std::string name;
+    uint32_t    sampleCnt;
+    uint64_t    itemCnt; // Work items per sample. E.g. hashed strings or sorted keys.
+    double      minNs;
+    double      meanNs;
+    double      p50Ns;
+    double      p90Ns;
+    double      p99Ns;
+    double      maxNs;
+    double      stdDevNs;
+};
+
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner(uint32_t warmupCnt, uint32_t sampleCnt, const std::string& filter);
+    ~BenchmarkRunner() {}
+
+    // Times each call of func as one sample. Skipped if the name doesn't contain the filter.
+    void Run(const std::string& name, uint64_t itemCnt, const std::function<void()>& func);
+
+    const std::vector<BenchmarkResult>& GetResults() const { return m_results; }
+
+    void PrintSummary(std::ostream& os) const;
+    void WriteJson(std::ostream& os) const;
+
+    // Prints the p50 change of each benchmark against a JSON file written by a previous run.
+    void PrintBaselineDiff(const std::string& baselineJsonPath, std::ostream& os) const;
+
+private:
+    uint32_t                     m_warmupCnt;
+    uint32_t                     m_sampleCnt;
+    std::string                  m_filter;
+    std::vector<BenchmarkResult> m_results;
+};
+
+// Keeps the compiler from removing the benchmarked work whose result is otherwise unused.
+extern volatile uint64_t g_benchmarkSink;
+inline void DoNotOptimize(uint64_t value) { g_benchmarkSink = g_benchmarkSink + value; }
+
+// A UV sphere of radius 1 for the mesh and the culling benchmarks. The poles and the seam have a vertex per segment,
+// like an exported one.
+void MakeUvSphere(uint32_t ringCnt, uint32_t segmentCnt, std::vector<float>& oPosData, std::vector<uint32_t>& oIndices);
+
+// The benchmark suites. Each file registers its benchmarks into the runner.
+void RunCoreBenchmarks(BenchmarkRunner& runner);
+void RunAssetBenchmarks(BenchmarkRunner& runner, const std::string& assetRootPath);
+void RunRenderBenchmarks(BenchmarkRunner& runner);
@@ -0,0 +1,61 @@
+#include "BenchmarkHarness.h"
+#include "../ThirdParty/arg/args.hxx"
+#include <fstream>
+#include <iostream>
+
+int main(int argc, char** argv)
+{
+    args::ArgumentParser parser("DX12 Mini-Renderer headless benchmarks of the CPU side subsystems.",
+                                "E.g. DX12MiniRendererBenchmark --out base.json, then DX12MiniRendererBenchmark --baseline base.json");
+    args::HelpFlag help(parser, "help", "Display this help menu", { 'h', "help" });
+    args::ValueFlag<std::string> inputFilter(parser, "", "Only run the benchmarks whose name contains this string.", { 'f', "filter" });
+    args::ValueFlag<std::string> inputOutPath(parser, "", "Write the results as JSON into this file.", { 'o', "out" });
+    args::ValueFlag<std::string> inputBaselinePath(parser, "", "Compare the results with a JSON file from a previous run.", { 'b', "baseline" });
+    args::ValueFlag<int> inputSampleCnt(parser, "", "Measured samples per benchmark. Default 50.", { 's', "samples" });
+    args::ValueFlag<int> inputWarmupCnt(parser, "", "Warm up samples per benchmark. Default 3.", { 'w', "warmup" });
+    args::ValueFlag<std::string> inputAssetPath(parser, "", "The sample scene folder. Default is the one in the source tree.", { 'a', "assets" });
+
+    try
+    {
+        parser.ParseCLI(argc, argv);
+    }
+    catch (const args::Help&)
+    {
+        std::cout << parser;
+        return 0;
+    }
+    catch (const args::ParseError& e)
+    {
+        std::cerr << e.what() << std::endl;
+        std::cerr << parser;
+        return 1;
+    }
+
+    const uint32_t sampleCnt = (inputSampleCnt && inputSampleCnt.Get() > 0) ? static_cast<uint32_t>(inputSampleCnt.Get()) : 50;
+    const uint32_t warmupCnt = (inputWarmupCnt && inputWarmupCnt.Get() >= 0) ? static_cast<uint32_t>(inputWarmupCnt.Get()) : 3;
+    std::string assetRootPath = inputAssetPath ? inputAssetPath.Get() : std::string(SOURCE_PATH) + "/Assets/SampleScene/GLTFs";
+
+    BenchmarkRunner runner(warmupCnt, sampleCnt, inputFilter ? inputFilter.Get() : "");
+    RunCoreBenchmarks(runner);
+    RunAssetBenchmarks(runner, assetRootPath);
+    RunRenderBenchmarks(runner);
+    runner.PrintSummary(std::cout);
+
+    if (inputOutPath)
+    {
+        std::ofstream outFile(inputOutPath.Get(), std::ios::out | std::ios::trunc);
+        if (!outFile.is_open())
+        {
+            std::cerr << "Cannot open " << inputOutPath.Get() << std::endl;
+            return 1;
+        }
+        runner.WriteJson(outFile);
+    }
+
+    if (inputBaselinePath)
+    {
+        runner.PrintBaselineDiff(inputBaselinePath.Get(), std::cout);
+    }
+
+    return 0;
+}
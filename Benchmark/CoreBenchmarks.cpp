@@ -0,0 +1,740 @@
+#include "BenchmarkHarness.h"
+#include "../Utils/crc32.h"
+#include "../Utils/MathUtils.h"
+#include "../EventSystem/EventManager.h"
+#include "../RenderBackend/RenderQueue.h"
+#include "../Utils/FrameArena.h"
+#include "../JobSystem/JobSystem.h"
+#include "../TimePerfManager/GpuTimestampQueryPool.h"
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <random>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    constexpr uint32_t RandomSeed = 20240731;
+
+    // ============================================================================================================
+    // The event system before the typed events. Kept here only as the comparison point of the event dispatch.
+    namespace LegacyEventSystem
+    {
+        typedef std::unordered_map<size_t, std::any> HEventArguments;
+        typedef void(*EventCallbackFuncPtr) (HEventArguments args);
+
+        class HEvent
+        {
+        public:
+            HEvent(const HEventArguments& arg, const std::string& type) : m_arg(arg), m_typeHash(crc32(type.data())) {}
+            size_t GetEventType() const { return m_typeHash; }
+            HEventArguments& GetArgs() { return m_arg; }
+
+        private:
+            HEventArguments m_arg;
+            size_t m_typeHash;
+        };
+
+        class HEventManager
+        {
+        public:
+            void RegisterListener(const std::string& type, EventCallbackFuncPtr listenFunc)
+            {
+                m_eventListenerMap[crc32(type.data())].push_back(listenFunc);
+            }
+
+            void SendEvent(HEvent& hEvent)
+            {
+                if (m_eventListenerMap.find(hEvent.GetEventType()) != m_eventListenerMap.end())
+                {
+                    for (auto& itr : m_eventListenerMap[hEvent.GetEventType()])
+                    {
+                        itr(hEvent.GetArgs());
+                    }
+                }
+            }
+
+        private:
+            std::unordered_map<size_t, std::list<EventCallbackFuncPtr>> m_eventListenerMap;
+        };
+    }
+
+    struct BenchmarkResizeEvent
+    {
+        static constexpr uint32_t TypeId = crc32("BenchmarkResize");
+        uint32_t width;
+        uint32_t height;
+    };
+
+    struct BenchmarkCoalescedEvent
+    {
+        static constexpr uint32_t TypeId = crc32("BenchmarkCoalesced");
+        static constexpr bool Coalesce = true;
+        uint32_t value;
+    };
+
+    // Posted by the stress producers. The sequence restarts from 0 for each producer.
+    struct BenchmarkSequenceEvent
+    {
+        static constexpr uint32_t TypeId = crc32("BenchmarkSequence");
+        uint32_t producerIdx;
+        uint32_t sequence;
+    };
+
+    std::atomic<uint64_t> g_receivedEventCnt(0);
+
+    // Written by the listeners on the dispatching thread only.
+    constexpr uint32_t MaxStressProducerCnt = 8;
+    constexpr uint32_t StressTimeoutSec = 10; // The stress wait aborts after this instead of hanging on a lost event.
+    uint32_t g_nextSequences[MaxStressProducerCnt] = {};
+    uint32_t g_outOfOrderEventCnt = 0;
+    uint32_t g_resizeDispatchCnt = 0;
+    ResizeSwapchainEvent g_lastResize = {};
+
+    void OnTypedResize(const BenchmarkResizeEvent& event)
+    {
+        g_receivedEventCnt.store(g_receivedEventCnt.load(std::memory_order_relaxed) + event.width + event.height, std::memory_order_relaxed);
+    }
+
+    void OnCoalesced(const BenchmarkCoalescedEvent& event)
+    {
+        DoNotOptimize(event.value);
+    }
+
+    void OnSequence(const BenchmarkSequenceEvent& event)
+    {
+        if (event.sequence != g_nextSequences[event.producerIdx])
+        {
+            g_outOfOrderEventCnt++;
+        }
+        g_nextSequences[event.producerIdx] = event.sequence + 1;
+        g_receivedEventCnt.store(g_receivedEventCnt.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void OnResize(const ResizeSwapchainEvent& event)
+    {
+        g_resizeDispatchCnt++;
+        g_lastResize = event;
+    }
+
+    // Registered on BenchmarkResizeEvent. Swaps itself for OnTypedResize in the middle of a dispatch.
+    HEventManager* g_pReentrantEventManager = nullptr;
+    void OnReentrantResize(const BenchmarkResizeEvent& event)
+    {
+        g_pReentrantEventManager->UnregisterListener<BenchmarkResizeEvent>(OnReentrantResize);
+        g_pReentrantEventManager->RegisterListener<BenchmarkResizeEvent>(OnTypedResize);
+        g_pReentrantEventManager->RegisterListener<BenchmarkResizeEvent>(OnTypedResize);
+        OnTypedResize(event);
+    }
+
+    void OnLegacyResize(LegacyEventSystem::HEventArguments args)
+    {
+        const uint32_t width = std::any_cast<uint32_t>(args[crc32("width")]);
+        const uint32_t height = std::any_cast<uint32_t>(args[crc32("height")]);
+        g_receivedEventCnt.store(g_receivedEventCnt.load(std::memory_order_relaxed) + width + height, std::memory_order_relaxed);
+    }
+
+    // ============================================================================================================
+    void RunCrc32Benchmarks(BenchmarkRunner& runner)
+    {
+        std::mt19937 rng(RandomSeed);
+        std::uniform_int_distribution<int> lengthDist(8, 64);
+        std::uniform_int_distribution<int> charDist('a', 'z');
+        std::vector<std::string> strs(1024);
+        for (std::string& str : strs)
+        {
+            str.resize(lengthDist(rng));
+            for (char& c : str)
+            {
+                c = static_cast<char>(charDist(rng));
+            }
+        }
+
+        runner.Run("crc32/runtime_strings_8_64", strs.size(), [&strs]()
+        {
+            uint64_t hashSum = 0;
+            for (const std::string& str : strs)
+            {
+                hashSum += crc32(str.c_str());
+            }
+            DoNotOptimize(hashSum);
+        });
+    }
+
+    // ============================================================================================================
+    void RunMathBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t MatCnt = 4096;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> valueDist(-1.f, 1.f);
+        std::vector<float> mats(MatCnt * 16);
+        std::vector<float> vecs(MatCnt * 4);
+        for (float& value : mats) { value = valueDist(rng); }
+        for (float& value : vecs) { value = valueDist(rng); }
+        std::vector<float> results(MatCnt * 16);
+
+        runner.Run("math/MatrixMul4x4", MatCnt - 1, [&]()
+        {
+            for (uint32_t i = 0; i < MatCnt - 1; i++)
+            {
+                MatrixMul4x4(&mats[i * 16], &mats[(i + 1) * 16], &results[i * 16]);
+            }
+            DoNotOptimize(static_cast<uint64_t>(results[0]));
+        });
+
+        runner.Run("math/MatMulVec4", MatCnt, [&]()
+        {
+            for (uint32_t i = 0; i < MatCnt; i++)
+            {
+                MatMulVec(&mats[i * 16], &vecs[i * 4], 4, &results[i * 4]);
+            }
+            DoNotOptimize(static_cast<uint64_t>(results[0]));
+        });
+
+        runner.Run("math/GenModelMat", MatCnt, [&]()
+        {
+            for (uint32_t i = 0; i < MatCnt; i++)
+            {
+                float scale[3] = { 1.f, 1.f, 1.f };
+                GenModelMat(&vecs[i * 4], vecs[i * 4], vecs[i * 4 + 1], vecs[i * 4 + 2], scale, &results[(i % (MatCnt / 16)) * 16]);
+            }
+            DoNotOptimize(static_cast<uint64_t>(results[0]));
+        });
+
+        runner.Run("math/CameraViewProj", MatCnt, [&]()
+        {
+            for (uint32_t i = 0; i < MatCnt; i++)
+            {
+                float view[3] = { vecs[i * 4], vecs[i * 4 + 1], 1.f };
+                float pos[3] = { vecs[i * 4 + 2], vecs[i * 4 + 3], -5.f };
+                float up[3] = { 0.f, 1.f, 0.f };
+                float viewMat[16], projMat[16];
+                NormalizeVec(view, 3);
+                GenViewMat(view, pos, up, viewMat);
+                GenPerspectiveProjMat(0.1f, 100.f, 1.f, 0.5625f, projMat);
+                MatrixMul4x4(projMat, viewMat, &results[(i % (MatCnt / 16)) * 16]);
+            }
+            DoNotOptimize(static_cast<uint64_t>(results[0]));
+        });
+    }
+
+    // ============================================================================================================
+    void RunEventBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t SendCnt = 10000;
+        constexpr uint32_t ListenerCnt = 4;
+
+        HEventManager eventManager;
+        for (uint32_t i = 0; i < ListenerCnt; i++)
+        {
+            eventManager.RegisterListener<BenchmarkResizeEvent>(OnTypedResize);
+        }
+        eventManager.RegisterListener<BenchmarkCoalescedEvent>(OnCoalesced);
+
+        LegacyEventSystem::HEventManager legacyEventManager;
+        for (uint32_t i = 0; i < ListenerCnt; i++)
+        {
+            legacyEventManager.RegisterListener("BenchmarkResize", OnLegacyResize);
+        }
+
+        runner.Run("events/send_typed_4_listeners", SendCnt, [&eventManager]()
+        {
+            for (uint32_t i = 0; i < SendCnt; i++)
+            {
+                eventManager.SendEvent(BenchmarkResizeEvent{ i, i + 1 });
+            }
+        });
+
+        // Builds the arguments per send like the callers of the old system did.
+        runner.Run("events/send_legacy_any_4_listeners", SendCnt, [&legacyEventManager]()
+        {
+            for (uint32_t i = 0; i < SendCnt; i++)
+            {
+                LegacyEventSystem::HEventArguments args;
+                args[crc32("width")] = i;
+                args[crc32("height")] = i + 1;
+                LegacyEventSystem::HEvent event(args, "BenchmarkResize");
+                legacyEventManager.SendEvent(event);
+            }
+        });
+
+        constexpr uint32_t PostCnt = HEventManager::POSTED_EVENT_QUEUE_CAPACITY;
+        runner.Run("events/post_and_dispatch_1024", PostCnt, [&eventManager]()
+        {
+            for (uint32_t i = 0; i < PostCnt; i++)
+            {
+                if (i % 2 == 0)
+                {
+                    eventManager.PostEvent(BenchmarkResizeEvent{ i, i });
+                }
+                else
+                {
+                    eventManager.PostEvent(BenchmarkCoalescedEvent{ i });
+                }
+            }
+            eventManager.DispatchPostedEvents();
+        });
+
+        // 8 producers post while the main thread keeps dispatching, like the worker threads posting to the main loop.
+        // Each producer's events must arrive in its posting order.
+        constexpr uint32_t ProducerCnt = MaxStressProducerCnt;
+        constexpr uint32_t PostPerProducer = 5000;
+        HEventManager stressEventManager;
+        stressEventManager.RegisterListener<BenchmarkSequenceEvent>(OnSequence);
+        runner.Run("events/mpsc_stress_8_producers", ProducerCnt * PostPerProducer, [&stressEventManager]()
+        {
+            g_receivedEventCnt.store(0, std::memory_order_relaxed);
+            std::fill(std::begin(g_nextSequences), std::end(g_nextSequences), 0);
+            g_outOfOrderEventCnt = 0;
+
+            std::atomic<uint32_t> finishedProducerCnt(0);
+            std::vector<std::thread> producers;
+            for (uint32_t producerIdx = 0; producerIdx < ProducerCnt; producerIdx++)
+            {
+                producers.emplace_back([&stressEventManager, &finishedProducerCnt, producerIdx]()
+                {
+                    for (uint32_t i = 0; i < PostPerProducer; i++)
+                    {
+                        while (!stressEventManager.PostEvent(BenchmarkSequenceEvent{ producerIdx, i }))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                    finishedProducerCnt.fetch_add(1, std::memory_order_release);
+                });
+            }
+
+            const uint64_t expectedCnt = static_cast<uint64_t>(ProducerCnt) * PostPerProducer;
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(StressTimeoutSec);
+            while (finishedProducerCnt.load(std::memory_order_acquire) < ProducerCnt ||
+                   g_receivedEventCnt.load(std::memory_order_relaxed) < expectedCnt)
+            {
+                stressEventManager.DispatchPostedEvents();
+                if (std::chrono::steady_clock::now() > deadline)
+                {
+                    std::cerr << "events/mpsc_stress_8_producers: timed out with "
+                              << g_receivedEventCnt.load(std::memory_order_relaxed) << " of " << expectedCnt
+                              << " events received." << std::endl;
+                    std::abort();
+                }
+            }
+
+            for (auto& producer : producers)
+            {
+                producer.join();
+            }
+
+            bool isComplete = g_receivedEventCnt.load(std::memory_order_relaxed) == expectedCnt;
+            for (uint32_t producerIdx = 0; producerIdx < ProducerCnt; producerIdx++)
+            {
+                isComplete = isComplete && g_nextSequences[producerIdx] == PostPerProducer;
+            }
+            if (g_outOfOrderEventCnt != 0 || !isComplete)
+            {
+                std::cerr << "events/mpsc_stress_8_producers: " << g_outOfOrderEventCnt
+                          << " events out of the posting order, " << g_receivedEventCnt.load(std::memory_order_relaxed)
+                          << " of " << expectedCnt << " received." << std::endl;
+                std::abort();
+            }
+        });
+
+        // The posted resizes of a frame collapse to the last one.
+        {
+            constexpr uint32_t ResizeCnt = 16;
+            HEventManager resizeEventManager;
+            resizeEventManager.RegisterListener<ResizeSwapchainEvent>(OnResize);
+            g_resizeDispatchCnt = 0;
+            for (uint32_t i = 0; i < ResizeCnt; i++)
+            {
+                resizeEventManager.PostEvent(ResizeSwapchainEvent{ 640 + i, 360 + i });
+            }
+            resizeEventManager.DispatchPostedEvents();
+            if (g_resizeDispatchCnt != 1 || g_lastResize.width != 640 + ResizeCnt - 1 || g_lastResize.height != 360 + ResizeCnt - 1)
+            {
+                std::cerr << "events: " << ResizeCnt << " posted resizes dispatched " << g_resizeDispatchCnt
+                          << " times, last " << g_lastResize.width << "x" << g_lastResize.height << "." << std::endl;
+                std::abort();
+            }
+        }
+
+        // A listener that unregisters itself and registers others during a dispatch. The current event still goes to
+        // the listeners it started with. The new ones get the next event.
+        {
+            HEventManager reentrantEventManager;
+            g_pReentrantEventManager = &reentrantEventManager;
+            reentrantEventManager.RegisterListener<BenchmarkResizeEvent>(OnReentrantResize);
+            reentrantEventManager.RegisterListener<BenchmarkResizeEvent>(OnTypedResize);
+            g_receivedEventCnt.store(0, std::memory_order_relaxed);
+            reentrantEventManager.SendEvent(BenchmarkResizeEvent{ 1, 0 });
+            const uint64_t firstCnt = g_receivedEventCnt.load(std::memory_order_relaxed);
+            reentrantEventManager.SendEvent(BenchmarkResizeEvent{ 1, 0 });
+            const uint64_t secondCnt = g_receivedEventCnt.load(std::memory_order_relaxed) - firstCnt;
+            g_pReentrantEventManager = nullptr;
+            if (firstCnt != 2 || secondCnt != 3)
+            {
+                std::cerr << "events: re-entrant registration reached " << firstCnt << " and " << secondCnt
+                          << " listeners instead of 2 and 3." << std::endl;
+                std::abort();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void RunSortBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t KeyCnt = 100000;
+        std::mt19937_64 rng(RandomSeed);
+        std::uniform_int_distribution<uint32_t> stateDist(0, 255);
+        std::uniform_real_distribution<float> depthDist(0.f, 1.f);
+        std::vector<uint64_t> sourceKeys(KeyCnt);
+        for (uint32_t i = 0; i < KeyCnt; i++)
+        {
+            sourceKeys[i] = RenderQueue::BuildSortKey(RenderPassType::Opaque, stateDist(rng), depthDist(rng), i);
+        }
+
+        std::vector<uint64_t> keys(KeyCnt);
+        std::vector<uint64_t> scratchKeys(KeyCnt);
+        runner.Run("sort/radix_render_keys_100k", KeyCnt, [&]()
+        {
+            keys = sourceKeys;
+            RadixSortKeys(keys.data(), scratchKeys.data(), KeyCnt);
+            DoNotOptimize(keys[0]);
+        });
+
+        runner.Run("sort/std_sort_render_keys_100k", KeyCnt, [&]()
+        {
+            keys = sourceKeys;
+            std::sort(keys.begin(), keys.end());
+            DoNotOptimize(keys[0]);
+        });
+
+        // The radix sort must match the std::sort, on the render keys and on keys that use all the 64 bits.
+        std::vector<uint64_t> fullRangeKeys(KeyCnt);
+        for (uint64_t& key : fullRangeKeys)
+        {
+            key = rng();
+        }
+        for (const std::vector<uint64_t>* pSourceKeys : { &sourceKeys, &fullRangeKeys })
+        {
+            keys = *pSourceKeys;
+            RadixSortKeys(keys.data(), scratchKeys.data(), KeyCnt);
+            std::vector<uint64_t> expectedKeys = *pSourceKeys;
+            std::sort(expectedKeys.begin(), expectedKeys.end());
+            if (!std::is_sorted(keys.begin(), keys.end()) || keys != expectedKeys)
+            {
+                std::cerr << "sort/radix_render_keys_100k: the radix sort doesn't match the std::sort on the "
+                          << (pSourceKeys == &sourceKeys ? "render" : "full range") << " keys." << std::endl;
+                std::abort();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    // The transient containers of a forward frame: mesh list, visibility flags and the prim to state id map.
+    template<typename MeshVector, typename FlagVector, typename StateMap>
+    uint32_t SimulateFrameContainers(MeshVector& meshes, FlagVector& visibility, StateMap& stateIds, uint32_t meshCnt)
+    {
+        for (uint32_t i = 0; i < meshCnt; i++)
+        {
+            meshes.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(i + 1) * 64));
+        }
+        visibility.assign(meshCnt, true);
+        for (uint32_t i = 0; i < meshCnt; i++)
+        {
+            stateIds.emplace(meshes[i / 2], static_cast<uint32_t>(stateIds.size()));
+        }
+        return static_cast<uint32_t>(stateIds.size());
+    }
+
+    void RunAllocatorBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t MeshCnt = 2048;
+
+        runner.Run("alloc/frame_containers_heap_2048", MeshCnt, []()
+        {
+            std::vector<const void*> meshes;
+            std::vector<bool> visibility;
+            std::unordered_map<const void*, uint32_t> stateIds;
+            DoNotOptimize(SimulateFrameContainers(meshes, visibility, stateIds, MeshCnt));
+        });
+
+        FrameArena frameArena;
+        runner.Run("alloc/frame_containers_arena_2048", MeshCnt, [&frameArena]()
+        {
+            // Reset before building, since the containers still touch their memory in their destructors.
+            frameArena.Reset();
+            typedef std::pair<const void* const, uint32_t> StateIdPair;
+            FrameVector<const void*> meshes{ FrameArenaAllocator<const void*>(&frameArena) };
+            FrameVector<bool> visibility{ FrameArenaAllocator<bool>(&frameArena) };
+            std::unordered_map<const void*, uint32_t, std::hash<const void*>, std::equal_to<const void*>, FrameArenaAllocator<StateIdPair>>
+                stateIds(MeshCnt, std::hash<const void*>(), std::equal_to<const void*>(), FrameArenaAllocator<StateIdPair>(&frameArena));
+            meshes.reserve(MeshCnt);
+            DoNotOptimize(SimulateFrameContainers(meshes, visibility, stateIds, MeshCnt));
+        });
+    }
+
+    // ============================================================================================================
+    // Nested fork/join: every level above the cutoff forks one half as a job and waits on it, so the waits nest as
+    // deep as the recursion and the workers have to steal from each other's stacks.
+    uint64_t ForkJoinFib(uint32_t n)
+    {
+        if (n < 16)
+        {
+            return n < 2 ? n : ForkJoinFib(n - 1) + ForkJoinFib(n - 2);
+        }
+
+        uint64_t left = 0;
+        JobCounter counter;
+        JobSystem::GetInstance()->Run(counter, [n, &left]() { left = ForkJoinFib(n - 1); });
+        const uint64_t right = ForkJoinFib(n - 2);
+        JobSystem::GetInstance()->Wait(counter);
+        return left + right;
+    }
+
+    void RunJobBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t ElementCnt = 1 << 20;
+        constexpr uint32_t GrainSize = 4096;
+        constexpr uint32_t FibN = 27;
+        constexpr uint64_t FibResult = 196418;
+
+        std::vector<float> values(ElementCnt);
+        for (uint32_t i = 0; i < ElementCnt; i++)
+        {
+            values[i] = static_cast<float>(i);
+        }
+        std::vector<float> results(ElementCnt);
+
+        // Scale from the calling thread alone up to one worker per hardware thread. 0 workers means no job system,
+        // which is the serial baseline of ParallelFor.
+        const uint32_t hardwareThreadCnt = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t workerCnt = 0; workerCnt < hardwareThreadCnt; workerCnt = workerCnt * 2 + 1)
+        {
+            if (workerCnt > 0)
+            {
+                JobSystem::Create(workerCnt);
+            }
+            const std::string threadStr = std::to_string(workerCnt + 1) + "_threads";
+
+            runner.Run("jobs/parallel_for_1m_" + threadStr, ElementCnt, [&]()
+            {
+                JobSystem::ParallelFor(0, ElementCnt, GrainSize, [&](uint32_t rangeBegin, uint32_t rangeEnd)
+                {
+                    for (uint32_t i = rangeBegin; i < rangeEnd; i++)
+                    {
+                        results[i] = sqrtf(values[i]) * sinf(values[i]);
+                    }
+                });
+                DoNotOptimize(static_cast<uint64_t>(results[ElementCnt / 3]));
+            });
+
+            if (workerCnt > 0)
+            {
+                runner.Run("jobs/fork_join_fib27_" + threadStr, FibResult, [&]()
+                {
+                    const uint64_t fib = ForkJoinFib(FibN);
+                    if (fib != FibResult)
+                    {
+                        std::cerr << "jobs/fork_join_fib27 computed " << fib << " instead of " << FibResult << std::endl;
+                        std::abort();
+                    }
+                    DoNotOptimize(fib);
+                });
+                JobSystem::Destroy();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    // Stands in for the GPU queries. Every timestamp write reads a clock that advances by TickStep per write, and a
+    // resolve copies the written queries into the readback copy like the GPU does at the end of the frame.
+    class FakeGpuTimestampSource : public GpuTimestampSource
+    {
+    public:
+        static constexpr uint64_t Frequency = 10000000; // 100 ns per tick.
+        static constexpr uint64_t TickStep = 25;
+
+        explicit FakeGpuTimestampSource(uint32_t queryCnt)
+            : m_queries(queryCnt, 0), m_readback(queryCnt, 0), m_tick(1000), m_writeCnt(0), m_outOfRangeCnt(0) {}
+
+        uint64_t GetFrequency() const override { return Frequency; }
+
+        void WriteTimestamp(uint32_t queryIdx) override
+        {
+            m_writeCnt++;
+            if (queryIdx >= m_queries.size())
+            {
+                m_outOfRangeCnt++;
+                return;
+            }
+            m_queries[queryIdx] = m_tick;
+            m_tick += TickStep;
+        }
+
+        void ResolveQueries(uint32_t firstQueryIdx, uint32_t queryCnt) override
+        {
+            if (firstQueryIdx + queryCnt > m_queries.size())
+            {
+                m_outOfRangeCnt++;
+                return;
+            }
+            std::copy_n(m_queries.begin() + firstQueryIdx, queryCnt, m_readback.begin() + firstQueryIdx);
+        }
+
+        void ReadQueries(uint32_t firstQueryIdx, uint32_t queryCnt, uint64_t* oTicks) override
+        {
+            if (firstQueryIdx + queryCnt > m_readback.size())
+            {
+                m_outOfRangeCnt++;
+                return;
+            }
+            std::copy_n(m_readback.begin() + firstQueryIdx, queryCnt, oTicks);
+        }
+
+        uint32_t GetWriteCnt() const { return m_writeCnt; }
+        uint32_t GetOutOfRangeCnt() const { return m_outOfRangeCnt; }
+
+    private:
+        std::vector<uint64_t> m_queries;
+        std::vector<uint64_t> m_readback;
+        uint64_t              m_tick;
+        uint32_t              m_writeCnt;
+        uint32_t              m_outOfRangeCnt;
+    };
+
+    void CheckGpuTimestamps(bool isCorrect, const char* pCheckName)
+    {
+        if (!isCorrect)
+        {
+            std::cerr << "gpu_timestamps: " << pCheckName << " check failed." << std::endl;
+            std::abort();
+        }
+    }
+
+    // ============================================================================================================
+    void RunGpuTimestampBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t FrameSlotCnt = 3;
+        constexpr uint32_t MaxZonesPerFrame = 4;
+        constexpr uint64_t NsPerTick = 1000000000 / FakeGpuTimestampSource::Frequency;
+        constexpr uint64_t TickStepNs = FakeGpuTimestampSource::TickStep * NsPerTick;
+        const uint32_t outerZoneHash = crc32("Outer");
+        const uint32_t innerZoneHash = crc32("Inner");
+
+        // The renderer waits on the fence of the frame that last used a slot before reusing it, so frame n completes
+        // when frame n + FrameSlotCnt begins. Each frame's results must show up exactly then, in order, with the
+        // ticks of its own frame converted at the source frequency.
+        {
+            FakeGpuTimestampSource source(GpuTimestampQueryPool::GetRequiredQueryCnt(FrameSlotCnt, MaxZonesPerFrame));
+            GpuTimestampQueryPool pool(&source, FrameSlotCnt, MaxZonesPerFrame);
+            std::vector<GpuZoneResult> zones;
+            uint64_t frameSerial = 0;
+            for (uint64_t frameIdx = 0; frameIdx < FrameSlotCnt * 4; frameIdx++)
+            {
+                CheckGpuTimestamps(!pool.PopCompletedFrame(frameSerial, zones), "no results before the frame completes");
+                if (frameIdx >= FrameSlotCnt)
+                {
+                    pool.MarkFrameCompleted(frameIdx - FrameSlotCnt);
+                    CheckGpuTimestamps(pool.PopCompletedFrame(frameSerial, zones), "results after the frame completes");
+                    CheckGpuTimestamps(frameSerial == frameIdx - FrameSlotCnt, "completed frame serial");
+                    CheckGpuTimestamps(zones.size() == 2 &&
+                                       zones[0].nameHash == outerZoneHash && zones[0].depth == 0 &&
+                                       zones[0].startNs == 0 && zones[0].endNs == 3 * TickStepNs &&
+                                       zones[1].nameHash == innerZoneHash && zones[1].depth == 1 &&
+                                       zones[1].startNs == TickStepNs && zones[1].endNs == 2 * TickStepNs,
+                                       "zone times");
+                    CheckGpuTimestamps(!pool.PopCompletedFrame(frameSerial, zones), "one result per completed frame");
+                }
+
+                pool.BeginFrame(frameIdx);
+                pool.BeginZone(outerZoneHash);
+                pool.BeginZone(innerZoneHash);
+                pool.EndZone();
+                pool.EndZone();
+                pool.EndFrame();
+            }
+            CheckGpuTimestamps(pool.GetLostFrameCnt() == 0, "no lost frame when the slots are reused in time");
+
+            // Reusing a slot whose frame hasn't completed loses that frame.
+            const uint64_t nextFrameIdx = FrameSlotCnt * 4;
+            pool.BeginFrame(nextFrameIdx);
+            pool.EndFrame();
+            CheckGpuTimestamps(pool.GetLostFrameCnt() == 1, "lost frame on an early slot reuse");
+            CheckGpuTimestamps(source.GetOutOfRangeCnt() == 0, "query range");
+        }
+
+        // The zones past the per frame limit are counted and never touch the queries of the next slot.
+        {
+            constexpr uint32_t ZoneCnt = MaxZonesPerFrame + 3;
+            FakeGpuTimestampSource source(GpuTimestampQueryPool::GetRequiredQueryCnt(FrameSlotCnt, MaxZonesPerFrame));
+            GpuTimestampQueryPool pool(&source, FrameSlotCnt, MaxZonesPerFrame);
+            pool.BeginFrame(FrameSlotCnt - 1); // The last slot, so a write past the limit would be out of range.
+            for (uint32_t i = 0; i < ZoneCnt; i++)
+            {
+                pool.BeginZone(innerZoneHash + i);
+                pool.EndZone();
+            }
+            pool.EndFrame();
+            pool.MarkFrameCompleted(FrameSlotCnt - 1);
+
+            std::vector<GpuZoneResult> zones;
+            uint64_t frameSerial = 0;
+            CheckGpuTimestamps(pool.PopCompletedFrame(frameSerial, zones) && zones.size() == MaxZonesPerFrame, "zone limit");
+            CheckGpuTimestamps(pool.GetOverflowZoneCnt() == ZoneCnt - MaxZonesPerFrame, "overflow zone count");
+            CheckGpuTimestamps(source.GetWriteCnt() == 2 * MaxZonesPerFrame && source.GetOutOfRangeCnt() == 0,
+                               "no timestamp written past the limit");
+        }
+
+        // The bookkeeping cost of the GPU zones of a frame, with the read back of the frame that completed.
+        constexpr uint32_t BenchmarkZonesPerFrame = 64;
+        constexpr uint32_t BenchmarkFrameCnt = 1000;
+        FakeGpuTimestampSource source(GpuTimestampQueryPool::GetRequiredQueryCnt(FrameSlotCnt, BenchmarkZonesPerFrame));
+        GpuTimestampQueryPool pool(&source, FrameSlotCnt, BenchmarkZonesPerFrame);
+        std::vector<GpuZoneResult> zones;
+        zones.reserve(BenchmarkZonesPerFrame);
+        uint64_t frameIdx = 0;
+        runner.Run("gpu_timestamps/pool_frames_64_zones", BenchmarkFrameCnt * BenchmarkZonesPerFrame, [&]()
+        {
+            uint64_t zoneNsSum = 0;
+            for (uint32_t i = 0; i < BenchmarkFrameCnt; i++, frameIdx++)
+            {
+                if (frameIdx >= FrameSlotCnt)
+                {
+                    pool.MarkFrameCompleted(frameIdx - FrameSlotCnt);
+                    uint64_t frameSerial = 0;
+                    while (pool.PopCompletedFrame(frameSerial, zones))
+                    {
+                        zoneNsSum += zones.back().endNs;
+                    }
+                }
+
+                pool.BeginFrame(frameIdx);
+                for (uint32_t zoneIdx = 0; zoneIdx < BenchmarkZonesPerFrame; zoneIdx++)
+                {
+                    pool.BeginZone(zoneIdx);
+                    pool.EndZone();
+                }
+                pool.EndFrame();
+            }
+            DoNotOptimize(zoneNsSum);
+        });
+    }
+}
+
+// ================================================================================================================
+void RunCoreBenchmarks(BenchmarkRunner& runner)
+{
+    RunCrc32Benchmarks(runner);
+    RunMathBenchmarks(runner);
+    RunEventBenchmarks(runner);
+    RunSortBenchmarks(runner);
+    RunAllocatorBenchmarks(runner);
+    RunJobBenchmarks(runner);
+    RunGpuTimestampBenchmarks(runner);
+}
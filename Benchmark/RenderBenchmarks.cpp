@@ -0,0 +1,476 @@
+#include "BenchmarkHarness.h"
+#include "../Utils/MathUtils.h"
+#include "../RenderBackend/SoftwareOcclusionCuller.h"
+#include "../RenderBackend/MeshletCuller.h"
+#include "../RenderBackend/ClusteredLightCuller.h"
+#include "../RenderBackend/RenderQueue.h"
+#include "../JobSystem/JobSystem.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+namespace
+{
+    constexpr uint32_t RandomSeed = 20240731;
+
+    // A camera at the origin looking at z+, like the Camera of the renderer.
+    struct BenchmarkCamera
+    {
+        float viewMat[16];
+        float projMat[16];
+        float vpMat[16];
+        float nearPlane = 0.1f;
+        float farPlane = 200.f;
+
+        BenchmarkCamera()
+        {
+            float view[3] = { 0.f, 0.f, 1.f };
+            float pos[3] = { 0.f, 0.f, 0.f };
+            float up[3] = { 0.f, 1.f, 0.f };
+            GenViewMat(view, pos, up, viewMat);
+            GenPerspectiveProjMat(nearPlane, farPlane, 1.f, 0.5625f, projMat);
+            MatMulMat(projMat, viewMat, vpMat, 4);
+        }
+    };
+
+    // ============================================================================================================
+    void RunOcclusionBenchmarks(BenchmarkRunner& runner)
+    {
+        // A 64 x 64 quad wall at z = 20 hiding a field of small boxes behind it.
+        constexpr uint32_t GridSize = 64;
+        std::vector<float> wallPos;
+        std::vector<uint32_t> wallIdx;
+        for (uint32_t y = 0; y <= GridSize; y++)
+        {
+            for (uint32_t x = 0; x <= GridSize; x++)
+            {
+                wallPos.push_back(-40.f + 80.f * x / GridSize);
+                wallPos.push_back(-25.f + 50.f * y / GridSize);
+                wallPos.push_back(20.f);
+            }
+        }
+        for (uint32_t y = 0; y < GridSize; y++)
+        {
+            for (uint32_t x = 0; x < GridSize; x++)
+            {
+                const uint32_t v0 = y * (GridSize + 1) + x;
+                wallIdx.insert(wallIdx.end(), { v0, v0 + 1, v0 + GridSize + 1, v0 + 1, v0 + GridSize + 2, v0 + GridSize + 1 });
+            }
+        }
+
+        constexpr uint32_t BoxCnt = 10000;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> xDist(-60.f, 60.f);
+        std::uniform_real_distribution<float> yDist(-30.f, 30.f);
+        std::uniform_real_distribution<float> zDist(5.f, 150.f);
+        std::vector<float> boxCenters(BoxCnt * 3);
+        for (uint32_t i = 0; i < BoxCnt; i++)
+        {
+            boxCenters[i * 3] = xDist(rng);
+            boxCenters[i * 3 + 1] = yDist(rng);
+            boxCenters[i * 3 + 2] = zDist(rng);
+        }
+
+        const float identityMat[16] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+        BenchmarkCamera camera;
+        SoftwareOcclusionCuller culler;
+
+        // Known cases against a 10 x 10 wall at z = 20 that covers only the middle of the screen.
+        {
+            const float smallWallPos[12] = { -5.f, -5.f, 20.f, 5.f, -5.f, 20.f, 5.f, 5.f, 20.f, -5.f, 5.f, 20.f };
+            const uint32_t smallWallIdx[6] = { 0, 1, 2, 0, 2, 3 };
+            culler.BeginFrame(camera.vpMat);
+            culler.RasterizeOccluder(smallWallPos, smallWallIdx, 6, identityMat);
+            culler.BuildHiZ();
+
+            struct OcclusionCase
+            {
+                const char* pName;
+                float       center[3];
+                float       halfExtent;
+                bool        isVisible;
+            };
+            const OcclusionCase cases[] = {
+                { "fully behind the wall",     { 0.f, 0.f, 40.f },   1.f,  false },
+                { "beside the wall",           { 10.f, 0.f, 20.f },  0.5f, true },
+                { "in front of the wall",      { 0.f, 0.f, 10.f },   1.f,  true },
+                { "straddling the near plane", { 0.f, 0.f, 0.f },    1.f,  true },
+                { "off the screen",            { 200.f, 0.f, 20.f }, 1.f,  false },
+            };
+            for (const OcclusionCase& occlusionCase : cases)
+            {
+                float aabbMin[3];
+                float aabbMax[3];
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    aabbMin[axis] = occlusionCase.center[axis] - occlusionCase.halfExtent;
+                    aabbMax[axis] = occlusionCase.center[axis] + occlusionCase.halfExtent;
+                }
+                if (culler.IsAABBVisible(aabbMin, aabbMax, identityMat) != occlusionCase.isVisible)
+                {
+                    std::cerr << "The box " << occlusionCase.pName << " should be " << (occlusionCase.isVisible ? "visible." : "culled.") << std::endl;
+                    std::abort();
+                }
+            }
+        }
+
+        runner.Run("occlusion/rasterize_8k_tris", wallIdx.size() / 3, [&]()
+        {
+            culler.BeginFrame(camera.vpMat);
+            culler.RasterizeOccluder(wallPos.data(), wallIdx.data(), static_cast<uint32_t>(wallIdx.size()), identityMat);
+            culler.BuildHiZ();
+        });
+
+        runner.Run("occlusion/test_10k_aabbs", BoxCnt, [&]()
+        {
+            uint64_t visibleCnt = 0;
+            for (uint32_t i = 0; i < BoxCnt; i++)
+            {
+                const float aabbMin[3] = { boxCenters[i * 3] - 0.5f, boxCenters[i * 3 + 1] - 0.5f, boxCenters[i * 3 + 2] - 0.5f };
+                const float aabbMax[3] = { boxCenters[i * 3] + 0.5f, boxCenters[i * 3 + 1] + 0.5f, boxCenters[i * 3 + 2] + 0.5f };
+                visibleCnt += culler.IsAABBVisible(aabbMin, aabbMax, identityMat) ? 1 : 0;
+            }
+            DoNotOptimize(visibleCnt);
+        });
+    }
+
+    // ============================================================================================================
+    void RunMeshletCullingBenchmarks(BenchmarkRunner& runner)
+    {
+        // A field of spheres around the view, so some are out of the frustum and the rest show the cones one side.
+        std::vector<float> posData;
+        std::vector<uint32_t> indices;
+        MakeUvSphere(128, 128, posData, indices);
+        std::vector<Meshlet> meshlets;
+        std::vector<uint32_t> meshletVerts;
+        std::vector<uint8_t> meshletTris;
+        BuildMeshlets(indices.data(), static_cast<uint32_t>(indices.size()), posData.data(), static_cast<uint32_t>(posData.size() / 3),
+                      meshlets, meshletVerts, meshletTris);
+        std::vector<MeshletBounds> bounds(meshlets.size());
+        for (uint32_t i = 0; i < meshlets.size(); i++)
+        {
+            ComputeMeshletBounds(meshlets[i], meshletVerts.data(), meshletTris.data(), posData.data(), bounds[i]);
+        }
+
+        constexpr uint32_t InstanceCnt = 256;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> xDist(-60.f, 60.f);
+        std::uniform_real_distribution<float> yDist(-30.f, 30.f);
+        std::uniform_real_distribution<float> zDist(5.f, 150.f);
+        std::uniform_real_distribution<float> scaleDist(1.f, 3.f);
+        std::vector<float> modelMats(InstanceCnt * 16, 0.f);
+        for (uint32_t i = 0; i < InstanceCnt; i++)
+        {
+            float* pModelMat = &modelMats[i * 16];
+            const float scale = scaleDist(rng);
+            pModelMat[0] = scale;
+            pModelMat[5] = scale;
+            pModelMat[10] = scale;
+            pModelMat[15] = 1.f;
+            pModelMat[3] = xDist(rng);
+            pModelMat[7] = yDist(rng);
+            pModelMat[11] = zDist(rng);
+        }
+
+        BenchmarkCamera camera;
+        const float viewPos[3] = { 0.f, 0.f, 0.f };
+        MeshletCuller culler;
+        std::vector<uint8_t> visibility(meshlets.size());
+        const uint32_t meshletCnt = static_cast<uint32_t>(meshlets.size());
+        runner.Run("meshlet/cull_" + std::to_string(InstanceCnt * meshletCnt / 1000) + "k_meshlets", InstanceCnt * meshletCnt, [&]()
+        {
+            culler.BeginFrame(camera.vpMat, viewPos);
+            uint64_t visibleCnt = 0;
+            for (uint32_t i = 0; i < InstanceCnt; i++)
+            {
+                visibleCnt += culler.CullMeshlets(meshlets.data(), bounds.data(), meshletCnt, &modelMats[i * 16], true, visibility.data());
+            }
+            DoNotOptimize(visibleCnt);
+        });
+
+        const MeshletCullingStats& stats = culler.GetStats();
+        if (stats.testedCnt > 0)
+        {
+            std::cout << "    " << 100.0 * stats.frustumCulledCnt / stats.testedCnt << "% frustum culled, "
+                      << 100.0 * stats.coneCulledCnt / stats.testedCnt << "% cone culled, "
+                      << 100.0 * stats.culledTriCnt / (static_cast<double>(InstanceCnt) * indices.size() / 3) << "% of the triangles"
+                      << std::endl;
+        }
+    }
+
+    // ============================================================================================================
+    void RunClusterBenchmarks(BenchmarkRunner& runner)
+    {
+        std::mt19937 rng(RandomSeed);
+        std::uniform_real_distribution<float> xyDist(-50.f, 50.f);
+        std::uniform_real_distribution<float> zDist(0.f, 150.f);
+        std::uniform_real_distribution<float> radianceDist(0.1f, 4.f);
+        std::vector<ClusterLight> lights(4000);
+        for (ClusterLight& light : lights)
+        {
+            light.position[0] = xyDist(rng);
+            light.position[1] = xyDist(rng);
+            light.position[2] = zDist(rng);
+            light.radiance[0] = radianceDist(rng);
+            light.radiance[1] = radianceDist(rng);
+            light.radiance[2] = radianceDist(rng);
+            light.radius = ClusteredLightCuller::CalculateLightRadius(light.radiance);
+        }
+        std::vector<ClusterLight> fewLights(lights.begin(), lights.begin() + 256);
+
+        BenchmarkCamera camera;
+        ClusteredLightCuller culler;
+
+        // The world position of a view space point. The camera is at the origin, so the view matrix is a rotation.
+        auto ViewToWorld = [&camera](const float* pViewPos, float* pWorldPos)
+        {
+            for (uint32_t col = 0; col < 3; col++)
+            {
+                pWorldPos[col] = camera.viewMat[col] * pViewPos[0] + camera.viewMat[4 + col] * pViewPos[1] + camera.viewMat[8 + col] * pViewPos[2];
+            }
+        };
+        // The view space center of the cluster's froxel, at the geometric middle of its slice.
+        auto GetClusterCenter = [&](uint32_t tileX, uint32_t tileY, uint32_t slice, float* pViewPos)
+        {
+            const float depthRatio = camera.farPlane / camera.nearPlane;
+            pViewPos[2] = camera.nearPlane * powf(depthRatio, (slice + 0.5f) / ClusteredLightCuller::CLUSTER_Z);
+            const float ndcX = ((tileX + 0.5f) / ClusteredLightCuller::CLUSTER_X) * 2.f - 1.f;
+            const float ndcY = 1.f - ((tileY + 0.5f) / ClusteredLightCuller::CLUSTER_Y) * 2.f;
+            pViewPos[0] = ndcX * pViewPos[2] / camera.projMat[0];
+            pViewPos[1] = ndcY * pViewPos[2] / camera.projMat[5];
+        };
+        auto GetClusterIdx = [](uint32_t tileX, uint32_t tileY, uint32_t slice)
+        {
+            return (slice * ClusteredLightCuller::CLUSTER_Y + tileY) * ClusteredLightCuller::CLUSTER_X + tileX;
+        };
+        auto FindLightClusters = [&culler](uint32_t lightIdx)
+        {
+            std::vector<uint32_t> clusterIdxs;
+            const std::vector<LightCluster>& clusters = culler.GetClusters();
+            const std::vector<uint32_t>& lightIndices = culler.GetLightIndices();
+            for (uint32_t clusterIdx = 0; clusterIdx < clusters.size(); clusterIdx++)
+            {
+                const auto begin = lightIndices.begin() + clusters[clusterIdx].offset;
+                if (std::find(begin, begin + clusters[clusterIdx].count, lightIdx) != begin + clusters[clusterIdx].count)
+                {
+                    clusterIdxs.push_back(clusterIdx);
+                }
+            }
+            return clusterIdxs;
+        };
+
+        // A small light in the middle of the cluster (5, 3, 10) lands only there. One on the edge between the tiles 7
+        // and 8 of the cluster row (y 4, slice 12) lands in both.
+        {
+            std::vector<ClusterLight> knownLights(2, ClusterLight{});
+            float viewPos[3];
+            GetClusterCenter(5, 3, 10, viewPos);
+            ViewToWorld(viewPos, knownLights[0].position);
+            knownLights[0].radius = 0.01f * viewPos[2];
+            GetClusterCenter(7, 4, 12, viewPos);
+            viewPos[0] += 0.5f * (2.f / ClusteredLightCuller::CLUSTER_X) * viewPos[2] / camera.projMat[0];
+            ViewToWorld(viewPos, knownLights[1].position);
+            knownLights[1].radius = 0.01f * viewPos[2];
+
+            culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, knownLights);
+            const std::vector<uint32_t> centerClusters = FindLightClusters(0);
+            const std::vector<uint32_t> edgeClusters = FindLightClusters(1);
+            if (centerClusters != std::vector<uint32_t>{ GetClusterIdx(5, 3, 10) } ||
+                edgeClusters != std::vector<uint32_t>{ GetClusterIdx(7, 4, 12), GetClusterIdx(8, 4, 12) })
+            {
+                std::cerr << "The lights at the known view space positions landed in the wrong clusters." << std::endl;
+                std::abort();
+            }
+        }
+
+        // MAX_LIGHTS_PER_CLUSTER + 44 lights in one cluster. It keeps the first ones and counts the rest as dropped.
+        {
+            constexpr uint32_t CrowdedLightCnt = ClusteredLightCuller::MAX_LIGHTS_PER_CLUSTER + 44;
+            std::vector<ClusterLight> crowdedLights(CrowdedLightCnt, ClusterLight{});
+            float viewPos[3];
+            GetClusterCenter(5, 3, 10, viewPos);
+            for (ClusterLight& light : crowdedLights)
+            {
+                ViewToWorld(viewPos, light.position);
+                light.radius = 0.01f * viewPos[2];
+            }
+
+            culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, crowdedLights);
+            const LightCluster& cluster = culler.GetClusters()[GetClusterIdx(5, 3, 10)];
+            const ClusteredLightCullingStats& stats = culler.GetStats();
+            bool isKeepingFirst = cluster.count == ClusteredLightCuller::MAX_LIGHTS_PER_CLUSTER;
+            for (uint32_t i = 0; isKeepingFirst && i < cluster.count; i++)
+            {
+                isKeepingFirst = culler.GetLightIndices()[cluster.offset + i] == i;
+            }
+            if (!isKeepingFirst || stats.lightIndexCnt != ClusteredLightCuller::MAX_LIGHTS_PER_CLUSTER || stats.overflowCnt != 44 ||
+                stats.overflowClusterCnt != 1)
+            {
+                std::cerr << "The full cluster didn't keep its first " << ClusteredLightCuller::MAX_LIGHTS_PER_CLUSTER
+                          << " lights and count the dropped ones." << std::endl;
+                std::abort();
+            }
+        }
+
+        // The single thread build is the reference for the job system's one.
+        std::vector<LightCluster> refClusters;
+        std::vector<uint32_t> refLightIndices;
+        culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, lights);
+        refClusters = culler.GetClusters();
+        refLightIndices = culler.GetLightIndices();
+
+        // Without the job system the slices are assigned on the calling thread.
+        for (bool useJobs : { false, true })
+        {
+            if (useJobs)
+            {
+                JobSystem::Create();
+            }
+            const std::string threadStr = useJobs ? "all_threads" : "1_thread";
+            runner.Run("cluster/build_256_lights_" + threadStr, fewLights.size(), [&]()
+            {
+                culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, fewLights);
+            });
+            runner.Run("cluster/build_4000_lights_" + threadStr, lights.size(), [&]()
+            {
+                culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, lights);
+            });
+
+            // Built again outside the timing, which the filter may skip.
+            culler.Build(camera.viewMat, camera.projMat, camera.nearPlane, camera.farPlane, lights);
+            const std::vector<LightCluster>& clusters = culler.GetClusters();
+            const bool isSameClusters = std::equal(clusters.begin(), clusters.end(), refClusters.begin(), refClusters.end(),
+                                                   [](const LightCluster& a, const LightCluster& b) { return a.offset == b.offset && a.count == b.count; });
+            if (!isSameClusters || culler.GetLightIndices() != refLightIndices)
+            {
+                std::cerr << "The " << threadStr << " cluster build differs from the single thread one." << std::endl;
+                std::abort();
+            }
+            if (useJobs)
+            {
+                JobSystem::Destroy();
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void RunRenderQueueBenchmarks(BenchmarkRunner& runner)
+    {
+        constexpr uint32_t DrawCnt = 20000;
+        constexpr uint32_t StateCnt = 200;
+        std::mt19937 rng(RandomSeed);
+        std::uniform_int_distribution<uint32_t> stateDist(0, StateCnt - 1);
+        std::uniform_real_distribution<float> depthDist(0.f, 1.f);
+        std::vector<uint32_t> drawStates(DrawCnt);
+        std::vector<float> drawDepths(DrawCnt);
+        for (uint32_t i = 0; i < DrawCnt; i++)
+        {
+            drawStates[i] = stateDist(rng);
+            drawDepths[i] = depthDist(rng);
+        }
+
+        RenderQueue renderQueue;
+        std::vector<InstanceBatch> batches;
+
+        // A known frame. The state id stands for the primitive asset and its material, as in the forward renderer. The
+        // draws of the same primitive and state collapse into one instanced batch whatever their depths, and another
+        // state or pass splits them.
+        {
+            struct QueueDraw
+            {
+                RenderPassType pass;
+                uint32_t       stateId;
+                float          depth;
+            };
+            const QueueDraw draws[] = {
+                { RenderPassType::Opaque, 3, 0.9f }, { RenderPassType::Opaque, 7, 0.2f }, { RenderPassType::Opaque, 3, 0.1f },
+                { RenderPassType::Transparent, 3, 0.5f }, { RenderPassType::Opaque, 3, 0.5f }, { RenderPassType::Opaque, 7, 0.8f },
+                { RenderPassType::Opaque, 3, 0.3f }, { RenderPassType::Transparent, 3, 0.4f }, { RenderPassType::Opaque, 3, 0.7f },
+                { RenderPassType::Opaque, 7, 0.6f },
+            };
+            const uint32_t drawCnt = static_cast<uint32_t>(sizeof(draws) / sizeof(draws[0]));
+            renderQueue.Clear();
+            for (uint32_t i = 0; i < drawCnt; i++)
+            {
+                renderQueue.Push(RenderQueue::BuildSortKey(draws[i].pass, draws[i].stateId, draws[i].depth, i));
+            }
+            renderQueue.Sort();
+            const std::vector<uint64_t>& keys = renderQueue.GetKeys();
+            RenderQueue::BuildInstanceBatches(keys.data(), renderQueue.Size(), batches);
+
+            struct ExpectedBatch
+            {
+                RenderPassType pass;
+                uint32_t       stateId;
+                uint32_t       instanceCnt;
+            };
+            const ExpectedBatch expectedBatches[] = {
+                { RenderPassType::Opaque, 3, 5 }, { RenderPassType::Opaque, 7, 3 }, { RenderPassType::Transparent, 3, 2 }
+            };
+            bool isMatching = batches.size() == 3;
+            for (uint32_t i = 0; isMatching && i < batches.size(); i++)
+            {
+                isMatching = batches[i].instanceCnt == expectedBatches[i].instanceCnt;
+                for (uint32_t keyIdx = batches[i].firstKeyIdx; isMatching && keyIdx < batches[i].firstKeyIdx + batches[i].instanceCnt; keyIdx++)
+                {
+                    const QueueDraw& draw = draws[RenderQueue::GetDrawIdx(keys[keyIdx])];
+                    isMatching = draw.pass == expectedBatches[i].pass && draw.stateId == expectedBatches[i].stateId;
+                }
+            }
+            if (!isMatching)
+            {
+                std::cerr << "The render queue batched the draws of the known frame wrong." << std::endl;
+                std::abort();
+            }
+        }
+
+        runner.Run("render_queue/build_sort_batch_20k", DrawCnt, [&]()
+        {
+            renderQueue.Clear();
+            for (uint32_t i = 0; i < DrawCnt; i++)
+            {
+                renderQueue.Push(RenderQueue::BuildSortKey(RenderPassType::Opaque, drawStates[i], drawDepths[i], i));
+            }
+            renderQueue.Sort();
+            RenderQueue::BuildInstanceBatches(renderQueue.GetKeys().data(), renderQueue.Size(), batches);
+            DoNotOptimize(batches.size());
+        });
+
+        // Every used state is one batch of all its draws. Batched again outside the timing, which the filter may skip.
+        renderQueue.Clear();
+        for (uint32_t i = 0; i < DrawCnt; i++)
+        {
+            renderQueue.Push(RenderQueue::BuildSortKey(RenderPassType::Opaque, drawStates[i], drawDepths[i], i));
+        }
+        renderQueue.Sort();
+        RenderQueue::BuildInstanceBatches(renderQueue.GetKeys().data(), renderQueue.Size(), batches);
+
+        std::vector<uint32_t> stateDrawCnts(StateCnt, 0);
+        for (uint32_t stateId : drawStates)
+        {
+            stateDrawCnts[stateId]++;
+        }
+        const uint32_t usedStateCnt = static_cast<uint32_t>(StateCnt - std::count(stateDrawCnts.begin(), stateDrawCnts.end(), 0u));
+        bool isMatching = batches.size() == usedStateCnt;
+        for (uint32_t i = 0; isMatching && i < batches.size(); i++)
+        {
+            const uint32_t stateId = RenderQueue::GetStateId(renderQueue.GetKeys()[batches[i].firstKeyIdx]);
+            isMatching = batches[i].instanceCnt == stateDrawCnts[stateId];
+        }
+        if (!isMatching)
+        {
+            std::cerr << "The render queue didn't batch the 20k draws by their states." << std::endl;
+            std::abort();
+        }
+    }
+}
+
+// ================================================================================================================
+void RunRenderBenchmarks(BenchmarkRunner& runner)
+{
+    RunOcclusionBenchmarks(runner);
+    RunMeshletCullingBenchmarks(runner);
+    RunClusterBenchmarks(runner);
+    RunRenderQueueBenchmarks(runner);
+}
@@ -1,46 +1,145 @@
 #include "EventManager.h"
-#include "../Utils/crc32.h"
+#include "../Utils/MemoryTracker.h"
+#include <algorithm>
 
 // ================================================================================================================
-HEvent::HEvent(
-    const HEventArguments& arg,
-    const std::string& type)
-    : m_isHandled(false)
+HEventManager::HEventManager()
+    : m_listeners(),
+      m_dispatchDepth(0),
+      m_postedEvents(POSTED_EVENT_QUEUE_CAPACITY)
 {
-    m_typeHash = crc32(type.data());
-    m_arg = arg;
+    MEMORY_TAG_SCOPE(MemoryTag::Events);
+    m_drainedEvents.reserve(POSTED_EVENT_QUEUE_CAPACITY);
+    m_coalescedTypeIds.reserve(64);
 }
 
 // ================================================================================================================
-void HEventManager::RegisterListener(
-    const std::string&      type,
-    EventCallbackFuncPtr listenFunc)
+void HEventManager::AddListener(
+    uint32_t       typeId,
+    GenericFuncPtr listenFunc,
+    InvokeFuncPtr  invokeFunc)
 {
-    size_t typeHash = crc32(type.data());
+    MEMORY_TAG_SCOPE(MemoryTag::Events);
+    const Listener listener{ typeId, listenFunc, invokeFunc };
+    if (m_dispatchDepth > 0)
+    {
+        // Inserting now could reallocate or shift m_listeners under the dispatch loop.
+        m_pendingListenerChanges.push_back(PendingListenerChange{ listener, true });
+        return;
+    }
+    InsertListener(listener);
+}
+
+// ================================================================================================================
+void HEventManager::RemoveListener(
+    uint32_t       typeId,
+    GenericFuncPtr listenFunc)
+{
+    if (m_dispatchDepth > 0)
+    {
+        MEMORY_TAG_SCOPE(MemoryTag::Events);
+        m_pendingListenerChanges.push_back(PendingListenerChange{ Listener{ typeId, listenFunc, nullptr }, false });
+        return;
+    }
+    EraseListener(typeId, listenFunc);
+}
+
+// ================================================================================================================
+void HEventManager::InsertListener(
+    const Listener& newListener)
+{
+    // Insert after the existing listeners of the same type to keep the registration order.
+    auto itr = std::upper_bound(m_listeners.begin(), m_listeners.end(), newListener.typeId,
+                                [](uint32_t id, const Listener& listener) { return id < listener.typeId; });
+    m_listeners.insert(itr, newListener);
+}
+
+// ================================================================================================================
+void HEventManager::EraseListener(
+    uint32_t       typeId,
+    GenericFuncPtr listenFunc)
+{
+    auto itr = std::lower_bound(m_listeners.begin(), m_listeners.end(), typeId,
+                                [](const Listener& listener, uint32_t id) { return listener.typeId < id; });
+    for (; itr != m_listeners.end() && itr->typeId == typeId; itr++)
+    {
+        if (itr->listenFunc == listenFunc)
+        {
+            m_listeners.erase(itr);
+            return;
+        }
+    }
+}
 
-    if (m_eventListenerMap.find(typeHash) != m_eventListenerMap.end())
+// ================================================================================================================
+void HEventManager::Dispatch(
+    uint32_t    typeId,
+    const void* pEvent)
+{
+    // m_listeners doesn't change until the outermost dispatch ends, so the iterators stay valid through the nested
+    // SendEvent calls of the listeners.
+    m_dispatchDepth++;
+    auto itr = std::lower_bound(m_listeners.begin(), m_listeners.end(), typeId,
+                                [](const Listener& listener, uint32_t id) { return listener.typeId < id; });
+    for (; itr != m_listeners.end() && itr->typeId == typeId; itr++)
     {
-        // There are listeners for the target event type. Add the entity handle into the listener list.
-        m_eventListenerMap[typeHash].push_back(listenFunc);
+        itr->invokeFunc(itr->listenFunc, pEvent);
     }
-    else
+    m_dispatchDepth--;
+
+    if (m_dispatchDepth == 0 && !m_pendingListenerChanges.empty())
     {
-        // No listener for the target event type. Create the listener list and add the entity into it.
-        m_eventListenerMap[typeHash] = std::list<EventCallbackFuncPtr>();
-        m_eventListenerMap[typeHash].push_back(listenFunc);
+        MEMORY_TAG_SCOPE(MemoryTag::Events);
+        for (const PendingListenerChange& change : m_pendingListenerChanges)
+        {
+            if (change.isAdd)
+            {
+                InsertListener(change.listener);
+            }
+            else
+            {
+                EraseListener(change.listener.typeId, change.listener.listenFunc);
+            }
+        }
+        m_pendingListenerChanges.clear();
     }
 }
 
 // ================================================================================================================
-void HEventManager::SendEvent(
-    HEvent& hEvent)
+void HEventManager::DispatchPostedEvents()
 {
-    if (m_eventListenerMap.find(hEvent.GetEventType()) != m_eventListenerMap.end())
+    // Only drain what is in the queue now. The listeners may post new events.
+    m_drainedEvents.clear();
+    PostedEvent postedEvent;
+    while (m_drainedEvents.size() < POSTED_EVENT_QUEUE_CAPACITY && m_postedEvents.Pop(postedEvent))
+    {
+        m_drainedEvents.push_back(postedEvent);
+    }
+
+    // Walk backward to keep the last event of each coalesced type. The earlier ones are marked as superseded.
+    m_coalescedTypeIds.clear();
+    for (auto itr = m_drainedEvents.rbegin(); itr != m_drainedEvents.rend(); itr++)
+    {
+        if (itr->coalesce == 0)
+        {
+            continue;
+        }
+
+        if (std::find(m_coalescedTypeIds.begin(), m_coalescedTypeIds.end(), itr->typeId) != m_coalescedTypeIds.end())
+        {
+            itr->coalesce = 2;
+        }
+        else
+        {
+            m_coalescedTypeIds.push_back(itr->typeId);
+        }
+    }
+
+    for (const PostedEvent& event : m_drainedEvents)
     {
-        std::list<EventCallbackFuncPtr>& list = m_eventListenerMap[hEvent.GetEventType()];
-        for (auto& itr : list)
+        if (event.coalesce != 2)
         {
-            itr(hEvent.GetArgs());
+            Dispatch(event.typeId, event.payload);
         }
     }
-}
\ No newline at end of file
+}
@@ -1,50 +1,103 @@
 #pragma once
-#include <string>
-#include <unordered_map>
-#include <any>
-#include <list>
+#include <cstdint>
+#include <vector>
+#include "Events.h"
+#include "EventQueue.h"
 
-typedef std::unordered_map<size_t, std::any> HEventArguments; // Argument name -- Argument value
+// A listener is a free or static function that takes the event payload by const reference.
+template<typename EventType>
+using EventCallbackFuncPtr = void(*) (const EventType& event);
 
-class HEvent
+// Manage interested objects listening and registration.
+// The listeners of all event types are kept in one flat vector sorted by the event type id, so a dispatch is a binary
+// search plus a linear walk and it never allocates.
+// Registration, SendEvent and DispatchPostedEvents are main thread only. PostEvent can be called from any thread.
+// A listener can register or unregister listeners. The change is applied after the outermost dispatch returns, so the
+// event being dispatched still reaches the listeners it started with.
+class HEventManager
 {
 public:
-    explicit HEvent(const HEventArguments& arg, const std::string& type);
-    ~HEvent() {};
+    static constexpr uint32_t POSTED_EVENT_QUEUE_CAPACITY = 1024;
 
-    size_t GetEventType() const { return m_typeHash; }
-    HEventArguments& GetArgs() { return m_arg; }
+    HEventManager();
+    ~HEventManager() {};
 
-private:
-    HEventArguments m_arg;
-    size_t m_typeHash;
-    bool m_isHandled;
-};
+    template<typename EventType>
+    void RegisterListener(EventCallbackFuncPtr<EventType> listenFunc)
+    {
+        static_assert(IsValidEventType<EventType>, "Events must be trivially copyable and have a uint32_t TypeId.");
+        AddListener(EventType::TypeId, reinterpret_cast<GenericFuncPtr>(listenFunc), &InvokeListener<EventType>);
+    }
 
-/*
-class EventInteractionObject
-{
-public:
-    EventInteractionObject() {};
-    ~EventInteractionObject() {};
-};
-*/
+    template<typename EventType>
+    void UnregisterListener(EventCallbackFuncPtr<EventType> listenFunc)
+    {
+        RemoveListener(EventType::TypeId, reinterpret_cast<GenericFuncPtr>(listenFunc));
+    }
 
-typedef void(*EventCallbackFuncPtr) (HEventArguments args);
+    // Synchronously call all listeners of this event type on the calling thread.
+    template<typename EventType>
+    void SendEvent(const EventType& event)
+    {
+        static_assert(IsValidEventType<EventType>, "Events must be trivially copyable and have a uint32_t TypeId.");
+        Dispatch(EventType::TypeId, &event);
+    }
 
-// Manage interested objects listening and registration.
-class HEventManager
-{
-public:
-    HEventManager()
-        : m_eventListenerMap()
-    {};
-    ~HEventManager() {};
+    // Queue the event from any thread. It's dispatched on the main thread by the next DispatchPostedEvents().
+    // Returns false if the queue is full and the event is dropped.
+    template<typename EventType>
+    bool PostEvent(const EventType& event)
+    {
+        static_assert(IsValidEventType<EventType>, "Events must be trivially copyable and have a uint32_t TypeId.");
+        static_assert(sizeof(EventType) <= PostedEvent::MAX_PAYLOAD_SIZE, "The event is too big to be posted.");
+
+        PostedEvent postedEvent;
+        postedEvent.typeId = EventType::TypeId;
+        postedEvent.coalesce = IsCoalescedEventType<EventType>() ? 1 : 0;
+        memcpy(postedEvent.payload, &event, sizeof(EventType));
+        return m_postedEvents.Push(postedEvent);
+    }
 
-    void RegisterListener(const std::string& type, EventCallbackFuncPtr listenFunc);
-    void UnregisterListener(const std::string& type, EventCallbackFuncPtr listenFunc) {}
-    void SendEvent(HEvent& hEvent);
+    // Drain the posted events and dispatch them in the posting order. For the coalesced event types, only the last
+    // posted one is dispatched. The events posted by the listeners during this call wait for the next call.
+    void DispatchPostedEvents();
 
 private:
-    std::unordered_map<size_t, std::list<EventCallbackFuncPtr>> m_eventListenerMap; // Event type -- Linked list of registered function to execute when the event happens.
-};
\ No newline at end of file
+    typedef void(*GenericFuncPtr) ();
+    typedef void(*InvokeFuncPtr) (GenericFuncPtr listenFunc, const void* pEvent);
+
+    struct Listener
+    {
+        uint32_t       typeId;
+        GenericFuncPtr listenFunc;
+        InvokeFuncPtr  invokeFunc; // Casts the listener and the payload back to their types.
+    };
+
+    template<typename EventType>
+    static void InvokeListener(GenericFuncPtr listenFunc, const void* pEvent)
+    {
+        reinterpret_cast<EventCallbackFuncPtr<EventType>>(listenFunc)(*static_cast<const EventType*>(pEvent));
+    }
+
+    void AddListener(uint32_t typeId, GenericFuncPtr listenFunc, InvokeFuncPtr invokeFunc);
+    void RemoveListener(uint32_t typeId, GenericFuncPtr listenFunc);
+    void InsertListener(const Listener& newListener);
+    void EraseListener(uint32_t typeId, GenericFuncPtr listenFunc);
+    void Dispatch(uint32_t typeId, const void* pEvent);
+
+    struct PendingListenerChange
+    {
+        Listener listener;
+        bool     isAdd;
+    };
+
+    std::vector<Listener> m_listeners; // Sorted by the type id. Listeners of the same type keep the registration order.
+
+    // Registrations made by the listeners while m_listeners is walked. Applied in order when the dispatch ends.
+    uint32_t                           m_dispatchDepth;
+    std::vector<PendingListenerChange> m_pendingListenerChanges;
+
+    MPSCEventQueue           m_postedEvents;
+    std::vector<PostedEvent> m_drainedEvents;     // Reserved to the queue capacity. Reused every frame.
+    std::vector<uint32_t>    m_coalescedTypeIds;
+};
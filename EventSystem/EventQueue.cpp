@@ -0,0 +1,69 @@
+#include "EventQueue.h"
+#include "../Utils/MemoryTracker.h"
+#include <cassert>
+
+MPSCEventQueue::MPSCEventQueue(uint32_t capacity)
+    : m_cells(),
+      m_mask(capacity - 1),
+      m_enqueuePos(0),
+      m_dequeuePos(0)
+{
+    assert(capacity >= 2 && (capacity & (capacity - 1)) == 0 && "The event queue capacity must be a power of 2.");
+    {
+        // Allocated in the body, so the cells are charged to the events tag.
+        MEMORY_TAG_SCOPE(MemoryTag::Events);
+        m_cells = std::vector<Cell>(capacity);
+    }
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool MPSCEventQueue::Push(const PostedEvent& event)
+{
+    uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        Cell& cell = m_cells[pos & m_mask];
+        const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        const int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+        if (diff == 0)
+        {
+            // The cell is free for this position. Claim it.
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.event = event;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // The consumer hasn't released this cell yet. Full.
+            return false;
+        }
+        else
+        {
+            // Another producer took this position.
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool MPSCEventQueue::Pop(PostedEvent& oEvent)
+{
+    const uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    Cell& cell = m_cells[pos & m_mask];
+    const uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (static_cast<int64_t>(sequence) - static_cast<int64_t>(pos + 1) < 0)
+    {
+        // Empty, or the producer of this cell is still writing it.
+        return false;
+    }
+
+    oEvent = cell.event;
+    m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+    cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <vector>
+
+// Fixed size storage of one posted event. The payload is a copy of a trivially copyable event struct.
+struct PostedEvent
+{
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 48;
+
+    uint32_t typeId;
+    uint32_t coalesce; // 0: Always dispatched. 1: Only the last one of this type in a frame is dispatched. 2: Superseded.
+    alignas(8) uint8_t payload[MAX_PAYLOAD_SIZE];
+};
+
+// Bounded lock-free multi-producer single-consumer ring (Dmitry Vyukov's bounded queue).
+// Any thread can Push(). Only one thread at a time can Pop().
+class MPSCEventQueue
+{
+public:
+    explicit MPSCEventQueue(uint32_t capacity);
+    ~MPSCEventQueue() {}
+
+    // Returns false if the queue is full. The event is dropped in that case.
+    bool Push(const PostedEvent& event);
+    bool Pop(PostedEvent& oEvent);
+
+    uint32_t Capacity() const { return m_mask + 1; }
+
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<uint64_t> sequence;
+        PostedEvent           event;
+    };
+
+    std::vector<Cell> m_cells;
+    uint32_t          m_mask;
+
+    // Keep the producer and consumer positions on their own cache lines.
+    alignas(64) std::atomic<uint64_t> m_enqueuePos;
+    alignas(64) std::atomic<uint64_t> m_dequeuePos;
+};
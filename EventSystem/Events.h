@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include "../Utils/crc32.h"
+
+/*
+* Event types. Each event is a POD payload with a compile-time type id.
+* Add a new event by declaring a struct with a unique TypeId here.
+* Set Coalesce to true if only the last one matters when several are posted in one frame.
+*/
+
+struct WaitGpuIdleEvent
+{
+    static constexpr uint32_t TypeId = crc32("WaitGpuIdle");
+    static constexpr bool Coalesce = true;
+};
+
+struct ResizeSwapchainEvent
+{
+    static constexpr uint32_t TypeId = crc32("ResizeSwapchain");
+    static constexpr bool Coalesce = true;
+    uint32_t width;
+    uint32_t height;
+};
+
+template<typename EventType>
+constexpr bool IsValidEventType = std::is_trivially_copyable_v<EventType> && std::is_same_v<decltype(EventType::TypeId), const uint32_t>;
+
+template<typename EventType>
+constexpr bool IsCoalescedEventType()
+{
+    if constexpr (requires { EventType::Coalesce; })
+    {
+        return EventType::Coalesce;
+    }
+    return false;
+}
@@ -0,0 +1,265 @@
+#include "JobSystem.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include <cassert>
+#include <string>
+
+JobSystem* JobSystem::m_pThis = nullptr;
+
+namespace
+{
+    constexpr uint32_t INVALID_THREAD_IDX = UINT32_MAX;
+
+    // The spins of an idle worker before it goes to sleep.
+    constexpr uint32_t IDLE_SPIN_CNT = 64;
+
+    thread_local uint32_t t_jobThreadIdx = INVALID_THREAD_IDX;
+
+    uint32_t NextRandom(uint32_t& state)
+    {
+        // xorshift32
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+// ================================================================================================================
+void JobSystem::Create(uint32_t workerCnt)
+{
+    assert(m_pThis == nullptr && "The job system is already created.");
+    if (workerCnt == 0)
+    {
+        const uint32_t hardwareThreadCnt = std::thread::hardware_concurrency();
+        workerCnt = hardwareThreadCnt > 1 ? hardwareThreadCnt - 1 : 0;
+    }
+    m_pThis = new JobSystem(workerCnt);
+}
+
+// ================================================================================================================
+void JobSystem::Destroy()
+{
+    delete m_pThis;
+    m_pThis = nullptr;
+}
+
+// ================================================================================================================
+bool JobSystem::IsJobThread()
+{
+    return m_pThis != nullptr && t_jobThreadIdx != INVALID_THREAD_IDX;
+}
+
+// ================================================================================================================
+JobSystem::JobSystem(uint32_t workerCnt)
+    : m_quit(false),
+      m_workGeneration(0),
+      m_sleepingCnt(0)
+{
+    MEMORY_TAG_SCOPE(MemoryTag::Jobs);
+    for (uint32_t i = 0; i < workerCnt + 1; i++)
+    {
+        m_threadContexts.push_back(std::make_unique<ThreadContext>());
+        m_threadContexts[i]->rngState = 0x9E3779B9u * (i + 1);
+    }
+
+    t_jobThreadIdx = 0;
+    for (uint32_t i = 1; i < workerCnt + 1; i++)
+    {
+        m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+    }
+}
+
+// ================================================================================================================
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_quit.store(true, std::memory_order_seq_cst);
+    }
+    m_sleepCv.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    t_jobThreadIdx = INVALID_THREAD_IDX;
+}
+
+// ================================================================================================================
+void JobSystem::WorkerMain(uint32_t threadIdx)
+{
+    t_jobThreadIdx = threadIdx;
+    if (TimePerfManager* pTimePerfManager = TimePerfManager::GetInstance())
+    {
+        pTimePerfManager->SetCurrentThreadName("Job Worker " + std::to_string(threadIdx));
+    }
+
+    uint32_t idleSpinCnt = 0;
+    while (!m_quit.load(std::memory_order_relaxed))
+    {
+        // Read the generation before the last search, so a job submitted after the search keeps the worker awake.
+        const uint64_t workGeneration = m_workGeneration.load(std::memory_order_seq_cst);
+        if (RunOneJob(threadIdx))
+        {
+            idleSpinCnt = 0;
+            continue;
+        }
+
+        if (idleSpinCnt++ < IDLE_SPIN_CNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepingCnt.fetch_add(1, std::memory_order_seq_cst);
+        m_sleepCv.wait(lock, [this, workGeneration]()
+        {
+            return m_quit.load(std::memory_order_seq_cst) || m_workGeneration.load(std::memory_order_seq_cst) != workGeneration;
+        });
+        m_sleepingCnt.fetch_sub(1, std::memory_order_relaxed);
+        idleSpinCnt = 0;
+    }
+}
+
+// ================================================================================================================
+Job* JobSystem::AllocateJob()
+{
+    const uint32_t threadIdx = t_jobThreadIdx;
+    assert(threadIdx != INVALID_THREAD_IDX && "Jobs can only be submitted from the creating thread or a job.");
+    ThreadContext& context = *m_threadContexts[threadIdx];
+
+    // The slots are recycled in the ring order. A slot whose job hasn't finished yet is skipped, since it may be a job
+    // further up this thread's own stack. Only when all slots are busy, run the other jobs until one frees up.
+    for (;;)
+    {
+        for (uint32_t i = 0; i < MAX_JOBS_PER_THREAD; i++)
+        {
+            Job& job = context.jobPool[context.nextJobIdx++ & (MAX_JOBS_PER_THREAD - 1)];
+            if (job.inUse.load(std::memory_order_acquire) == 0)
+            {
+                job.inUse.store(1, std::memory_order_relaxed);
+                job.memoryTag = MemoryTracker::GetCurrentTag();
+                return &job;
+            }
+        }
+
+        if (!RunOneJob(threadIdx))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ================================================================================================================
+void JobSystem::Submit(Job* pJob, JobCounter& counter)
+{
+    pJob->pCounter = &counter;
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+
+    if (!m_threadContexts[t_jobThreadIdx]->deque.Push(pJob))
+    {
+        // The deque is full. Run it here instead.
+        Execute(pJob);
+        return;
+    }
+    WakeWorker();
+}
+
+// ================================================================================================================
+void JobSystem::SubmitRange(const RangeJobPayload& rangePayload, JobCounter& counter)
+{
+    Job* pJob = AllocateJob();
+    pJob->pInvoke = &JobSystem::InvokeRangeJob;
+    pJob->pDependency = nullptr;
+    memcpy(pJob->payload, &rangePayload, sizeof(RangeJobPayload));
+    Submit(pJob, counter);
+}
+
+// ================================================================================================================
+void JobSystem::InvokeRangeJob(Job& job)
+{
+    RangeJobPayload rangePayload;
+    memcpy(&rangePayload, job.payload, sizeof(RangeJobPayload));
+
+    // Keep the left half and hand the right half out until the range is down to the grain size.
+    while (rangePayload.end - rangePayload.begin > rangePayload.grainSize)
+    {
+        RangeJobPayload rightPayload = rangePayload;
+        rightPayload.begin = rangePayload.begin + (rangePayload.end - rangePayload.begin) / 2;
+        rangePayload.end = rightPayload.begin;
+        m_pThis->SubmitRange(rightPayload, *job.pCounter);
+    }
+    rangePayload.pRangeInvoke(rangePayload.pFunc, rangePayload.begin, rangePayload.end);
+}
+
+// ================================================================================================================
+void JobSystem::Wait(const JobCounter& counter)
+{
+    const uint32_t threadIdx = t_jobThreadIdx;
+    assert(threadIdx != INVALID_THREAD_IDX && "Only the creating thread or a job can wait.");
+    while (counter.m_pending.load(std::memory_order_acquire) != 0)
+    {
+        if (!RunOneJob(threadIdx))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// ================================================================================================================
+bool JobSystem::RunOneJob(uint32_t threadIdx)
+{
+    ThreadContext& context = *m_threadContexts[threadIdx];
+    Job* pJob = nullptr;
+    if (!context.deque.Pop(pJob))
+    {
+        // Start from a random victim, so the thieves don't all hit the same deque.
+        const uint32_t threadCnt = static_cast<uint32_t>(m_threadContexts.size());
+        const uint32_t firstVictim = NextRandom(context.rngState) % threadCnt;
+        bool stolen = false;
+        for (uint32_t i = 0; i < threadCnt && !stolen; i++)
+        {
+            const uint32_t victim = (firstVictim + i) % threadCnt;
+            stolen = victim != threadIdx && m_threadContexts[victim]->deque.Steal(pJob);
+        }
+
+        if (!stolen)
+        {
+            return false;
+        }
+    }
+
+    Execute(pJob);
+    return true;
+}
+
+// ================================================================================================================
+void JobSystem::Execute(Job* pJob)
+{
+    if (pJob->pDependency != nullptr)
+    {
+        // Help with the other jobs until the dependency is done.
+        Wait(*pJob->pDependency);
+    }
+
+    {
+        MEMORY_TAG_SCOPE(pJob->memoryTag);
+        pJob->pInvoke(*pJob);
+    }
+
+    // Release the slot before the counter. Once the counter reaches zero the waiter may destroy it.
+    JobCounter* pCounter = pJob->pCounter;
+    pJob->inUse.store(0, std::memory_order_release);
+    pCounter->m_pending.fetch_sub(1, std::memory_order_release);
+}
+
+// ================================================================================================================
+void JobSystem::WakeWorker()
+{
+    m_workGeneration.fetch_add(1, std::memory_order_seq_cst);
+    if (m_sleepingCnt.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_sleepCv.notify_one();
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "WorkStealingDeque.h"
+#include "../Utils/MemoryTracker.h"
+
+class JobSystem;
+
+// Counts the unfinished jobs of a group. Run() increments it and the job's completion decrements it. It must outlive
+// the jobs that reference it, which Wait() on it guarantees.
+class JobCounter
+{
+public:
+    JobCounter() : m_pending(0) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+    uint32_t GetPending() const { return m_pending.load(std::memory_order_relaxed); }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> m_pending;
+};
+
+// One unit of work. The callable is copied into the payload, so it must be small and trivially copyable -- e.g. a
+// lambda capturing by reference.
+struct Job
+{
+    typedef void(*InvokeFuncPtr)(Job& job);
+    static constexpr uint32_t PAYLOAD_SIZE = 48;
+
+    InvokeFuncPtr         pInvoke = nullptr;
+    JobCounter*           pCounter = nullptr;
+    const JobCounter*     pDependency = nullptr;
+    MemoryTag             memoryTag = MemoryTag::Untagged; // The submitter's tag, so the job's allocations are charged to it.
+    std::atomic<uint32_t> inUse{ 0 };
+    alignas(16) uint8_t   payload[PAYLOAD_SIZE];
+};
+
+// Work stealing job scheduler. Each worker and the main thread own a Chase-Lev deque and a ring of job slots. A thread
+// pushes and pops its own deque and steals from the others when it runs dry. The idle workers sleep on a condition
+// variable. Wait() runs the other jobs until the counter reaches zero, so a job can fork and join nested jobs without
+// blocking a worker, and the main thread helps instead of idling.
+// Jobs can only be submitted from the thread that called Create() or from inside a job.
+class JobSystem
+{
+public:
+    static constexpr uint32_t MAX_JOBS_PER_THREAD = 4096;
+
+    // 0 means one worker per hardware thread besides the calling thread.
+    static void Create(uint32_t workerCnt = 0);
+    static void Destroy();
+    static JobSystem* GetInstance() { return m_pThis; }
+
+    uint32_t GetWorkerCnt() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    // Whether the calling thread can submit jobs -- the creating thread or a worker.
+    static bool IsJobThread();
+
+    // Schedule func() and add it to the counter. With a dependency, the job first waits (helping) for that counter.
+    template<typename Func>
+    void Run(JobCounter& counter, Func func, const JobCounter* pDependency = nullptr)
+    {
+        static_assert(sizeof(Func) <= Job::PAYLOAD_SIZE, "The job's captures don't fit into the payload. Capture by reference.");
+        static_assert(std::is_trivially_copyable_v<Func> && std::is_trivially_destructible_v<Func>,
+                      "The job must be trivially copyable. Capture by reference or by pointer.");
+
+        Job* pJob = AllocateJob();
+        pJob->pInvoke = [](Job& job) { (*reinterpret_cast<Func*>(job.payload))(); };
+        pJob->pDependency = pDependency;
+        memcpy(pJob->payload, &func, sizeof(Func));
+        Submit(pJob, counter);
+    }
+
+    // Run the other jobs until the counter reaches zero.
+    void Wait(const JobCounter& counter);
+
+    // Call func(rangeBegin, rangeEnd) over [begin, end) in ranges of at most grainSize and return once all are done.
+    // The ranges are split in halves recursively, so the thieves take the big halves first. Falls back to one inline
+    // call when there is no job system or the calling thread isn't a job thread.
+    template<typename Func>
+    static void ParallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const Func& func)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        JobSystem* pJobSystem = m_pThis;
+        if (pJobSystem == nullptr || pJobSystem->m_workers.empty() || !IsJobThread() || end - begin <= grainSize)
+        {
+            func(begin, end);
+            return;
+        }
+
+        RangeJobPayload rangePayload;
+        rangePayload.pFunc = &func;
+        rangePayload.pRangeInvoke = [](const void* pFunc, uint32_t rangeBegin, uint32_t rangeEnd)
+        {
+            (*static_cast<const Func*>(pFunc))(rangeBegin, rangeEnd);
+        };
+        rangePayload.begin = begin;
+        rangePayload.end = end;
+        rangePayload.grainSize = grainSize == 0 ? 1 : grainSize;
+
+        JobCounter counter;
+        pJobSystem->SubmitRange(rangePayload, counter);
+        pJobSystem->Wait(counter);
+    }
+
+private:
+    struct RangeJobPayload
+    {
+        const void* pFunc;
+        void(*pRangeInvoke)(const void* pFunc, uint32_t rangeBegin, uint32_t rangeEnd);
+        uint32_t begin;
+        uint32_t end;
+        uint32_t grainSize;
+    };
+
+    struct ThreadContext
+    {
+        ThreadContext()
+            : deque(MAX_JOBS_PER_THREAD),
+              jobPool(MAX_JOBS_PER_THREAD),
+              nextJobIdx(0),
+              rngState(0)
+        {}
+
+        WorkStealingDeque<Job*> deque;
+        std::vector<Job>        jobPool;
+        uint32_t                nextJobIdx;
+        uint32_t                rngState;
+    };
+
+    explicit JobSystem(uint32_t workerCnt);
+    ~JobSystem();
+
+    void WorkerMain(uint32_t threadIdx);
+
+    Job* AllocateJob();
+    void Submit(Job* pJob, JobCounter& counter);
+    void SubmitRange(const RangeJobPayload& rangePayload, JobCounter& counter);
+    static void InvokeRangeJob(Job& job);
+
+    // Pop a job from the own deque or steal one from the others, then run it. Returns false if none was found.
+    bool RunOneJob(uint32_t threadIdx);
+    void Execute(Job* pJob);
+    void WakeWorker();
+
+    std::vector<std::unique_ptr<ThreadContext>> m_threadContexts; // [0] is the creating thread.
+    std::vector<std::thread>                    m_workers;
+
+    std::atomic<bool>       m_quit;
+    std::atomic<uint64_t>   m_workGeneration; // Bumped on each submit, so a worker going to sleep can spot new work.
+    std::atomic<uint32_t>   m_sleepingCnt;
+    std::mutex              m_sleepMutex;
+    std::condition_variable m_sleepCv;
+
+    static JobSystem* m_pThis;
+};
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Chase-Lev work stealing deque with the memory orders from "Correct and Efficient Work-Stealing for Weak Memory
+// Models" (Le et al. 2013). The owner thread pushes and pops at the bottom in LIFO order. Any other thread steals from
+// the top in FIFO order. The capacity is fixed. Push() returns false when it's full, and the caller runs the item itself.
+// T must be a pointer or another lock-free trivially copyable type.
+template<typename T>
+class WorkStealingDeque
+{
+public:
+    explicit WorkStealingDeque(uint32_t capacity)
+        : m_items(capacity),
+          m_mask(capacity - 1),
+          m_top(0),
+          m_bottom(0)
+    {}
+
+    // Owner thread only.
+    bool Push(T item)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top > static_cast<int64_t>(m_mask))
+        {
+            return false;
+        }
+        m_items[bottom & m_mask].store(item, std::memory_order_relaxed);
+        // A release store instead of the paper's release fence. Same guarantee, and visible to the thread sanitizers.
+        m_bottom.store(bottom + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner thread only.
+    bool Pop(T& oItem)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            // Empty.
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        oItem = m_items[bottom & m_mask].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // The last item. Race against the thieves for it.
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    // Any thread.
+    bool Steal(T& oItem)
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom)
+        {
+            return false;
+        }
+
+        oItem = m_items[top & m_mask].load(std::memory_order_relaxed);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    // A hint. The result can be stale by the time it's used.
+    bool Empty() const
+    {
+        return m_top.load(std::memory_order_relaxed) >= m_bottom.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<std::atomic<T>> m_items;
+    uint64_t                    m_mask;
+
+    // Keep the thieves' and the owner's ends on their own cache lines.
+    alignas(64) std::atomic<int64_t> m_top;
+    alignas(64) std::atomic<int64_t> m_bottom;
+};
@@ -3,16 +3,33 @@
 #include "Utils/AssetManager.h"
 #include "Scene/Level.h"
 #include "Scene/Camera.h"
+#include "Scene/SceneStreamer.h"
 #include "TimePerfManager/TimePerfManager.h"
+#include "TimePerfManager/D3D12GpuTimestampSource.h"
+#include "Utils/MemoryTracker.h"
+#include "Utils/FrameArena.h"
+#include "JobSystem/JobSystem.h"
 #include "RenderBackend/HWRTRenderBackend.h"
 #include "RenderBackend/ForwardRenderBackend.h"
 #include <dxgidebug.h>
 #include <filesystem>
 #include <chrono>
+#include <iostream>
 #pragma comment(lib, "dxguid.lib")
 
 namespace fs = std::filesystem;
 
+// The GPU upload bytes per frame while a scene streams in. At least one mesh or texture set goes up per frame.
+constexpr uint64_t SCENE_STREAMING_UPLOAD_BUDGET_BYTES = 8 * 1024 * 1024;
+
+namespace
+{
+    float ElapsedMs(std::chrono::high_resolution_clock::time_point startTime)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+}
+
 bool DX12MiniRenderer::show_demo_window = true;
 bool DX12MiniRenderer::show_another_window = true;
 bool DX12MiniRenderer::clear_color = true;
@@ -73,7 +90,7 @@ void DX12MiniRenderer::TempRendererWaitGpuIdle()
     tmpCmdQueuefence->Release();
 }
 
-void DX12MiniRenderer::WaitGpuIdle(HEventArguments args)
+void DX12MiniRenderer::WaitGpuIdle(const WaitGpuIdleEvent& event)
 {
     TempRendererWaitGpuIdle();
 }
@@ -115,6 +132,13 @@ void DX12MiniRenderer::GenerateImGUIStates()
     float fps = 0.f;
     float cpuTime = 0.f;
     float gpuTime = 0.f;
+    TimePerfManager* pTimePerfManager = TimePerfManager::GetInstance();
+    if (pTimePerfManager)
+    {
+        fps = pTimePerfManager->GetFps();
+        cpuTime = pTimePerfManager->GetCpuFrameStats().avgMs;
+        gpuTime = pTimePerfManager->GetGpuFrameStats().avgMs;
+    }
     uint32_t displayWidth = 100;
     uint32_t displayHeight = 100;
     uint32_t renderWidth = 100;
@@ -134,6 +158,95 @@ void DX12MiniRenderer::GenerateImGUIStates()
         ImGui::Begin("Debug Menu", &show_another_window, ImGuiWindowFlags_AlwaysAutoResize);   // Pass a pointer to our bool variable (the window will have a closing button that will clear the bool when clicked)
         ImGui::Text("FPS: %.1f, CPU time: %.1f ms, GPU time: %.1f ms", fps, cpuTime, gpuTime);
         ImGui::Text("Display res: %d x %d, Render Res: %d x %d", displayWidth, displayHeight, renderWidth, renderHeight);
+        if (DX12MiniRenderer::m_pThis != nullptr)
+        {
+            const DX12MiniRenderer* pApp = DX12MiniRenderer::m_pThis;
+            if (pApp->m_pSceneStreamer != nullptr && !pApp->m_pSceneStreamer->IsFullyLoaded())
+            {
+                const SceneStreamingStats& streamingStats = pApp->m_pSceneStreamer->GetStats();
+                ImGui::Text("Streaming: %d / %d assets loaded, %d prims visible, %d textured, %.1f MB uploaded",
+                            streamingStats.loadedAssetCnt, streamingStats.requestedAssetCnt, streamingStats.visiblePrimCnt,
+                            streamingStats.texturedPrimCnt, streamingStats.uploadedBytes / (1024.f * 1024.f));
+            }
+            else
+            {
+                ImGui::Text("Time to first frame: %.1f ms, Time to fully loaded: %.1f ms", pApp->m_timeToFirstFrameMs, pApp->m_timeToFullyLoadedMs);
+            }
+        }
+        if (DX12MiniRenderer::m_pThis != nullptr && DX12MiniRenderer::m_pThis->m_pRendererBackend &&
+            DX12MiniRenderer::m_pThis->m_pRendererBackend->GetType() == RendererBackendType::Forward)
+        {
+            ForwardRenderer* pForwardRenderer = dynamic_cast<ForwardRenderer*>(DX12MiniRenderer::m_pThis->m_pRendererBackend);
+            const OcclusionCullingStats& stats = pForwardRenderer->GetOcclusionCullingStats();
+            ImGui::Checkbox("Occlusion Culling", &pForwardRenderer->OcclusionCullingEnabled());
+            ImGui::Text("Occluders: %d (%d tris), Culled: %d / %d, Raster: %.3f ms, Test: %.3f ms",
+                        stats.occluderCnt, stats.occluderTriCnt, stats.culledCnt, stats.testedCnt, stats.rasterizeMs, stats.testMs);
+            const ForwardDrawStats& drawStats = pForwardRenderer->GetDrawStats();
+            ImGui::Text("Draw calls: %d (%d primitives before instancing)", drawStats.drawCallCnt, drawStats.visiblePrimCnt);
+            ImGui::Checkbox("Mesh LODs", &pForwardRenderer->MeshLodsEnabled());
+            ImGui::Text("Triangles: %llu (%llu with the full meshes)", static_cast<unsigned long long>(drawStats.drawnTriCnt),
+                        static_cast<unsigned long long>(drawStats.fullTriCnt));
+            const MeshletCullingStats& meshletStats = pForwardRenderer->GetMeshletCullingStats();
+            ImGui::Checkbox("Meshlet Culling", &pForwardRenderer->MeshletCullingEnabled());
+            ImGui::Text("Meshlets: %d tested, %d frustum culled, %d cone culled (%llu tris)", meshletStats.testedCnt,
+                        meshletStats.frustumCulledCnt, meshletStats.coneCulledCnt, static_cast<unsigned long long>(meshletStats.culledTriCnt));
+            const ClusteredLightCullingStats& lightStats = pForwardRenderer->GetLightCullingStats();
+            ImGui::Text("Point lights: %d, Light indices: %d (%d dropped in %d full clusters), Cluster build: %.3f ms",
+                        lightStats.lightCnt, lightStats.lightIndexCnt, lightStats.overflowCnt, lightStats.overflowClusterCnt, lightStats.buildMs);
+        }
+        if (pTimePerfManager && ImGui::CollapsingHeader("CPU Zones"))
+        {
+            const PerfStats& cpuStats = pTimePerfManager->GetCpuFrameStats();
+            ImGui::Text("CPU frame min: %.2f ms, max: %.2f ms, p99: %.2f ms", cpuStats.minMs, cpuStats.maxMs, cpuStats.p99Ms);
+            ImGui::Text("Zone overhead: %.1f ns, Dropped zones: %d", pTimePerfManager->GetZoneOverheadNs(), pTimePerfManager->GetDroppedZoneCnt());
+            if (pTimePerfManager->IsCapturing())
+            {
+                ImGui::Text("Capturing %s ...", pTimePerfManager->GetLastCapturePath().c_str());
+            }
+            else
+            {
+                static uint32_t captureIdx = 0;
+                if (ImGui::Button("Capture 120 Frames Trace"))
+                {
+                    pTimePerfManager->RequestCapture(120, "PerfCapture_" + std::to_string(captureIdx++) + ".json");
+                }
+                if (!pTimePerfManager->GetLastCapturePath().empty())
+                {
+                    ImGui::SameLine();
+                    ImGui::Text("Last: %s", pTimePerfManager->GetLastCapturePath().c_str());
+                }
+            }
+            for (const PerfZoneStats& zoneStats : pTimePerfManager->GetZoneStats())
+            {
+                ImGui::Text("%s %-28s avg %.3f / p99 %.3f / max %.3f ms (x%d)", zoneStats.isGpu ? "GPU" : "CPU", zoneStats.pName, zoneStats.stats.avgMs,
+                            zoneStats.stats.p99Ms, zoneStats.stats.maxMs, zoneStats.stats.lastCallCnt);
+            }
+        }
+        if (ImGui::CollapsingHeader("Memory"))
+        {
+            if (!MemoryTracker::IsEnabled())
+            {
+                ImGui::Text("Memory tracking is disabled. Build with ENABLE_MEMORY_TRACKING.");
+            }
+            else if (DX12MiniRenderer::m_pThis != nullptr)
+            {
+                ImGui::Text("Heap allocations per frame: %llu", static_cast<unsigned long long>(DX12MiniRenderer::m_pThis->m_frameHeapAllocCnt));
+            }
+            if (DX12MiniRenderer::m_pThis != nullptr && !DX12MiniRenderer::m_pThis->m_frameContexts.empty())
+            {
+                const FrameArena* pFrameArena = DX12MiniRenderer::m_pThis->m_frameContexts[0].pFrameArena;
+                ImGui::Text("Frame arena: %.1f KB high water / %.1f KB block", pFrameArena->GetHighWaterBytes() / 1024.f, pFrameArena->GetBlockSize() / 1024.f);
+            }
+            for (uint32_t i = 0; i < static_cast<uint32_t>(MemoryTag::Count); i++)
+            {
+                const MemoryTag tag = static_cast<MemoryTag>(i);
+                const MemoryTagStats memStats = MemoryTracker::GetStats(tag);
+                ImGui::Text("%-14s live %.2f MB / peak %.2f MB (%llu allocs, %llu live)", MemoryTracker::GetTagName(tag),
+                            memStats.liveBytes / (1024.0 * 1024.0), memStats.peakBytes / (1024.0 * 1024.0),
+                            static_cast<unsigned long long>(memStats.allocCnt),
+                            static_cast<unsigned long long>(memStats.allocCnt - memStats.freeCnt));
+            }
+        }
         // if (ImGui::Button("Close Me"))
             // show_another_window = false;
         ImGui::End();
@@ -162,6 +275,8 @@ void DX12MiniRenderer::InitTempRendererInfarstructure()
         m_frameContexts[i].Fence->Signal(1);
 
         m_frameContexts[i].FenceEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+        m_frameContexts[i].pFrameArena = new FrameArena();
     }
 
     // m_pD3dDevice->CreateCommandList1(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_frameContexts[0].CommandAllocator, nullptr, IID_PPV_ARGS(&m_pD3dCommandList));
@@ -185,6 +300,9 @@ FrameContext* DX12MiniRenderer::WaitForCurrentFrameResources()
     {
         frameCtx->Fence->Signal(0);
     }
+
+    // The GPU is done with this frame's last use, so its transient CPU data can be recycled.
+    frameCtx->pFrameArena->Reset();
     return frameCtx;
 }
 
@@ -198,13 +316,30 @@ void DX12MiniRenderer::CleanupTempRendererInfarstructure()
         if (itr.CommandAllocator) { itr.CommandAllocator->Release(); itr.CommandAllocator = nullptr; }
         if (itr.Fence) { itr.Fence->Release(); itr.Fence = nullptr; }
         if (itr.FenceEvent) { CloseHandle(itr.FenceEvent); itr.FenceEvent = nullptr; }
+        if (itr.pFrameArena) { delete itr.pFrameArena; itr.pFrameArena = nullptr; }
     }
 }
 
-void DX12MiniRenderer::Init(std::string sceneYaml)
+void DX12MiniRenderer::Init(std::string sceneYaml, const RendererInitOptions& options)
 {
+    m_initStartTime = std::chrono::high_resolution_clock::now();
+    TimePerfManager::Create();
+    m_pTimePerfManager = TimePerfManager::GetInstance();
+    m_pTimePerfManager->SetCurrentThreadName("Main Thread");
+    m_pTimePerfManager->MeasureZoneOverheadNs(1 << 16);
+    if (options.startupTraceFrameCnt > 0)
+    {
+        m_pTimePerfManager->RequestCapture(options.startupTraceFrameCnt, "StartupTrace.json");
+    }
+
+    // After the TimePerfManager, so the workers register their thread names. The scene loading already uses it.
+    JobSystem::Create();
+
     InitDevice();
     InitTempRendererInfarstructure();
+
+    m_pGpuTimestampSource = new D3D12GpuTimestampSource(m_pD3dDevice, m_pD3dCommandQueue, TimePerfManager::GetRequiredGpuQueryCnt(UIManager::NUM_BACK_BUFFERS));
+    m_pTimePerfManager->InitGpuTimestamps(m_pGpuTimestampSource, UIManager::NUM_BACK_BUFFERS);
     m_pUIManager = new UIManager(m_pD3dDevice, &m_eventManager);
     m_pUIManager->Init(m_pD3dCommandQueue);
     m_pUIManager->SetCustomImGUIFunc(GenerateImGUIStates);
@@ -212,10 +347,39 @@ void DX12MiniRenderer::Init(std::string sceneYaml)
 
     m_pAssetManager = new AssetManager();
     g_pAssetManager = m_pAssetManager;
+    m_pAssetManager->SetVertexFormat(options.vertexFormat);
 
     // Tmp Load Test Triangle Level
     m_pLevel = new Level();
-    m_sceneAssetLoader.LoadAsLevel(sceneYaml, m_pLevel);
+    m_sceneAssetLoader.SetTextureCompression(options.textureCompression);
+    m_sceneAssetLoader.SetMeshOptimization(options.meshOptimization);
+    m_sceneAssetLoader.SetMeshLodCnt(options.meshLodCnt);
+    m_sceneAssetLoader.SetBuildMeshlets(options.buildMeshlets);
+    if (options.streamScene)
+    {
+        m_pSceneStreamer = new SceneStreamer();
+        m_sceneAssetLoader.SetSceneStreamer(m_pSceneStreamer);
+    }
+    {
+        PERF_ZONE("Load Level");
+        m_sceneAssetLoader.LoadAsLevel(sceneYaml, m_pLevel);
+    }
+    m_sceneAssetLoader.SetSceneStreamer(nullptr);
+
+    if (m_pSceneStreamer)
+    {
+        m_pSceneStreamer->Start();
+        // The path tracer builds its acceleration structures from the whole scene in its init.
+        if (m_pLevel->m_rendererBackendType == RendererBackendType::PathTracing)
+        {
+            m_pSceneStreamer->Flush();
+        }
+    }
+    if (m_pSceneStreamer == nullptr || m_pSceneStreamer->IsFullyLoaded())
+    {
+        m_timeToFullyLoadedMs = ElapsedMs(m_initStartTime);
+        m_pAssetManager->PrintTextureCacheStats();
+    }
     // m_sceneAssetLoader.LoadAsLevel("C:\\JiaruiYan\\Projects\\DX12MiniRenderer\\Assets\\SampleScene\\GLTFs\\\DXRMilestoneScene\\data.yaml", m_pLevel);
     // m_sceneAssetLoader.LoadAsLevel("C:\\JiaruiYan\\Projects\\DX12MiniRenderer\\Assets\\SampleScene\\GLTFs\\\DXRMilestoneScene\\DXRMilestone.yaml", m_pLevel);
     // m_sceneAssetLoader.LoadAsLevel("C:\\JiaruiYan\\Projects\\DX12MiniRenderer\\Assets\\SampleScene\\GLTFs\\\CornellBoxMultiMaterials\\CornellboxMultiMaterial.yaml", m_pLevel);
@@ -235,7 +399,7 @@ void DX12MiniRenderer::Init(std::string sceneYaml)
         m_pRendererBackend = new ForwardRenderer();
     }
 
-    m_eventManager.RegisterListener("WaitGpuIdle", DX12MiniRenderer::WaitGpuIdle);
+    m_eventManager.RegisterListener<WaitGpuIdleEvent>(DX12MiniRenderer::WaitGpuIdle);
 
     uint32_t width = 0;
     uint32_t height = 0;
@@ -252,26 +416,54 @@ void DX12MiniRenderer::Init(std::string sceneYaml)
     initStruct.pLevel = m_pLevel;
     initStruct.pInitFrameContext = &m_frameContexts[0];
     initStruct.pCommandList = m_pD3dCommandList;
-    m_pRendererBackend->Init(initStruct);
+    {
+        PERF_ZONE("Renderer Backend Init");
+        m_pRendererBackend->Init(initStruct);
+    }
     
-    m_eventManager.RegisterListener("ResizeSwapchain", RendererBackend::OnResizeCallback);
+    m_eventManager.RegisterListener<ResizeSwapchainEvent>(RendererBackend::OnResizeCallback);
 }
 
 void DX12MiniRenderer::Run()
 {
     auto timeStamp = std::chrono::high_resolution_clock::now();
 
+    uint64_t frameStartAllocCnt = MemoryTracker::GetTotalAllocCnt();
     while (m_pUIManager->ContinueRunning())
     {
+        m_pTimePerfManager->NewFrameStart();
+        const uint64_t allocCnt = MemoryTracker::GetTotalAllocCnt();
+        m_frameHeapAllocCnt = allocCnt - frameStartAllocCnt;
+        frameStartAllocCnt = allocCnt;
+
         auto nowTimeStamp = std::chrono::high_resolution_clock::now();
         auto elapsedSec = std::chrono::duration_cast<std::chrono::milliseconds>(nowTimeStamp - timeStamp);
         timeStamp = nowTimeStamp;
 
         float deltaSec = float(elapsedSec.count()) / 1000.0f;
-        m_pUIManager->Tick(deltaSec);
+        {
+            PERF_ZONE("UI Tick");
+            m_pUIManager->Tick(deltaSec);
+        }
+
+        // Handle the events posted from other threads since the last frame.
+        m_eventManager.DispatchPostedEvents();
 
         // Temp Renderer
         FrameContext* frameCtx = WaitForCurrentFrameResources();
+
+        // The previous frame is done on the GPU, so the streamed primitives can swap their resources.
+        if (m_pSceneStreamer != nullptr && !m_pSceneStreamer->IsFullyLoaded())
+        {
+            m_pSceneStreamer->Tick(SCENE_STREAMING_UPLOAD_BUDGET_BYTES);
+            if (m_pSceneStreamer->IsFullyLoaded())
+            {
+                m_timeToFullyLoadedMs = ElapsedMs(m_initStartTime);
+                std::cout << "Time to fully loaded: " << m_timeToFullyLoadedMs << " ms" << std::endl;
+                m_pAssetManager->PrintTextureCacheStats();
+            }
+        }
+
         ID3D12Resource* frameCRT = m_pUIManager->GetCurrentMainRTResource();
         D3D12_CPU_DESCRIPTOR_HANDLE frameCRTDescriptor = m_pUIManager->GetCurrentMainRTDescriptor();
 
@@ -313,6 +505,8 @@ void DX12MiniRenderer::Run()
         }
 
         m_pD3dCommandList->Reset(frameCtx->CommandAllocator, nullptr);
+        m_pGpuTimestampSource->SetCommandList(m_pD3dCommandList);
+        m_pTimePerfManager->GpuFrameBegin(m_frameSerial);
         m_pD3dCommandList->ResourceBarrier(1, &barrier);
 
         ImVec4 clear_color = ImVec4(m_pLevel->m_backgroundColor[0], 
@@ -324,43 +518,77 @@ void DX12MiniRenderer::Run()
 
         // Render Scene
         RenderTargetInfo rtInfo{frameCRT, frameCRTDescriptor, m_pUIManager->GetCurrentRTResourceDesc()};
-        m_pRendererBackend->RenderTick(m_pD3dCommandList, rtInfo);
+        {
+            PERF_ZONE("Render Tick");
+            m_pRendererBackend->SetFrameArena(frameCtx->pFrameArena);
+            m_pRendererBackend->RenderTick(m_pD3dCommandList, rtInfo);
+        }
         
         // Render Dear ImGui graphics
         m_pD3dCommandList->OMSetRenderTargets(1, &frameCRTDescriptor, FALSE, nullptr); // Bind the render target.
         m_pD3dCommandList->SetDescriptorHeaps(1, &imGUIDescriptorHeap);
 
-        m_pUIManager->RecordDrawData(m_pD3dCommandList);
+        {
+            GPU_PERF_ZONE("ImGui");
+            m_pUIManager->RecordDrawData(m_pD3dCommandList);
+        }
         
         barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_RENDER_TARGET;
         barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PRESENT;
         m_pD3dCommandList->ResourceBarrier(1, &barrier);
+        m_pTimePerfManager->GpuFrameEnd();
         m_pD3dCommandList->Close();
 
         m_pD3dCommandQueue->ExecuteCommandLists(1, (ID3D12CommandList* const*)&m_pD3dCommandList);
+        m_pTimePerfManager->CpuFrameEnd();
 
         m_pD3dCommandQueue->Signal(frameCtx->Fence, 1);
 
         // If hEvent is a null handle, then this API will not return until the specified fence value(s) have been reached.
         frameCtx->Fence->SetEventOnCompletion(1, nullptr);
+        m_pTimePerfManager->GpuFrameCompleted(m_frameSerial);
+        m_frameSerial++;
 
         // It looks like the Present() put works on the command queue, which means we need to use the command queue signal to wait for GPU to finish the work.
         m_pUIManager->Present();
+
+        if (m_timeToFirstFrameMs == 0.f)
+        {
+            m_timeToFirstFrameMs = ElapsedMs(m_initStartTime);
+            std::cout << "Time to first frame: " << m_timeToFirstFrameMs << " ms" << std::endl;
+            if (m_pSceneStreamer == nullptr || m_pSceneStreamer->IsFullyLoaded())
+            {
+                std::cout << "Time to fully loaded: " << m_timeToFullyLoadedMs << " ms" << std::endl;
+            }
+        }
     }
     
     FrameContext* frameCtx = WaitForCurrentFrameResources();
     m_pD3dCommandQueue->Signal(frameCtx->Fence, 1);
     frameCtx->Fence->SetEventOnCompletion(1, nullptr);
 
-    HEventArguments dummyArgs;
-    WaitGpuIdle(dummyArgs);
+    WaitGpuIdle(WaitGpuIdleEvent());
 }
 
 void DX12MiniRenderer::Finalize()
 {
+    // Dump before the teardown, so the live bytes are what the loaded scene costs.
+    if (MemoryTracker::IsEnabled())
+    {
+        MemoryTracker::DumpJson("MemoryReport.json");
+    }
+
+    // Stops the streaming thread. The primitives it already handed to the AssetManager are released with it below.
+    if (m_pSceneStreamer) { delete m_pSceneStreamer; m_pSceneStreamer = nullptr; }
+
     delete m_pLevel;
 
+    // Before the TimePerfManager, which the workers' zones write into.
+    JobSystem::Destroy();
+
     if (m_pUIManager) { m_pUIManager->Finalize(); delete m_pUIManager; m_pUIManager = nullptr; }
+    if (m_pTimePerfManager) { m_pTimePerfManager->DeinitGpuTimestamps(); TimePerfManager::Destroy(); m_pTimePerfManager = nullptr; }
+    if (m_pGpuTimestampSource) { delete m_pGpuTimestampSource; m_pGpuTimestampSource = nullptr; }
     if (m_pAssetManager) { m_pAssetManager->Deinit(); delete m_pAssetManager; m_pAssetManager = nullptr; }
     CleanupTempRendererInfarstructure();
     if (m_pD3dDevice) { m_pD3dDevice->Release(); m_pD3dDevice = nullptr; }
@@ -1,14 +1,19 @@
 #pragma once
 
 #include <d3d12.h>
+#include <chrono>
 #include "EventSystem/EventManager.h"
 #include "Scene/SceneAssetLoader.h"
+#include "Utils/MeshUtils.h"
 
 class UIManager;
 class Level;
 class RendererBackend;
 class AssetManager;
 class TimePerfManager;
+class D3D12GpuTimestampSource;
+class FrameArena;
+class SceneStreamer;
 enum class RendererBackendType;
 
 // It's possible to just use one fence like the ImGUI example but I prefer to use multiple fences for readability, which is more similar to Vulkan Fence.
@@ -20,6 +25,26 @@ struct FrameContext
     ID3D12CommandAllocator* CommandAllocator;
     ID3D12Fence*            Fence;
     HANDLE                  FenceEvent = nullptr;
+    FrameArena*             pFrameArena = nullptr; // Transient CPU allocations of the frame. Reset with the CommandAllocator.
+};
+
+// The startup options picked on the command line. The defaults load the whole scene into the plain buffers.
+struct RendererInitOptions
+{
+    // Non-zero captures the scene loading and the first frames as a Chrome trace.
+    uint32_t           startupTraceFrameCnt = 0;
+    // Render right after the scene graph is loaded and stream the meshes and textures in afterwards.
+    bool               streamScene = false;
+    // Block compress the material textures as they load.
+    TextureCompression textureCompression = TextureCompression::None;
+    // Reorder the index and vertex buffers of the meshes as they load.
+    MeshOptimization   meshOptimization = MeshOptimization::None;
+    // The vertex buffer layout of the forward renderer.
+    VertexFormat       vertexFormat = VertexFormat::Float;
+    // Simplify the meshes into up to that many levels of detail as they load, for the forward renderer.
+    uint32_t           meshLodCnt = 1;
+    // Split the meshes into meshlets as they load, for the forward renderer's cluster culling.
+    bool               buildMeshlets = false;
 };
 
 class DX12MiniRenderer
@@ -31,8 +56,9 @@ public:
     /*
     * Create UIManager.
     * Create DX12 Device.
+    * Load the scene with the startup options.
     */
-    void Init(std::string sceneYaml);
+    void Init(std::string sceneYaml, const RendererInitOptions& options = RendererInitOptions());
 
     /*
     * The main loop of the application.
@@ -46,7 +72,7 @@ public:
 
 private:
     void InitDevice();
-    static void WaitGpuIdle(HEventArguments args);
+    static void WaitGpuIdle(const WaitGpuIdleEvent& event);
     static void GenerateImGUIStates();
 
     ID3D12Device5*   m_pD3dDevice = nullptr;
@@ -56,6 +82,15 @@ private:
     SceneAssetLoader m_sceneAssetLoader;
     AssetManager*    m_pAssetManager = nullptr;
     TimePerfManager* m_pTimePerfManager = nullptr;
+    D3D12GpuTimestampSource* m_pGpuTimestampSource = nullptr;
+    uint64_t         m_frameSerial = 0;
+    uint64_t         m_frameHeapAllocCnt = 0; // Heap allocations of the last frame. Only counted with the memory tracking.
+
+    // Measured from the start of Init(). Without the streaming, the scene is fully loaded before the first frame.
+    std::chrono::high_resolution_clock::time_point m_initStartTime;
+    float            m_timeToFirstFrameMs = 0.f;
+    float            m_timeToFullyLoadedMs = 0.f;
+    SceneStreamer*   m_pSceneStreamer = nullptr;
 
     static DX12MiniRenderer* m_pThis;
 
@@ -0,0 +1,165 @@
+#include "ClusteredLightCuller.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include "../JobSystem/JobSystem.h"
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+ClusteredLightCuller::ClusteredLightCuller()
+    : m_nearPlane(0.1f),
+      m_farPlane(100.f),
+      m_projScaleX(1.f),
+      m_projScaleY(1.f),
+      m_sliceScale(0.f),
+      m_sliceBias(0.f),
+      m_clusterLightSlots(CLUSTER_CNT * MAX_LIGHTS_PER_CLUSTER, 0),
+      m_clusterLightCnts(CLUSTER_CNT, 0),
+      m_sliceOverflowCnts(CLUSTER_Z, 0),
+      m_sliceOverflowClusterCnts(CLUSTER_Z, 0),
+      m_clusters(CLUSTER_CNT)
+{
+}
+
+float ClusteredLightCuller::CalculateLightRadius(const float* pRadiance)
+{
+    const float maxRadiance = std::max({ pRadiance[0], pRadiance[1], pRadiance[2] });
+    return sqrtf(std::max(maxRadiance, 0.f) / LIGHT_CUTOFF_RADIANCE);
+}
+
+void ClusteredLightCuller::Build(const float* pViewMat, const float* pProjMat, float nearPlane, float farPlane, const std::vector<ClusterLight>& lights)
+{
+    PERF_ZONE("Light Cluster Build");
+    auto buildStartTime = std::chrono::high_resolution_clock::now();
+
+    m_nearPlane = nearPlane;
+    m_farPlane = farPlane;
+    m_projScaleX = pProjMat[0];
+    m_projScaleY = pProjMat[5];
+    m_sliceScale = static_cast<float>(CLUSTER_Z) / logf(farPlane / nearPlane);
+    m_sliceBias = -logf(nearPlane) * m_sliceScale;
+
+    m_viewSpaceLights.resize(lights.size() * 4);
+    for (uint32_t i = 0; i < lights.size(); i++)
+    {
+        const float* pPos = lights[i].position;
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            m_viewSpaceLights[4 * i + row] = pViewMat[4 * row] * pPos[0] + pViewMat[4 * row + 1] * pPos[1] + pViewMat[4 * row + 2] * pPos[2] + pViewMat[4 * row + 3];
+        }
+        m_viewSpaceLights[4 * i + 3] = lights[i].radius;
+    }
+
+    // Each slice owns its clusters, so the jobs fill the slices without any other sync.
+    JobSystem::ParallelFor(0, CLUSTER_Z, 1, [this](uint32_t sliceBegin, uint32_t sliceEnd)
+    {
+        PERF_ZONE("Light Cluster Slices");
+        for (uint32_t slice = sliceBegin; slice < sliceEnd; slice++)
+        {
+            AssignSlice(slice);
+        }
+    });
+
+    // Compact the per cluster slots into one continuous light index list.
+    uint32_t lightIndexCnt = 0;
+    for (uint32_t clusterIdx = 0; clusterIdx < CLUSTER_CNT; clusterIdx++)
+    {
+        m_clusters[clusterIdx].offset = lightIndexCnt;
+        m_clusters[clusterIdx].count = std::min(m_clusterLightCnts[clusterIdx], MAX_LIGHTS_PER_CLUSTER);
+        lightIndexCnt += m_clusters[clusterIdx].count;
+    }
+
+    m_lightIndices.resize(lightIndexCnt);
+    for (uint32_t clusterIdx = 0; clusterIdx < CLUSTER_CNT; clusterIdx++)
+    {
+        std::copy_n(&m_clusterLightSlots[clusterIdx * MAX_LIGHTS_PER_CLUSTER], m_clusters[clusterIdx].count, m_lightIndices.begin() + m_clusters[clusterIdx].offset);
+    }
+
+    m_stats.lightCnt = static_cast<uint32_t>(lights.size());
+    m_stats.lightIndexCnt = lightIndexCnt;
+    m_stats.overflowCnt = 0;
+    m_stats.overflowClusterCnt = 0;
+    for (uint32_t slice = 0; slice < CLUSTER_Z; slice++)
+    {
+        m_stats.overflowCnt += m_sliceOverflowCnts[slice];
+        m_stats.overflowClusterCnt += m_sliceOverflowClusterCnts[slice];
+    }
+
+    auto buildEndTime = std::chrono::high_resolution_clock::now();
+    m_stats.buildMs = std::chrono::duration<float, std::milli>(buildEndTime - buildStartTime).count();
+}
+
+void ClusteredLightCuller::AssignSlice(uint32_t slice)
+{
+    const uint32_t sliceClusterBegin = slice * CLUSTER_X * CLUSTER_Y;
+    std::fill_n(m_clusterLightCnts.begin() + sliceClusterBegin, CLUSTER_X * CLUSTER_Y, 0);
+    m_sliceOverflowCnts[slice] = 0;
+    m_sliceOverflowClusterCnts[slice] = 0;
+
+    const float depthRatio = m_farPlane / m_nearPlane;
+    const float sliceNear = m_nearPlane * powf(depthRatio, static_cast<float>(slice) / CLUSTER_Z);
+    const float sliceFar = m_nearPlane * powf(depthRatio, static_cast<float>(slice + 1) / CLUSTER_Z);
+
+    const uint32_t lightCnt = static_cast<uint32_t>(m_viewSpaceLights.size() / 4);
+    for (uint32_t lightIdx = 0; lightIdx < lightCnt; lightIdx++)
+    {
+        const float* pLight = &m_viewSpaceLights[4 * lightIdx];
+        const float radius = pLight[3];
+
+        // The part of the light sphere inside this slice.
+        const float z0 = std::max(sliceNear, pLight[2] - radius);
+        const float z1 = std::min(sliceFar, pLight[2] + radius);
+        if (z0 > z1)
+        {
+            continue;
+        }
+
+        // The biggest cross section radius of the sphere within [z0, z1].
+        const float closestDz = pLight[2] < z0 ? z0 - pLight[2] : (pLight[2] > z1 ? pLight[2] - z1 : 0.f);
+        const float sliceRadius = sqrtf(std::max(radius * radius - closestDz * closestDz, 0.f));
+
+        // Project the view space box of the cross section. The extremes of x / z are at the z0 or z1.
+        const float boxMinX = pLight[0] - sliceRadius;
+        const float boxMaxX = pLight[0] + sliceRadius;
+        const float boxMinY = pLight[1] - sliceRadius;
+        const float boxMaxY = pLight[1] + sliceRadius;
+        const float ndcMinX = m_projScaleX * std::min(boxMinX / z0, boxMinX / z1);
+        const float ndcMaxX = m_projScaleX * std::max(boxMaxX / z0, boxMaxX / z1);
+        const float ndcMinY = m_projScaleY * std::min(boxMinY / z0, boxMinY / z1);
+        const float ndcMaxY = m_projScaleY * std::max(boxMaxY / z0, boxMaxY / z1);
+
+        if (ndcMaxX < -1.f || ndcMinX > 1.f || ndcMaxY < -1.f || ndcMinY > 1.f)
+        {
+            continue;
+        }
+
+        // Screen tile y goes down while the ndc y goes up.
+        const int tileMinX = static_cast<int>(std::clamp((ndcMinX * 0.5f + 0.5f) * CLUSTER_X, 0.f, static_cast<float>(CLUSTER_X - 1)));
+        const int tileMaxX = static_cast<int>(std::clamp((ndcMaxX * 0.5f + 0.5f) * CLUSTER_X, 0.f, static_cast<float>(CLUSTER_X - 1)));
+        const int tileMinY = static_cast<int>(std::clamp((0.5f - ndcMaxY * 0.5f) * CLUSTER_Y, 0.f, static_cast<float>(CLUSTER_Y - 1)));
+        const int tileMaxY = static_cast<int>(std::clamp((0.5f - ndcMinY * 0.5f) * CLUSTER_Y, 0.f, static_cast<float>(CLUSTER_Y - 1)));
+
+        for (int tileY = tileMinY; tileY <= tileMaxY; tileY++)
+        {
+            for (int tileX = tileMinX; tileX <= tileMaxX; tileX++)
+            {
+                const uint32_t clusterIdx = sliceClusterBegin + tileY * CLUSTER_X + tileX;
+                uint32_t& clusterLightCnt = m_clusterLightCnts[clusterIdx];
+                if (clusterLightCnt < MAX_LIGHTS_PER_CLUSTER)
+                {
+                    m_clusterLightSlots[clusterIdx * MAX_LIGHTS_PER_CLUSTER + clusterLightCnt] = lightIdx;
+                    clusterLightCnt++;
+                }
+                else
+                {
+                    // The count goes one past the cap at the first dropped light, so the cluster is counted once.
+                    if (clusterLightCnt == MAX_LIGHTS_PER_CLUSTER)
+                    {
+                        m_sliceOverflowClusterCnts[slice]++;
+                        clusterLightCnt++;
+                    }
+                    m_sliceOverflowCnts[slice]++;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Matches the PointLight in the PBRShaders.hlsl.
+struct ClusterLight
+{
+    float position[3]; // World space.
+    float radius;      // Influence radius. The shader fades the light to zero at this distance.
+    float radiance[3];
+    float padding;
+};
+
+// Matches the uint2 cluster grid entry in the PBRShaders.hlsl.
+struct LightCluster
+{
+    uint32_t offset; // Into the light index list.
+    uint32_t count;
+};
+
+struct ClusteredLightCullingStats
+{
+    uint32_t lightCnt = 0;
+    uint32_t lightIndexCnt = 0;
+    uint32_t overflowCnt = 0;        // Light-cluster pairs dropped because the cluster was full.
+    uint32_t overflowClusterCnt = 0; // The clusters that dropped any. Their lighting pops as the lights move in and out.
+    float    buildMs = 0.f;
+};
+
+// Assigns the point lights to the view space froxels (Clusters) on the CPU for the Forward+ shading.
+// The screen is split into CLUSTER_X * CLUSTER_Y tiles and the depth range is split into CLUSTER_Z slices that grow
+// exponentially from near to far. It doesn't depend on the D3D12, so it can run headless.
+// The slices are assigned in parallel on the JobSystem when it exists, otherwise on the calling thread.
+// Conventions follow the renderer: row-major matrices, column vectors and view space z+ is the camera forward.
+class ClusteredLightCuller
+{
+public:
+    static constexpr uint32_t CLUSTER_X = 16;
+    static constexpr uint32_t CLUSTER_Y = 9;
+    static constexpr uint32_t CLUSTER_Z = 24;
+    static constexpr uint32_t CLUSTER_CNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    // A cluster keeps its first lights in the light order. The rest are dropped and counted in the stats.
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+    // The point light's radiance falls with 1 / d^2. It's cut off where the strongest channel drops below this value.
+    static constexpr float LIGHT_CUTOFF_RADIANCE = 0.01f;
+
+    ClusteredLightCuller();
+    ~ClusteredLightCuller() {}
+
+    static float CalculateLightRadius(const float* pRadiance);
+
+    // pProjMat is used for the x, y scale of the perspective projection. The lights' radius must be filled.
+    void Build(const float* pViewMat, const float* pProjMat, float nearPlane, float farPlane, const std::vector<ClusterLight>& lights);
+
+    // The clusters are ordered as ((z * CLUSTER_Y) + y) * CLUSTER_X + x. The tile y = 0 is the top of the screen.
+    const std::vector<LightCluster>& GetClusters() const { return m_clusters; }
+    const std::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+    const ClusteredLightCullingStats& GetStats() const { return m_stats; }
+
+    // slice = floor(log(viewZ) * sliceScale + sliceBias).
+    float GetSliceScale() const { return m_sliceScale; }
+    float GetSliceBias() const { return m_sliceBias; }
+
+private:
+    void AssignSlice(uint32_t slice);
+
+    // Per build states.
+    float m_nearPlane;
+    float m_farPlane;
+    float m_projScaleX;
+    float m_projScaleY;
+    float m_sliceScale;
+    float m_sliceBias;
+
+    std::vector<float> m_viewSpaceLights; // xyz + radius for each light.
+
+    // Each cluster has MAX_LIGHTS_PER_CLUSTER slots so the slices can be filled in parallel without the sync.
+    std::vector<uint32_t> m_clusterLightSlots;
+    std::vector<uint32_t> m_clusterLightCnts;
+    std::vector<uint32_t> m_sliceOverflowCnts;
+    std::vector<uint32_t> m_sliceOverflowClusterCnts;
+
+    std::vector<LightCluster> m_clusters;
+    std::vector<uint32_t>     m_lightIndices;
+
+    ClusteredLightCullingStats m_stats;
+};
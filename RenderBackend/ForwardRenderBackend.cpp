@@ -5,7 +5,40 @@
 #include "../Scene/Camera.h"
 #include "../Scene/Level.h"
 #include "../Scene/Lights.h"
+#include "../Utils/MathUtils.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include "../Utils/MemoryTracker.h"
+#include "../JobSystem/JobSystem.h"
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+extern AssetManager* g_pAssetManager;
+
+// The occluders are the primitives that take the biggest screen area. Their triangle count is capped to keep the
+// CPU rasterization cost bounded.
+constexpr uint32_t MAX_OCCLUDER_CNT = 16;
+constexpr uint32_t MAX_OCCLUDER_TRI_CNT = 32768;
+
+// The meshes per occlusion test job. One AABB test is cheap, so a job takes a batch of them.
+constexpr uint32_t OCCLUSION_TEST_GRAIN_SIZE = 32;
+
+// A primitive draws its coarsest LOD whose error projects to at most this many pixels.
+constexpr float MESH_LOD_MAX_PIXEL_ERROR = 1.0f;
+
+// VS scene CBV, PS scene CBV, PS material mask CBV and 4 material texture SRVs.
+constexpr uint32_t FORWARD_DRAW_DESCRIPTOR_CNT = 7;
+
+// Matches the InstanceData in the PBRShaders.hlsl.
+struct ForwardInstanceData
+{
+    float modelMat[16];
+    float cnstAlbedo[4];
+    float cnstMetallicRoughness[4];
+};
 
 ForwardRenderer::ForwardRenderer() :
     RendererBackend(RendererBackendType::Forward),
@@ -17,7 +50,11 @@ ForwardRenderer::ForwardRenderer() :
     m_pPsSceneBuffer(nullptr),
     m_pSceneCbvHeap(nullptr),
     m_pVsSceneBufferBegin(nullptr),
-    m_pPsSceneBufferBegin(nullptr)
+    m_pPsSceneBufferBegin(nullptr),
+    m_enableOcclusionCulling(true),
+    m_enableMeshLods(true),
+    m_enableMeshletCulling(true),
+    m_drawStats()
     // m_shaderVisibleCbvHeap(nullptr)
 {
 }
@@ -31,8 +68,8 @@ void ForwardRenderer::CreateRootSignature()
     D3D12_DESCRIPTOR_RANGE vsCbvRange = {};
     {
         vsCbvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-        vsCbvRange.NumDescriptors = 2;
-        vsCbvRange.BaseShaderRegister = 0;
+        vsCbvRange.NumDescriptors = 1;
+        vsCbvRange.BaseShaderRegister = 1;
         vsCbvRange.RegisterSpace = 0;
         vsCbvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
     }
@@ -40,8 +77,8 @@ void ForwardRenderer::CreateRootSignature()
     D3D12_DESCRIPTOR_RANGE psCbvRange = {};
     {
         psCbvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
-        psCbvRange.NumDescriptors = 3;
-        psCbvRange.BaseShaderRegister = 2;
+        psCbvRange.NumDescriptors = 2;
+        psCbvRange.BaseShaderRegister = 3;
         psCbvRange.RegisterSpace = 0;
         psCbvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
     }
@@ -57,7 +94,7 @@ void ForwardRenderer::CreateRootSignature()
 
     D3D12_DESCRIPTOR_RANGE psRanges[] = { psCbvRange, psSrvRange};
 
-    D3D12_ROOT_PARAMETER rootParameters[2] = {};
+    D3D12_ROOT_PARAMETER rootParameters[7] = {};
     {
         rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
         rootParameters[0].DescriptorTable.NumDescriptorRanges = 1;
@@ -68,13 +105,35 @@ void ForwardRenderer::CreateRootSignature()
         rootParameters[1].DescriptorTable.NumDescriptorRanges = 2;
         rootParameters[1].DescriptorTable.pDescriptorRanges = psRanges;
         rootParameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // The batch's first instance in the instance buffer, and the position dequantization of the compact vertices.
+        rootParameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[2].Constants.ShaderRegister = 0;
+        rootParameters[2].Constants.RegisterSpace = 0;
+        rootParameters[2].Constants.Num32BitValues = 7;
+        rootParameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        // Per instance model matrices and constant materials.
+        rootParameters[3].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        rootParameters[3].Descriptor.ShaderRegister = 4;
+        rootParameters[3].Descriptor.RegisterSpace = 0;
+        rootParameters[3].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        // Clustered lighting: Point lights, cluster grid and the light index list.
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            rootParameters[4 + i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+            rootParameters[4 + i].Descriptor.ShaderRegister = 5 + i;
+            rootParameters[4 + i].Descriptor.RegisterSpace = 0;
+            rootParameters[4 + i].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+        }
     }
 
     D3D12_STATIC_SAMPLER_DESC staticSamplers[4] = { StaticWrapSampler(0), StaticWrapSampler(1), StaticWrapSampler(2), StaticWrapSampler(3) };
 
     D3D12_ROOT_SIGNATURE_DESC rootSignatureDesc = {};
     {
-        rootSignatureDesc.NumParameters = 2;
+        rootSignatureDesc.NumParameters = 7;
         rootSignatureDesc.pParameters = rootParameters;
         rootSignatureDesc.NumStaticSamplers = 4;
         rootSignatureDesc.pStaticSamplers = staticSamplers;
@@ -110,17 +169,31 @@ void ForwardRenderer::CreatePipelineStateObject()
     forwardPBRShaderPathName += "/RenderBackend/ForwardRendererShaders/PBRShaders.hlsl";
     std::wstring wideString(forwardPBRShaderPathName.begin(), forwardPBRShaderPathName.end());
 
-    ThrowIfFailed(D3DCompileFromFile(wideString.c_str(), nullptr, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertShader, nullptr));
-    ThrowIfFailed(D3DCompileFromFile(wideString.c_str(), nullptr, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
+    // The vertex buffers all take the AssetManager's layout, so one pipeline serves every primitive.
+    const bool isCompactVertices = g_pAssetManager->GetVertexFormat() == VertexFormat::Compact;
+    const D3D_SHADER_MACRO compactVertDefines[] = { { "COMPACT_VERTICES", "1" }, { nullptr, nullptr } };
+    const D3D_SHADER_MACRO* pDefines = isCompactVertices ? compactVertDefines : nullptr;
+
+    ThrowIfFailed(D3DCompileFromFile(wideString.c_str(), pDefines, nullptr, "VSMain", "vs_5_0", compileFlags, 0, &vertShader, nullptr));
+    ThrowIfFailed(D3DCompileFromFile(wideString.c_str(), pDefines, nullptr, "PSMain", "ps_5_0", compileFlags, 0, &pixelShader, nullptr));
 
     // Define the vertex input layout.
-    D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
+    D3D12_INPUT_ELEMENT_DESC floatInputElementDescs[] =
     {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "NORMAL",   0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TANGENT",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,       0, 40, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
     };
+
+    // The COMPACT_VERT_SIZE_BYTE layout of the MeshUtils.h.
+    D3D12_INPUT_ELEMENT_DESC compactInputElementDescs[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL",   0, DXGI_FORMAT_R16G16_SNORM,       0,  8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TANGENT",  0, DXGI_FORMAT_R16G16_SNORM,       0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT,       0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
     /*
     D3D12_INPUT_ELEMENT_DESC inputElementDescs[] =
     {
@@ -172,7 +245,8 @@ void ForwardRenderer::CreatePipelineStateObject()
     }
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-    psoDesc.InputLayout = { inputElementDescs, _countof(inputElementDescs) };
+    psoDesc.InputLayout = isCompactVertices ? D3D12_INPUT_LAYOUT_DESC{ compactInputElementDescs, _countof(compactInputElementDescs) } :
+                                              D3D12_INPUT_LAYOUT_DESC{ floatInputElementDescs, _countof(floatInputElementDescs) };
     psoDesc.pRootSignature = m_pRootSignature;
     psoDesc.VS = D3D12_SHADER_BYTECODE{vertShader->GetBufferPointer(), vertShader->GetBufferSize()};
     psoDesc.PS = D3D12_SHADER_BYTECODE{pixelShader->GetBufferPointer(), pixelShader->GetBufferSize()};
@@ -259,6 +333,7 @@ void ForwardRenderer::CreateMeshRenderGpuResources()
 
 void ForwardRenderer::UpdatePerFrameGpuResources()
 {
+    PERF_ZONE("Forward Per Frame Resources");
     float vsConstantBuffer[64] = {};
     Camera* pCamera = nullptr;
     m_pLevel->RetriveActiveCamera(&pCamera);
@@ -276,37 +351,188 @@ void ForwardRenderer::UpdatePerFrameGpuResources()
     // Collect scene environment data to PS scene constant buffer
     float psConstantBuffer[64] = {};
 
-    std::vector<Light*> sceneLights;
+    FrameVector<Light*> sceneLights{ FrameArenaAllocator<Light*>(m_pFrameArena) };
     uint32_t ambientLightCnt = 0;
-    uint32_t pointLightCnt = 0;
     m_pLevel->RetriveLights(sceneLights);
+    m_clusterLights.clear();
     for (uint32_t i = 0; i < sceneLights.size(); i++)
     {
         if (sceneLights[i]->GetObjectTypeHash() == crc32("PointLight"))
         {
             PointLight* pPtLight = dynamic_cast<PointLight*>(sceneLights[i]);
-            memcpy(psConstantBuffer + pointLightCnt * 4,      pPtLight->position, sizeof(float) * 3);
-            memcpy(psConstantBuffer + 16 + pointLightCnt * 4, pPtLight->radiance, sizeof(float) * 3);
-            pointLightCnt++;
+            ClusterLight clusterLight = {};
+            memcpy(clusterLight.position, pPtLight->position, sizeof(float) * 3);
+            memcpy(clusterLight.radiance, pPtLight->radiance, sizeof(float) * 3);
+            clusterLight.radius = ClusteredLightCuller::CalculateLightRadius(pPtLight->radiance);
+            m_clusterLights.push_back(clusterLight);
         }
         else if (sceneLights[i]->GetObjectTypeHash() == crc32("AmbientLight"))
         {
             assert(ambientLightCnt <= 1, "We shouldn't have more than 1 ambient lights.");
             ambientLightCnt++;
             AmbientLight* pAmbientLight = dynamic_cast<AmbientLight*>(sceneLights[i]);
-            memcpy(psConstantBuffer + 36, pAmbientLight->radiance, sizeof(float) * 3);
+            memcpy(psConstantBuffer + 4, pAmbientLight->radiance, sizeof(float) * 3);
         }
     }
 
-    memcpy(psConstantBuffer + 32, pCamera->m_pos, sizeof(float) * 3);
-    memcpy(psConstantBuffer + 40, &pointLightCnt, sizeof(uint32_t));
-    // Current No Ambient Light.
+    m_lightCuller.Build(pCamera->m_viewMat, pCamera->m_projMat, pCamera->m_near, pCamera->m_far, m_clusterLights);
+
+    const uint32_t frameIdx = m_pUIManager->GetCurrentBackBufferIndex();
+    const std::vector<LightCluster>& lightClusters = m_lightCuller.GetClusters();
+    const std::vector<uint32_t>& lightIndices = m_lightCuller.GetLightIndices();
+    ReserveUploadBuffer(m_clusterLightBuffers[frameIdx], sizeof(ClusterLight) * m_clusterLights.size());
+    ReserveUploadBuffer(m_lightClusterBuffers[frameIdx], sizeof(LightCluster) * lightClusters.size());
+    ReserveUploadBuffer(m_lightIndexBuffers[frameIdx], sizeof(uint32_t) * lightIndices.size());
+    memcpy(m_clusterLightBuffers[frameIdx].pBegin, m_clusterLights.data(), sizeof(ClusterLight) * m_clusterLights.size());
+    memcpy(m_lightClusterBuffers[frameIdx].pBegin, lightClusters.data(), sizeof(LightCluster) * lightClusters.size());
+    memcpy(m_lightIndexBuffers[frameIdx].pBegin, lightIndices.data(), sizeof(uint32_t) * lightIndices.size());
+
+    uint32_t winWidth, winHeight;
+    m_pUIManager->GetWindowSize(winWidth, winHeight);
+    const uint32_t clusterDims[4] = { ClusteredLightCuller::CLUSTER_X, ClusteredLightCuller::CLUSTER_Y, ClusteredLightCuller::CLUSTER_Z,
+                                      static_cast<uint32_t>(m_clusterLights.size()) };
+    const float clusterParams[4] = { m_lightCuller.GetSliceScale(), m_lightCuller.GetSliceBias(),
+                                     static_cast<float>(winWidth), static_cast<float>(winHeight) };
+
+    memcpy(psConstantBuffer, pCamera->m_pos, sizeof(float) * 3);
+    memcpy(psConstantBuffer + 8, clusterDims, sizeof(clusterDims));
+    memcpy(psConstantBuffer + 12, clusterParams, sizeof(clusterParams));
 
     ThrowIfFailed(m_pPsSceneBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_pPsSceneBufferBegin)));
     memcpy(m_pPsSceneBufferBegin, psConstantBuffer, sizeof(psConstantBuffer));
     m_pPsSceneBuffer->Unmap(0, nullptr);
 }
 
+void ForwardRenderer::OcclusionCulling(const FrameVector<StaticMesh*>& staticMeshes, FrameVector<uint8_t>& oPrimVisibility)
+{
+    PERF_ZONE("Occlusion Culling");
+    // The first flat primitive index of each mesh, so the meshes can be tested out of order.
+    FrameVector<uint32_t> meshPrimOffsets{ FrameArenaAllocator<uint32_t>(m_pFrameArena) };
+    meshPrimOffsets.resize(staticMeshes.size());
+    size_t primCnt = 0;
+    for (uint32_t mshIdx = 0; mshIdx < staticMeshes.size(); mshIdx++)
+    {
+        meshPrimOffsets[mshIdx] = static_cast<uint32_t>(primCnt);
+        primCnt += staticMeshes[mshIdx]->m_primitiveAssets.size();
+    }
+    oPrimVisibility.assign(primCnt, 1);
+
+    m_occlusionCullingStats = OcclusionCullingStats();
+    if (!m_enableOcclusionCulling)
+    {
+        return;
+    }
+
+    Camera* pCamera = nullptr;
+    m_pLevel->RetriveActiveCamera(&pCamera);
+
+    auto rasterizeStartTime = std::chrono::high_resolution_clock::now();
+
+    // Rank the primitives by the squared ratio of their world space bounding box diagonal to the distance to the camera.
+    struct OccluderCandidate
+    {
+        float    score;
+        uint32_t mshIdx;
+        uint32_t primIdx;
+    };
+
+    FrameVector<OccluderCandidate> candidates{ FrameArenaAllocator<OccluderCandidate>(m_pFrameArena) };
+    candidates.reserve(primCnt);
+    for (uint32_t mshIdx = 0; mshIdx < staticMeshes.size(); mshIdx++)
+    {
+        for (uint32_t primIdx = 0; primIdx < staticMeshes[mshIdx]->m_primitiveAssets.size(); primIdx++)
+        {
+            const PrimitiveAsset* pPrimAsset = staticMeshes[mshIdx]->m_primitiveAssets[primIdx];
+            const float* pModelMat = staticMeshes[mshIdx]->GetPrimModelMat(primIdx);
+            if (pPrimAsset->m_idxCnt / 3 > MAX_OCCLUDER_TRI_CNT)
+            {
+                continue;
+            }
+
+            float worldMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float worldMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            for (uint32_t corner = 0; corner < 8; corner++)
+            {
+                float localPos[4] = { (corner & 1) ? pPrimAsset->m_aabbMax[0] : pPrimAsset->m_aabbMin[0],
+                                      (corner & 2) ? pPrimAsset->m_aabbMax[1] : pPrimAsset->m_aabbMin[1],
+                                      (corner & 4) ? pPrimAsset->m_aabbMax[2] : pPrimAsset->m_aabbMin[2],
+                                      1.f };
+                float worldPos[4] = {};
+                MatMulVec(pModelMat, localPos, 4, worldPos);
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    worldMin[i] = std::min(worldMin[i], worldPos[i]);
+                    worldMax[i] = std::max(worldMax[i], worldPos[i]);
+                }
+            }
+
+            float diagSqr = 0.f;
+            float distSqr = 0.f;
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                const float extent = worldMax[i] - worldMin[i];
+                const float toCenter = 0.5f * (worldMax[i] + worldMin[i]) - pCamera->m_pos[i];
+                diagSqr += extent * extent;
+                distSqr += toCenter * toCenter;
+            }
+
+            candidates.push_back({ diagSqr / std::max(distSqr, 1e-4f), mshIdx, primIdx });
+        }
+    }
+
+    const uint32_t occluderCnt = std::min(static_cast<uint32_t>(candidates.size()), MAX_OCCLUDER_CNT);
+    std::partial_sort(candidates.begin(), candidates.begin() + occluderCnt, candidates.end(),
+                      [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.score > b.score; });
+
+    m_occlusionCuller.BeginFrame(pCamera->m_vpMat);
+    for (uint32_t i = 0; i < occluderCnt; i++)
+    {
+        const PrimitiveAsset* pPrimAsset = staticMeshes[candidates[i].mshIdx]->m_primitiveAssets[candidates[i].primIdx];
+        if (m_occlusionCullingStats.occluderTriCnt + pPrimAsset->m_idxCnt / 3 > MAX_OCCLUDER_TRI_CNT)
+        {
+            continue;
+        }
+
+        const float* pModelMat = staticMeshes[candidates[i].mshIdx]->GetPrimModelMat(candidates[i].primIdx);
+        if (pPrimAsset->m_idxType)
+        {
+            m_occlusionCuller.RasterizeOccluder(pPrimAsset->m_posData.data(), pPrimAsset->m_idxDataUint32.data(), pPrimAsset->m_idxCnt, pModelMat);
+        }
+        else
+        {
+            m_occlusionCuller.RasterizeOccluder(pPrimAsset->m_posData.data(), pPrimAsset->m_idxDataUint16.data(), pPrimAsset->m_idxCnt, pModelMat);
+        }
+
+        m_occlusionCullingStats.occluderCnt++;
+        m_occlusionCullingStats.occluderTriCnt += pPrimAsset->m_idxCnt / 3;
+    }
+    m_occlusionCuller.BuildHiZ();
+
+    auto testStartTime = std::chrono::high_resolution_clock::now();
+
+    // The Hi-Z is read only from here on, so the meshes are tested in parallel.
+    JobSystem::ParallelFor(0, static_cast<uint32_t>(staticMeshes.size()), OCCLUSION_TEST_GRAIN_SIZE, [&](uint32_t mshBegin, uint32_t mshEnd)
+    {
+        for (uint32_t mshIdx = mshBegin; mshIdx < mshEnd; mshIdx++)
+        {
+            const StaticMesh* pStaticMesh = staticMeshes[mshIdx];
+            for (uint32_t primIdx = 0; primIdx < pStaticMesh->m_primitiveAssets.size(); primIdx++)
+            {
+                const PrimitiveAsset* pPrimAsset = pStaticMesh->m_primitiveAssets[primIdx];
+                const bool visible = m_occlusionCuller.IsAABBVisible(pPrimAsset->m_aabbMin, pPrimAsset->m_aabbMax, pStaticMesh->GetPrimModelMat(primIdx));
+                oPrimVisibility[meshPrimOffsets[mshIdx] + primIdx] = visible ? 1 : 0;
+            }
+        }
+    });
+
+    m_occlusionCullingStats.testedCnt = static_cast<uint32_t>(primCnt);
+    m_occlusionCullingStats.culledCnt = static_cast<uint32_t>(std::count(oPrimVisibility.begin(), oPrimVisibility.end(), 0));
+
+    auto testEndTime = std::chrono::high_resolution_clock::now();
+    m_occlusionCullingStats.rasterizeMs = std::chrono::duration<float, std::milli>(testStartTime - rasterizeStartTime).count();
+    m_occlusionCullingStats.testMs = std::chrono::duration<float, std::milli>(testEndTime - testStartTime).count();
+}
+
 void ForwardRenderer::CustomInit()
 {
     CreateRootSignature();
@@ -319,8 +545,131 @@ void ForwardRenderer::CustomInit()
     m_scissorRect = { 0, 0, static_cast<LONG>(winWidth), static_cast<LONG>(winHeight) };
 }
 
+void ForwardRenderer::CopyBatchDescriptors(const PrimitiveAsset* pPrimAsset, D3D12_CPU_DESCRIPTOR_HANDLE dstStartHandle)
+{
+    const uint32_t cbvDescHandleOffset = m_pD3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE vsSceneCbvHandle = dstStartHandle;
+    D3D12_CPU_DESCRIPTOR_HANDLE vsSceneVpMatCbvHandle = m_pSceneCbvHeap->GetCPUDescriptorHandleForHeapStart();
+    m_pD3dDevice->CopyDescriptorsSimple(1, vsSceneCbvHandle, vsSceneVpMatCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE psSceneCbvHandle = dstStartHandle;
+    psSceneCbvHandle.ptr += cbvDescHandleOffset;
+    D3D12_CPU_DESCRIPTOR_HANDLE psSceneSrcCbvHandle = m_pSceneCbvHeap->GetCPUDescriptorHandleForHeapStart();
+    psSceneSrcCbvHandle.ptr += cbvDescHandleOffset;
+    m_pD3dDevice->CopyDescriptorsSimple(1, psSceneCbvHandle, psSceneSrcCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE psPrimAssetCbvHandle = dstStartHandle;
+    psPrimAssetCbvHandle.ptr += cbvDescHandleOffset * 2;
+    D3D12_CPU_DESCRIPTOR_HANDLE psPrimAssetSrcCbvHandle = pPrimAsset->m_pMaterialMaskCbvHeap->GetCPUDescriptorHandleForHeapStart();
+    m_pD3dDevice->CopyDescriptorsSimple(1, psPrimAssetCbvHandle, psPrimAssetSrcCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    // Texture SRV binding
+    const uint32_t materialTexMask = pPrimAsset->m_materialMask;
+    const uint32_t texMasks[4] = { ALBEDO_MASK, NORMAL_MASK, ROUGHNESS_METALIC_MASK, AO_MASK };
+    const ImgInfo* pTexInfos[4] = { &pPrimAsset->m_baseColorTex, &pPrimAsset->m_normalTex, &pPrimAsset->m_metallicRoughnessTex, &pPrimAsset->m_occlusionTex };
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (materialTexMask & texMasks[i])
+        {
+            D3D12_CPU_DESCRIPTOR_HANDLE objTexSrvStartHandle = pPrimAsset->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
+            objTexSrvStartHandle.ptr += pTexInfos[i]->srvHeapIdx * cbvDescHandleOffset;
+
+            D3D12_CPU_DESCRIPTOR_HANDLE psObjTexSrvHandle = dstStartHandle;
+            psObjTexSrvHandle.ptr += cbvDescHandleOffset * (3 + i);
+            m_pD3dDevice->CopyDescriptorsSimple(1, psObjTexSrvHandle, objTexSrvStartHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        }
+    }
+}
+
+void ForwardRenderer::ReserveUploadBuffer(PerFrameUploadBuffer& uploadBuffer, uint64_t byteSize)
+{
+    // Always create the buffer even when it's empty since the root SRVs need a valid address.
+    if (uploadBuffer.pResource && uploadBuffer.capacity >= byteSize)
+    {
+        return;
+    }
+
+    // The previous frame that used this buffer is already finished, so it's safe to replace it.
+    ReleaseUploadBuffer(uploadBuffer);
+
+    uint64_t newCapacity = std::max(uploadBuffer.capacity * 2, static_cast<uint64_t>(4096));
+    while (newCapacity < byteSize)
+    {
+        newCapacity *= 2;
+    }
+
+    D3D12_HEAP_PROPERTIES heapProperties{};
+    {
+        heapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
+        heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        heapProperties.CreationNodeMask = 1;
+        heapProperties.VisibleNodeMask = 1;
+    }
+
+    D3D12_RESOURCE_DESC bufferRsrcDesc{};
+    {
+        bufferRsrcDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufferRsrcDesc.Alignment = 0;
+        bufferRsrcDesc.Width = newCapacity;
+        bufferRsrcDesc.Height = 1;
+        bufferRsrcDesc.DepthOrArraySize = 1;
+        bufferRsrcDesc.MipLevels = 1;
+        bufferRsrcDesc.Format = DXGI_FORMAT_UNKNOWN;
+        bufferRsrcDesc.SampleDesc.Count = 1;
+        bufferRsrcDesc.SampleDesc.Quality = 0;
+        bufferRsrcDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        bufferRsrcDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    }
+
+    ThrowIfFailed(m_pD3dDevice->CreateCommittedResource(
+            &heapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferRsrcDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&uploadBuffer.pResource)));
+
+    // Keep it mapped for the lifetime of the resource.
+    D3D12_RANGE readRange{ 0, 0 };
+    ThrowIfFailed(uploadBuffer.pResource->Map(0, &readRange, reinterpret_cast<void**>(&uploadBuffer.pBegin)));
+    uploadBuffer.capacity = newCapacity;
+}
+
+void ForwardRenderer::ReleaseUploadBuffer(PerFrameUploadBuffer& uploadBuffer)
+{
+    if (uploadBuffer.pResource)
+    {
+        uploadBuffer.pResource->Unmap(0, nullptr);
+        uploadBuffer.pResource->Release();
+    }
+    uploadBuffer = PerFrameUploadBuffer();
+}
+
+void ForwardRenderer::UploadInstanceData()
+{
+    PERF_ZONE("Instance Upload");
+    const uint32_t instanceCnt = m_renderQueue.Size();
+    PerFrameUploadBuffer& instanceBuffer = m_instanceBuffers[m_pUIManager->GetCurrentBackBufferIndex()];
+    ReserveUploadBuffer(instanceBuffer, sizeof(ForwardInstanceData) * instanceCnt);
+
+    // The instances are laid out in the sorted key order, so a batch's instances are continuous.
+    ForwardInstanceData* pInstanceData = reinterpret_cast<ForwardInstanceData*>(instanceBuffer.pBegin);
+    const std::vector<uint64_t>& sortedKeys = m_renderQueue.GetKeys();
+    for (uint32_t i = 0; i < instanceCnt; i++)
+    {
+        const ForwardDrawItem& drawItem = m_drawItems[RenderQueue::GetDrawIdx(sortedKeys[i])];
+        ForwardInstanceData instanceData = {};
+        memcpy(instanceData.modelMat, drawItem.pModelMat, sizeof(float) * 16);
+        drawItem.pStaticMesh->GetCnstMaterial(instanceData.cnstAlbedo, instanceData.cnstMetallicRoughness);
+        pInstanceData[i] = instanceData;
+    }
+}
+
 void ForwardRenderer::RenderTick(ID3D12GraphicsCommandList4* pCommandList, RenderTargetInfo rtInfo)
 {
+    MEMORY_TAG_SCOPE(MemoryTag::Render);
     uint32_t winWidth, winHeight;
     m_pUIManager->GetWindowSize(winWidth, winHeight);
     m_viewport = { 0.0f, 0.0f, static_cast<float>(winWidth), static_cast<float>(winHeight), D3D12_MIN_DEPTH, D3D12_MAX_DEPTH };
@@ -328,12 +677,9 @@ void ForwardRenderer::RenderTick(ID3D12GraphicsCommandList4* pCommandList, Rende
 
     D3D12_CPU_DESCRIPTOR_HANDLE frameDSVDescriptor = m_pUIManager->GetCurrentMainDSVDescriptor();
 
-    // Padding to 256 bytes for constant buffer
-    float vsConstantBuffer[64] = {};
-
     UpdatePerFrameGpuResources();
 
-    std::vector<StaticMesh*> staticMeshes;
+    FrameVector<StaticMesh*> staticMeshes{ FrameArenaAllocator<StaticMesh*>(m_pFrameArena) };
     m_pLevel->RetriveStaticMeshes(staticMeshes);
 
     // Pre-Render
@@ -344,117 +690,225 @@ void ForwardRenderer::RenderTick(ID3D12GraphicsCommandList4* pCommandList, Rende
     }
     m_inflightShaderVisibleCbvHeaps.clear();
 
-    // Render Logic
+    FrameVector<uint8_t> primVisibility{ FrameArenaAllocator<uint8_t>(m_pFrameArena) };
+    OcclusionCulling(staticMeshes, primVisibility);
+
+    // Build the sort keys of the visible primitives. The state id identifies the geometry and texture set.
+    Camera* pCamera = nullptr;
+    m_pLevel->RetriveActiveCamera(&pCamera);
+    const float depthRange = pCamera->m_far - pCamera->m_near;
+    // The pixels per world unit at the view depth 1. The m_projMat[5] is 1 / tan(fov / 2).
+    const float lodPixelScale = 0.5f * static_cast<float>(winHeight) * pCamera->m_projMat[5];
+
+    m_renderQueue.Clear();
+    m_drawItems.clear();
+
+    // Rebuilt every frame, so its nodes and buckets live in the frame arena instead of being freed by a clear().
+    typedef std::pair<const PrimitiveAsset* const, uint32_t> PrimStateIdPair;
+    std::unordered_map<const PrimitiveAsset*, uint32_t, std::hash<const PrimitiveAsset*>, std::equal_to<const PrimitiveAsset*>,
+                       FrameArenaAllocator<PrimStateIdPair>> primStateIds(primVisibility.size(),
+                                                                          std::hash<const PrimitiveAsset*>(),
+                                                                          std::equal_to<const PrimitiveAsset*>(),
+                                                                          FrameArenaAllocator<PrimStateIdPair>(m_pFrameArena));
+
+    uint32_t flatPrimIdx = 0;
+    uint64_t drawnTriCnt = 0;
+    uint64_t fullTriCnt = 0;
     for (uint32_t mshIdx = 0; mshIdx < staticMeshes.size(); mshIdx++)
     {
-        for (uint32_t primIdx = 0; primIdx < staticMeshes[mshIdx]->m_primitiveAssets.size(); primIdx++)
+        for (uint32_t primIdx = 0; primIdx < staticMeshes[mshIdx]->m_primitiveAssets.size(); primIdx++, flatPrimIdx++)
         {
-            uint32_t materialTexCnt = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->TextureCnt();
-
-            // Create in-flight shader visible CBV heap and properly copy the CBV descriptor to it.
-            // Shader visible heap.
-            D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc = {};
-            cbvHeapDesc.NumDescriptors = 5 + materialTexCnt;
-            cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-            cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-
-            ID3D12DescriptorHeap* pInflightShaderVisibleCbvHeap = nullptr;
-            ThrowIfFailed(m_pD3dDevice->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&pInflightShaderVisibleCbvHeap)));
-            m_inflightShaderVisibleCbvHeaps.push_back(pInflightShaderVisibleCbvHeap);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE shaderCbvDescHeapCpuHandle = pInflightShaderVisibleCbvHeap->GetCPUDescriptorHandleForHeapStart();
-            const uint32_t cbvDescHandleOffset = m_pD3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE vsObjCbvHandle = shaderCbvDescHeapCpuHandle;
-            D3D12_CPU_DESCRIPTOR_HANDLE meshModelMatCbvHandle = staticMeshes[mshIdx]->m_staticMeshCbvDescHeap->GetCPUDescriptorHandleForHeapStart();
-            m_pD3dDevice->CopyDescriptorsSimple(1, vsObjCbvHandle, meshModelMatCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE vsSceneCbvHandle = shaderCbvDescHeapCpuHandle;
-            vsSceneCbvHandle.ptr += cbvDescHandleOffset;
-            D3D12_CPU_DESCRIPTOR_HANDLE vsSceneVpMatCbvHandle = m_pSceneCbvHeap->GetCPUDescriptorHandleForHeapStart();
-            m_pD3dDevice->CopyDescriptorsSimple(1, vsSceneCbvHandle, vsSceneVpMatCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-            
-            D3D12_CPU_DESCRIPTOR_HANDLE psObjCnstMaterialCbvHandle = shaderCbvDescHeapCpuHandle;
-            psObjCnstMaterialCbvHandle.ptr += cbvDescHandleOffset * 2;
-            D3D12_CPU_DESCRIPTOR_HANDLE psCnstMaterialCbvHandle = staticMeshes[mshIdx]->m_staticMeshCnstMaterialCbvDescHeap->GetCPUDescriptorHandleForHeapStart();
-            m_pD3dDevice->CopyDescriptorsSimple(1, psObjCnstMaterialCbvHandle, psCnstMaterialCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE psSceneCbvHandle = shaderCbvDescHeapCpuHandle;
-            psSceneCbvHandle.ptr += cbvDescHandleOffset * 3;
-            D3D12_CPU_DESCRIPTOR_HANDLE psSceneSrcCbvHandle = m_pSceneCbvHeap->GetCPUDescriptorHandleForHeapStart();
-            psSceneSrcCbvHandle.ptr += cbvDescHandleOffset;
-            m_pD3dDevice->CopyDescriptorsSimple(1, psSceneCbvHandle, psSceneSrcCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-            D3D12_CPU_DESCRIPTOR_HANDLE psPrimAssetCbvHandle = shaderCbvDescHeapCpuHandle;
-            psPrimAssetCbvHandle.ptr += cbvDescHandleOffset * 4;
-            D3D12_CPU_DESCRIPTOR_HANDLE psPrimAssetSrcCbvHandle = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_pMaterialMaskCbvHeap->GetCPUDescriptorHandleForHeapStart();
-            m_pD3dDevice->CopyDescriptorsSimple(1, psPrimAssetCbvHandle, psPrimAssetSrcCbvHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-            // Texture SRV binding
-            uint32_t materialTexMask = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_materialMask;
-            if (materialTexMask & ALBEDO_MASK)
+            if (!primVisibility[flatPrimIdx])
             {
-                D3D12_CPU_DESCRIPTOR_HANDLE objTexSrvStartHandle = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
-                objTexSrvStartHandle.ptr += staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_baseColorTex.srvHeapIdx * cbvDescHandleOffset;
-
-                D3D12_CPU_DESCRIPTOR_HANDLE psObjAlbedoTexSrvHandle = shaderCbvDescHeapCpuHandle;
-                psObjAlbedoTexSrvHandle.ptr += cbvDescHandleOffset * 5;
-                m_pD3dDevice->CopyDescriptorsSimple(1, psObjAlbedoTexSrvHandle, objTexSrvStartHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                continue;
             }
 
-            if (materialTexMask & NORMAL_MASK)
+            PrimitiveAsset* pPrimAsset = staticMeshes[mshIdx]->m_primitiveAssets[primIdx];
+            auto stateItr = primStateIds.find(pPrimAsset);
+            if (stateItr == primStateIds.end())
             {
-                D3D12_CPU_DESCRIPTOR_HANDLE objTexSrvStartHandle = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
-                objTexSrvStartHandle.ptr += staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_normalTex.srvHeapIdx * cbvDescHandleOffset;
-
-                D3D12_CPU_DESCRIPTOR_HANDLE psObjNormalTexSrvHandle = shaderCbvDescHeapCpuHandle;
-                psObjNormalTexSrvHandle.ptr += cbvDescHandleOffset * 6;
-                m_pD3dDevice->CopyDescriptorsSimple(1, psObjNormalTexSrvHandle, objTexSrvStartHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                stateItr = primStateIds.emplace(pPrimAsset, static_cast<uint32_t>(primStateIds.size())).first;
             }
 
-            if (materialTexMask & ROUGHNESS_METALIC_MASK)
+            // The view depth is the clip space w, which is the last row of the vp matrix times the world position.
+            float localCenter[4] = { 0.5f * (pPrimAsset->m_aabbMin[0] + pPrimAsset->m_aabbMax[0]),
+                                     0.5f * (pPrimAsset->m_aabbMin[1] + pPrimAsset->m_aabbMax[1]),
+                                     0.5f * (pPrimAsset->m_aabbMin[2] + pPrimAsset->m_aabbMax[2]),
+                                     1.f };
+            const float* pModelMat = staticMeshes[mshIdx]->GetPrimModelMat(primIdx);
+            float worldCenter[4] = {};
+            MatMulVec(pModelMat, localCenter, 4, worldCenter);
+            const float* pVpMatW = &pCamera->m_vpMat[12];
+            const float viewDepth = pVpMatW[0] * worldCenter[0] + pVpMatW[1] * worldCenter[1] + pVpMatW[2] * worldCenter[2] + pVpMatW[3];
+
+            // The coarsest LOD whose error projects within the MESH_LOD_MAX_PIXEL_ERROR at the AABB's nearest depth. The
+            // error grows with the model's largest axis scale.
+            uint32_t lodIdx = 0;
+            if (m_enableMeshLods && !pPrimAsset->m_lods.empty())
             {
-                D3D12_CPU_DESCRIPTOR_HANDLE objTexSrvStartHandle = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
-                objTexSrvStartHandle.ptr += staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_metallicRoughnessTex.srvHeapIdx * cbvDescHandleOffset;
-
-                D3D12_CPU_DESCRIPTOR_HANDLE psObjRoughnessMetallicTexSrvHandle = shaderCbvDescHeapCpuHandle;
-                psObjRoughnessMetallicTexSrvHandle.ptr += cbvDescHandleOffset * 7;
-                m_pD3dDevice->CopyDescriptorsSimple(1, psObjRoughnessMetallicTexSrvHandle, objTexSrvStartHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+                float maxAxisScaleSq = 0.0f;
+                for (uint32_t col = 0; col < 3; col++)
+                {
+                    maxAxisScaleSq = std::max(maxAxisScaleSq, pModelMat[col] * pModelMat[col] + pModelMat[4 + col] * pModelMat[4 + col] +
+                                                              pModelMat[8 + col] * pModelMat[8 + col]);
+                }
+                const float maxAxisScale = sqrtf(maxAxisScaleSq);
+                float halfDiagonalSq = 0.0f;
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    const float halfExtent = 0.5f * (pPrimAsset->m_aabbMax[axis] - pPrimAsset->m_aabbMin[axis]);
+                    halfDiagonalSq += halfExtent * halfExtent;
+                }
+                const float nearestDepth = viewDepth - sqrtf(halfDiagonalSq) * maxAxisScale;
+                if (nearestDepth > pCamera->m_near)
+                {
+                    const float pixelsPerLocalUnit = maxAxisScale * lodPixelScale / nearestDepth;
+                    while (lodIdx < pPrimAsset->m_lods.size() &&
+                           pPrimAsset->m_lods[lodIdx].error * pixelsPerLocalUnit <= MESH_LOD_MAX_PIXEL_ERROR)
+                    {
+                        lodIdx++;
+                    }
+                }
             }
+            drawnTriCnt += (lodIdx == 0 ? pPrimAsset->m_idxCnt : pPrimAsset->m_lods[lodIdx - 1].idxCnt) / 3;
+            fullTriCnt += pPrimAsset->m_idxCnt / 3;
+
+            // Each LOD is its own state, so the instancing only merges the draws of the same LOD.
+            const uint32_t stateId = stateItr->second * MAX_MESH_LOD_CNT + lodIdx;
+            const uint32_t drawIdx = static_cast<uint32_t>(m_drawItems.size());
+            m_drawItems.push_back({ staticMeshes[mshIdx], pPrimAsset, pModelMat, lodIdx });
+            m_renderQueue.Push(RenderQueue::BuildSortKey(RenderPassType::Opaque, stateId, (viewDepth - pCamera->m_near) / depthRange, drawIdx));
+        }
+    }
+    {
+        PERF_ZONE("Render Queue Sort");
+        m_renderQueue.Sort();
+    }
 
-            if (materialTexMask & AO_MASK)
-            {
-                D3D12_CPU_DESCRIPTOR_HANDLE objTexSrvStartHandle = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
-                objTexSrvStartHandle.ptr += staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_occlusionTex.srvHeapIdx * cbvDescHandleOffset;
+    m_meshletCuller.BeginFrame(pCamera->m_vpMat, pCamera->m_pos);
+    if (m_drawItems.empty())
+    {
+        m_drawStats = ForwardDrawStats();
+        return;
+    }
+
+    // Merge the draws sharing the same primitive asset into instanced draws.
+    const std::vector<uint64_t>& sortedKeys = m_renderQueue.GetKeys();
+    RenderQueue::BuildInstanceBatches(sortedKeys.data(), m_renderQueue.Size(), m_instanceBatches);
+    UploadInstanceData();
 
-                D3D12_CPU_DESCRIPTOR_HANDLE psObjAOTexSrvHandle = shaderCbvDescHeapCpuHandle;
-                psObjAOTexSrvHandle.ptr += cbvDescHandleOffset * 8;
-                m_pD3dDevice->CopyDescriptorsSimple(1, psObjAOTexSrvHandle, objTexSrvStartHandle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    m_drawStats.visiblePrimCnt = m_renderQueue.Size();
+    m_drawStats.drawnTriCnt = drawnTriCnt;
+    m_drawStats.fullTriCnt = fullTriCnt;
+
+    // Render Logic
+    // One shader visible heap for the whole frame. Each batch owns FORWARD_DRAW_DESCRIPTOR_CNT continuous descriptors.
+    D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc = {};
+    cbvHeapDesc.NumDescriptors = FORWARD_DRAW_DESCRIPTOR_CNT * static_cast<uint32_t>(m_instanceBatches.size());
+    cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+
+    ID3D12DescriptorHeap* pInflightShaderVisibleCbvHeap = nullptr;
+    ThrowIfFailed(m_pD3dDevice->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&pInflightShaderVisibleCbvHeap)));
+    m_inflightShaderVisibleCbvHeaps.push_back(pInflightShaderVisibleCbvHeap);
+
+    const uint32_t cbvDescHandleOffset = m_pD3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    GPU_PERF_ZONE("Forward Draw");
+    ID3D12DescriptorHeap* ppHeaps[] = { pInflightShaderVisibleCbvHeap };
+    pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
+
+    pCommandList->SetPipelineState(m_pPipelineState);
+    pCommandList->SetGraphicsRootSignature(m_pRootSignature);
+    pCommandList->RSSetViewports(1, &m_viewport);
+    pCommandList->RSSetScissorRects(1, &m_scissorRect);
+    pCommandList->OMSetRenderTargets(1, &rtInfo.rtvHandle, FALSE, &frameDSVDescriptor);
+    pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    const uint32_t frameIdx = m_pUIManager->GetCurrentBackBufferIndex();
+    pCommandList->SetGraphicsRootShaderResourceView(3, m_instanceBuffers[frameIdx].pResource->GetGPUVirtualAddress());
+    pCommandList->SetGraphicsRootShaderResourceView(4, m_clusterLightBuffers[frameIdx].pResource->GetGPUVirtualAddress());
+    pCommandList->SetGraphicsRootShaderResourceView(5, m_lightClusterBuffers[frameIdx].pResource->GetGPUVirtualAddress());
+    pCommandList->SetGraphicsRootShaderResourceView(6, m_lightIndexBuffers[frameIdx].pResource->GetGPUVirtualAddress());
+
+    FrameVector<uint8_t> meshletVisibility{ FrameArenaAllocator<uint8_t>(m_pFrameArena) };
+    uint32_t drawCallCnt = 0;
+    for (uint32_t batchIdx = 0; batchIdx < m_instanceBatches.size(); batchIdx++)
+    {
+        const InstanceBatch& batch = m_instanceBatches[batchIdx];
+        const ForwardDrawItem& drawItem = m_drawItems[RenderQueue::GetDrawIdx(sortedKeys[batch.firstKeyIdx])];
+        const PrimitiveAsset* pPrimAsset = drawItem.pPrimAsset;
+
+        D3D12_CPU_DESCRIPTOR_HANDLE batchCpuHandle = pInflightShaderVisibleCbvHeap->GetCPUDescriptorHandleForHeapStart();
+        batchCpuHandle.ptr += static_cast<SIZE_T>(batchIdx) * FORWARD_DRAW_DESCRIPTOR_CNT * cbvDescHandleOffset;
+        CopyBatchDescriptors(pPrimAsset, batchCpuHandle);
+
+        D3D12_GPU_DESCRIPTOR_HANDLE vsCbvDescHeapGpuHandle = pInflightShaderVisibleCbvHeap->GetGPUDescriptorHandleForHeapStart();
+        vsCbvDescHeapGpuHandle.ptr += static_cast<UINT64>(batchIdx) * FORWARD_DRAW_DESCRIPTOR_CNT * cbvDescHandleOffset;
+        D3D12_GPU_DESCRIPTOR_HANDLE psCbvDescHeapGpuHandle = vsCbvDescHeapGpuHandle;
+        psCbvDescHeapGpuHandle.ptr += cbvDescHandleOffset;
+
+        pCommandList->IASetIndexBuffer(&pPrimAsset->m_idxBufferView);
+        pCommandList->IASetVertexBuffers(0, 1, &pPrimAsset->m_vertexBufferView);
+        pCommandList->SetGraphicsRootDescriptorTable(0, vsCbvDescHeapGpuHandle);
+        pCommandList->SetGraphicsRootDescriptorTable(1, psCbvDescHeapGpuHandle);
+        pCommandList->SetGraphicsRoot32BitConstant(2, batch.firstKeyIdx, 0);
+        if (pPrimAsset->m_vertFormat == VertexFormat::Compact)
+        {
+            // The positions are quantized in the primitive's AABB.
+            float posDequant[6];
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                posDequant[axis] = pPrimAsset->m_aabbMax[axis] - pPrimAsset->m_aabbMin[axis];
+                posDequant[3 + axis] = pPrimAsset->m_aabbMin[axis];
             }
+            pCommandList->SetGraphicsRoot32BitConstants(2, 6, posDequant, 1);
+        }
+        // The LODs' indices follow the level 0's in the same index buffer.
+        uint32_t idxCnt = pPrimAsset->m_idxCnt;
+        uint32_t startIdx = 0;
+        if (drawItem.lodIdx > 0)
+        {
+            idxCnt = pPrimAsset->m_lods[drawItem.lodIdx - 1].idxCnt;
+            startIdx = pPrimAsset->m_lods[drawItem.lodIdx - 1].idxOffset;
+        }
 
-            const uint32_t idxCnt = staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_idxCnt;
-            const uint32_t cbvDescHeapHandleOffset = m_pD3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-            D3D12_GPU_DESCRIPTOR_HANDLE psCbvDescHeapGpuHandle = pInflightShaderVisibleCbvHeap->GetGPUDescriptorHandleForHeapStart();
-            psCbvDescHeapGpuHandle.ptr += cbvDescHeapHandleOffset * 2;
-
-            // ID3D12DescriptorHeap* ppHeaps[] = { m_cbvDescHeap };
-            ID3D12DescriptorHeap* ppHeaps[] = { pInflightShaderVisibleCbvHeap };
-            pCommandList->SetDescriptorHeaps(_countof(ppHeaps), ppHeaps);
-
-            pCommandList->SetPipelineState(m_pPipelineState);
-            pCommandList->SetGraphicsRootSignature(m_pRootSignature);
-            pCommandList->RSSetViewports(1, &m_viewport);
-            pCommandList->RSSetScissorRects(1, &m_scissorRect);
-            pCommandList->OMSetRenderTargets(1, &rtInfo.rtvHandle, FALSE, &frameDSVDescriptor);
-            pCommandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-            pCommandList->IASetIndexBuffer(&staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_idxBufferView);
-            pCommandList->IASetVertexBuffers(0, 1, &staticMeshes[mshIdx]->m_primitiveAssets[primIdx]->m_vertexBufferView);
-            // pCommandList->SetGraphicsRootDescriptorTable(0, m_cbvDescHeap->GetGPUDescriptorHandleForHeapStart());
-            pCommandList->SetGraphicsRootDescriptorTable(0, pInflightShaderVisibleCbvHeap->GetGPUDescriptorHandleForHeapStart());
-            pCommandList->SetGraphicsRootDescriptorTable(1, psCbvDescHeapGpuHandle);
-            pCommandList->DrawIndexedInstanced(idxCnt, 1, 0, 0, 0);
+        // A single instance of the full mesh draws only the runs of its visible meshlets, whose triangles are in the
+        // meshlet order. The instanced draws share one index range, and the LODs have no meshlets. The cones only hold
+        // for the single faced materials, whose back faces glTF leaves out even though the pipeline doesn't cull them.
+        if (m_enableMeshletCulling && drawItem.lodIdx == 0 && batch.instanceCnt == 1 && !pPrimAsset->m_meshlets.empty())
+        {
+            const uint32_t meshletCnt = static_cast<uint32_t>(pPrimAsset->m_meshlets.size());
+            const bool backfaceCulling = (drawItem.pStaticMesh->GetStaticMeshMaterialMask() & DOUBLE_FACE_MASK) == 0;
+            meshletVisibility.resize(meshletCnt);
+            m_meshletCuller.CullMeshlets(pPrimAsset->m_meshlets.data(), pPrimAsset->m_meshletBounds.data(), meshletCnt,
+                                         drawItem.pModelMat, backfaceCulling, meshletVisibility.data());
+
+            uint32_t meshletIdx = 0;
+            while (meshletIdx < meshletCnt)
+            {
+                if (!meshletVisibility[meshletIdx])
+                {
+                    meshletIdx++;
+                    continue;
+                }
+                const uint32_t runStartTri = pPrimAsset->m_meshlets[meshletIdx].triOffset;
+                uint32_t runTriCnt = 0;
+                while (meshletIdx < meshletCnt && meshletVisibility[meshletIdx])
+                {
+                    runTriCnt += pPrimAsset->m_meshlets[meshletIdx].triCnt;
+                    meshletIdx++;
+                }
+                pCommandList->DrawIndexedInstanced(runTriCnt * 3, 1, runStartTri * 3, 0, 0);
+                drawCallCnt++;
+            }
+            continue;
         }
+
+        pCommandList->DrawIndexedInstanced(idxCnt, batch.instanceCnt, startIdx, 0, 0);
+        drawCallCnt++;
     }
+    m_drawStats.drawCallCnt = drawCallCnt;
+    m_drawStats.drawnTriCnt -= m_meshletCuller.GetStats().culledTriCnt;
 
     // Post-Render
 
@@ -510,4 +964,12 @@ void ForwardRenderer::CustomDeinit()
     {
         itr->Release();
     }
+
+    for (uint32_t i = 0; i < UIManager::NUM_BACK_BUFFERS; i++)
+    {
+        ReleaseUploadBuffer(m_instanceBuffers[i]);
+        ReleaseUploadBuffer(m_clusterLightBuffers[i]);
+        ReleaseUploadBuffer(m_lightClusterBuffers[i]);
+        ReleaseUploadBuffer(m_lightIndexBuffers[i]);
+    }
 }
\ No newline at end of file
@@ -1,5 +1,38 @@
 #pragma once
 #include "RendererBackend.h"
+#include "SoftwareOcclusionCuller.h"
+#include "MeshletCuller.h"
+#include "RenderQueue.h"
+#include "ClusteredLightCuller.h"
+#include "../UI/UIManager.h"
+#include "../Utils/FrameArena.h"
+
+class StaticMesh;
+struct PrimitiveAsset;
+
+struct ForwardDrawItem
+{
+    StaticMesh*     pStaticMesh;
+    PrimitiveAsset* pPrimAsset;
+    const float*    pModelMat; // The StaticMesh::GetPrimModelMat() of the primitive's placement.
+    uint32_t        lodIdx; // 0 is the full mesh, then the PrimitiveAsset::m_lods.
+};
+
+// A persistently mapped upload heap buffer that only grows.
+struct PerFrameUploadBuffer
+{
+    ID3D12Resource* pResource = nullptr;
+    UINT8*          pBegin = nullptr;
+    uint64_t        capacity = 0;
+};
+
+struct ForwardDrawStats
+{
+    uint32_t visiblePrimCnt = 0; // The draw call count without the instancing.
+    uint32_t drawCallCnt = 0;
+    uint64_t drawnTriCnt = 0; // With the selected LODs, less the culled meshlets.
+    uint64_t fullTriCnt = 0;  // As if every draw used the full mesh.
+};
 
 class ForwardRenderer : public RendererBackend
 {
@@ -10,6 +43,14 @@ public:
     virtual void RenderTick(ID3D12GraphicsCommandList4* pCommandList, RenderTargetInfo rtInfo) override;
     virtual void GetMainRenderTargetSize(uint32_t& oWidth, uint32_t& oHeight) override { oWidth = 100; oHeight = 100; } // TODO: Placeholder
 
+    const OcclusionCullingStats& GetOcclusionCullingStats() const { return m_occlusionCullingStats; }
+    bool& OcclusionCullingEnabled() { return m_enableOcclusionCulling; }
+    bool& MeshLodsEnabled() { return m_enableMeshLods; }
+    bool& MeshletCullingEnabled() { return m_enableMeshletCulling; }
+    const MeshletCullingStats& GetMeshletCullingStats() const { return m_meshletCuller.GetStats(); }
+    const ForwardDrawStats& GetDrawStats() const { return m_drawStats; }
+    const ClusteredLightCullingStats& GetLightCullingStats() const { return m_lightCuller.GetStats(); }
+
 protected:
     virtual void CustomInit();
     virtual void CustomDeinit();
@@ -21,6 +62,19 @@ private:
 
     void UpdatePerFrameGpuResources();
 
+    // Fill oPrimVisibility with one entry per mesh primitive in the order of the staticMeshes and their primitives.
+    // The entries are bytes rather than packed bools, so the tests can write them in parallel.
+    void OcclusionCulling(const FrameVector<StaticMesh*>& staticMeshes, FrameVector<uint8_t>& oPrimVisibility);
+
+    // Copy the batch's CBV and SRV descriptors into its range of the frame's shader visible heap.
+    void CopyBatchDescriptors(const PrimitiveAsset* pPrimAsset, D3D12_CPU_DESCRIPTOR_HANDLE dstStartHandle);
+
+    // Write the model matrices and constant materials of the sorted draws into the current frame's instance buffer.
+    void UploadInstanceData();
+
+    void ReserveUploadBuffer(PerFrameUploadBuffer& uploadBuffer, uint64_t byteSize);
+    void ReleaseUploadBuffer(PerFrameUploadBuffer& uploadBuffer);
+
     ID3D12RootSignature* m_pRootSignature;
     ID3D12PipelineState* m_pPipelineState;
     
@@ -36,4 +90,26 @@ private:
     // ID3D12DescriptorHeap* m_shaderVisibleCbvHeap;
 
     std::vector<ID3D12DescriptorHeap*> m_inflightShaderVisibleCbvHeaps;
+
+    SoftwareOcclusionCuller m_occlusionCuller;
+    OcclusionCullingStats   m_occlusionCullingStats;
+    bool                    m_enableOcclusionCulling;
+    bool                    m_enableMeshLods;
+    MeshletCuller           m_meshletCuller;
+    bool                    m_enableMeshletCulling;
+
+    // Per frame draw submission data. Kept as members to reuse the allocations.
+    RenderQueue                                           m_renderQueue;
+    std::vector<ForwardDrawItem>                          m_drawItems;
+    std::vector<InstanceBatch>                            m_instanceBatches;
+    ForwardDrawStats                                      m_drawStats;
+
+    ClusteredLightCuller      m_lightCuller;
+    std::vector<ClusterLight> m_clusterLights;
+
+    // Per frame in flight structured buffers.
+    PerFrameUploadBuffer m_instanceBuffers[UIManager::NUM_BACK_BUFFERS];
+    PerFrameUploadBuffer m_clusterLightBuffers[UIManager::NUM_BACK_BUFFERS];
+    PerFrameUploadBuffer m_lightClusterBuffers[UIManager::NUM_BACK_BUFFERS];
+    PerFrameUploadBuffer m_lightIndexBuffers[UIManager::NUM_BACK_BUFFERS];
 };
\ No newline at end of file
@@ -101,6 +101,24 @@ float3 fresnelSchlickRoughness(float cosTheta, float3 F0, float roughness)
     return F0 + (max(float3(1.0 - roughness, 1.0 - roughness, 1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+#ifdef COMPACT_VERTICES
+// The compact vertex layout of the MeshUtils.h. The input assembler already converts the UNORM, SNORM and half formats.
+struct VSInput
+{
+    float4 position : POSITION; // xyz in the primitive's AABB. w is the tangent handedness, 1 for +1 and 0 for -1.
+    float2 normal   : NORMAL;   // Octahedral.
+    float2 tangent  : TANGENT;  // Octahedral.
+    float2 uv       : TEXCOORD;
+};
+
+float3 DecodeOctahedral(float2 oct)
+{
+    float3 dir = float3(oct, 1.0 - abs(oct.x) - abs(oct.y));
+    float fold = saturate(-dir.z);
+    dir.xy += dir.xy >= 0.0 ? -fold : fold;
+    return normalize(dir);
+}
+#else
 struct VSInput
 {
     float3 position : POSITION;
@@ -108,6 +126,7 @@ struct VSInput
     float4 tangent  : TANGENT;
     float2 uv       : TEXCOORD;
 };
+#endif
 
 struct PSInput
 {
@@ -116,11 +135,25 @@ struct PSInput
     float4 normal   : NORMAL0;
     float4 tangent  : TANGENT0;
     float2 uv       : TEXCOORD0;
+    nointerpolation float4 cnstAlbedo       : COLOR0;
+    nointerpolation float4 metalicRoughness : COLOR1;
 };
 
-cbuffer VsObjectBuffer : register(b0)
+// Per-Instance Data. The constant material belongs to the Static Mesh instance.
+struct InstanceData
 {
     float4x4 modelMat;
+    float4   cnstAlbedo;
+    float4   metalicRoughness;
+};
+
+StructuredBuffer<InstanceData> i_instanceData : register(t4);
+
+cbuffer VsDrawConstants : register(b0)
+{
+    uint   instanceOffset;
+    float3 posDequantScale;  // The AABB extents of the compact vertices.
+    float3 posDequantOffset; // The AABB min of the compact vertices.
 };
 
 cbuffer VsSceneBuffer : register(b1)
@@ -128,17 +161,33 @@ cbuffer VsSceneBuffer : register(b1)
     float4x4 vpMat;
 };
 
-PSInput VSMain(VSInput i_vertInput)
+PSInput VSMain(VSInput i_vertInput, uint instanceId : SV_InstanceID)
 {
     PSInput result = (PSInput)0;
 
+    InstanceData instance = i_instanceData[instanceOffset + instanceId];
+    float4x4 modelMat = instance.modelMat;
     float4x4 mvpMat = mul(vpMat, modelMat);
+
+#ifdef COMPACT_VERTICES
+    float3 position = i_vertInput.position.xyz * posDequantScale + posDequantOffset;
+    float3 normal   = DecodeOctahedral(i_vertInput.normal);
+    float3 tangent  = DecodeOctahedral(i_vertInput.tangent);
+    float  handedness = i_vertInput.position.w * 2.0 - 1.0;
+#else
+    float3 position = i_vertInput.position;
+    float3 normal   = i_vertInput.normal;
+    float3 tangent  = i_vertInput.tangent.xyz;
+    float  handedness = i_vertInput.tangent.w;
+#endif
     
-    result.pos      = mul(mvpMat, float4(i_vertInput.position, 1.0));
-    result.normal   = mul(modelMat, float4(i_vertInput.normal, 0.0));
-    result.worldPos = mul(modelMat, float4(i_vertInput.position, 1.0));
-    result.tangent  = mul(modelMat, float4(i_vertInput.tangent.xyz, 0.0));
+    result.pos      = mul(mvpMat, float4(position, 1.0));
+    result.normal   = mul(modelMat, float4(normal, 0.0));
+    result.worldPos = mul(modelMat, float4(position, 1.0));
+    result.tangent  = float4(mul(modelMat, float4(tangent, 0.0)).xyz, handedness);
     result.uv       = i_vertInput.uv;
+    result.cnstAlbedo       = instance.cnstAlbedo;
+    result.metalicRoughness = instance.metalicRoughness;
     
     return result;
 }
@@ -149,20 +198,35 @@ static const uint ROUGHNESS_METALIC_MASK = 4;
 static const uint AO_MASK                = 8;
 static const uint EMISSIVE_MASK          = 16;
 
-// Per-Static Mesh Material Data
-cbuffer PsMaterialBuffer : register(b2)
+cbuffer PsSceneBuffer : register(b3)
 {
-    float4 constAlbedo;
-    float4 metalicRoughness;
+    float4 cameraPos;     // one padding float
+    float4 ambientLight;  // one padding float
+    uint4  clusterDims;   // (0, 1, 2): Cluster grid x, y, z; (3): Point Light Counts.
+    float4 clusterParams; // (0): Slice scale; (1): Slice bias; (2, 3): Render target size.
 }
 
-cbuffer PsSceneBuffer : register(b3)
+// Clustered lighting data built by the ClusteredLightCuller on the CPU.
+struct PointLight
 {
-    float3 lightPositions[4];
-    float3 lightRadiance[4];
-    float4 cameraPos;    // one padding float
-    float4 ambientLight; // one padding float
-    uint4  extraIntData; // (0): Point Light Counts; (1): ;
+    float3 position;
+    float  radius;
+    float3 radiance;
+    float  padding;
+};
+
+StructuredBuffer<PointLight> i_pointLights   : register(t5);
+StructuredBuffer<uint2>      i_lightClusters : register(t6); // (Offset, Count) into the light index list.
+StructuredBuffer<uint>       i_lightIndices  : register(t7);
+
+uint GetClusterIndex(float4 svPosition)
+{
+    // The SV_Position.w is the view space depth.
+    uint3 cluster;
+    cluster.x = min(uint(svPosition.x / clusterParams.z * clusterDims.x), clusterDims.x - 1);
+    cluster.y = min(uint(svPosition.y / clusterParams.w * clusterDims.y), clusterDims.y - 1);
+    cluster.z = uint(clamp(floor(log(svPosition.w) * clusterParams.x + clusterParams.y), 0.0, float(clusterDims.z - 1)));
+    return (cluster.z * clusterDims.y + cluster.y) * clusterDims.x + cluster.x;
 }
 
 // Per-Primitive Asset Material Data.
@@ -189,8 +253,8 @@ SamplerState i_occlusionSamplerState : register(s3);
 
 float4 PSMain(PSInput input) : SV_TARGET
 {
-    float3 sphereRefAlbedo = constAlbedo.xyz; // F0
-    float3 sphereDifAlbedo = constAlbedo.xyz;
+    float3 sphereRefAlbedo = input.cnstAlbedo.xyz; // F0
+    float3 sphereDifAlbedo = input.cnstAlbedo.xyz;
     if(materialMask & ALBEDO_MASK)
     {
         float3 texAlbedo = i_baseColorTexture.Sample(i_baseColorSamplerState, input.uv).xyz;
@@ -201,16 +265,18 @@ float4 PSMain(PSInput input) : SV_TARGET
     float3 worldNormal = normalize(input.normal.xyz);
     if(materialMask & NORMAL_MASK)
     {
-        float3 normalSampled = i_normalTexture.Sample(i_normalSamplerState, input.uv).xyz;
+        // A BC5 normal map only keeps the xy, so the z is always rebuilt from the unit length.
+        float2 normalSampledXY = i_normalTexture.Sample(i_normalSamplerState, input.uv).xy * 2.0 - 1.0;
+        float3 normalSampled = float3(normalSampledXY, sqrt(saturate(1.0 - dot(normalSampledXY, normalSampledXY))));
         float3 tangent = normalize(input.tangent.xyz);
-        float3 biTangent = normalize(cross(worldNormal, tangent));
-        normalSampled = normalSampled * 2.0 - 1.0;
+        // The glTF's bitangent sign, which flips where the texture is mirrored.
+        float3 biTangent = normalize(cross(worldNormal, tangent)) * (input.tangent.w < 0.0 ? -1.0 : 1.0);
         worldNormal = tangent * normalSampled.x + biTangent * normalSampled.y + worldNormal * normalSampled.z;
     }
     
     // Overwrite the constant metallic roughness if there is a texture.
-    float metallic = metalicRoughness.x;
-    float roughness = metalicRoughness.y;
+    float metallic = input.metalicRoughness.x;
+    float roughness = input.metalicRoughness.y;
     if(materialMask & ROUGHNESS_METALIC_MASK)
     {
         float3 roughnessMetallicSampled = i_roughnessMetallicTexture.Sample(i_roughnessMetallicSamplerState, input.uv).xyz;
@@ -229,16 +295,20 @@ float4 PSMain(PSInput input) : SV_TARGET
     float viewNormalCosTheta = max(dot(worldNormal, wo), 0.0);
 
     float3 Lo = float3(0.0, 0.0, 0.0); // Output light values to the view direction.
-    uint lightCnt = extraIntData.x;
-    for (int i = 0; i < lightCnt; i++)
-    {        
-        float3 lightColor = lightRadiance[i];
-        float3 lightPos = lightPositions[i];
+    uint2 lightCluster = i_lightClusters[GetClusterIndex(input.pos)];
+    for (uint i = 0; i < lightCluster.y; i++)
+    {
+        PointLight light = i_pointLights[i_lightIndices[lightCluster.x + i]];
+        float3 lightColor = light.radiance;
+        float3 lightPos = light.position;
         float3 wi = normalize(lightPos - input.worldPos.xyz);
         float3 H = normalize(wi + wo);
         float distance = length(lightPos - input.worldPos.xyz);
 
-        float attenuation = 1.0 / (distance * distance);
+        // Window the inverse square falloff to reach zero at the light radius, so the cluster bounds don't cut it.
+        float distanceRatio = distance / light.radius;
+        float window = saturate(1.0 - distanceRatio * distanceRatio * distanceRatio * distanceRatio);
+        float attenuation = window * window / (distance * distance);
         float3 radiance = lightColor * attenuation;
 
         float lightNormalCosTheta = max(dot(worldNormal, wi), 0.0);
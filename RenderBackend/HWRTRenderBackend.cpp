@@ -10,6 +10,7 @@
 #include "../Utils/MathUtils.h"
 #include "RTShaders/CustomRTShader.fxh"
 #include "../UI/UIManager.h"
+#include "../TimePerfManager/TimePerfManager.h"
 #include "../MiniRendererApp.h"
 #include <algorithm>     // For std::size, typed std::max, etc.
 #include <DirectXMath.h> // For XMMATRIX
@@ -98,7 +99,8 @@ void HWRTRenderBackend::InitScene()
                 break;
             }
             vertFloatCnt += primAsset->m_vertData.size();
-            idxIntCnt += primAsset->m_idxCnt;
+            // The same layout as the GenSceneVertIdxBuffer().
+            idxIntCnt += primAsset->FitsUint16Indices() ? primAsset->m_idxCnt : 0;
         }
     };
 
@@ -132,6 +134,7 @@ void HWRTRenderBackend::InitScene()
     std::vector<InstanceInfo> instInfoVecData;
 
     UINT instIdx = 0;
+    uint32_t unfitPrimInstCnt = 0;
     for (int sMeshIdx = 0; sMeshIdx < staticMeshes.size(); sMeshIdx++)
     {
         auto* pStaticMesh = staticMeshes[sMeshIdx];
@@ -149,8 +152,15 @@ void HWRTRenderBackend::InitScene()
                 .AccelerationStructure = pPrimAsset->m_blas->GetGPUVirtualAddress(),
             };
 
+            // The closest hit shader can't read the indices past uint16, so the rays never hit these primitives.
+            if (!pPrimAsset->FitsUint16Indices())
+            {
+                pInstDesc->InstanceMask = 0;
+                unfitPrimInstCnt++;
+            }
+
             // Update transform
-            memcpy(pInstDesc->Transform, staticMeshes[sMeshIdx]->m_modelMat, sizeof(float) * 12);
+            memcpy(pInstDesc->Transform, pStaticMesh->GetPrimModelMat(primIdx), sizeof(float) * 12);
 
             // A prim asset is a blas, but there can be multiple instances refer to one blas and use different materials...
             uint32_t vertStartFloat, idxStartInt;
@@ -173,6 +183,12 @@ void HWRTRenderBackend::InitScene()
         }
     }
 
+    if (unfitPrimInstCnt > 0)
+    {
+        std::cout << "Path tracing skips " << unfitPrimInstCnt << " primitive instances with more than "
+                  << UINT16_MAX + 1 << " vertices." << std::endl;
+    }
+
     // Create and init the camera constant buffer
     auto cameraCnstDesc = BASIC_BUFFER_DESC;
     cameraCnstDesc.Width = sizeof(FrameConstBuffer);
@@ -231,7 +247,7 @@ void HWRTRenderBackend::InitTopLevel()
                                           IID_PPV_ARGS(&m_tlasUpdateScratch));
 }
 
-ID3D12Resource* HWRTRenderBackend::MakeBLAS(ID3D12Resource* vertexBuffer, UINT vertexFloats, ID3D12Resource* indexBuffer, UINT indices)
+ID3D12Resource* HWRTRenderBackend::MakeBLAS(ID3D12Resource* vertexBuffer, UINT vertexFloats, ID3D12Resource* indexBuffer, UINT indices, DXGI_FORMAT indexFormat)
 {
     D3D12_RAYTRACING_GEOMETRY_DESC geometryDesc = {
         .Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES,
@@ -240,7 +256,7 @@ ID3D12Resource* HWRTRenderBackend::MakeBLAS(ID3D12Resource* vertexBuffer, UINT v
         .Triangles = {
             .Transform3x4 = 0, // NOTE: We need model matrix for each mesh primitives.
 
-            .IndexFormat = indexBuffer ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_UNKNOWN,
+            .IndexFormat = indexBuffer ? indexFormat : DXGI_FORMAT_UNKNOWN,
             .VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT,
             .IndexCount = indices,
             .VertexCount = vertexFloats / VERT_SIZE_FLOAT,
@@ -284,7 +300,7 @@ void HWRTRenderBackend::InitBottomLevel()
         {
             auto* vertexBuffer = primPtr->m_gpuVertBuffer;
             auto* indexBuffer = primPtr->m_gpuIndexBuffer;
-            primPtr->m_blas = MakeBLAS(vertexBuffer, primPtr->m_vertData.size(), indexBuffer, primPtr->m_idxCnt);
+            primPtr->m_blas = MakeBLAS(vertexBuffer, primPtr->m_vertData.size(), indexBuffer, primPtr->m_idxCnt, primPtr->m_idxBufferView.Format);
         }
     }
 }
@@ -516,7 +532,10 @@ void HWRTRenderBackend::RenderTick(ID3D12GraphicsCommandList4* pCommandList, Ren
         .Width = static_cast<UINT>(rtInfo.rtDesc.Width),
         .Height = rtInfo.rtDesc.Height,
         .Depth = 1};
-    pCommandList->DispatchRays(&dispatchDesc);
+    {
+        GPU_PERF_ZONE("DispatchRays");
+        pCommandList->DispatchRays(&dispatchDesc);
+    }
 
     auto barrier = [&](auto* resource, auto before, auto after) {
         D3D12_RESOURCE_BARRIER rb = {
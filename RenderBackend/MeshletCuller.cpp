@@ -0,0 +1,121 @@
+#include "MeshletCuller.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// The model matrix's axes may differ this much in length and still count as a uniform scale for the cone test.
+constexpr float UNIFORM_SCALE_TOLERANCE = 1e-3f;
+
+MeshletCuller::MeshletCuller()
+{
+    memset(m_frustumPlanes, 0, sizeof(m_frustumPlanes));
+    memset(m_viewPos, 0, sizeof(m_viewPos));
+}
+
+void MeshletCuller::BeginFrame(const float* pVpMat, const float* pViewPos)
+{
+    // The clip space rows. The inside is -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    const float* pRowX = &pVpMat[0];
+    const float* pRowY = &pVpMat[4];
+    const float* pRowZ = &pVpMat[8];
+    const float* pRowW = &pVpMat[12];
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        m_frustumPlanes[0][i] = pRowW[i] + pRowX[i];
+        m_frustumPlanes[1][i] = pRowW[i] - pRowX[i];
+        m_frustumPlanes[2][i] = pRowW[i] + pRowY[i];
+        m_frustumPlanes[3][i] = pRowW[i] - pRowY[i];
+        m_frustumPlanes[4][i] = pRowZ[i];
+        m_frustumPlanes[5][i] = pRowW[i] - pRowZ[i];
+    }
+
+    for (float* pPlane : m_frustumPlanes)
+    {
+        const float len = sqrtf(pPlane[0] * pPlane[0] + pPlane[1] * pPlane[1] + pPlane[2] * pPlane[2]);
+        if (len > 0.f)
+        {
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                pPlane[i] /= len;
+            }
+        }
+    }
+
+    memcpy(m_viewPos, pViewPos, sizeof(m_viewPos));
+    m_stats = MeshletCullingStats();
+}
+
+uint32_t MeshletCuller::CullMeshlets(const Meshlet* pMeshlets, const MeshletBounds* pBounds, uint32_t meshletCnt, const float* pModelMat,
+                                     bool backfaceCulling, uint8_t* pVisibility)
+{
+    // The lengths of the model matrix's columns are the scales of the local axes.
+    float axisScales[3];
+    for (uint32_t col = 0; col < 3; col++)
+    {
+        axisScales[col] = sqrtf(pModelMat[col] * pModelMat[col] + pModelMat[4 + col] * pModelMat[4 + col] + pModelMat[8 + col] * pModelMat[8 + col]);
+    }
+    const float maxScale = std::max({ axisScales[0], axisScales[1], axisScales[2] });
+    const float minScale = std::min({ axisScales[0], axisScales[1], axisScales[2] });
+    const float det = pModelMat[0] * (pModelMat[5] * pModelMat[10] - pModelMat[6] * pModelMat[9]) -
+                      pModelMat[1] * (pModelMat[4] * pModelMat[10] - pModelMat[6] * pModelMat[8]) +
+                      pModelMat[2] * (pModelMat[4] * pModelMat[9] - pModelMat[5] * pModelMat[8]);
+    const bool coneCulling = backfaceCulling && det > 0.f && maxScale - minScale <= maxScale * UNIFORM_SCALE_TOLERANCE;
+    const float invScale = maxScale > 0.f ? 1.f / maxScale : 0.f;
+
+    uint32_t visibleCnt = 0;
+    for (uint32_t m = 0; m < meshletCnt; m++)
+    {
+        const MeshletBounds& bounds = pBounds[m];
+
+        float center[3];
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            center[row] = pModelMat[4 * row] * bounds.center[0] + pModelMat[4 * row + 1] * bounds.center[1] +
+                          pModelMat[4 * row + 2] * bounds.center[2] + pModelMat[4 * row + 3];
+        }
+        const float radius = bounds.radius * maxScale;
+
+        bool visible = true;
+        for (const float* pPlane : m_frustumPlanes)
+        {
+            if (pPlane[0] * center[0] + pPlane[1] * center[1] + pPlane[2] * center[2] + pPlane[3] < -radius)
+            {
+                visible = false;
+                m_stats.frustumCulledCnt++;
+                break;
+            }
+        }
+
+        if (visible && coneCulling && bounds.coneCutoff < 1.f)
+        {
+            float apexToView[3];
+            float axis[3];
+            for (uint32_t row = 0; row < 3; row++)
+            {
+                apexToView[row] = pModelMat[4 * row] * bounds.coneApex[0] + pModelMat[4 * row + 1] * bounds.coneApex[1] +
+                                  pModelMat[4 * row + 2] * bounds.coneApex[2] + pModelMat[4 * row + 3] - m_viewPos[row];
+                axis[row] = (pModelMat[4 * row] * bounds.coneAxis[0] + pModelMat[4 * row + 1] * bounds.coneAxis[1] +
+                             pModelMat[4 * row + 2] * bounds.coneAxis[2]) * invScale;
+            }
+            const float dist = sqrtf(apexToView[0] * apexToView[0] + apexToView[1] * apexToView[1] + apexToView[2] * apexToView[2]);
+            if (apexToView[0] * axis[0] + apexToView[1] * axis[1] + apexToView[2] * axis[2] >= bounds.coneCutoff * dist)
+            {
+                visible = false;
+                m_stats.coneCulledCnt++;
+            }
+        }
+
+        pVisibility[m] = visible ? 1 : 0;
+        if (visible)
+        {
+            visibleCnt++;
+        }
+        else
+        {
+            m_stats.culledTriCnt += pMeshlets[m].triCnt;
+        }
+    }
+
+    m_stats.testedCnt += meshletCnt;
+    return visibleCnt;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include "../Utils/MeshUtils.h"
+
+struct MeshletCullingStats
+{
+    uint32_t testedCnt = 0;
+    uint32_t frustumCulledCnt = 0;
+    uint32_t coneCulledCnt = 0;
+    uint64_t culledTriCnt = 0;
+};
+
+// Culls the meshlets of the visible primitives by their bounding spheres against the view frustum and by their normal
+// cones against the view position. It doesn't depend on the D3D12, so it can run headless.
+// Conventions follow the renderer: row-major matrices, column vectors, DX12 clip space with the depth range [0, 1].
+class MeshletCuller
+{
+public:
+    MeshletCuller();
+    ~MeshletCuller() {}
+
+    // Extract the world space frustum planes and reset the stats.
+    void BeginFrame(const float* pVpMat, const float* pViewPos);
+
+    // Writes 1 to the pVisibility of each visible meshlet and 0 otherwise, and returns the visible count. The cone test
+    // is skipped when the backfaceCulling is false, e.g. for the double faced materials, and under the non-uniform or
+    // mirroring model matrices that don't keep the cones.
+    uint32_t CullMeshlets(const Meshlet* pMeshlets, const MeshletBounds* pBounds, uint32_t meshletCnt, const float* pModelMat,
+                          bool backfaceCulling, uint8_t* pVisibility);
+
+    const MeshletCullingStats& GetStats() const { return m_stats; }
+
+private:
+    float m_frustumPlanes[6][4]; // Normalized (n, d). The inside is dot(n, p) + d >= 0.
+    float m_viewPos[3];
+
+    MeshletCullingStats m_stats;
+};
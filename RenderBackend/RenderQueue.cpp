@@ -0,0 +1,100 @@
+#include "RenderQueue.h"
+#include <cstring>
+#include <algorithm>
+
+uint64_t RenderQueue::BuildSortKey(RenderPassType pass, uint32_t stateId, float normalizedDepth, uint32_t drawIdx)
+{
+    const float clampedDepth = std::clamp(normalizedDepth, 0.f, 1.f);
+    const uint64_t depthBucket = static_cast<uint64_t>(clampedDepth * static_cast<float>((1u << DEPTH_BITS) - 1));
+
+    uint64_t key = 0;
+    key |= (static_cast<uint64_t>(pass) & ((1u << PASS_BITS) - 1)) << PASS_SHIFT;
+    key |= (static_cast<uint64_t>(stateId) & (MAX_STATE_CNT - 1)) << STATE_SHIFT;
+    key |= depthBucket << DEPTH_SHIFT;
+    key |= (static_cast<uint64_t>(drawIdx) & (MAX_DRAW_CNT - 1)) << DRAW_IDX_SHIFT;
+    return key;
+}
+
+void RenderQueue::Sort()
+{
+    if (m_scratchKeys.size() < m_keys.size())
+    {
+        m_scratchKeys.resize(m_keys.size());
+    }
+    RadixSortKeys(m_keys.data(), m_scratchKeys.data(), static_cast<uint32_t>(m_keys.size()));
+}
+
+void RenderQueue::BuildInstanceBatches(const uint64_t* pSortedKeys, uint32_t cnt, std::vector<InstanceBatch>& oBatches)
+{
+    oBatches.clear();
+
+    // The pass and state id are the bits above the depth bucket.
+    constexpr uint32_t BATCH_KEY_SHIFT = STATE_SHIFT;
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        if (!oBatches.empty())
+        {
+            const uint64_t batchKey = pSortedKeys[oBatches.back().firstKeyIdx] >> BATCH_KEY_SHIFT;
+            if ((pSortedKeys[i] >> BATCH_KEY_SHIFT) == batchKey)
+            {
+                oBatches.back().instanceCnt++;
+                continue;
+            }
+        }
+        oBatches.push_back({ i, 1 });
+    }
+}
+
+void RadixSortKeys(uint64_t* pKeys, uint64_t* pScratch, uint32_t cnt)
+{
+    if (cnt < 2)
+    {
+        return;
+    }
+
+    // Build all 8 histograms in one read pass.
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (uint32_t i = 0; i < cnt; i++)
+    {
+        const uint64_t key = pKeys[i];
+        for (uint32_t digit = 0; digit < 8; digit++)
+        {
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+        }
+    }
+
+    uint64_t* pSrc = pKeys;
+    uint64_t* pDst = pScratch;
+    for (uint32_t digit = 0; digit < 8; digit++)
+    {
+        uint32_t* pHistogram = histograms[digit];
+
+        // All keys fall into the same bucket so this pass wouldn't change the order.
+        if (pHistogram[(pSrc[0] >> (digit * 8)) & 0xFF] == cnt)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < 256; bucket++)
+        {
+            const uint32_t bucketCnt = pHistogram[bucket];
+            pHistogram[bucket] = offset;
+            offset += bucketCnt;
+        }
+
+        for (uint32_t i = 0; i < cnt; i++)
+        {
+            const uint64_t key = pSrc[i];
+            pDst[pHistogram[(key >> (digit * 8)) & 0xFF]++] = key;
+        }
+
+        std::swap(pSrc, pDst);
+    }
+
+    if (pSrc != pKeys)
+    {
+        memcpy(pKeys, pSrc, sizeof(uint64_t) * cnt);
+    }
+}
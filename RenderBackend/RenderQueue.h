@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Sort keys for the draw submission. The layout from the most significant bits:
+// [63, 60] Pass | [59, 36] State id (Material/Texture set/Geometry) | [35, 20] Depth bucket | [19, 0] Draw index.
+// Sorting the keys ascending groups the draws by pass and state, then orders them front to back for the early-Z.
+enum class RenderPassType : uint32_t
+{
+    Opaque = 0,
+    Transparent = 1
+};
+
+// A run of sorted keys that is drawn by one instanced draw call. The instances are the keys in
+// [firstKeyIdx, firstKeyIdx + instanceCnt) in the sorted order.
+struct InstanceBatch
+{
+    uint32_t firstKeyIdx;
+    uint32_t instanceCnt;
+};
+
+class RenderQueue
+{
+public:
+    static constexpr uint32_t PASS_BITS = 4;
+    static constexpr uint32_t STATE_BITS = 24;
+    static constexpr uint32_t DEPTH_BITS = 16;
+    static constexpr uint32_t DRAW_IDX_BITS = 20;
+
+    static constexpr uint32_t DRAW_IDX_SHIFT = 0;
+    static constexpr uint32_t DEPTH_SHIFT = DRAW_IDX_SHIFT + DRAW_IDX_BITS;
+    static constexpr uint32_t STATE_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+    static constexpr uint32_t PASS_SHIFT = STATE_SHIFT + STATE_BITS;
+
+    static constexpr uint32_t MAX_DRAW_CNT = 1u << DRAW_IDX_BITS;
+    static constexpr uint32_t MAX_STATE_CNT = 1u << STATE_BITS;
+
+    RenderQueue() {}
+    ~RenderQueue() {}
+
+    // normalizedDepth is the view depth remapped to [0, 1] and it's clamped into this range.
+    static uint64_t BuildSortKey(RenderPassType pass, uint32_t stateId, float normalizedDepth, uint32_t drawIdx);
+
+    static uint32_t GetDrawIdx(uint64_t key) { return static_cast<uint32_t>((key >> DRAW_IDX_SHIFT) & (MAX_DRAW_CNT - 1)); }
+    static uint32_t GetStateId(uint64_t key) { return static_cast<uint32_t>((key >> STATE_SHIFT) & (MAX_STATE_CNT - 1)); }
+    static RenderPassType GetPass(uint64_t key) { return static_cast<RenderPassType>(key >> PASS_SHIFT); }
+
+    void Clear() { m_keys.clear(); }
+    void Push(uint64_t key) { m_keys.push_back(key); }
+    void Sort();
+
+    // Merge the consecutive sorted keys that have the same pass and state id into instance batches.
+    // The state id must identify everything that isn't per instance data (Geometry, textures, pass).
+    static void BuildInstanceBatches(const uint64_t* pSortedKeys, uint32_t cnt, std::vector<InstanceBatch>& oBatches);
+
+    uint32_t Size() const { return static_cast<uint32_t>(m_keys.size()); }
+    const std::vector<uint64_t>& GetKeys() const { return m_keys; }
+
+private:
+    std::vector<uint64_t> m_keys;
+    std::vector<uint64_t> m_scratchKeys; // Kept across frames to avoid the reallocation.
+};
+
+// LSD radix sort with 8 bits digits. The digits that are the same for all keys are skipped, which is common since only
+// a few pass and state ids are used in a frame. The result is in pKeys. pScratch must hold cnt keys.
+void RadixSortKeys(uint64_t* pKeys, uint64_t* pScratch, uint32_t cnt);
@@ -8,6 +8,7 @@ class HEventManager;
 class SceneAssetLoader;
 class Level;
 class FrameContext;
+class FrameArena;
 
 enum class RendererBackendType
 {
@@ -49,15 +50,16 @@ public:
     void Deinit();
 
     virtual void RenderTick(ID3D12GraphicsCommandList4* pCommandList, RenderTargetInfo rtInfo) = 0;
-    static void OnResizeCallback(HEventArguments args)
+    static void OnResizeCallback(const ResizeSwapchainEvent& event)
     {
-        uint32_t width = std::any_cast<uint32_t>(args[crc32("Width")]);
-        uint32_t height = std::any_cast<uint32_t>(args[crc32("Height")]);
-        m_pInstance->CustomResize(width, height);
+        m_pInstance->CustomResize(event.width, event.height);
     }
 
     RendererBackendType GetType() { return m_type; }
 
+    // The transient allocations of the next RenderTick() come from this arena. It's reset once the frame's fence completes.
+    void SetFrameArena(FrameArena* pFrameArena) { m_pFrameArena = pFrameArena; }
+
     virtual void Resize(uint32_t width, uint32_t height) {}
     virtual void GetMainRenderTargetSize(uint32_t& oWidth, uint32_t& oHeight) = 0;
 
@@ -75,6 +77,7 @@ protected:
     Level*         m_pLevel = nullptr;
     FrameContext*  m_pInitFrameContext = nullptr;
     ID3D12GraphicsCommandList4* m_pCommandList = nullptr;
+    FrameArena*    m_pFrameArena = nullptr;
 
 private:
     RendererBackendType m_type;
@@ -0,0 +1,248 @@
+#include "SoftwareOcclusionCuller.h"
+#include "../Utils/MathUtils.h"
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define OCCLUSION_CULLER_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Triangles and boxes crossing this w are treated conservatively -- Skipped as occluders and visible as occludees.
+constexpr float NEAR_W_EPSILON = 1e-4f;
+
+SoftwareOcclusionCuller::SoftwareOcclusionCuller()
+    : m_depthBuffer(DEPTH_WIDTH * DEPTH_HEIGHT, 1.f),
+      m_hiZBuffer(HIZ_WIDTH * HIZ_HEIGHT, 1.f)
+{
+    memset(m_vpMat, 0, sizeof(m_vpMat));
+}
+
+void SoftwareOcclusionCuller::BeginFrame(const float* pVpMat)
+{
+    memcpy(m_vpMat, pVpMat, sizeof(m_vpMat));
+    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), 1.f);
+    std::fill(m_hiZBuffer.begin(), m_hiZBuffer.end(), 1.f);
+}
+
+void SoftwareOcclusionCuller::RasterizeOccluder(const float* pPosData, const uint16_t* pIdxData, uint32_t idxCnt, const float* pModelMat)
+{
+    RasterizeOccluderImpl(pPosData, pIdxData, idxCnt, pModelMat);
+}
+
+void SoftwareOcclusionCuller::RasterizeOccluder(const float* pPosData, const uint32_t* pIdxData, uint32_t idxCnt, const float* pModelMat)
+{
+    RasterizeOccluderImpl(pPosData, pIdxData, idxCnt, pModelMat);
+}
+
+template<typename IdxType>
+void SoftwareOcclusionCuller::RasterizeOccluderImpl(const float* pPosData, const IdxType* pIdxData, uint32_t idxCnt, const float* pModelMat)
+{
+    float mvpMat[16] = {};
+    MatrixMul4x4(m_vpMat, pModelMat, mvpMat);
+
+    for (uint32_t triIdx = 0; triIdx + 2 < idxCnt; triIdx += 3)
+    {
+        float screenVerts[3][3] = {};
+        bool clipped = false;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            const float* pPos = &pPosData[3 * pIdxData[triIdx + i]];
+            float clip[4] = {};
+            for (uint32_t row = 0; row < 4; row++)
+            {
+                clip[row] = mvpMat[4 * row] * pPos[0] + mvpMat[4 * row + 1] * pPos[1] + mvpMat[4 * row + 2] * pPos[2] + mvpMat[4 * row + 3];
+            }
+
+            // We don't clip triangles against the near plane. Skipping them only means less culling.
+            if (clip[3] < NEAR_W_EPSILON || clip[2] < 0.f)
+            {
+                clipped = true;
+                break;
+            }
+
+            const float invW = 1.f / clip[3];
+            screenVerts[i][0] = (clip[0] * invW * 0.5f + 0.5f) * DEPTH_WIDTH;
+            screenVerts[i][1] = (0.5f - clip[1] * invW * 0.5f) * DEPTH_HEIGHT;
+            screenVerts[i][2] = clip[2] * invW;
+        }
+
+        if (!clipped)
+        {
+            RasterizeTriangle(screenVerts[0], screenVerts[1], screenVerts[2]);
+        }
+    }
+}
+
+void SoftwareOcclusionCuller::RasterizeTriangle(const float* pV0, const float* pV1, const float* pV2)
+{
+    // Edge(a, b, p) = (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x). Make the area positive.
+    float area = (pV1[0] - pV0[0]) * (pV2[1] - pV0[1]) - (pV1[1] - pV0[1]) * (pV2[0] - pV0[0]);
+    if (area < 0.f)
+    {
+        std::swap(pV1, pV2);
+        area = -area;
+    }
+
+    if (area < 1e-8f)
+    {
+        return;
+    }
+
+    // Clamp in float first since the vertices close to the camera plane can go far outside of the int range.
+    const int minX = static_cast<int>(std::clamp(std::min({ pV0[0], pV1[0], pV2[0] }), 0.f, static_cast<float>(DEPTH_WIDTH)));
+    const int maxX = static_cast<int>(std::clamp(std::max({ pV0[0], pV1[0], pV2[0] }), -1.f, static_cast<float>(DEPTH_WIDTH - 1)));
+    const int minY = static_cast<int>(std::clamp(std::min({ pV0[1], pV1[1], pV2[1] }), 0.f, static_cast<float>(DEPTH_HEIGHT)));
+    const int maxY = static_cast<int>(std::clamp(std::max({ pV0[1], pV1[1], pV2[1] }), -1.f, static_cast<float>(DEPTH_HEIGHT - 1)));
+
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // Edge functions and the depth plane as A * x + B * y + C.
+    const float* pEdgeVerts[3][2] = { { pV1, pV2 }, { pV2, pV0 }, { pV0, pV1 } };
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const float* pA = pEdgeVerts[i][0];
+        const float* pB = pEdgeVerts[i][1];
+        edgeA[i] = -(pB[1] - pA[1]);
+        edgeB[i] = pB[0] - pA[0];
+        edgeC[i] = -edgeA[i] * pA[0] - edgeB[i] * pA[1];
+    }
+
+    const float invArea = 1.f / area;
+    const float depthA = (edgeA[0] * pV0[2] + edgeA[1] * pV1[2] + edgeA[2] * pV2[2]) * invArea;
+    const float depthB = (edgeB[0] * pV0[2] + edgeB[1] * pV1[2] + edgeB[2] * pV2[2]) * invArea;
+    const float depthC = (edgeC[0] * pV0[2] + edgeC[1] * pV1[2] + edgeC[2] * pV2[2]) * invArea;
+
+#ifdef OCCLUSION_CULLER_SSE
+    // Process 4 pixels of a row at a time. The depth buffer width is a multiple of 4.
+    const int alignedMinX = minX & ~3;
+    const __m128 pixOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (int y = minY; y <= maxY; y++)
+    {
+        const float py = static_cast<float>(y) + 0.5f;
+        float* pRow = &m_depthBuffer[y * DEPTH_WIDTH];
+        for (int x = alignedMinX; x <= maxX; x += 4)
+        {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixOffsets);
+
+            const __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), px), _mm_set1_ps(edgeB[0] * py + edgeC[0]));
+            const __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), px), _mm_set1_ps(edgeB[1] * py + edgeC[1]));
+            const __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), px), _mm_set1_ps(edgeB[2] * py + edgeC[2]));
+
+            const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+            if (_mm_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            const __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), px), _mm_set1_ps(depthB * py + depthC));
+            const __m128 oldDepth = _mm_loadu_ps(&pRow[x]);
+            const __m128 minDepth = _mm_min_ps(oldDepth, depth);
+            _mm_storeu_ps(&pRow[x], _mm_or_ps(_mm_and_ps(inside, minDepth), _mm_andnot_ps(inside, oldDepth)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++)
+    {
+        const float py = static_cast<float>(y) + 0.5f;
+        float* pRow = &m_depthBuffer[y * DEPTH_WIDTH];
+        for (int x = minX; x <= maxX; x++)
+        {
+            const float px = static_cast<float>(x) + 0.5f;
+            const float w0 = edgeA[0] * px + edgeB[0] * py + edgeC[0];
+            const float w1 = edgeA[1] * px + edgeB[1] * py + edgeC[1];
+            const float w2 = edgeA[2] * px + edgeB[2] * py + edgeC[2];
+            if (w0 >= 0.f && w1 >= 0.f && w2 >= 0.f)
+            {
+                const float depth = depthA * px + depthB * py + depthC;
+                pRow[x] = std::min(pRow[x], depth);
+            }
+        }
+    }
+#endif
+}
+
+void SoftwareOcclusionCuller::BuildHiZ()
+{
+    for (uint32_t tileY = 0; tileY < HIZ_HEIGHT; tileY++)
+    {
+        for (uint32_t tileX = 0; tileX < HIZ_WIDTH; tileX++)
+        {
+            float maxDepth = 0.f;
+            for (uint32_t y = tileY * HIZ_TILE_SIZE; y < (tileY + 1) * HIZ_TILE_SIZE; y++)
+            {
+                const float* pRow = &m_depthBuffer[y * DEPTH_WIDTH + tileX * HIZ_TILE_SIZE];
+                for (uint32_t x = 0; x < HIZ_TILE_SIZE; x++)
+                {
+                    maxDepth = std::max(maxDepth, pRow[x]);
+                }
+            }
+            m_hiZBuffer[tileY * HIZ_WIDTH + tileX] = maxDepth;
+        }
+    }
+}
+
+bool SoftwareOcclusionCuller::IsAABBVisible(const float* pAabbMin, const float* pAabbMax, const float* pModelMat) const
+{
+    float mvpMat[16] = {};
+    MatrixMul4x4(m_vpMat, pModelMat, mvpMat);
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (uint32_t corner = 0; corner < 8; corner++)
+    {
+        const float pos[3] = { (corner & 1) ? pAabbMax[0] : pAabbMin[0],
+                               (corner & 2) ? pAabbMax[1] : pAabbMin[1],
+                               (corner & 4) ? pAabbMax[2] : pAabbMin[2] };
+        float clip[4] = {};
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            clip[row] = mvpMat[4 * row] * pos[0] + mvpMat[4 * row + 1] * pos[1] + mvpMat[4 * row + 2] * pos[2] + mvpMat[4 * row + 3];
+        }
+
+        if (clip[3] < NEAR_W_EPSILON)
+        {
+            // The box crosses the camera plane.
+            return true;
+        }
+
+        const float invW = 1.f / clip[3];
+        const float screenX = (clip[0] * invW * 0.5f + 0.5f) * DEPTH_WIDTH;
+        const float screenY = (0.5f - clip[1] * invW * 0.5f) * DEPTH_HEIGHT;
+        minX = std::min(minX, screenX);
+        maxX = std::max(maxX, screenX);
+        minY = std::min(minY, screenY);
+        maxY = std::max(maxY, screenY);
+        minZ = std::min(minZ, clip[2] * invW);
+    }
+
+    // Frustum rejection.
+    if (maxX < 0.f || maxY < 0.f || minX >= DEPTH_WIDTH || minY >= DEPTH_HEIGHT || minZ > 1.f)
+    {
+        return false;
+    }
+
+    const int tileMinX = static_cast<int>(std::max(minX, 0.f)) / static_cast<int>(HIZ_TILE_SIZE);
+    const int tileMaxX = static_cast<int>(std::min(maxX, static_cast<float>(DEPTH_WIDTH - 1))) / static_cast<int>(HIZ_TILE_SIZE);
+    const int tileMinY = static_cast<int>(std::max(minY, 0.f)) / static_cast<int>(HIZ_TILE_SIZE);
+    const int tileMaxY = static_cast<int>(std::min(maxY, static_cast<float>(DEPTH_HEIGHT - 1))) / static_cast<int>(HIZ_TILE_SIZE);
+
+    for (int tileY = tileMinY; tileY <= tileMaxY; tileY++)
+    {
+        for (int tileX = tileMinX; tileX <= tileMaxX; tileX++)
+        {
+            if (minZ <= m_hiZBuffer[tileY * HIZ_WIDTH + tileX])
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// A low resolution CPU depth rasterizer used to reject the hidden primitives before recording the draws.
+// It doesn't depend on the D3D12, so it can run headless.
+// Conventions follow the renderer: row-major matrices, column vectors, DX12 clip space with the depth range [0, 1]
+// and the LESS depth test.
+struct OcclusionCullingStats
+{
+    uint32_t occluderCnt = 0;
+    uint32_t occluderTriCnt = 0;
+    uint32_t testedCnt = 0;
+    uint32_t culledCnt = 0;
+    float    rasterizeMs = 0.f;
+    float    testMs = 0.f;
+};
+
+class SoftwareOcclusionCuller
+{
+public:
+    static constexpr uint32_t DEPTH_WIDTH = 256;
+    static constexpr uint32_t DEPTH_HEIGHT = 128;
+    static constexpr uint32_t HIZ_TILE_SIZE = 8;
+    static constexpr uint32_t HIZ_WIDTH = DEPTH_WIDTH / HIZ_TILE_SIZE;
+    static constexpr uint32_t HIZ_HEIGHT = DEPTH_HEIGHT / HIZ_TILE_SIZE;
+
+    SoftwareOcclusionCuller();
+    ~SoftwareOcclusionCuller() {}
+
+    // Clear the depth buffer and set the view-projection matrix used by the following rasterization and tests.
+    void BeginFrame(const float* pVpMat);
+
+    // pPosData is a float3 position array. The triangles are rasterized without backface culling.
+    void RasterizeOccluder(const float* pPosData, const uint16_t* pIdxData, uint32_t idxCnt, const float* pModelMat);
+    void RasterizeOccluder(const float* pPosData, const uint32_t* pIdxData, uint32_t idxCnt, const float* pModelMat);
+
+    // Build the hierarchical depth (Max depth of each tile) after all occluders are rasterized.
+    void BuildHiZ();
+
+    // Conservative test. Returns false only if the box is outside of the screen or fully behind the rasterized occluders.
+    bool IsAABBVisible(const float* pAabbMin, const float* pAabbMax, const float* pModelMat) const;
+
+    const float* GetDepthBuffer() const { return m_depthBuffer.data(); }
+    const float* GetHiZBuffer() const { return m_hiZBuffer.data(); }
+
+private:
+    template<typename IdxType>
+    void RasterizeOccluderImpl(const float* pPosData, const IdxType* pIdxData, uint32_t idxCnt, const float* pModelMat);
+
+    // The input vertices are in the screen space -- x, y in pixels and z in [0, 1].
+    void RasterizeTriangle(const float* pV0, const float* pV1, const float* pV2);
+
+    float m_vpMat[16];
+    std::vector<float> m_depthBuffer;
+    std::vector<float> m_hiZBuffer;
+};
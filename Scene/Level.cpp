@@ -4,6 +4,35 @@
 #include "Lights.h"
 #include "../Utils/crc32.h"
 
+namespace
+{
+    template<typename StaticMeshVector>
+    void CollectStaticMeshes(const std::vector<Object*>& objects, StaticMeshVector& o_staticMeshes)
+    {
+        for (Object* pObj : objects)
+        {
+            if (pObj->GetObjectTypeHash() == crc32("StaticMesh"))
+            {
+                StaticMesh* pStaticMesh = dynamic_cast<StaticMesh*>(pObj);
+                o_staticMeshes.push_back(pStaticMesh);
+            }
+        }
+    }
+
+    template<typename LightVector>
+    void CollectLights(const std::vector<Object*>& objects, LightVector& o_lights)
+    {
+        for (Object* pObj : objects)
+        {
+            if (pObj->GetObjectTypeHash() == crc32("AmbientLight") || pObj->GetObjectTypeHash() == crc32("PointLight"))
+            {
+                Light* pLight = dynamic_cast<Light*>(pObj);
+                o_lights.push_back(pLight);
+            }
+        }
+    }
+}
+
 Level::Level()
 {
 }
@@ -23,14 +52,14 @@ void Level::LoadObject(const std::string& objName, const YAML::Node& i_node, PFN
 
 void Level::RetriveStaticMeshes(std::vector<StaticMesh*>& o_staticMeshes)
 {
-    for (Object* pObj : m_objects)
-    {
-        if (pObj->GetObjectTypeHash() == crc32("StaticMesh"))
-        {
-            StaticMesh* pStaticMesh = dynamic_cast<StaticMesh*>(pObj);
-            o_staticMeshes.push_back(pStaticMesh);
-        }
-    }
+    CollectStaticMeshes(m_objects, o_staticMeshes);
+}
+
+void Level::RetriveStaticMeshes(FrameVector<StaticMesh*>& o_staticMeshes)
+{
+    // Reserve the upper bound once. A growing arena vector leaves all its old buffers behind.
+    o_staticMeshes.reserve(o_staticMeshes.size() + m_objects.size());
+    CollectStaticMeshes(m_objects, o_staticMeshes);
 }
 
 void Level::RetriveActiveCamera(Camera** o_camera)
@@ -53,12 +82,11 @@ void Level::RetriveActiveCamera(Camera** o_camera)
 
 void Level::RetriveLights(std::vector<Light*>& o_lights)
 {
-    for (Object* pObj : m_objects)
-    {
-        if (pObj->GetObjectTypeHash() == crc32("AmbientLight") || pObj->GetObjectTypeHash() == crc32("PointLight"))
-        {
-            Light* pLight = dynamic_cast<Light*>(pObj);
-            o_lights.push_back(pLight);
-        }
-    }
+    CollectLights(m_objects, o_lights);
+}
+
+void Level::RetriveLights(FrameVector<Light*>& o_lights)
+{
+    o_lights.reserve(o_lights.size() + m_objects.size());
+    CollectLights(m_objects, o_lights);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <string>
 #include "Object.h"
 #include "../RenderBackend/RendererBackend.h"
+#include "../Utils/FrameArena.h"
 
 class StaticMesh;
 class Camera;
@@ -34,6 +35,10 @@ public:
     void RetriveActiveCamera(Camera** o_camera);
     void RetriveLights(std::vector<Light*>& o_lights);
 
+    // Same as above for the per frame containers.
+    void RetriveStaticMeshes(FrameVector<StaticMesh*>& o_staticMeshes);
+    void RetriveLights(FrameVector<Light*>& o_lights);
+
     std::string m_sceneName;
     float m_backgroundColor[3];
 
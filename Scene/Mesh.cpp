@@ -110,18 +110,26 @@ Object* StaticMesh::Deseralize(const std::string& objName, const YAML::Node& i_n
     assert((mesh->m_scale[0] == mesh->m_scale[1]) &&
            (mesh->m_scale[1] == mesh->m_scale[2]), "Assume scale are equal.");
 
-    SceneAssetLoader::LoadStaticMesh(assetPath, mesh);
-
+    // The primitives chain their node matrices onto it as they are added.
     GenModelMat(mesh->m_position,
                 mesh->m_rotation[2], mesh->m_rotation[0], mesh->m_rotation[1],
                 mesh->m_scale, mesh->m_modelMat);
 
+    SceneAssetLoader::LoadStaticMesh(assetPath, mesh);
+
     mesh->GenAndInitGpuBufferRsrc();
     mesh->SendModelMatrixToGpuBuffer();
 
     return mesh;
 }
 
+void StaticMesh::AddPrimitive(PrimitiveAsset* pPrimAsset, const float* pNodeMat)
+{
+    m_primitiveAssets.push_back(pPrimAsset);
+    m_primModelMats.resize(m_primModelMats.size() + 16);
+    MatrixMul4x4(m_modelMat, pNodeMat, &m_primModelMats[m_primModelMats.size() - 16]);
+}
+
 void StaticMesh::SendModelMatrixToGpuBuffer()
 {
     void* pConstBufferBegin;
@@ -21,6 +21,14 @@ public:
     static Object* Deseralize(const std::string& objName, const YAML::Node& i_node);
     void SendModelMatrixToGpuBuffer();
 
+    // Place a primitive of the asset by its glTF node's world matrix. A primitive placed by several nodes is listed
+    // once per node in the m_primitiveAssets. The model matrix has to be generated before.
+    void AddPrimitive(PrimitiveAsset* pPrimAsset, const float* pNodeMat);
+
+    // The model matrix chained with the node matrix of the m_primitiveAssets[primIdx]. Cached by AddPrimitive(), so
+    // the renderers don't chain it per draw.
+    const float* GetPrimModelMat(uint32_t primIdx) const { return &m_primModelMats[16 * primIdx]; }
+
     bool IsCnstEmissiveMaterial() const { return m_isCnstEmissiveMaterial; }
 
     uint32_t GetStaticMeshMaterialMask() const
@@ -49,6 +57,16 @@ public:
         return res;
     }
 
+    // Same data as GetCnstAlbedo() and GetCnstMetallicRoughness() without the allocations. Used by the per frame instance data.
+    void GetCnstMaterial(float* oAlbedo, float* oMetallicRoughness) const
+    {
+        oAlbedo[0] = m_cnstAlbedo[0];
+        oAlbedo[1] = m_cnstAlbedo[1];
+        oAlbedo[2] = m_cnstAlbedo[2];
+        oMetallicRoughness[0] = m_cnstMetallic;
+        oMetallicRoughness[1] = m_cnstRoughness;
+    }
+
     std::string m_assetPath;
 
     // std::vector<MeshPrimitive> m_meshPrimitives;
@@ -67,6 +85,8 @@ public:
 private:
     void GenAndInitGpuBufferRsrc();
 
+    std::vector<float> m_primModelMats; // 16 floats per primitive.
+
     float m_position[3];
     float m_rotation[3];
     float m_scale[3];
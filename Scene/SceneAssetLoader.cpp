@@ -3,11 +3,22 @@
 #include "Mesh.h"
 #include "Lights.h"
 #include "Camera.h"
+#include "SceneStreamer.h"
 #include "yaml-cpp/yaml.h"
 #include "../Utils/MathUtils.h"
 #include "../Utils/StrPathUtils.h"
 #include "../Utils/GltfUtils.h"
+#include "../Utils/TextureUtils.h"
+#include "../Utils/BlockCompression.h"
+#include "../Utils/TextureContainer.h"
+#include "../Utils/MeshUtils.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include "../Utils/MemoryTracker.h"
+#include "../JobSystem/JobSystem.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -18,7 +29,809 @@ SceneAssetLoader* SceneAssetLoader::m_pThis = nullptr;
 
 extern AssetManager* g_pAssetManager;
 
+namespace
+{
+    struct StashedImages
+    {
+        std::vector<std::vector<unsigned char>> encoded;
+        std::vector<bool>                       isContainer; // KTX2/DDS, which are mapped from their files instead.
+    };
+
+    // The TinyGltf image loader hook. It only keeps a copy of the encoded image, which is decoded in parallel after the
+    // parse. The image passed in is a temporary of the parser, so the bytes are stashed by the image index instead.
+    bool StashEncodedImage(tinygltf::Image* pImage, const int imageIdx, std::string* pErr, std::string* pWarn,
+                           int reqWidth, int reqHeight, const unsigned char* pBytes, int size, void* pUserData)
+    {
+        auto& stashedImages = *static_cast<StashedImages*>(pUserData);
+        if (imageIdx >= static_cast<int>(stashedImages.encoded.size()))
+        {
+            stashedImages.encoded.resize(imageIdx + 1);
+            stashedImages.isContainer.resize(imageIdx + 1, false);
+        }
+
+        if (IsTextureContainer(pBytes, size))
+        {
+            stashedImages.isContainer[imageIdx] = true;
+        }
+        else
+        {
+            stashedImages.encoded[imageIdx].assign(pBytes, pBytes + size);
+        }
+        return true;
+    }
+
+    // The image of a texture. The KHR_texture_basisu and MSFT_texture_dds put the container image into an extension and
+    // keep the source as the PNG/JPEG fallback, which is used when the container can't be loaded. -1 if no image is usable.
+    int GetTextureImageIdx(const tinygltf::Model& model, const int texIdx,
+                           const std::vector<std::shared_ptr<TextureContainer>>& imageContainers)
+    {
+        const auto& texture = model.textures[texIdx];
+        for (const char* pExtName : { "KHR_texture_basisu", "MSFT_texture_dds" })
+        {
+            const auto itr = texture.extensions.find(pExtName);
+            if (itr != texture.extensions.end() && itr->second.Has("source") && itr->second.Get("source").IsInt())
+            {
+                const int extImgIdx = itr->second.Get("source").Get<int>();
+                if (extImgIdx >= 0 && extImgIdx < static_cast<int>(imageContainers.size()) && imageContainers[extImgIdx])
+                {
+                    return extImgIdx;
+                }
+            }
+        }
+
+        const int imgIdx = texture.source;
+        if (imgIdx < 0 || imgIdx >= static_cast<int>(model.images.size()))
+        {
+            return -1;
+        }
+        const bool hasContainer = imgIdx < static_cast<int>(imageContainers.size()) && imageContainers[imgIdx];
+        return (hasContainer || !model.images[imgIdx].image.empty()) ? imgIdx : -1;
+    }
+
+    // Assume that all the decoded textures are 8 bits per channel with 4 components. The container levels are uploaded
+    // from the file mapping as they are, so they skip the mip generation and the block compression.
+    void SetTextureImage(ImgInfo& imgInfo, const tinygltf::Image& img, const std::shared_ptr<TextureContainer>& pContainer,
+                         const std::string& sourceUri)
+    {
+        imgInfo.sourceUri = sourceUri;
+        if (pContainer)
+        {
+            imgInfo.pixWidth = pContainer->width;
+            imgInfo.pixHeight = pContainer->height;
+            imgInfo.componentCnt = 4;
+            imgInfo.mipCnt = static_cast<uint32_t>(pContainer->levels.size());
+            imgInfo.blockDesc.format = pContainer->format;
+            imgInfo.dataVec.clear();
+            imgInfo.pContainer = pContainer;
+            return;
+        }
+
+        imgInfo.pixWidth = img.width;
+        imgInfo.pixHeight = img.height;
+        imgInfo.componentCnt = img.component;
+        imgInfo.dataVec = img.image;
+
+        assert(img.component == 4 && "All textures should have 4 components.");
+        assert(img.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE && "All textures' each component should be a byte.");
+    }
+
+    // The 1x1 default textures of a primitive without the texture. All the textures are 4 components R8G8B8A8 textures.
+    void SetDefaultBaseColorTexture(PrimitiveAsset& meshPrimitive)
+    {
+        meshPrimitive.m_baseColorTex.pixHeight = 1;
+        meshPrimitive.m_baseColorTex.pixWidth = 1;
+        meshPrimitive.m_baseColorTex.mipCnt = 1;
+        meshPrimitive.m_baseColorTex.blockDesc.format = BlockFormat::None;
+        meshPrimitive.m_baseColorTex.pContainer = nullptr;
+        meshPrimitive.m_baseColorTex.sourceUri.clear();
+        meshPrimitive.m_baseColorTex.componentCnt = 4;
+        meshPrimitive.m_baseColorTex.dataVec = std::vector<uint8_t>(4, 255);
+    }
+
+    void SetDefaultMetallicRoughnessTexture(PrimitiveAsset& meshPrimitive)
+    {
+        float defaultMetallicRoughness[4] = { 0.f, 1.f, 0.f, 0.f };
+        meshPrimitive.m_metallicRoughnessTex.pixHeight = 1;
+        meshPrimitive.m_metallicRoughnessTex.pixWidth = 1;
+        meshPrimitive.m_metallicRoughnessTex.mipCnt = 1;
+        meshPrimitive.m_metallicRoughnessTex.blockDesc.format = BlockFormat::None;
+        meshPrimitive.m_metallicRoughnessTex.pContainer = nullptr;
+        meshPrimitive.m_metallicRoughnessTex.sourceUri.clear();
+        meshPrimitive.m_metallicRoughnessTex.componentCnt = 4;
+        meshPrimitive.m_metallicRoughnessTex.dataVec = std::vector<uint8_t>(sizeof(defaultMetallicRoughness), 0);
+        memcpy(meshPrimitive.m_metallicRoughnessTex.dataVec.data(), defaultMetallicRoughness, sizeof(defaultMetallicRoughness));
+    }
+
+    void SetDefaultOcclusionTexture(PrimitiveAsset& meshPrimitive)
+    {
+        float defaultOcclusion[4] = { 1.f, 0.f, 0.f, 0.f };
+        meshPrimitive.m_occlusionTex.pixHeight = 1;
+        meshPrimitive.m_occlusionTex.pixWidth = 1;
+        meshPrimitive.m_occlusionTex.mipCnt = 1;
+        meshPrimitive.m_occlusionTex.blockDesc.format = BlockFormat::None;
+        meshPrimitive.m_occlusionTex.pContainer = nullptr;
+        meshPrimitive.m_occlusionTex.sourceUri.clear();
+        meshPrimitive.m_occlusionTex.componentCnt = 4;
+        meshPrimitive.m_occlusionTex.dataVec = std::vector<uint8_t>(sizeof(defaultOcclusion), 0);
+        memcpy(meshPrimitive.m_occlusionTex.dataVec.data(), &defaultOcclusion, sizeof(defaultOcclusion));
+    }
+
+    void SetDefaultNormalTexture(PrimitiveAsset& meshPrimitive)
+    {
+        float defaultNormal[3] = { 0.f, 0.f, 1.f };
+        meshPrimitive.m_normalTex.pixHeight = 1;
+        meshPrimitive.m_normalTex.pixWidth = 1;
+        meshPrimitive.m_normalTex.mipCnt = 1;
+        meshPrimitive.m_normalTex.blockDesc.format = BlockFormat::None;
+        meshPrimitive.m_normalTex.pContainer = nullptr;
+        meshPrimitive.m_normalTex.sourceUri.clear();
+        meshPrimitive.m_normalTex.componentCnt = 3;
+        meshPrimitive.m_normalTex.dataVec = std::vector<uint8_t>(sizeof(defaultNormal), 0);
+        memcpy(meshPrimitive.m_normalTex.dataVec.data(), defaultNormal, sizeof(defaultNormal));
+    }
+
+    // The primitives using one glTF image through the same processing get the same texels, so only the first one does
+    // the work and the others copy it. The wrap modes change the mip filtering. Empty for a texture without a source.
+    std::string GetTextureWorkKey(const ImgInfo& imgInfo, const char* pWork, uint32_t variant)
+    {
+        if (imgInfo.sourceUri.empty())
+        {
+            return std::string();
+        }
+        return imgInfo.sourceUri + "|" + pWork + std::to_string(variant) + "|" +
+               std::to_string(static_cast<uint32_t>(imgInfo.wrapModeHorizontal)) + std::to_string(static_cast<uint32_t>(imgInfo.wrapModeVertical));
+    }
+
+    // Appends the full mip chain to each loaded texture of the primitives. The textures go in parallel, and the rows of
+    // each level split further, so a single large texture still spreads across the workers.
+    void GenerateMaterialMips(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt)
+    {
+        PERF_ZONE("Generate Texture Mips");
+        MEMORY_TAG_SCOPE(MemoryTag::Textures);
+        struct MipTask
+        {
+            ImgInfo*   pImgInfo;
+            MipContent content;
+        };
+
+        std::vector<MipTask> mipTasks;
+        std::vector<std::pair<ImgInfo*, const ImgInfo*>> sharedChains; // The duplicate and the first of its work key.
+        std::unordered_map<std::string, const ImgInfo*> firstByWorkKey;
+        uint64_t srcPixCnt = 0;
+        uint64_t srcBytes = 0;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            PrimitiveAsset* pPrimitiveAsset = ppPrimitiveAssets[i];
+            const MipTask primTasks[4] = { { &pPrimitiveAsset->m_baseColorTex, MipContent::SRgb },
+                                           { &pPrimitiveAsset->m_metallicRoughnessTex, MipContent::Linear },
+                                           { &pPrimitiveAsset->m_normalTex, MipContent::Normal },
+                                           { &pPrimitiveAsset->m_occlusionTex, MipContent::Linear } };
+            for (const MipTask& task : primTasks)
+            {
+                // The 1x1 defaults have no mips, and the containers come with theirs.
+                if (task.pImgInfo->pixWidth > 1 && !task.pImgInfo->pContainer)
+                {
+                    const std::string workKey = GetTextureWorkKey(*task.pImgInfo, "mips", static_cast<uint32_t>(task.content));
+                    if (!workKey.empty())
+                    {
+                        const auto [itr, isFirst] = firstByWorkKey.emplace(workKey, task.pImgInfo);
+                        if (!isFirst)
+                        {
+                            sharedChains.push_back({ task.pImgInfo, itr->second });
+                            continue;
+                        }
+                    }
+                    mipTasks.push_back(task);
+                    srcPixCnt += static_cast<uint64_t>(task.pImgInfo->pixWidth) * task.pImgInfo->pixHeight;
+                    srcBytes += task.pImgInfo->dataVec.size();
+                }
+            }
+        }
+
+        if (mipTasks.empty())
+        {
+            return;
+        }
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, static_cast<uint32_t>(mipTasks.size()), 1, [&mipTasks](uint32_t taskBegin, uint32_t taskEnd)
+        {
+            for (uint32_t i = taskBegin; i < taskEnd; i++)
+            {
+                ImgInfo& imgInfo = *mipTasks[i].pImgInfo;
+                MipGenDesc desc;
+                desc.content = mipTasks[i].content;
+                desc.filter = MipFilter::Box;
+                desc.wrapHorizontal = imgInfo.wrapModeHorizontal == TexWrapMode::REPEAT;
+                desc.wrapVertical = imgInfo.wrapModeVertical == TexWrapMode::REPEAT;
+                imgInfo.mipCnt = GenerateMipChain(imgInfo.dataVec, imgInfo.pixWidth, imgInfo.pixHeight, desc);
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        for (const auto& [pDupImgInfo, pFirstImgInfo] : sharedChains)
+        {
+            pDupImgInfo->dataVec = pFirstImgInfo->dataVec;
+            pDupImgInfo->mipCnt = pFirstImgInfo->mipCnt;
+        }
+
+        uint64_t chainBytes = 0;
+        for (const MipTask& task : mipTasks)
+        {
+            chainBytes += task.pImgInfo->dataVec.size();
+        }
+        std::cout << "Generated the mips of " << mipTasks.size() << " textures: " << srcPixCnt / 1e6 << " MPixels in "
+                  << elapsedMs << " ms (" << srcPixCnt / 1e3 / std::max(elapsedMs, 1e-3) << " MPixels/s), +"
+                  << (chainBytes - srcBytes) / (1024.0 * 1024.0) << " MB. " << sharedChains.size()
+                  << " duplicates copied theirs." << std::endl;
+    }
+
+    bool HasTranslucentTexel(const ImgInfo& imgInfo)
+    {
+        for (size_t i = 3; i < imgInfo.dataVec.size(); i += 4)
+        {
+            if (imgInfo.dataVec[i] != 255)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Replaces each mip chain of the primitives with its BCn blocks. The D3D12 only takes the block formats at the
+    // level 0 sizes of 4 multiples, so the other textures stay uncompressed. Each is decoded back once to report its
+    // PSNR against the source.
+    void CompressMaterialTextures(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt, TextureCompression compression)
+    {
+        if (compression == TextureCompression::None)
+        {
+            return;
+        }
+
+        PERF_ZONE("Compress Textures");
+        MEMORY_TAG_SCOPE(MemoryTag::Textures);
+        struct CompressTask
+        {
+            ImgInfo*          pImgInfo;
+            BlockCompressDesc desc;
+            uint32_t          slot;
+            double            psnr;
+        };
+
+        std::vector<CompressTask> compressTasks;
+        std::vector<std::pair<ImgInfo*, const ImgInfo*>> sharedBlocks; // The duplicate and the first of its work key.
+        std::unordered_map<std::string, const ImgInfo*> firstByWorkKey;
+        uint64_t srcPixCnt = 0;
+        uint64_t srcBytes = 0;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            PrimitiveAsset* pPrimitiveAsset = ppPrimitiveAssets[i];
+            ImgInfo* pImgInfos[4] = { &pPrimitiveAsset->m_baseColorTex, &pPrimitiveAsset->m_metallicRoughnessTex,
+                                      &pPrimitiveAsset->m_normalTex, &pPrimitiveAsset->m_occlusionTex };
+            for (uint32_t slot = 0; slot < 4; slot++)
+            {
+                ImgInfo* pImgInfo = pImgInfos[slot];
+                if (pImgInfo->pixWidth <= 1 || pImgInfo->pixWidth % 4 != 0 || pImgInfo->pixHeight % 4 != 0 || pImgInfo->pContainer)
+                {
+                    continue;
+                }
+
+                const std::string workKey = GetTextureWorkKey(*pImgInfo, "blocks", slot);
+                if (!workKey.empty())
+                {
+                    const auto [itr, isFirst] = firstByWorkKey.emplace(workKey, pImgInfo);
+                    if (!isFirst)
+                    {
+                        sharedBlocks.push_back({ pImgInfo, itr->second });
+                        continue;
+                    }
+                }
+
+                CompressTask task = { pImgInfo, {}, slot, 0.0 };
+                switch (slot)
+                {
+                case 0:
+                    task.desc.format = compression == TextureCompression::Quality ? BlockFormat::BC7 :
+                                       (HasTranslucentTexel(*pImgInfo) ? BlockFormat::BC3 : BlockFormat::BC1);
+                    break;
+                case 1:
+                    // The glTF keeps the roughness in the green and the metallic in the blue.
+                    task.desc.format = BlockFormat::BC5;
+                    task.desc.srcChannels[0] = 1;
+                    task.desc.srcChannels[1] = 2;
+                    break;
+                case 2:
+                    // The shader rebuilds the z from the xy.
+                    task.desc.format = BlockFormat::BC5;
+                    break;
+                default:
+                    task.desc.format = BlockFormat::BC4;
+                    break;
+                }
+                compressTasks.push_back(task);
+                srcPixCnt += static_cast<uint64_t>(pImgInfo->pixWidth) * pImgInfo->pixHeight;
+                srcBytes += pImgInfo->dataVec.size();
+            }
+        }
+
+        if (compressTasks.empty())
+        {
+            return;
+        }
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, static_cast<uint32_t>(compressTasks.size()), 1, [&compressTasks](uint32_t taskBegin, uint32_t taskEnd)
+        {
+            std::vector<uint8_t> blocks;
+            std::vector<uint8_t> decoded;
+            for (uint32_t i = taskBegin; i < taskEnd; i++)
+            {
+                CompressTask& task = compressTasks[i];
+                ImgInfo& imgInfo = *task.pImgInfo;
+                CompressMipChain(imgInfo.dataVec.data(), imgInfo.pixWidth, imgInfo.pixHeight, imgInfo.mipCnt, task.desc, blocks);
+                DecompressMipChain(blocks.data(), imgInfo.pixWidth, imgInfo.pixHeight, imgInfo.mipCnt, task.desc, decoded);
+                task.psnr = CalcPsnr(imgInfo.dataVec.data(), decoded.data(), imgInfo.dataVec.size() / 4, GetBlockChannelMask(task.desc));
+
+                imgInfo.dataVec.swap(blocks);
+                imgInfo.blockDesc = task.desc;
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        for (const auto& [pDupImgInfo, pFirstImgInfo] : sharedBlocks)
+        {
+            pDupImgInfo->dataVec = pFirstImgInfo->dataVec;
+            pDupImgInfo->blockDesc = pFirstImgInfo->blockDesc;
+        }
+
+        // The worst texture of each slot is the one worth looking at.
+        double minPsnrs[4] = { DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX };
+        uint64_t blockBytes = 0;
+        for (const CompressTask& task : compressTasks)
+        {
+            minPsnrs[task.slot] = std::min(minPsnrs[task.slot], task.psnr);
+            blockBytes += task.pImgInfo->dataVec.size();
+        }
+        std::cout << "Compressed " << compressTasks.size() << " textures: " << srcPixCnt / 1e6 << " MPixels in " << elapsedMs
+                  << " ms (" << srcPixCnt / 1e3 / std::max(elapsedMs, 1e-3) << " MPixels/s), " << srcBytes / (1024.0 * 1024.0)
+                  << " MB -> " << blockBytes / (1024.0 * 1024.0) << " MB." << std::endl;
+        const char* slotNames[4] = { "Base color", "Metallic roughness", "Normal", "Occlusion" };
+        for (uint32_t slot = 0; slot < 4; slot++)
+        {
+            if (minPsnrs[slot] != DBL_MAX)
+            {
+                std::cout << "    " << slotNames[slot] << " min PSNR: " << minPsnrs[slot] << " dB." << std::endl;
+            }
+        }
+    }
+
+    // The faces that bend more than this across an edge get their own normals there, so the hard surface models keep
+    // their edges and the curved ones still shade smoothly.
+    constexpr float GENERATED_NORMAL_CREASE_DEGREES = 60.0f;
+
+    // Reads the primitive's indices as uint32 whatever their stored type, so the passes work on one layout.
+    void ReadPrimitiveIndices(const PrimitiveAsset& primAsset, std::vector<uint32_t>& oIndices)
+    {
+        if (primAsset.m_idxType)
+        {
+            oIndices.assign(primAsset.m_idxDataUint32.begin(), primAsset.m_idxDataUint32.begin() + primAsset.m_idxCnt);
+        }
+        else
+        {
+            oIndices.assign(primAsset.m_idxDataUint16.begin(), primAsset.m_idxDataUint16.begin() + primAsset.m_idxCnt);
+        }
+    }
+
+    // Writes the indices back over the primitive's, widening the uint16 ones to uint32 when the vertices no longer fit.
+    void WritePrimitiveIndices(PrimitiveAsset& primAsset, const std::vector<uint32_t>& indices, uint32_t vertCnt)
+    {
+        if (!primAsset.m_idxType && vertCnt > UINT16_MAX + 1)
+        {
+            primAsset.m_idxType = true;
+            primAsset.m_idxDataUint16 = {};
+            primAsset.m_idxDataUint32.resize(primAsset.m_idxCnt);
+        }
+        if (primAsset.m_idxType)
+        {
+            std::copy(indices.begin(), indices.end(), primAsset.m_idxDataUint32.begin());
+        }
+        else
+        {
+            std::transform(indices.begin(), indices.end(), primAsset.m_idxDataUint16.begin(),
+                           [](uint32_t idx) { return static_cast<uint16_t>(idx); });
+        }
+    }
+
+    // Generates the smooth normals of the primitives whose glTF has no NORMAL, which come with an empty normal stream.
+    // The vertices split on the hard edges are appended, and the uint16 indices widen to uint32 when they no longer fit.
+    // The primitives go in parallel, and the large ones spread their triangles over the jobs too.
+    void GeneratePrimitiveNormals(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt)
+    {
+        std::vector<PrimitiveAsset*> normallessPrims;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            if (ppPrimitiveAssets[i]->m_normalData.empty())
+            {
+                normallessPrims.push_back(ppPrimitiveAssets[i]);
+            }
+        }
+        if (normallessPrims.empty())
+        {
+            return;
+        }
+
+        PERF_ZONE("Generate Normals");
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+        std::vector<uint32_t> vertCntsBefore(normallessPrims.size());
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, static_cast<uint32_t>(normallessPrims.size()), 1, [&normallessPrims, &vertCntsBefore](uint32_t primBegin, uint32_t primEnd)
+        {
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> srcVerts;
+            for (uint32_t i = primBegin; i < primEnd; i++)
+            {
+                PrimitiveAsset& primAsset = *normallessPrims[i];
+                const uint32_t vertCnt = static_cast<uint32_t>(primAsset.m_posData.size() / 3);
+                vertCntsBefore[i] = vertCnt;
+                ReadPrimitiveIndices(primAsset, indices);
+
+                const uint32_t newVertCnt = GenerateNormals(indices.data(), primAsset.m_idxCnt, primAsset.m_posData.data(), vertCnt,
+                                                            GENERATED_NORMAL_CREASE_DEGREES, primAsset.m_normalData, srcVerts);
+                ExpandVertexStream(primAsset.m_posData, 3, srcVerts);
+                ExpandVertexStream(primAsset.m_texCoordData, 2, srcVerts);
+                WritePrimitiveIndices(primAsset, indices, newVertCnt);
+
+                // The glTF ignores the tangents without the normals, so they're generated against the new ones instead.
+                primAsset.m_tangentData = {};
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        uint64_t triCnt = 0;
+        uint64_t vertCntBefore = 0;
+        uint64_t vertCntAfter = 0;
+        for (uint32_t i = 0; i < normallessPrims.size(); i++)
+        {
+            triCnt += normallessPrims[i]->m_idxCnt / 3;
+            vertCntBefore += vertCntsBefore[i];
+            vertCntAfter += normallessPrims[i]->m_posData.size() / 3;
+        }
+
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        std::cout << "Generated the normals of " << normallessPrims.size() << " meshes: " << triCnt / 1e6 << " MTriangles in "
+                  << elapsedMs << " ms (" << elapsedMs / (triCnt / 1e6) << " ms per MTriangle), vertices " << vertCntBefore
+                  << " -> " << vertCntAfter << "." << std::endl;
+    }
+
+    // Generates the MikkTSpace tangents of the primitives whose glTF has no TANGENT, which come with an empty tangent
+    // stream. The vertices split where the texture is mirrored are appended, and the uint16 indices widen to uint32 when
+    // they no longer fit. The primitives go in parallel, and the large ones spread their triangles over the jobs too.
+    void GeneratePrimitiveTangents(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt)
+    {
+        std::vector<PrimitiveAsset*> tangentlessPrims;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            if (ppPrimitiveAssets[i]->m_tangentData.empty())
+            {
+                tangentlessPrims.push_back(ppPrimitiveAssets[i]);
+            }
+        }
+        if (tangentlessPrims.empty())
+        {
+            return;
+        }
+
+        PERF_ZONE("Generate Tangents");
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+        std::vector<uint32_t> vertCntsBefore(tangentlessPrims.size());
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, static_cast<uint32_t>(tangentlessPrims.size()), 1, [&tangentlessPrims, &vertCntsBefore](uint32_t primBegin, uint32_t primEnd)
+        {
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> srcVerts;
+            for (uint32_t i = primBegin; i < primEnd; i++)
+            {
+                PrimitiveAsset& primAsset = *tangentlessPrims[i];
+                const uint32_t vertCnt = static_cast<uint32_t>(primAsset.m_posData.size() / 3);
+                vertCntsBefore[i] = vertCnt;
+                ReadPrimitiveIndices(primAsset, indices);
+
+                const uint32_t newVertCnt = GenerateTangents(indices.data(), primAsset.m_idxCnt, primAsset.m_posData.data(), primAsset.m_normalData.data(),
+                                                             primAsset.m_texCoordData.data(), vertCnt, primAsset.m_tangentData, srcVerts);
+                ExpandVertexStream(primAsset.m_posData, 3, srcVerts);
+                ExpandVertexStream(primAsset.m_normalData, 3, srcVerts);
+                ExpandVertexStream(primAsset.m_texCoordData, 2, srcVerts);
+                WritePrimitiveIndices(primAsset, indices, newVertCnt);
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        uint64_t triCnt = 0;
+        uint64_t vertCntBefore = 0;
+        uint64_t vertCntAfter = 0;
+        for (uint32_t i = 0; i < tangentlessPrims.size(); i++)
+        {
+            triCnt += tangentlessPrims[i]->m_idxCnt / 3;
+            vertCntBefore += vertCntsBefore[i];
+            vertCntAfter += tangentlessPrims[i]->m_posData.size() / 3;
+        }
+
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        std::cout << "Generated the tangents of " << tangentlessPrims.size() << " meshes: " << triCnt / 1e6 << " MTriangles in "
+                  << elapsedMs << " ms (" << elapsedMs / (triCnt / 1e6) << " ms per MTriangle), vertices " << vertCntBefore
+                  << " -> " << vertCntAfter << "." << std::endl;
+    }
+
+    // Reorders each primitive's triangles for the post-transform vertex cache, and optionally for the overdraw, then
+    // renumbers its vertices in the fetch order. The primitives go in parallel. It stands in for an offline mesh bake.
+    void OptimizePrimitiveMeshes(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt, MeshOptimization optimization)
+    {
+        if (optimization == MeshOptimization::None || primitiveCnt == 0)
+        {
+            return;
+        }
+
+        PERF_ZONE("Optimize Meshes");
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+        struct PrimStats
+        {
+            VertexCacheStats before;
+            VertexCacheStats after;
+            uint32_t         vertCntBefore;
+            uint32_t         vertCntAfter;
+        };
+        std::vector<PrimStats> primStats(primitiveCnt);
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, primitiveCnt, 1, [ppPrimitiveAssets, optimization, &primStats](uint32_t primBegin, uint32_t primEnd)
+        {
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> remap;
+            for (uint32_t i = primBegin; i < primEnd; i++)
+            {
+                PrimitiveAsset& primAsset = *ppPrimitiveAssets[i];
+                const uint32_t vertCnt = static_cast<uint32_t>(primAsset.m_posData.size() / 3);
+                ReadPrimitiveIndices(primAsset, indices);
+
+                PrimStats& stats = primStats[i];
+                stats.before = AnalyzeVertexCache(indices.data(), primAsset.m_idxCnt, vertCnt);
+                stats.vertCntBefore = vertCnt;
+
+                OptimizeVertexCache(indices.data(), primAsset.m_idxCnt, vertCnt);
+                if (optimization == MeshOptimization::Overdraw)
+                {
+                    OptimizeOverdraw(indices.data(), primAsset.m_idxCnt, primAsset.m_posData.data(), vertCnt);
+                }
+
+                const uint32_t newVertCnt = OptimizeVertexFetchRemap(indices.data(), primAsset.m_idxCnt, vertCnt, remap);
+                RemapVertexStream(primAsset.m_posData, 3, remap, newVertCnt);
+                RemapVertexStream(primAsset.m_normalData, 3, remap, newVertCnt);
+                RemapVertexStream(primAsset.m_tangentData, 4, remap, newVertCnt);
+                RemapVertexStream(primAsset.m_texCoordData, 2, remap, newVertCnt);
+
+                // The vertex count only goes down, so the uint16 indices still fit.
+                WritePrimitiveIndices(primAsset, indices, newVertCnt);
+
+                stats.after = AnalyzeVertexCache(indices.data(), primAsset.m_idxCnt, newVertCnt);
+                stats.vertCntAfter = newVertCnt;
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        // The misses add up over the primitives, so the totals are weighted by their triangles and vertices.
+        uint64_t triCnt = 0;
+        double missesBefore = 0.0;
+        double missesAfter = 0.0;
+        uint64_t vertCntBefore = 0;
+        uint64_t vertCntAfter = 0;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            const uint32_t primTriCnt = ppPrimitiveAssets[i]->m_idxCnt / 3;
+            triCnt += primTriCnt;
+            missesBefore += primStats[i].before.acmr * primTriCnt;
+            missesAfter += primStats[i].after.acmr * primTriCnt;
+            vertCntBefore += primStats[i].vertCntBefore;
+            vertCntAfter += primStats[i].vertCntAfter;
+        }
+
+        if (triCnt == 0)
+        {
+            return;
+        }
+
+        // The ATVR counts the referenced vertices, which are all the vertices left after the remap.
+        std::cout << "Optimized " << primitiveCnt << " meshes (" << (optimization == MeshOptimization::Overdraw ? "overdraw" : "vertex cache")
+                  << "): " << triCnt / 1e6 << " MTriangles in " << elapsedMs << " ms (" << elapsedMs / (triCnt / 1e6)
+                  << " ms per MTriangle). ACMR " << missesBefore / triCnt << " -> " << missesAfter / triCnt << ", ATVR "
+                  << missesBefore / vertCntAfter << " -> " << missesAfter / vertCntAfter << ", vertices " << vertCntBefore
+                  << " -> " << vertCntAfter << "." << std::endl;
+    }
+
+    // Splits each primitive's level 0 into meshlets with their culling bounds, and reorders its triangles to match. The
+    // meshlets grow in the index order, so they follow the vertex cache order of the mesh optimization when it's on,
+    // though the overdraw order is lost. The primitives go in parallel. It stands in for an offline mesh bake.
+    void BuildPrimitiveMeshlets(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt, bool buildMeshlets)
+    {
+        if (!buildMeshlets || primitiveCnt == 0)
+        {
+            return;
+        }
+
+        PERF_ZONE("Build Meshlets");
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, primitiveCnt, 1, [ppPrimitiveAssets](uint32_t primBegin, uint32_t primEnd)
+        {
+            std::vector<uint32_t> indices;
+            for (uint32_t i = primBegin; i < primEnd; i++)
+            {
+                PrimitiveAsset& primAsset = *ppPrimitiveAssets[i];
+                const uint32_t vertCnt = static_cast<uint32_t>(primAsset.m_posData.size() / 3);
+                ReadPrimitiveIndices(primAsset, indices);
+
+                BuildMeshlets(indices.data(), primAsset.m_idxCnt, primAsset.m_posData.data(), vertCnt, primAsset.m_meshlets,
+                              primAsset.m_meshletVerts, primAsset.m_meshletTris);
+                primAsset.m_meshletBounds.resize(primAsset.m_meshlets.size());
+                for (uint32_t m = 0; m < primAsset.m_meshlets.size(); m++)
+                {
+                    ComputeMeshletBounds(primAsset.m_meshlets[m], primAsset.m_meshletVerts.data(), primAsset.m_meshletTris.data(),
+                                         primAsset.m_posData.data(), primAsset.m_meshletBounds[m]);
+                }
+
+                WritePrimitiveIndices(primAsset, indices, vertCnt);
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        uint64_t triCnt = 0;
+        uint64_t meshletCnt = 0;
+        uint64_t meshletVertCnt = 0;
+        uint64_t cullableConeCnt = 0;
+        double coneSpreadSum = 0.0;
+        uint64_t meshletBytes = 0;
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            const PrimitiveAsset& primAsset = *ppPrimitiveAssets[i];
+            triCnt += primAsset.m_idxCnt / 3;
+            meshletCnt += primAsset.m_meshlets.size();
+            meshletVertCnt += primAsset.m_meshletVerts.size();
+            for (const MeshletBounds& bounds : primAsset.m_meshletBounds)
+            {
+                // The cutoff is the sine of the normals' largest angle to the axis.
+                if (bounds.coneCutoff < 1.0f)
+                {
+                    cullableConeCnt++;
+                    coneSpreadSum += asin(bounds.coneCutoff) * 180.0 / M_PI;
+                }
+            }
+            meshletBytes += primAsset.m_meshlets.size() * (sizeof(Meshlet) + sizeof(MeshletBounds)) +
+                            primAsset.m_meshletVerts.size() * sizeof(uint32_t) + primAsset.m_meshletTris.size();
+        }
+
+        if (meshletCnt == 0)
+        {
+            return;
+        }
+
+        std::cout << "Built the meshlets of " << primitiveCnt << " meshes: " << triCnt / 1e6 << " MTriangles in " << elapsedMs
+                  << " ms (" << elapsedMs / (triCnt / 1e6) << " ms per MTriangle). " << meshletCnt << " meshlets of "
+                  << static_cast<double>(meshletVertCnt) / meshletCnt << " vertices and " << static_cast<double>(triCnt) / meshletCnt
+                  << " triangles on average (" << 100.0 * triCnt / (meshletCnt * MESHLET_MAX_TRI_CNT) << "% of the triangle limit), "
+                  << 100.0 * cullableConeCnt / meshletCnt << "% with a backface cone of "
+                  << (cullableConeCnt > 0 ? coneSpreadSum / cullableConeCnt : 0.0) << " degrees spread on average, "
+                  << static_cast<double>(meshletBytes) / triCnt << " bytes per triangle." << std::endl;
+    }
+
+    // Simplifies each primitive into up to lodCnt - 1 coarser levels. Each level targets half of the previous level's
+    // triangles and is simplified from it, so its error adds up. The chain stops when a level barely shrinks, since the
+    // seams and borders stay, or when the error would pass MESH_LOD_MAX_ERROR. The levels are vertex cache ordered
+    // too with the mesh optimization. The primitives go in parallel. It stands in for an offline mesh bake.
+    void GeneratePrimitiveLods(PrimitiveAsset* const* ppPrimitiveAssets, uint32_t primitiveCnt, uint32_t lodCnt, MeshOptimization optimization)
+    {
+        if (lodCnt <= 1 || primitiveCnt == 0)
+        {
+            return;
+        }
+
+        PERF_ZONE("Generate Mesh LODs");
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+        constexpr uint32_t MIN_LOD_SHRINK_PERCENT = 10;
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        JobSystem::ParallelFor(0, primitiveCnt, 1, [ppPrimitiveAssets, lodCnt, optimization](uint32_t primBegin, uint32_t primEnd)
+        {
+            std::vector<uint32_t> indices;
+            std::vector<uint32_t> lodIndices;
+            for (uint32_t i = primBegin; i < primEnd; i++)
+            {
+                PrimitiveAsset& primAsset = *ppPrimitiveAssets[i];
+                primAsset.m_lods.clear();
+                primAsset.m_lodIdxData.clear();
+                const uint32_t vertCnt = static_cast<uint32_t>(primAsset.m_posData.size() / 3);
+                ReadPrimitiveIndices(primAsset, indices);
+
+                // The errors come back relative to the extent, which is the AABB's.
+                primAsset.GenAABB();
+                const float extent = std::max({ primAsset.m_aabbMax[0] - primAsset.m_aabbMin[0],
+                                                primAsset.m_aabbMax[1] - primAsset.m_aabbMin[1],
+                                                primAsset.m_aabbMax[2] - primAsset.m_aabbMin[2] });
+                const float* pNormalData = primAsset.m_normalData.empty() ? nullptr : primAsset.m_normalData.data();
+                const float* pTexCoordData = primAsset.m_texCoordData.empty() ? nullptr : primAsset.m_texCoordData.data();
+                uint32_t idxOffset = primAsset.m_idxCnt;
+                float error = 0.0f;
+                for (uint32_t lod = 1; lod < lodCnt; lod++)
+                {
+                    const uint32_t targetIdxCnt = static_cast<uint32_t>(indices.size() / 2 / 3 * 3);
+                    error += SimplifyMesh(indices.data(), static_cast<uint32_t>(indices.size()), primAsset.m_posData.data(), pNormalData,
+                                          pTexCoordData, vertCnt, targetIdxCnt, MESH_LOD_MAX_ERROR - error, lodIndices);
+                    if (lodIndices.empty() || lodIndices.size() * 100 > indices.size() * (100 - MIN_LOD_SHRINK_PERCENT))
+                    {
+                        break;
+                    }
+
+                    if (optimization != MeshOptimization::None)
+                    {
+                        OptimizeVertexCache(lodIndices.data(), static_cast<uint32_t>(lodIndices.size()), vertCnt);
+                    }
+                    primAsset.m_lods.push_back({ idxOffset, static_cast<uint32_t>(lodIndices.size()), error * extent });
+                    primAsset.m_lodIdxData.insert(primAsset.m_lodIdxData.end(), lodIndices.begin(), lodIndices.end());
+                    idxOffset += static_cast<uint32_t>(lodIndices.size());
+                    indices.swap(lodIndices);
+                }
+            }
+        });
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+        // The triangles of a level add up over the primitives that have it.
+        std::vector<uint64_t> lodTriCnts(lodCnt, 0);
+        std::vector<float> lodMaxErrors(lodCnt, 0.0f);
+        for (uint32_t i = 0; i < primitiveCnt; i++)
+        {
+            const PrimitiveAsset& primAsset = *ppPrimitiveAssets[i];
+            const float extent = std::max({ primAsset.m_aabbMax[0] - primAsset.m_aabbMin[0],
+                                            primAsset.m_aabbMax[1] - primAsset.m_aabbMin[1],
+                                            primAsset.m_aabbMax[2] - primAsset.m_aabbMin[2] });
+            lodTriCnts[0] += primAsset.m_idxCnt / 3;
+            for (uint32_t lod = 1; lod <= primAsset.m_lods.size(); lod++)
+            {
+                lodTriCnts[lod] += primAsset.m_lods[lod - 1].idxCnt / 3;
+                if (extent > 0.0f)
+                {
+                    lodMaxErrors[lod] = std::max(lodMaxErrors[lod], primAsset.m_lods[lod - 1].error / extent);
+                }
+            }
+        }
+
+        if (lodTriCnts[0] == 0)
+        {
+            return;
+        }
+
+        std::cout << "Generated the LODs of " << primitiveCnt << " meshes: " << lodTriCnts[0] / 1e6 << " MTriangles in " << elapsedMs
+                  << " ms (" << elapsedMs / (lodTriCnts[0] / 1e6) << " ms per MTriangle)." << std::endl;
+        for (uint32_t lod = 1; lod < lodCnt && lodTriCnts[lod] > 0; lod++)
+        {
+            std::cout << "    LOD " << lod << ": " << lodTriCnts[lod] << " triangles (" << 100.0 * lodTriCnts[lod] / lodTriCnts[0]
+                      << "% of the LOD 0), max error " << lodMaxErrors[lod] << " of the extent." << std::endl;
+        }
+    }
+}
+
 SceneAssetLoader::SceneAssetLoader()
+    : m_pSceneStreamer(nullptr),
+      m_textureCompression(TextureCompression::None),
+      m_meshOptimization(MeshOptimization::None),
+      m_meshLodCnt(1),
+      m_buildMeshlets(false)
 {
    m_pThis = this;
 }
@@ -29,8 +842,14 @@ SceneAssetLoader::~SceneAssetLoader()
 
 void SceneAssetLoader::LoadAsLevel(const std::string& fileNamePath, Level* o_pLevel)
 {
+    PERF_ZONE("Load Scene Yaml");
+    MEMORY_TAG_SCOPE(MemoryTag::SceneObjects);
     // Load the scene file into the level
-    YAML::Node config = YAML::LoadFile(fileNamePath.c_str());
+    YAML::Node config;
+    {
+        MEMORY_TAG_SCOPE(MemoryTag::LoaderScratch);
+        config = YAML::LoadFile(fileNamePath.c_str());
+    }
     std::string sceneType = "";
     if (config["SceneType"].IsDefined())
     {
@@ -48,6 +867,12 @@ void SceneAssetLoader::LoadAsLevel(const std::string& fileNamePath, Level* o_pLe
     if (rendererType.compare("PathTracer") == 0)
     {
         o_pLevel->m_rendererBackendType = RendererBackendType::PathTracing;
+        // Its acceleration structures and hit shaders read the float vertices.
+        if (g_pAssetManager->GetVertexFormat() != VertexFormat::Float)
+        {
+            std::cout << "The path tracer only takes the float vertices. Ignore the compact vertex format." << std::endl;
+            g_pAssetManager->SetVertexFormat(VertexFormat::Float);
+        }
     }
     else
     {
@@ -109,10 +934,16 @@ void SceneAssetLoader::LoadAsLevel(const std::string& fileNamePath, Level* o_pLe
 
 void SceneAssetLoader::LoadStaticMesh(const std::string& fileNamePath, StaticMesh* pStaticMesh)
 {
+    PERF_ZONE("Load Static Mesh");
     //#TODO: Check the file extension and call the appropriate loader. E.g. OpenUSD
     //#TODO: We may want to use FastGltf instead of TinyGltf.
 
-    if (g_pAssetManager->IsStaticMeshAssetLoaded(fileNamePath))
+    if (m_pThis->m_pSceneStreamer != nullptr)
+    {
+        // Loaded later on the streaming thread. The mesh draws nothing until its geometry arrives.
+        m_pThis->m_pSceneStreamer->RequestStaticMesh(fileNamePath, pStaticMesh);
+    }
+    else if (g_pAssetManager->IsStaticMeshAssetLoaded(fileNamePath))
     {
         g_pAssetManager->LoadStaticMeshAssets(fileNamePath, pStaticMesh);
     }
@@ -137,8 +968,37 @@ TexWrapMode GltfSamplerWrapToInternalWrapMode(int wrapMode)
     }
 }
 
+void SceneAssetLoader::SetPlaceholderTextures(PrimitiveAsset& primitiveAsset)
+{
+    SetDefaultBaseColorTexture(primitiveAsset);
+    SetDefaultMetallicRoughnessTexture(primitiveAsset);
+    SetDefaultOcclusionTexture(primitiveAsset);
+    SetDefaultNormalTexture(primitiveAsset);
+}
+
 void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh* pStaticMesh)
 {
+    std::vector<PrimitiveAsset*> primitiveAssets;
+    std::vector<PrimitiveInstance> primInstances;
+    LoadGltfPrimitives(fileNamePath, primitiveAssets, primInstances);
+    for (PrimitiveAsset* pPrimitiveAsset : primitiveAssets)
+    {
+        g_pAssetManager->SaveModelPrimAssetAndCreateGpuRsrc(fileNamePath, pPrimitiveAsset);
+    }
+    for (const PrimitiveInstance& primInstance : primInstances)
+    {
+        g_pAssetManager->SaveModelPrimInstance(fileNamePath, primInstance);
+        pStaticMesh->AddPrimitive(primInstance.pPrimAsset, primInstance.nodeMat);
+    }
+}
+
+void SceneAssetLoader::LoadGltfPrimitives(const std::string&              fileNamePath,
+                                          std::vector<PrimitiveAsset*>&   oPrimitiveAssets,
+                                          std::vector<PrimitiveInstance>& oPrimInstances)
+{
+    PERF_ZONE("Load glTF");
+    // The tinygltf model is released at the end of the loading. Only the data copied into the assets is kept.
+    MEMORY_TAG_SCOPE(MemoryTag::LoaderScratch);
     std::string absPath = GetFileDir(m_pThis->m_currentScenePath);
     const std::string fullGltfPathName = absPath + "\\" + fileNamePath;
     std::cout << "Loading gltf file: " << fullGltfPathName << std::endl;
@@ -148,7 +1008,88 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
     std::string err;
     std::string warn;
 
-    bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, fullGltfPathName);
+    StashedImages stashedImages;
+    loader.SetImageLoader(StashEncodedImage, &stashedImages);
+
+    bool ret = false;
+    {
+        PERF_ZONE("Parse glTF");
+        ret = loader.LoadASCIIFromFile(&model, &err, &warn, fullGltfPathName);
+    }
+
+    // The stb_image decode is the most of the glTF load time, and the images are independent of each other. The KTX2/DDS
+    // images are mapped from their files instead, which only reads the header until the upload touches the levels.
+    std::vector<std::shared_ptr<TextureContainer>> imageContainers(model.images.size());
+    const std::string gltfDir = GetFileDir(fullGltfPathName);
+    // The texture cache and the duplicate texture work go by these. An embedded image is named by its index.
+    std::vector<std::string> imageUris(model.images.size());
+    for (uint32_t i = 0; i < model.images.size(); i++)
+    {
+        imageUris[i] = model.images[i].uri.empty() ? fullGltfPathName + "#" + std::to_string(i) : gltfDir + "\\" + model.images[i].uri;
+    }
+    if (ret)
+    {
+        PERF_ZONE("Decode glTF Images");
+        const uint32_t imageCnt = static_cast<uint32_t>(std::min(stashedImages.encoded.size(), model.images.size()));
+        std::vector<std::string> decodeErrs(imageCnt);
+        std::vector<std::string> containerWarns(imageCnt);
+        JobSystem::ParallelFor(0, imageCnt, 1, [&](uint32_t imageBegin, uint32_t imageEnd)
+        {
+            for (uint32_t i = imageBegin; i < imageEnd; i++)
+            {
+                if (stashedImages.isContainer[i])
+                {
+                    // A failed container falls back to the texture source, or to the default texture.
+                    std::string containerErr = "embedded containers aren't supported";
+                    if (!model.images[i].uri.empty())
+                    {
+                        imageContainers[i] = OpenTextureContainer(imageUris[i], containerErr);
+                    }
+                    if (!imageContainers[i])
+                    {
+                        containerWarns[i] = "Skip the texture container image " + std::to_string(i) + ": " + containerErr + ".\n";
+                    }
+                    continue;
+                }
+
+                if (stashedImages.encoded[i].empty())
+                {
+                    continue;
+                }
+                std::string decodeWarn;
+                const auto& bytes = stashedImages.encoded[i];
+                if (!tinygltf::LoadImageData(&model.images[i], i, &decodeErrs[i], &decodeWarn, 0, 0, bytes.data(), static_cast<int>(bytes.size()), nullptr) &&
+                    decodeErrs[i].empty())
+                {
+                    decodeErrs[i] = "Failed to decode the image " + std::to_string(i) + ".\n";
+                }
+            }
+        });
+
+        for (const std::string& decodeErr : decodeErrs)
+        {
+            err += decodeErr;
+            ret = ret && decodeErr.empty();
+        }
+
+        uint32_t containerCnt = 0;
+        uint64_t containerBytes = 0;
+        for (uint32_t i = 0; i < imageCnt; i++)
+        {
+            warn += containerWarns[i];
+            if (imageContainers[i])
+            {
+                containerCnt++;
+                containerBytes += imageContainers[i]->file.GetSize();
+            }
+        }
+        if (containerCnt > 0)
+        {
+            std::cout << "Mapped " << containerCnt << " KTX2/DDS textures: " << containerBytes / (1024.0 * 1024.0)
+                      << " MB without the decode." << std::endl;
+        }
+        stashedImages = {};
+    }
 
     if (!warn.empty()) {
         printf("Warn: %s\n", warn.c_str());
@@ -171,25 +1112,62 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
     //       (2): The gltf may has multiple buffers. The buffer idx should come from the buffer view.
     //       (3): Be aware of the byte stride: https://github.com/KhronosGroup/glTF-Tutorials/blob/main/gltfTutorial/gltfTutorial_005_BuffersBufferViewsAccessors.md#data-interleaving
     //       (4): Be aware of the base color factor: https://github.com/KhronosGroup/glTF-Tutorials/blob/main/gltfTutorial/gltfTutorial_011_SimpleMaterial.md#material-definition
-    // This example only supports gltf that only has one mesh and one skin.
-    assert(model.meshes.size() == 1, "This SharedLib Gltf Loader currently only supports one mesh.");
     assert(model.skins.size() == 0, "This SharedLib Gltf Loader currently doesn't support the skinning."); // TODO: Support skinning and animation.
-    assert(model.scenes.size() == 1, "This SharedLib Gltf Loader currently only supports one scene.");
-    assert(model.scenes[0].nodes.size() == 1, "This SharedLib Gltf Loader currently only supports one node in the scene.");
-    
-    // Load mesh and relevant info
-    // Any node MAY contain one mesh, defined in its mesh property. The mesh MAY be skinned using information provided in a referenced skin object.
-    // TODO: We should support multiple meshes in the future.
-    const auto& mesh = model.meshes[0];
-    // pStaticMesh->m_primitiveAssets.resize(mesh.primitives.size());
-
-    for (uint32_t i = 0; i < mesh.primitives.size(); i++)
-    {
-        const auto& primitive = mesh.primitives[i];
+
+    // Any node MAY contain one mesh. A mesh referenced by several nodes is loaded once and placed by each of them. A glTF
+    // without a scene places each mesh once at the origin.
+    GltfFlatNodes flatNodes;
+    {
+        PERF_ZONE("Flatten glTF Nodes");
+        FlattenGltfNodes(model, -1, flatNodes);
+    }
+    const uint32_t meshCnt = static_cast<uint32_t>(model.meshes.size());
+    std::vector<uint32_t> placedMeshIdxs;
+    std::vector<const float*> placedNodeMats;
+    const float identityMat[16] = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f };
+    if (model.scenes.empty())
+    {
+        for (uint32_t meshIdx = 0; meshIdx < meshCnt; meshIdx++)
+        {
+            placedMeshIdxs.push_back(meshIdx);
+            placedNodeMats.push_back(identityMat);
+        }
+    }
+    for (uint32_t flatIdx = 0; flatIdx < flatNodes.nodeIdxs.size(); flatIdx++)
+    {
+        const int meshIdx = model.nodes[flatNodes.nodeIdxs[flatIdx]].mesh;
+        if (meshIdx >= 0 && meshIdx < static_cast<int>(meshCnt))
+        {
+            placedMeshIdxs.push_back(meshIdx);
+            placedNodeMats.push_back(&flatNodes.worldMats[16 * flatIdx]);
+        }
+    }
+
+    // The primitives of the placed meshes in their first placement order.
+    const uint32_t NOT_LOADED = UINT32_MAX;
+    std::vector<uint32_t> meshFirstPrimIdxs(meshCnt, NOT_LOADED);
+    std::vector<const tinygltf::Primitive*> primitives;
+    for (uint32_t meshIdx : placedMeshIdxs)
+    {
+        if (meshFirstPrimIdxs[meshIdx] == NOT_LOADED)
+        {
+            meshFirstPrimIdxs[meshIdx] = static_cast<uint32_t>(primitives.size());
+            for (const tinygltf::Primitive& primitive : model.meshes[meshIdx].primitives)
+            {
+                primitives.push_back(&primitive);
+            }
+        }
+    }
+
+    const size_t firstPrimIdx = oPrimitiveAssets.size();
+    for (uint32_t i = 0; i < primitives.size(); i++)
+    {
+        MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+        const auto& primitive = *primitives[i];
         PrimitiveAsset* pPrimitiveAsset = new PrimitiveAsset();
 
         // Load pos
-        int posIdx = mesh.primitives[i].attributes.at("POSITION");
+        int posIdx = primitive.attributes.at("POSITION");
         const auto& posAccessor = model.accessors[posIdx];
 
         assert(posAccessor.componentType == TINYGLTF_PARAMETER_TYPE_FLOAT, "The pos accessor data type should be float.");
@@ -201,7 +1179,7 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
         ReadOutAccessorData(pPrimitiveAsset->m_posData.data(), posAccessor, model.bufferViews, model.buffers);
 
         // Load indices
-        int indicesIdx = mesh.primitives[i].indices;
+        int indicesIdx = primitive.indices;
         const auto& idxAccessor = model.accessors[indicesIdx];
 
         assert(idxAccessor.componentType == TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT ||
@@ -222,11 +1200,11 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
         }
         pPrimitiveAsset->m_idxCnt = idxAccessor.count;
 
-        // Load normal
+        // Load normal. Without it, the normal data stays empty for the GeneratePrimitiveNormals().
         int normalIdx = -1;
-        if (mesh.primitives[i].attributes.count("NORMAL") > 0)
+        if (primitive.attributes.count("NORMAL") > 0)
         {
-            normalIdx = mesh.primitives[i].attributes.at("NORMAL");
+            normalIdx = primitive.attributes.at("NORMAL");
             const auto& normalAccessor = model.accessors[normalIdx];
 
             assert(normalAccessor.componentType == TINYGLTF_PARAMETER_TYPE_FLOAT, "The normal accessor data type should be float.");
@@ -235,41 +1213,12 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
             pPrimitiveAsset->m_normalData.resize(3 * normalAccessor.count);
             ReadOutAccessorData(pPrimitiveAsset->m_normalData.data(), normalAccessor, model.bufferViews, model.buffers);
         }
-        else
-        {
-            // If we don't have any normal geo data, then we will just apply the first triangle's normal to all the other
-            // triangles/vertices.
-            uint16_t idx0 = pPrimitiveAsset->m_idxDataUint16[0];
-            float vertPos0[3] = { pPrimitiveAsset->m_posData[3 * idx0], pPrimitiveAsset->m_posData[3 * idx0 + 1], pPrimitiveAsset->m_posData[3 * idx0 + 2] };
-
-            uint16_t idx1 = pPrimitiveAsset->m_idxDataUint16[1];
-            float vertPos1[3] = { pPrimitiveAsset->m_posData[3 * idx1], pPrimitiveAsset->m_posData[3 * idx1 + 1], pPrimitiveAsset->m_posData[3 * idx1 + 2] };
-
-            uint16_t idx2 = pPrimitiveAsset->m_idxDataUint16[2];
-            float vertPos2[3] = { pPrimitiveAsset->m_posData[3 * idx2], pPrimitiveAsset->m_posData[3 * idx2 + 1], pPrimitiveAsset->m_posData[3 * idx2 + 2] };
-
-            float v1[3] = { vertPos1[0] - vertPos0[0], vertPos1[1] - vertPos0[1], vertPos1[2] - vertPos0[2] };
-            float v2[3] = { vertPos2[0] - vertPos0[0], vertPos2[1] - vertPos0[1], vertPos2[2] - vertPos0[2] };
-
-            float autoGenNormal[3] = { 0.f };
-            CrossProductVec3(v1, v2, autoGenNormal);
-            NormalizeVec(autoGenNormal, 3);
-
-            pPrimitiveAsset->m_normalData.resize(3 * posAccessor.count);
-            for (uint32_t i = 0; i < posAccessor.count; i++)
-            {
-                uint32_t normalStartingIdx = i * 3;
-                pPrimitiveAsset->m_normalData[normalStartingIdx] = autoGenNormal[0];
-                pPrimitiveAsset->m_normalData[normalStartingIdx + 1] = autoGenNormal[1];
-                pPrimitiveAsset->m_normalData[normalStartingIdx + 2] = autoGenNormal[2];
-            }
-        }
 
         // Load uv
         int uvIdx = -1;
-        if (mesh.primitives[i].attributes.count("TEXCOORD_0") > 0)
+        if (primitive.attributes.count("TEXCOORD_0") > 0)
         {
-            uvIdx = mesh.primitives[i].attributes.at("TEXCOORD_0");
+            uvIdx = primitive.attributes.at("TEXCOORD_0");
             const auto& uvAccessor = model.accessors[uvIdx];
 
             assert(uvAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT, "The uv accessor data type should be float.");
@@ -284,11 +1233,11 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
             pPrimitiveAsset->m_texCoordData = std::vector<float>(posAccessor.count * 2, 0.f);
         }
 
-        // Load tangent
+        // Load tangent. Without it, the tangent data stays empty for the GeneratePrimitiveTangents().
         int tangentIdx = -1;
-        if (mesh.primitives[i].attributes.count("TANGENT"))
+        if (primitive.attributes.count("TANGENT"))
         {
-            tangentIdx = mesh.primitives[i].attributes.at("TANGENT");
+            tangentIdx = primitive.attributes.at("TANGENT");
             const auto& tangentAccessor = model.accessors[tangentIdx];
 
             assert(tangentAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT, "The tangent accessor data type should be float.");
@@ -298,50 +1247,11 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
             pPrimitiveAsset->m_tangentData.resize(4 * tangentAccessor.count);
             ReadOutAccessorData(pPrimitiveAsset->m_tangentData.data(), tangentAccessor, model.bufferViews, model.buffers);
         }
-        else
-        {
-            // assert(false, "The loaded mesh doesn't have tangent data.");
-            pPrimitiveAsset->m_tangentData = std::vector<float>(posAccessor.count * 4, 0.f);
-        }
 
+        MEMORY_TAG_SCOPE(MemoryTag::Textures);
         // Load the base color texture or create a default pure color texture.
         // The baseColorFactor contains the red, green, blue, and alpha components of the main color of the material.
-        int materialIdx = mesh.primitives[i].material;
-
-        // All the textures are 4 components R8G8B8A8 textures.
-        auto pfnSetDefaultBaseColor = [](PrimitiveAsset& meshPrimitive) {
-            meshPrimitive.m_baseColorTex.pixHeight = 1;
-            meshPrimitive.m_baseColorTex.pixWidth = 1;
-            meshPrimitive.m_baseColorTex.componentCnt = 4;
-            meshPrimitive.m_baseColorTex.dataVec = std::vector<uint8_t>(4, 255);
-            };
-
-        auto pfnSetDefaultMetallicRoughness = [](PrimitiveAsset& meshPrimitive) {
-            float defaultMetallicRoughness[4] = { 0.f, 1.f, 0.f, 0.f };
-            meshPrimitive.m_metallicRoughnessTex.pixHeight = 1;
-            meshPrimitive.m_metallicRoughnessTex.pixWidth = 1;
-            meshPrimitive.m_metallicRoughnessTex.componentCnt = 4;
-            meshPrimitive.m_metallicRoughnessTex.dataVec = std::vector<uint8_t>(sizeof(defaultMetallicRoughness), 0);
-            memcpy(meshPrimitive.m_metallicRoughnessTex.dataVec.data(), defaultMetallicRoughness, sizeof(defaultMetallicRoughness));
-            };
-
-        auto pfnSetDefaultOcclusion = [](PrimitiveAsset& meshPrimitive) {
-            float defaultOcclusion[4] = { 1.f, 0.f, 0.f, 0.f };
-            meshPrimitive.m_occlusionTex.pixHeight = 1;
-            meshPrimitive.m_occlusionTex.pixWidth = 1;
-            meshPrimitive.m_occlusionTex.componentCnt = 4;
-            meshPrimitive.m_occlusionTex.dataVec = std::vector<uint8_t>(sizeof(defaultOcclusion), 0);
-            memcpy(meshPrimitive.m_occlusionTex.dataVec.data(), &defaultOcclusion, sizeof(defaultOcclusion));
-            };
-
-        auto pfnSetDefaultNormal = [](PrimitiveAsset& meshPrimitive) {
-            float defaultNormal[3] = { 0.f, 0.f, 1.f };
-            meshPrimitive.m_normalTex.pixHeight = 1;
-            meshPrimitive.m_normalTex.pixWidth = 1;
-            meshPrimitive.m_normalTex.componentCnt = 3;
-            meshPrimitive.m_normalTex.dataVec = std::vector<uint8_t>(sizeof(defaultNormal), 0);
-            memcpy(meshPrimitive.m_normalTex.dataVec.data(), defaultNormal, sizeof(defaultNormal));
-            };
+        int materialIdx = primitive.material;
 
         if (materialIdx != -1)
         {
@@ -354,24 +1264,16 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
             int normalTexIdx = material.normalTexture.index;
             // material.emissiveTexture -- Let forget emissive. The renderer doesn't support emissive textures.
 
-            if (baseColorTexIdx == -1)
+            const int baseColorTexImgIdx = (baseColorTexIdx == -1) ? -1 : GetTextureImageIdx(model, baseColorTexIdx, imageContainers);
+            if (baseColorTexImgIdx == -1)
             {
-                pfnSetDefaultBaseColor(*pPrimitiveAsset);
+                SetDefaultBaseColorTexture(*pPrimitiveAsset);
             }
             else
             {
                 // A texture is defined by an image index, denoted by the source property and a sampler index (sampler).
-                // Assmue that all textures are 8 bits per channel. They are all xxx / 255. They all have 4 components.
                 const auto& baseColorTex = model.textures[baseColorTexIdx];
-                int baseColorTexImgIdx = baseColorTex.source;
-
-                // This model has a base color texture.
-                const auto& baseColorImg = model.images[baseColorTexImgIdx];
-
-                pPrimitiveAsset->m_baseColorTex.pixWidth = baseColorImg.width;
-                pPrimitiveAsset->m_baseColorTex.pixHeight = baseColorImg.height;
-                pPrimitiveAsset->m_baseColorTex.componentCnt = baseColorImg.component;
-                pPrimitiveAsset->m_baseColorTex.dataVec = baseColorImg.image;
+                SetTextureImage(pPrimitiveAsset->m_baseColorTex, model.images[baseColorTexImgIdx], imageContainers[baseColorTexImgIdx], imageUris[baseColorTexImgIdx]);
                 if (baseColorTex.sampler >= 0)
                 {
                     pPrimitiveAsset->m_baseColorTex.wrapModeHorizontal = GltfSamplerWrapToInternalWrapMode(model.samplers[baseColorTex.sampler].wrapS);
@@ -382,29 +1284,23 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
                     pPrimitiveAsset->m_baseColorTex.wrapModeHorizontal = TexWrapMode::REPEAT;
                     pPrimitiveAsset->m_baseColorTex.wrapModeVertical   = TexWrapMode::REPEAT;
                 }
-                
-                assert(baseColorImg.component == 4, "All textures should have 4 components.");
-                assert(baseColorImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
             }
 
             // The textures for metalness and roughness properties are packed together in a single texture called metallicRoughnessTexture.Its green
             // channel contains roughness values and its blue channel contains metalness values.This texture MUST be encoded with linear transfer function
             // and MAY use more than 8 bits per channel.
-            if (metallicRoughnessTexIdx == -1)
+            const int metallicRoughnessTexImgIdx = (metallicRoughnessTexIdx == -1) ? -1 : GetTextureImageIdx(model, metallicRoughnessTexIdx, imageContainers);
+            if (metallicRoughnessTexImgIdx == -1)
             {
-                pfnSetDefaultMetallicRoughness(*pPrimitiveAsset);
+                SetDefaultMetallicRoughnessTexture(*pPrimitiveAsset);
             }
             else
             {
                 const auto& metallicRoughnessTex = model.textures[metallicRoughnessTexIdx];
-                int metallicRoughnessTexImgIdx = metallicRoughnessTex.source;
-
-                const auto& metallicRoughnessImg = model.images[metallicRoughnessTexImgIdx];
-
-                pPrimitiveAsset->m_metallicRoughnessTex.pixWidth = metallicRoughnessImg.width;
-                pPrimitiveAsset->m_metallicRoughnessTex.pixHeight = metallicRoughnessImg.height;
-                pPrimitiveAsset->m_metallicRoughnessTex.componentCnt = metallicRoughnessImg.component;
-                pPrimitiveAsset->m_metallicRoughnessTex.dataVec = metallicRoughnessImg.image;
+                SetTextureImage(pPrimitiveAsset->m_metallicRoughnessTex, model.images[metallicRoughnessTexImgIdx], imageContainers[metallicRoughnessTexImgIdx], imageUris[metallicRoughnessTexImgIdx]);
+                // A block compressed container holds the roughness and metalness in its two channels, like the BC5 encode.
+                pPrimitiveAsset->m_metallicRoughnessTex.blockDesc.srcChannels[0] = 1;
+                pPrimitiveAsset->m_metallicRoughnessTex.blockDesc.srcChannels[1] = 2;
                 if (metallicRoughnessTex.sampler >= 0)
                 {
                     pPrimitiveAsset->m_metallicRoughnessTex.wrapModeHorizontal = GltfSamplerWrapToInternalWrapMode(model.samplers[metallicRoughnessTex.sampler].wrapS);
@@ -415,26 +1311,17 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
                     pPrimitiveAsset->m_metallicRoughnessTex.wrapModeHorizontal = TexWrapMode::REPEAT;
                     pPrimitiveAsset->m_metallicRoughnessTex.wrapModeVertical   = TexWrapMode::REPEAT;
                 }
-
-                assert(metallicRoughnessImg.component == 4, "All textures should have 4 components.");
-                assert(metallicRoughnessImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
             }
 
-            if (normalTexIdx == -1)
+            const int normalTexImgIdx = (normalTexIdx == -1) ? -1 : GetTextureImageIdx(model, normalTexIdx, imageContainers);
+            if (normalTexImgIdx == -1)
             {
-                pfnSetDefaultNormal(*pPrimitiveAsset);
+                SetDefaultNormalTexture(*pPrimitiveAsset);
             }
             else
             {
                 const auto& normalTex = model.textures[normalTexIdx];
-                int normalTexImgIdx = normalTex.source;
-
-                const auto& normalImg = model.images[normalTexImgIdx];
-
-                pPrimitiveAsset->m_normalTex.pixWidth = normalImg.width;
-                pPrimitiveAsset->m_normalTex.pixHeight = normalImg.height;
-                pPrimitiveAsset->m_normalTex.componentCnt = normalImg.component;
-                pPrimitiveAsset->m_normalTex.dataVec = normalImg.image;
+                SetTextureImage(pPrimitiveAsset->m_normalTex, model.images[normalTexImgIdx], imageContainers[normalTexImgIdx], imageUris[normalTexImgIdx]);
                 if (normalTex.sampler >= 0)
                 {
                     pPrimitiveAsset->m_normalTex.wrapModeHorizontal = GltfSamplerWrapToInternalWrapMode(model.samplers[normalTex.sampler].wrapS);
@@ -445,29 +1332,20 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
                     pPrimitiveAsset->m_normalTex.wrapModeHorizontal = TexWrapMode::REPEAT;
                     pPrimitiveAsset->m_normalTex.wrapModeVertical = TexWrapMode::REPEAT;
                 }
-
-                assert(normalImg.component == 4, "All textures should have 4 components.");
-                assert(normalImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
             }
 
             // The occlusion texture; it indicates areas that receive less indirect lighting from ambient sources.
             // Direct lighting is not affected.The red channel of the texture encodes the occlusion value,
             // where 0.0 means fully - occluded area(no indirect lighting) and 1.0 means not occluded area(full indirect lighting).
-            if (occlusionTexIdx == -1)
+            const int occlusionTexImgIdx = (occlusionTexIdx == -1) ? -1 : GetTextureImageIdx(model, occlusionTexIdx, imageContainers);
+            if (occlusionTexImgIdx == -1)
             {
-                pfnSetDefaultOcclusion(*pPrimitiveAsset);
+                SetDefaultOcclusionTexture(*pPrimitiveAsset);
             }
             else
             {
                 const auto& occlusionTex = model.textures[occlusionTexIdx];
-                int occlusionTexImgIdx = occlusionTex.source;
-
-                const auto& occlusionImg = model.images[occlusionTexImgIdx];
-
-                pPrimitiveAsset->m_occlusionTex.pixWidth = occlusionImg.width;
-                pPrimitiveAsset->m_occlusionTex.pixHeight = occlusionImg.height;
-                pPrimitiveAsset->m_occlusionTex.componentCnt = occlusionImg.component;
-                pPrimitiveAsset->m_occlusionTex.dataVec = occlusionImg.image;
+                SetTextureImage(pPrimitiveAsset->m_occlusionTex, model.images[occlusionTexImgIdx], imageContainers[occlusionTexImgIdx], imageUris[occlusionTexImgIdx]);
                 if (occlusionTex.sampler >= 0)
                 {
                     pPrimitiveAsset->m_occlusionTex.wrapModeHorizontal = GltfSamplerWrapToInternalWrapMode(model.samplers[occlusionTex.sampler].wrapS);
@@ -478,28 +1356,48 @@ void SceneAssetLoader::LoadTinyGltf(const std::string& fileNamePath, StaticMesh*
                     pPrimitiveAsset->m_occlusionTex.wrapModeHorizontal = TexWrapMode::REPEAT;
                     pPrimitiveAsset->m_occlusionTex.wrapModeVertical = TexWrapMode::REPEAT;
                 }
-
-                assert(occlusionImg.component == 4, "All textures should have 4 components.");
-                assert(occlusionImg.pixel_type == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, "All textures' each component should be a byte.");
             }
         }
         else
         {
             // No material, then we will create a pure white model.
-            pfnSetDefaultBaseColor(*pPrimitiveAsset);
-            pfnSetDefaultMetallicRoughness(*pPrimitiveAsset);
-            pfnSetDefaultOcclusion(*pPrimitiveAsset);
-            pfnSetDefaultNormal(*pPrimitiveAsset);
+            SetDefaultBaseColorTexture(*pPrimitiveAsset);
+            SetDefaultMetallicRoughnessTexture(*pPrimitiveAsset);
+            SetDefaultOcclusionTexture(*pPrimitiveAsset);
+            SetDefaultNormalTexture(*pPrimitiveAsset);
         }
 
-        // pPrimitiveAsset->CreateVertIdxBuffer();
-        g_pAssetManager->SaveModelPrimAssetAndCreateGpuRsrc(fileNamePath, pPrimitiveAsset);
-        pStaticMesh->m_primitiveAssets.push_back(pPrimitiveAsset);
+        oPrimitiveAssets.push_back(pPrimitiveAsset);
+    }
+
+    GeneratePrimitiveNormals(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx));
+    GeneratePrimitiveTangents(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx));
+    OptimizePrimitiveMeshes(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx),
+                            m_pThis->m_meshOptimization);
+    BuildPrimitiveMeshlets(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx),
+                           m_pThis->m_buildMeshlets);
+    GeneratePrimitiveLods(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx),
+                          m_pThis->m_meshLodCnt, m_pThis->m_meshOptimization);
+    GenerateMaterialMips(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx));
+    CompressMaterialTextures(oPrimitiveAssets.data() + firstPrimIdx, static_cast<uint32_t>(oPrimitiveAssets.size() - firstPrimIdx),
+                             m_pThis->m_textureCompression);
+
+    for (uint32_t placeIdx = 0; placeIdx < placedMeshIdxs.size(); placeIdx++)
+    {
+        const uint32_t meshIdx = placedMeshIdxs[placeIdx];
+        for (uint32_t i = 0; i < model.meshes[meshIdx].primitives.size(); i++)
+        {
+            PrimitiveInstance primInstance;
+            primInstance.pPrimAsset = oPrimitiveAssets[firstPrimIdx + meshFirstPrimIdxs[meshIdx] + i];
+            memcpy(primInstance.nodeMat, placedNodeMats[placeIdx], sizeof(float) * 16);
+            oPrimInstances.push_back(primInstance);
+        }
     }
 }
 
 void SceneAssetLoader::LoadShaderObject(const std::string& fileNamePath, std::vector<unsigned char>& oShaderByteCode)
 {
+    PERF_ZONE("Load Shader Object");
     std::ifstream inputShader(fileNamePath.c_str(), std::ios::binary | std::ios::in);
     std::vector<unsigned char> inputShaderStr(std::istreambuf_iterator<char>(inputShader), {});
     inputShader.close();
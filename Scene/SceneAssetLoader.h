@@ -1,10 +1,30 @@
 #pragma once
 #include <string>
+#include <vector>
 #include <unordered_map>
 
 class Level;
 class Camera;
 class StaticMesh;
+class SceneStreamer;
+struct PrimitiveAsset;
+struct PrimitiveInstance;
+
+// How the loader encodes the material textures after their mips. It stands in for an offline asset bake.
+enum class TextureCompression
+{
+    None,    // R8G8B8A8.
+    Quality, // BC7 base color, BC5 normal and metallic roughness, BC4 occlusion.
+    Size     // As the Quality, except a BC1 base color, or BC3 when it has an alpha.
+};
+
+// How the loader reorders the index and vertex buffers of the meshes. Both also reorder the vertices for the fetch.
+enum class MeshOptimization
+{
+    None,        // As authored.
+    VertexCache, // The triangles for the post-transform vertex cache.
+    Overdraw     // As the VertexCache, then the triangle clusters front to back from the mesh center.
+};
 
 typedef void(*PFN_SerializeAndCreate)(const std::string& i_fileNamePath);
 
@@ -32,7 +52,28 @@ public:
     // Load a scene file into the input level
     void LoadInLevel(Level* i_pLevel, Level* o_pSubLevel) {}
 
+    // While a streamer is set, the static meshes are only requested from it instead of being loaded in place.
+    void SetSceneStreamer(SceneStreamer* pSceneStreamer) { m_pSceneStreamer = pSceneStreamer; }
+
+    // Set before the loading starts, since the streaming thread reads it too.
+    void SetTextureCompression(TextureCompression compression) { m_textureCompression = compression; }
+    void SetMeshOptimization(MeshOptimization optimization) { m_meshOptimization = optimization; }
+    // The levels of detail per mesh with the full one, so 1 doesn't simplify. Up to MAX_MESH_LOD_CNT.
+    void SetMeshLodCnt(uint32_t lodCnt) { m_meshLodCnt = lodCnt; }
+    // Split the meshes into meshlets for the cluster culling. It reorders their triangles after the mesh optimization.
+    void SetBuildMeshlets(bool buildMeshlets) { m_buildMeshlets = buildMeshlets; }
+
     static void LoadStaticMesh(const std::string& fileNamePath, StaticMesh* pStaticMesh);
+
+    // Parse a glTF into new primitive assets on the CPU only. It doesn't touch the AssetManager or the D3D12, so it
+    // can run off the main thread. The meshes of the default scene's nodes are loaded once each, and oPrimInstances
+    // places their primitives by the nodes' world matrices.
+    static void LoadGltfPrimitives(const std::string&              fileNamePath,
+                                   std::vector<PrimitiveAsset*>&   oPrimitiveAssets,
+                                   std::vector<PrimitiveInstance>& oPrimInstances);
+
+    // Replace the primitive's textures with the 1x1 defaults that the loader uses for the missing textures.
+    static void SetPlaceholderTextures(PrimitiveAsset& primitiveAsset);
     static void LoadShaderObject(const std::string& fileNamePath, std::vector<unsigned char>& oShaderByteCode);
 
 private:
@@ -40,4 +81,9 @@ private:
 
     static SceneAssetLoader* m_pThis;
     std::string m_currentScenePath;
+    SceneStreamer* m_pSceneStreamer;
+    TextureCompression m_textureCompression;
+    MeshOptimization m_meshOptimization;
+    uint32_t m_meshLodCnt;
+    bool m_buildMeshlets;
 };
\ No newline at end of file
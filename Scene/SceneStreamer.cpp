@@ -0,0 +1,228 @@
+#include "SceneStreamer.h"
+#include "SceneAssetLoader.h"
+#include "Mesh.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include <cassert>
+#include <cstring>
+
+extern AssetManager* g_pAssetManager;
+
+// ================================================================================================================
+SceneStreamer::SceneStreamer()
+    : m_cancel(false),
+      m_loadedAssetCnt(0)
+{
+}
+
+// ================================================================================================================
+SceneStreamer::~SceneStreamer()
+{
+    // The asset being loaded still finishes, since the glTF parse cannot be interrupted.
+    m_cancel.store(true, std::memory_order_relaxed);
+    if (m_streamingThread.joinable())
+    {
+        m_streamingThread.join();
+    }
+
+    // The primitives whose geometry isn't uploaded yet aren't owned by the AssetManager.
+    for (StreamedPrimitive& streamedPrim : m_loadedPrims)
+    {
+        delete streamedPrim.pPrimAsset;
+    }
+    for (StreamedPrimitive& streamedPrim : m_geometryQueue)
+    {
+        delete streamedPrim.pPrimAsset;
+    }
+}
+
+// ================================================================================================================
+void SceneStreamer::RequestStaticMesh(const std::string& assetPath, StaticMesh* pStaticMesh)
+{
+    assert(!m_streamingThread.joinable() && "The meshes must be requested before the streaming starts.");
+    auto itr = m_assetMeshes.find(assetPath);
+    if (itr == m_assetMeshes.end())
+    {
+        m_assetPaths.push_back(assetPath);
+        itr = m_assetMeshes.emplace(assetPath, std::vector<StaticMesh*>()).first;
+    }
+    itr->second.push_back(pStaticMesh);
+    m_stats.requestedAssetCnt = static_cast<uint32_t>(m_assetPaths.size());
+}
+
+// ================================================================================================================
+void SceneStreamer::Start()
+{
+    m_streamingThread = std::thread(&SceneStreamer::StreamingThreadMain, this);
+}
+
+// ================================================================================================================
+void SceneStreamer::StreamingThreadMain()
+{
+    if (TimePerfManager* pTimePerfManager = TimePerfManager::GetInstance())
+    {
+        pTimePerfManager->SetCurrentThreadName("Scene Streaming");
+    }
+
+    for (const std::string& assetPath : m_assetPaths)
+    {
+        if (m_cancel.load(std::memory_order_relaxed))
+        {
+            break;
+        }
+
+        std::vector<PrimitiveAsset*> primAssets;
+        std::vector<PrimitiveInstance> primInstances;
+        SceneAssetLoader::LoadGltfPrimitives(assetPath, primAssets, primInstances);
+
+        // Keep the real textures aside. The primitive goes up with the placeholders first.
+        std::vector<StreamedPrimitive> streamedPrims(primAssets.size());
+        std::unordered_map<const PrimitiveAsset*, uint32_t> primIdxs;
+        for (uint32_t i = 0; i < primAssets.size(); i++)
+        {
+            primIdxs[primAssets[i]] = i;
+        }
+        for (const PrimitiveInstance& primInstance : primInstances)
+        {
+            std::vector<float>& nodeMats = streamedPrims[primIdxs[primInstance.pPrimAsset]].nodeMats;
+            nodeMats.insert(nodeMats.end(), primInstance.nodeMat, primInstance.nodeMat + 16);
+        }
+        for (uint32_t i = 0; i < primAssets.size(); i++)
+        {
+            PrimitiveAsset* pPrimAsset = primAssets[i];
+            streamedPrims[i].assetPath = assetPath;
+            streamedPrims[i].pPrimAsset = pPrimAsset;
+            streamedPrims[i].textures[0] = std::move(pPrimAsset->m_baseColorTex);
+            streamedPrims[i].textures[1] = std::move(pPrimAsset->m_metallicRoughnessTex);
+            streamedPrims[i].textures[2] = std::move(pPrimAsset->m_normalTex);
+            streamedPrims[i].textures[3] = std::move(pPrimAsset->m_occlusionTex);
+            SceneAssetLoader::SetPlaceholderTextures(*pPrimAsset);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_loadedMutex);
+            for (StreamedPrimitive& streamedPrim : streamedPrims)
+            {
+                m_loadedPrims.push_back(std::move(streamedPrim));
+            }
+            m_loadedAssetCnt++;
+        }
+        m_loadedCv.notify_all();
+    }
+}
+
+// ================================================================================================================
+void SceneStreamer::Tick(uint64_t uploadBudgetBytes)
+{
+    PERF_ZONE("Scene Streaming Upload");
+    {
+        std::lock_guard<std::mutex> lock(m_loadedMutex);
+        while (!m_loadedPrims.empty())
+        {
+            m_geometryQueue.push_back(std::move(m_loadedPrims.front()));
+            m_loadedPrims.pop_front();
+        }
+        m_stats.loadedAssetCnt = m_loadedAssetCnt;
+    }
+
+    // All geometry before any texture. A placeholder on screen is worth more than a sharper mesh that's already there.
+    uint64_t uploadedBytes = 0;
+    uint32_t uploadedItemCnt = 0;
+    while (!m_geometryQueue.empty() && (uploadedItemCnt == 0 || uploadedBytes < uploadBudgetBytes))
+    {
+        StreamedPrimitive& streamedPrim = m_geometryQueue.front();
+        uploadedBytes += UploadGeometry(streamedPrim);
+        uploadedItemCnt++;
+
+        const bool hasTextures = streamedPrim.textures[0].pixWidth > 1 || streamedPrim.textures[1].pixWidth > 1 ||
+                                 streamedPrim.textures[2].pixWidth > 1 || streamedPrim.textures[3].pixWidth > 1;
+        if (hasTextures)
+        {
+            m_textureQueue.push_back(std::move(streamedPrim));
+        }
+        else
+        {
+            m_stats.texturedPrimCnt++;
+        }
+        m_geometryQueue.pop_front();
+    }
+
+    while (!m_textureQueue.empty() && (uploadedItemCnt == 0 || uploadedBytes < uploadBudgetBytes))
+    {
+        uploadedBytes += UploadTextures(m_textureQueue.front());
+        uploadedItemCnt++;
+        m_textureQueue.pop_front();
+    }
+
+    m_stats.pendingGeometryCnt = static_cast<uint32_t>(m_geometryQueue.size());
+    m_stats.pendingTextureCnt = static_cast<uint32_t>(m_textureQueue.size());
+    m_stats.uploadedBytes += uploadedBytes;
+    m_stats.lastTickUploadedBytes = uploadedBytes;
+}
+
+// ================================================================================================================
+void SceneStreamer::Flush()
+{
+    PERF_ZONE("Scene Streaming Flush");
+    while (!IsFullyLoaded())
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_loadedMutex);
+            m_loadedCv.wait(lock, [this]()
+            {
+                return !m_loadedPrims.empty() || m_loadedAssetCnt == m_assetPaths.size();
+            });
+        }
+        Tick(UINT64_MAX);
+    }
+}
+
+// ================================================================================================================
+bool SceneStreamer::IsFullyLoaded() const
+{
+    // Tick() drains the handed over primitives in the same lock as it reads the loaded count, so all loaded assets
+    // are in the queues by then.
+    return m_stats.loadedAssetCnt == m_assetPaths.size() && m_geometryQueue.empty() && m_textureQueue.empty();
+}
+
+// ================================================================================================================
+uint64_t SceneStreamer::UploadGeometry(StreamedPrimitive& streamedPrim)
+{
+    PrimitiveAsset* pPrimAsset = streamedPrim.pPrimAsset;
+    g_pAssetManager->SaveModelPrimAssetAndCreateGpuRsrc(streamedPrim.assetPath, pPrimAsset);
+    // The vertex size depends on the AssetManager's vertex format, and the index buffer has the LODs too.
+    const uint64_t vertBytes = pPrimAsset->m_vertexBufferView.SizeInBytes;
+    const uint64_t idxBytes = pPrimAsset->m_idxBufferView.SizeInBytes;
+    const uint32_t placeCnt = static_cast<uint32_t>(streamedPrim.nodeMats.size() / 16);
+    for (uint32_t i = 0; i < placeCnt; i++)
+    {
+        PrimitiveInstance primInstance;
+        primInstance.pPrimAsset = pPrimAsset;
+        memcpy(primInstance.nodeMat, &streamedPrim.nodeMats[16 * i], sizeof(float) * 16);
+        g_pAssetManager->SaveModelPrimInstance(streamedPrim.assetPath, primInstance);
+    }
+    for (StaticMesh* pStaticMesh : m_assetMeshes[streamedPrim.assetPath])
+    {
+        for (uint32_t i = 0; i < placeCnt; i++)
+        {
+            pStaticMesh->AddPrimitive(pPrimAsset, &streamedPrim.nodeMats[16 * i]);
+        }
+    }
+    m_stats.visiblePrimCnt++;
+    return vertBytes + idxBytes;
+}
+
+// ================================================================================================================
+uint64_t SceneStreamer::UploadTextures(StreamedPrimitive& streamedPrim)
+{
+    // The placeholders are 1x1, so they never had GPU textures that the swap could leak.
+    PrimitiveAsset* pPrimAsset = streamedPrim.pPrimAsset;
+    pPrimAsset->m_baseColorTex = std::move(streamedPrim.textures[0]);
+    pPrimAsset->m_metallicRoughnessTex = std::move(streamedPrim.textures[1]);
+    pPrimAsset->m_normalTex = std::move(streamedPrim.textures[2]);
+    pPrimAsset->m_occlusionTex = std::move(streamedPrim.textures[3]);
+
+    // The textures shared from the asset manager's cache upload nothing, so they don't count against the budget.
+    const uint64_t texBytes = g_pAssetManager->RecreateMaterialGpuRsrc(pPrimAsset);
+    m_stats.texturedPrimCnt++;
+    return texBytes;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include "../Utils/AssetManager.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class StaticMesh;
+
+struct SceneStreamingStats
+{
+    uint32_t requestedAssetCnt = 0;
+    uint32_t loadedAssetCnt = 0;      // Parsed and decoded on the streaming thread.
+    uint32_t visiblePrimCnt = 0;      // Geometry uploaded. Drawn with the placeholder or the real textures.
+    uint32_t texturedPrimCnt = 0;     // Real textures uploaded.
+    uint32_t pendingGeometryCnt = 0;
+    uint32_t pendingTextureCnt = 0;
+    uint64_t uploadedBytes = 0;
+    uint64_t lastTickUploadedBytes = 0;
+};
+
+// Loads the static mesh assets of a scene on a background thread after the scene graph is in, so the first frame
+// doesn't wait for them. A mesh starts drawing once its geometry is uploaded, with the loader's 1x1 default textures as
+// the placeholders, and its real textures follow on the later frames.
+// The GPU uploads stay on the main thread between the frames, and each Tick() stops at its byte budget. The streaming
+// thread is a plain thread rather than jobs: the frame's ParallelFor waits help with any job they find, and a whole
+// glTF load picked up there would stall that frame.
+class SceneStreamer
+{
+public:
+    SceneStreamer();
+    ~SceneStreamer();
+
+    // Main thread, before Start(). The meshes sharing an asset path share one load.
+    void RequestStaticMesh(const std::string& assetPath, StaticMesh* pStaticMesh);
+
+    // Start loading the requested assets in the request order.
+    void Start();
+
+    // Main thread, while the GPU is idle. Upload the loaded geometry first and then the textures, until the budget is
+    // spent. At least one item goes through per call, so an item bigger than the budget doesn't block the stream.
+    void Tick(uint64_t uploadBudgetBytes);
+
+    // Block until all requested assets are loaded and uploaded. The path tracer needs the whole scene for its BVH.
+    void Flush();
+
+    bool IsFullyLoaded() const;
+    const SceneStreamingStats& GetStats() const { return m_stats; }
+
+private:
+    struct StreamedPrimitive
+    {
+        std::string     assetPath;
+        PrimitiveAsset*    pPrimAsset = nullptr;
+        std::vector<float> nodeMats;         // The world matrices of the glTF nodes placing it, 16 floats each.
+        ImgInfo            textures[4] = {}; // The real base color, metallic roughness, normal and occlusion textures.
+    };
+
+    void StreamingThreadMain();
+
+    // Main thread. Returns the uploaded bytes.
+    uint64_t UploadGeometry(StreamedPrimitive& streamedPrim);
+    uint64_t UploadTextures(StreamedPrimitive& streamedPrim);
+
+    std::vector<std::string>                                  m_assetPaths; // Read only after Start().
+    std::unordered_map<std::string, std::vector<StaticMesh*>> m_assetMeshes;
+
+    std::thread       m_streamingThread;
+    std::atomic<bool> m_cancel;
+
+    // Handed over from the streaming thread.
+    std::mutex                    m_loadedMutex;
+    std::condition_variable       m_loadedCv;
+    std::deque<StreamedPrimitive> m_loadedPrims;
+    uint32_t                      m_loadedAssetCnt;
+
+    // Main thread only.
+    std::deque<StreamedPrimitive> m_geometryQueue;
+    std::deque<StreamedPrimitive> m_textureQueue;
+    SceneStreamingStats           m_stats;
+};
@@ -0,0 +1,83 @@
+#include "D3D12GpuTimestampSource.h"
+#include "../Utils/DX12Utils.h"
+#include <cstring>
+
+// ================================================================================================================
+D3D12GpuTimestampSource::D3D12GpuTimestampSource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, uint32_t queryCnt)
+{
+    ThrowIfFailed(pCommandQueue->GetTimestampFrequency(&m_frequency));
+
+    D3D12_QUERY_HEAP_DESC queryHeapDesc{};
+    {
+        queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+        queryHeapDesc.Count = queryCnt;
+        queryHeapDesc.NodeMask = 0;
+    }
+    ThrowIfFailed(pDevice->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&m_pQueryHeap)));
+    m_pQueryHeap->SetName(L"GPU Timestamp Query Heap");
+
+    D3D12_HEAP_PROPERTIES heapProperties{};
+    {
+        heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+        heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+        heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+        heapProperties.CreationNodeMask = 1;
+        heapProperties.VisibleNodeMask = 1;
+    }
+
+    D3D12_RESOURCE_DESC bufferRsrcDesc{};
+    {
+        bufferRsrcDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        bufferRsrcDesc.Alignment = 0;
+        bufferRsrcDesc.Width = sizeof(uint64_t) * queryCnt;
+        bufferRsrcDesc.Height = 1;
+        bufferRsrcDesc.DepthOrArraySize = 1;
+        bufferRsrcDesc.MipLevels = 1;
+        bufferRsrcDesc.Format = DXGI_FORMAT_UNKNOWN;
+        bufferRsrcDesc.SampleDesc.Count = 1;
+        bufferRsrcDesc.SampleDesc.Quality = 0;
+        bufferRsrcDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        bufferRsrcDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    }
+
+    ThrowIfFailed(pDevice->CreateCommittedResource(
+            &heapProperties,
+            D3D12_HEAP_FLAG_NONE,
+            &bufferRsrcDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&m_pReadbackBuffer)));
+    m_pReadbackBuffer->SetName(L"GPU Timestamp Readback Buffer");
+}
+
+// ================================================================================================================
+D3D12GpuTimestampSource::~D3D12GpuTimestampSource()
+{
+    if (m_pQueryHeap) { m_pQueryHeap->Release(); m_pQueryHeap = nullptr; }
+    if (m_pReadbackBuffer) { m_pReadbackBuffer->Release(); m_pReadbackBuffer = nullptr; }
+}
+
+// ================================================================================================================
+void D3D12GpuTimestampSource::WriteTimestamp(uint32_t queryIdx)
+{
+    m_pCommandList->EndQuery(m_pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, queryIdx);
+}
+
+// ================================================================================================================
+void D3D12GpuTimestampSource::ResolveQueries(uint32_t firstQueryIdx, uint32_t queryCnt)
+{
+    m_pCommandList->ResolveQueryData(m_pQueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, firstQueryIdx, queryCnt,
+                                     m_pReadbackBuffer, sizeof(uint64_t) * firstQueryIdx);
+}
+
+// ================================================================================================================
+void D3D12GpuTimestampSource::ReadQueries(uint32_t firstQueryIdx, uint32_t queryCnt, uint64_t* oTicks)
+{
+    // Only map the range of this frame. The other frame slots may still be written by the GPU.
+    D3D12_RANGE readRange{ sizeof(uint64_t) * firstQueryIdx, sizeof(uint64_t) * (firstQueryIdx + queryCnt) };
+    uint8_t* pData = nullptr;
+    ThrowIfFailed(m_pReadbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+    memcpy(oTicks, pData + readRange.Begin, sizeof(uint64_t) * queryCnt);
+    D3D12_RANGE writeRange{ 0, 0 };
+    m_pReadbackBuffer->Unmap(0, &writeRange);
+}
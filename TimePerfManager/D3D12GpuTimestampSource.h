@@ -0,0 +1,25 @@
+#pragma once
+#include <d3d12.h>
+#include "GpuTimestampQueryPool.h"
+
+// Timestamp queries on a D3D12 query heap, resolved into one readback buffer laid out like the heap.
+class D3D12GpuTimestampSource : public GpuTimestampSource
+{
+public:
+    D3D12GpuTimestampSource(ID3D12Device* pDevice, ID3D12CommandQueue* pCommandQueue, uint32_t queryCnt);
+    ~D3D12GpuTimestampSource();
+
+    // The command list that the following timestamps and resolves are recorded into.
+    void SetCommandList(ID3D12GraphicsCommandList* pCommandList) { m_pCommandList = pCommandList; }
+
+    uint64_t GetFrequency() const override { return m_frequency; }
+    void WriteTimestamp(uint32_t queryIdx) override;
+    void ResolveQueries(uint32_t firstQueryIdx, uint32_t queryCnt) override;
+    void ReadQueries(uint32_t firstQueryIdx, uint32_t queryCnt, uint64_t* oTicks) override;
+
+private:
+    ID3D12QueryHeap*           m_pQueryHeap = nullptr;
+    ID3D12Resource*            m_pReadbackBuffer = nullptr;
+    ID3D12GraphicsCommandList* m_pCommandList = nullptr;
+    uint64_t                   m_frequency = 1;
+};
@@ -0,0 +1,149 @@
+#include "GpuTimestampQueryPool.h"
+#include <algorithm>
+#include <cassert>
+
+// ================================================================================================================
+GpuTimestampQueryPool::GpuTimestampQueryPool(GpuTimestampSource* pSource, uint32_t frameSlotCnt, uint32_t maxZonesPerFrame)
+    : m_pSource(pSource),
+      m_frameSlotCnt(frameSlotCnt),
+      m_maxZonesPerFrame(maxZonesPerFrame),
+      m_frameSlots(frameSlotCnt),
+      m_currentSlotIdx(0),
+      m_inFrame(false),
+      m_completedFrameSerial(0),
+      m_anyFrameCompleted(false),
+      m_ticks(maxZonesPerFrame * 2),
+      m_lostFrameCnt(0),
+      m_overflowZoneCnt(0)
+{
+    for (FrameSlot& frameSlot : m_frameSlots)
+    {
+        frameSlot.zones.reserve(maxZonesPerFrame);
+    }
+    m_openZones.reserve(maxZonesPerFrame);
+}
+
+// ================================================================================================================
+void GpuTimestampQueryPool::BeginFrame(uint64_t frameSerial)
+{
+    assert(!m_inFrame);
+    m_currentSlotIdx = static_cast<uint32_t>(frameSerial % m_frameSlotCnt);
+    FrameSlot& frameSlot = m_frameSlots[m_currentSlotIdx];
+    if (frameSlot.pending)
+    {
+        m_lostFrameCnt++;
+    }
+
+    frameSlot.frameSerial = frameSerial;
+    frameSlot.zones.clear();
+    frameSlot.pending = false;
+    m_openZones.clear();
+    m_inFrame = true;
+}
+
+// ================================================================================================================
+void GpuTimestampQueryPool::BeginZone(uint32_t nameHash)
+{
+    assert(m_inFrame);
+    FrameSlot& frameSlot = m_frameSlots[m_currentSlotIdx];
+    if (frameSlot.zones.size() >= m_maxZonesPerFrame)
+    {
+        m_overflowZoneCnt++;
+        m_openZones.push_back(INVALID_ZONE);
+        return;
+    }
+
+    const uint32_t zoneIdx = static_cast<uint32_t>(frameSlot.zones.size());
+    frameSlot.zones.push_back(ZoneSlot{ nameHash, static_cast<uint32_t>(m_openZones.size()) });
+    m_openZones.push_back(zoneIdx);
+    m_pSource->WriteTimestamp(GetFirstQueryIdx(m_currentSlotIdx) + 2 * zoneIdx);
+}
+
+// ================================================================================================================
+void GpuTimestampQueryPool::EndZone()
+{
+    assert(m_inFrame && !m_openZones.empty());
+    const uint32_t zoneIdx = m_openZones.back();
+    m_openZones.pop_back();
+    if (zoneIdx != INVALID_ZONE)
+    {
+        m_pSource->WriteTimestamp(GetFirstQueryIdx(m_currentSlotIdx) + 2 * zoneIdx + 1);
+    }
+}
+
+// ================================================================================================================
+void GpuTimestampQueryPool::EndFrame()
+{
+    assert(m_inFrame);
+    while (!m_openZones.empty())
+    {
+        EndZone();
+    }
+
+    FrameSlot& frameSlot = m_frameSlots[m_currentSlotIdx];
+    if (!frameSlot.zones.empty())
+    {
+        m_pSource->ResolveQueries(GetFirstQueryIdx(m_currentSlotIdx), 2 * static_cast<uint32_t>(frameSlot.zones.size()));
+        frameSlot.pending = true;
+    }
+    m_inFrame = false;
+}
+
+// ================================================================================================================
+void GpuTimestampQueryPool::MarkFrameCompleted(uint64_t frameSerial)
+{
+    m_completedFrameSerial = m_anyFrameCompleted ? std::max(m_completedFrameSerial, frameSerial) : frameSerial;
+    m_anyFrameCompleted = true;
+}
+
+// ================================================================================================================
+bool GpuTimestampQueryPool::PopCompletedFrame(uint64_t& oFrameSerial, std::vector<GpuZoneResult>& oZones)
+{
+    if (!m_anyFrameCompleted)
+    {
+        return false;
+    }
+
+    FrameSlot* pOldestSlot = nullptr;
+    uint32_t oldestSlotIdx = 0;
+    for (uint32_t i = 0; i < m_frameSlotCnt; i++)
+    {
+        FrameSlot& frameSlot = m_frameSlots[i];
+        if (frameSlot.pending && frameSlot.frameSerial <= m_completedFrameSerial &&
+            (pOldestSlot == nullptr || frameSlot.frameSerial < pOldestSlot->frameSerial))
+        {
+            pOldestSlot = &frameSlot;
+            oldestSlotIdx = i;
+        }
+    }
+
+    if (pOldestSlot == nullptr)
+    {
+        return false;
+    }
+
+    const uint32_t queryCnt = 2 * static_cast<uint32_t>(pOldestSlot->zones.size());
+    m_pSource->ReadQueries(GetFirstQueryIdx(oldestSlotIdx), queryCnt, m_ticks.data());
+    pOldestSlot->pending = false;
+
+    uint64_t baseTick = m_ticks[0];
+    for (uint32_t i = 0; i < queryCnt; i++)
+    {
+        baseTick = std::min(baseTick, m_ticks[i]);
+    }
+
+    // Convert in double to avoid overflowing ticks * 1e9 with the high frequency timers.
+    const double nsPerTick = 1e9 / static_cast<double>(m_pSource->GetFrequency());
+    oFrameSerial = pOldestSlot->frameSerial;
+    oZones.clear();
+    for (uint32_t zoneIdx = 0; zoneIdx < pOldestSlot->zones.size(); zoneIdx++)
+    {
+        const uint64_t beginTick = m_ticks[2 * zoneIdx];
+        const uint64_t endTick = std::max(beginTick, m_ticks[2 * zoneIdx + 1]);
+        oZones.push_back(GpuZoneResult{ pOldestSlot->zones[zoneIdx].nameHash,
+                                        pOldestSlot->zones[zoneIdx].depth,
+                                        static_cast<uint64_t>(static_cast<double>(beginTick - baseTick) * nsPerTick),
+                                        static_cast<uint64_t>(static_cast<double>(endTick - baseTick) * nsPerTick) });
+    }
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// The graphics API side of the GPU timestamps. The pool only hands out query indices, so the bookkeeping can run
+// without a GPU, e.g. against a fake source.
+class GpuTimestampSource
+{
+public:
+    virtual ~GpuTimestampSource() {}
+
+    // Timestamp ticks per second.
+    virtual uint64_t GetFrequency() const = 0;
+
+    // Records a timestamp write into the current frame's commands.
+    virtual void WriteTimestamp(uint32_t queryIdx) = 0;
+
+    // Records the copy of the queries into CPU readable memory at the end of the current frame's commands.
+    virtual void ResolveQueries(uint32_t firstQueryIdx, uint32_t queryCnt) = 0;
+
+    // Reads the resolved queries. Only called after the frame that resolved them is completed on the GPU.
+    virtual void ReadQueries(uint32_t firstQueryIdx, uint32_t queryCnt, uint64_t* oTicks) = 0;
+};
+
+// A finished GPU zone. The times are relative to the first timestamp of its frame.
+struct GpuZoneResult
+{
+    uint32_t nameHash;
+    uint32_t depth;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Named begin/end timestamp pairs for the frames in flight. Each frame slot owns 2 * maxZonesPerFrame queries.
+// A frame's queries are read back once the frame is reported completed, so reading never waits on the GPU. A slot
+// reused before its frame completed loses that frame's results.
+class GpuTimestampQueryPool
+{
+public:
+    GpuTimestampQueryPool(GpuTimestampSource* pSource, uint32_t frameSlotCnt, uint32_t maxZonesPerFrame);
+    ~GpuTimestampQueryPool() {}
+
+    static uint32_t GetRequiredQueryCnt(uint32_t frameSlotCnt, uint32_t maxZonesPerFrame) { return frameSlotCnt * maxZonesPerFrame * 2; }
+
+    // frameSerial must increase by frame.
+    void BeginFrame(uint64_t frameSerial);
+    void BeginZone(uint32_t nameHash);
+    void EndZone();
+    // Closes the zones left open and resolves the frame's queries.
+    void EndFrame();
+
+    // All frames up to frameSerial are finished on the GPU, e.g. after waiting on the frame fence.
+    void MarkFrameCompleted(uint64_t frameSerial);
+
+    // Reads back the oldest completed frame not read yet. Returns false if there is none.
+    bool PopCompletedFrame(uint64_t& oFrameSerial, std::vector<GpuZoneResult>& oZones);
+
+    uint32_t GetLostFrameCnt() const { return m_lostFrameCnt; }
+    uint32_t GetOverflowZoneCnt() const { return m_overflowZoneCnt; }
+
+private:
+    static constexpr uint32_t INVALID_ZONE = UINT32_MAX;
+
+    struct ZoneSlot
+    {
+        uint32_t nameHash;
+        uint32_t depth;
+    };
+
+    struct FrameSlot
+    {
+        uint64_t              frameSerial = 0;
+        std::vector<ZoneSlot> zones; // The zone i owns the queries 2 * i and 2 * i + 1 of the slot.
+        bool                  pending = false;
+    };
+
+    uint32_t GetFirstQueryIdx(uint32_t slotIdx) const { return slotIdx * m_maxZonesPerFrame * 2; }
+
+    GpuTimestampSource*    m_pSource;
+    uint32_t               m_frameSlotCnt;
+    uint32_t               m_maxZonesPerFrame;
+    std::vector<FrameSlot> m_frameSlots;
+
+    uint32_t               m_currentSlotIdx;
+    bool                   m_inFrame;
+    std::vector<uint32_t>  m_openZones; // Zone indices of the current frame. INVALID_ZONE for an overflowed zone.
+    uint64_t               m_completedFrameSerial;
+    bool                   m_anyFrameCompleted;
+    std::vector<uint64_t>  m_ticks;
+
+    uint32_t               m_lostFrameCnt;
+    uint32_t               m_overflowZoneCnt;
+};
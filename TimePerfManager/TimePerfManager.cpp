@@ -1 +1,509 @@
 #include "TimePerfManager.h"
+#include "../Utils/MemoryTracker.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+TimePerfManager* TimePerfManager::m_pThis = nullptr;
+std::atomic<uint32_t> TimePerfManager::m_generation(0);
+
+namespace
+{
+    // The zone names are registered by the static initializers at the PERF_ZONE sites, which can run on any thread
+    // and before the manager exists.
+    std::mutex& ZoneNameMutex()
+    {
+        static std::mutex zoneNameMutex;
+        return zoneNameMutex;
+    }
+
+    std::unordered_map<uint32_t, const char*>& ZoneNames()
+    {
+        static std::unordered_map<uint32_t, const char*> zoneNames;
+        return zoneNames;
+    }
+
+    // The thread's handle to its profiling data. Marks the data as reusable when the thread exits.
+    struct PerfThreadHandle
+    {
+        std::shared_ptr<PerfThreadData> pThreadData;
+        uint32_t                        generation = UINT32_MAX;
+
+        ~PerfThreadHandle()
+        {
+            if (pThreadData)
+            {
+                pThreadData->released.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    thread_local PerfThreadHandle t_perfThreadHandle;
+
+    constexpr uint32_t GpuFrameZoneHash = crc32("GPU Frame");
+
+    // Writes a name as the content of a JSON string. The quotes, the backslashes and the control characters are escaped.
+    void WriteJsonStringContent(std::ostream& os, const char* pStr)
+    {
+        for (const char* pChar = pStr; *pChar != '\0'; pChar++)
+        {
+            const unsigned char c = static_cast<unsigned char>(*pChar);
+            switch (c)
+            {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (c < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    os << escaped;
+                }
+                else
+                {
+                    os << *pChar;
+                }
+            }
+        }
+    }
+}
+
+// ================================================================================================================
+void PerfHistory::Add(float ms, uint32_t callCnt)
+{
+    m_values[m_next] = ms;
+    m_next = (m_next + 1) % HISTORY_FRAME_CNT;
+    m_cnt = std::min(m_cnt + 1, HISTORY_FRAME_CNT);
+    m_lastCallCnt = callCnt;
+}
+
+// ================================================================================================================
+PerfStats PerfHistory::Compute() const
+{
+    PerfStats stats;
+    if (m_cnt == 0)
+    {
+        return stats;
+    }
+
+    float sortedValues[HISTORY_FRAME_CNT];
+    std::copy_n(m_values, m_cnt, sortedValues);
+
+    stats.lastMs = m_values[(m_next + HISTORY_FRAME_CNT - 1) % HISTORY_FRAME_CNT];
+    stats.minMs = *std::min_element(sortedValues, sortedValues + m_cnt);
+    stats.maxMs = *std::max_element(sortedValues, sortedValues + m_cnt);
+    float sum = 0.f;
+    for (uint32_t i = 0; i < m_cnt; i++)
+    {
+        sum += sortedValues[i];
+    }
+    stats.avgMs = sum / static_cast<float>(m_cnt);
+
+    const uint32_t p99Idx = std::min(m_cnt - 1, static_cast<uint32_t>(static_cast<float>(m_cnt) * 0.99f));
+    std::nth_element(sortedValues, sortedValues + p99Idx, sortedValues + m_cnt);
+    stats.p99Ms = sortedValues[p99Idx];
+    stats.lastCallCnt = m_lastCallCnt;
+    return stats;
+}
+
+// ================================================================================================================
+TimePerfManager::TimePerfManager()
+    : m_frameStartNs(0),
+      m_cpuFrameEndNs(0),
+      m_zoneOverheadNs(0.f),
+      m_captureFramesLeft(0),
+      m_captureWriting(false)
+{
+    RegisterZoneName("GPU Frame", GpuFrameZoneHash);
+}
+
+// ================================================================================================================
+TimePerfManager::~TimePerfManager()
+{
+    if (m_captureWriter.joinable())
+    {
+        m_captureWriter.join();
+    }
+}
+
+// ================================================================================================================
+void TimePerfManager::Create()
+{
+    if (m_pThis == nullptr)
+    {
+        m_generation.fetch_add(1, std::memory_order_relaxed);
+        m_pThis = new TimePerfManager();
+    }
+}
+
+// ================================================================================================================
+void TimePerfManager::Destroy()
+{
+    delete m_pThis;
+    m_pThis = nullptr;
+}
+
+// ================================================================================================================
+bool TimePerfManager::RegisterZoneName(const char* pName, uint32_t nameHash)
+{
+    std::lock_guard<std::mutex> lock(ZoneNameMutex());
+    ZoneNames()[nameHash] = pName;
+    return true;
+}
+
+// ================================================================================================================
+const char* TimePerfManager::GetZoneName(uint32_t nameHash)
+{
+    std::lock_guard<std::mutex> lock(ZoneNameMutex());
+    auto itr = ZoneNames().find(nameHash);
+    return itr != ZoneNames().end() ? itr->second : "Unknown";
+}
+
+// ================================================================================================================
+PerfThreadData* TimePerfManager::GetThreadData()
+{
+    const uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    if (t_perfThreadHandle.generation == generation)
+    {
+        return t_perfThreadHandle.pThreadData.get();
+    }
+
+    std::lock_guard<std::mutex> lock(m_threadDataMutex);
+    MEMORY_TAG_SCOPE(MemoryTag::Profiling);
+
+    // Reuse the data of an exited thread once the aggregation has consumed all its records.
+    std::shared_ptr<PerfThreadData> pThreadData = nullptr;
+    for (auto& itr : m_threadDatas)
+    {
+        if (itr->released.load(std::memory_order_acquire) && itr->ring.Empty())
+        {
+            pThreadData = itr;
+            break;
+        }
+    }
+
+    if (pThreadData == nullptr)
+    {
+        pThreadData = std::make_shared<PerfThreadData>();
+        pThreadData->threadIdx = static_cast<uint32_t>(m_threadDatas.size());
+        m_threadDatas.push_back(pThreadData);
+    }
+
+    pThreadData->depth = 0;
+    pThreadData->threadName = "Thread " + std::to_string(pThreadData->threadIdx);
+    pThreadData->released.store(false, std::memory_order_release);
+
+    if (t_perfThreadHandle.pThreadData)
+    {
+        t_perfThreadHandle.pThreadData->released.store(true, std::memory_order_release);
+    }
+    t_perfThreadHandle.pThreadData = pThreadData;
+    t_perfThreadHandle.generation = generation;
+    return pThreadData.get();
+}
+
+// ================================================================================================================
+void TimePerfManager::SetCurrentThreadName(const std::string& name)
+{
+    PerfThreadData* pThreadData = GetThreadData();
+    std::lock_guard<std::mutex> lock(m_threadDataMutex);
+    pThreadData->threadName = name;
+}
+
+// ================================================================================================================
+void TimePerfManager::NewFrameStart()
+{
+    const uint64_t nowNs = NowNs();
+
+    if (m_frameStartNs != 0)
+    {
+        const uint64_t cpuFrameEndNs = m_cpuFrameEndNs > m_frameStartNs ? m_cpuFrameEndNs : nowNs;
+        m_frameHistory.Add(static_cast<float>(nowNs - m_frameStartNs) * 1e-6f, 1);
+        m_cpuFrameHistory.Add(static_cast<float>(cpuFrameEndNs - m_frameStartNs) * 1e-6f, 1);
+        m_frameStats = m_frameHistory.Compute();
+        m_cpuFrameStats = m_cpuFrameHistory.Compute();
+    }
+
+    // Gather the zones finished since the last frame start from all threads.
+    const bool capturing = m_captureFramesLeft > 0;
+    {
+        std::lock_guard<std::mutex> lock(m_threadDataMutex);
+        for (auto& pThreadData : m_threadDatas)
+        {
+            const uint32_t threadIdx = pThreadData->threadIdx;
+            pThreadData->ring.Drain([this, capturing, threadIdx](const PerfZoneRecord& record)
+            {
+                ZoneAccumulator& accumulator = m_zoneAccumulators[record.nameHash];
+                accumulator.frameNs += record.endNs - record.startNs;
+                accumulator.frameCallCnt++;
+                if (capturing)
+                {
+                    m_captureEvents.push_back(PerfCaptureEvent{ record, threadIdx });
+                }
+            });
+        }
+    }
+
+    // Merge the newest GPU frame completed since the last frame start. Older ones are skipped so one CPU frame
+    // never accumulates several GPU frames.
+    bool gpuFrameMerged = false;
+    if (m_pGpuQueryPool)
+    {
+        uint64_t gpuFrameSerial = 0;
+        while (m_pGpuQueryPool->PopCompletedFrame(gpuFrameSerial, m_gpuZoneResults))
+        {
+            gpuFrameMerged = true;
+        }
+
+        if (gpuFrameMerged)
+        {
+            for (const GpuZoneResult& zoneResult : m_gpuZoneResults)
+            {
+                ZoneAccumulator& accumulator = m_zoneAccumulators[zoneResult.nameHash];
+                accumulator.isGpu = true;
+                accumulator.frameNs += zoneResult.endNs - zoneResult.startNs;
+                accumulator.frameCallCnt++;
+            }
+        }
+    }
+
+    if (capturing)
+    {
+        m_captureFrameStartNs.push_back(nowNs);
+        m_captureFramesLeft--;
+        if (m_captureFramesLeft == 0)
+        {
+            FinishCapture();
+        }
+    }
+
+    m_zoneStats.clear();
+    for (auto& itr : m_zoneAccumulators)
+    {
+        ZoneAccumulator& accumulator = itr.second;
+        // The GPU zones only advance when a GPU frame is read back.
+        if (!accumulator.isGpu || gpuFrameMerged)
+        {
+            accumulator.history.Add(static_cast<float>(accumulator.frameNs) * 1e-6f, accumulator.frameCallCnt);
+        }
+        accumulator.frameNs = 0;
+        accumulator.frameCallCnt = 0;
+        m_zoneStats.push_back(PerfZoneStats{ itr.first, GetZoneName(itr.first), accumulator.isGpu, accumulator.history.Compute() });
+        if (itr.first == GpuFrameZoneHash)
+        {
+            m_gpuFrameStats = m_zoneStats.back().stats;
+        }
+    }
+
+    std::sort(m_zoneStats.begin(), m_zoneStats.end(),
+              [](const PerfZoneStats& a, const PerfZoneStats& b) { return a.stats.avgMs > b.stats.avgMs; });
+
+    m_frameStartNs = nowNs;
+}
+
+// ================================================================================================================
+void TimePerfManager::InitGpuTimestamps(GpuTimestampSource* pSource, uint32_t frameSlotCnt)
+{
+    m_pGpuQueryPool = std::make_unique<GpuTimestampQueryPool>(pSource, frameSlotCnt, MAX_GPU_ZONES_PER_FRAME);
+}
+
+// ================================================================================================================
+void TimePerfManager::DeinitGpuTimestamps()
+{
+    m_pGpuQueryPool.reset();
+}
+
+// ================================================================================================================
+uint32_t TimePerfManager::GetRequiredGpuQueryCnt(uint32_t frameSlotCnt)
+{
+    return GpuTimestampQueryPool::GetRequiredQueryCnt(frameSlotCnt, MAX_GPU_ZONES_PER_FRAME);
+}
+
+// ================================================================================================================
+void TimePerfManager::GpuFrameBegin(uint64_t frameSerial)
+{
+    if (m_pGpuQueryPool)
+    {
+        m_pGpuQueryPool->BeginFrame(frameSerial);
+        m_pGpuQueryPool->BeginZone(GpuFrameZoneHash);
+    }
+}
+
+// ================================================================================================================
+void TimePerfManager::GpuFrameEnd()
+{
+    if (m_pGpuQueryPool)
+    {
+        m_pGpuQueryPool->EndFrame();
+    }
+}
+
+// ================================================================================================================
+void TimePerfManager::GpuFrameCompleted(uint64_t frameSerial)
+{
+    if (m_pGpuQueryPool)
+    {
+        m_pGpuQueryPool->MarkFrameCompleted(frameSerial);
+    }
+}
+
+// ================================================================================================================
+void TimePerfManager::GPUTimeStampStart(uint32_t nameHash)
+{
+    m_pGpuQueryPool->BeginZone(nameHash);
+}
+
+// ================================================================================================================
+void TimePerfManager::GPUTimeStampEnd()
+{
+    m_pGpuQueryPool->EndZone();
+}
+
+// ================================================================================================================
+uint32_t TimePerfManager::GetDroppedZoneCnt() const
+{
+    // A new thread can register its ring while the UI reads this.
+    std::lock_guard<std::mutex> lock(m_threadDataMutex);
+    uint32_t droppedCnt = 0;
+    for (const auto& pThreadData : m_threadDatas)
+    {
+        droppedCnt += pThreadData->ring.GetDroppedCnt();
+    }
+    return droppedCnt;
+}
+
+// ================================================================================================================
+bool TimePerfManager::RequestCapture(uint32_t frameCnt, const std::string& filePath)
+{
+    if (IsCapturing() || frameCnt == 0)
+    {
+        return false;
+    }
+
+    if (m_captureWriter.joinable())
+    {
+        m_captureWriter.join();
+    }
+
+    m_captureEvents.clear();
+    m_captureFrameStartNs.clear();
+    m_captureFramesLeft = frameCnt;
+    m_capturePath = filePath;
+    return true;
+}
+
+// ================================================================================================================
+void TimePerfManager::FinishCapture()
+{
+    std::vector<std::pair<uint32_t, std::string>> threadNames;
+    {
+        std::lock_guard<std::mutex> lock(m_threadDataMutex);
+        for (const auto& pThreadData : m_threadDatas)
+        {
+            threadNames.emplace_back(pThreadData->threadIdx, pThreadData->threadName);
+        }
+    }
+
+    // The writer owns the captured data, so the next capture can start as soon as the file is written.
+    m_captureWriting.store(true, std::memory_order_release);
+    m_captureWriter = std::thread([this, events = std::move(m_captureEvents), frameStartNs = std::move(m_captureFrameStartNs),
+                                   threadNames = std::move(threadNames), filePath = m_capturePath]()
+    {
+        WriteChromeTrace(filePath, events, frameStartNs, threadNames);
+        m_captureWriting.store(false, std::memory_order_release);
+    });
+    m_captureEvents = std::vector<PerfCaptureEvent>();
+    m_captureFrameStartNs = std::vector<uint64_t>();
+}
+
+// ================================================================================================================
+// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+// Complete events ("X") carry the zones. The viewer derives the nesting from the time ranges on each thread.
+void TimePerfManager::WriteChromeTrace(const std::string& filePath,
+                                       const std::vector<PerfCaptureEvent>& events,
+                                       const std::vector<uint64_t>& frameStartNs,
+                                       const std::vector<std::pair<uint32_t, std::string>>& threadNames)
+{
+    std::ofstream traceFile(filePath, std::ios::out | std::ios::trunc);
+    if (!traceFile.is_open())
+    {
+        return;
+    }
+
+    uint64_t baseNs = UINT64_MAX;
+    for (const PerfCaptureEvent& event : events)
+    {
+        baseNs = std::min(baseNs, event.record.startNs);
+    }
+    if (!frameStartNs.empty())
+    {
+        baseNs = std::min(baseNs, frameStartNs.front());
+    }
+
+    // Microseconds with the nanosecond fraction. The timestamps are relative to the first event.
+    char usBuffer[32];
+    auto toUs = [&usBuffer](uint64_t ns) -> const char*
+    {
+        snprintf(usBuffer, sizeof(usBuffer), "%.3f", static_cast<double>(ns) * 1e-3);
+        return usBuffer;
+    };
+
+    traceFile << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    traceFile << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"DX12MiniRenderer\"}}";
+
+    for (const auto& threadName : threadNames)
+    {
+        traceFile << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadName.first
+                  << ",\"args\":{\"name\":\"";
+        WriteJsonStringContent(traceFile, threadName.second.c_str());
+        traceFile << "\"}}";
+        traceFile << ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadName.first
+                  << ",\"args\":{\"sort_index\":" << threadName.first << "}}";
+    }
+
+    for (uint32_t i = 0; i < frameStartNs.size(); i++)
+    {
+        traceFile << ",\n{\"name\":\"Frame " << i << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":0,\"tid\":0,\"ts\":" << toUs(frameStartNs[i] - baseNs) << "}";
+    }
+
+    for (const PerfCaptureEvent& event : events)
+    {
+        traceFile << ",\n{\"name\":\"";
+        WriteJsonStringContent(traceFile, GetZoneName(event.record.nameHash));
+        traceFile << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadIdx
+                  << ",\"ts\":" << toUs(event.record.startNs - baseNs);
+        traceFile << ",\"dur\":" << toUs(event.record.endNs - event.record.startNs) << ",\"args\":{\"depth\":" << event.record.depth << "}}";
+    }
+
+    traceFile << "\n]}\n";
+}
+
+// ================================================================================================================
+float TimePerfManager::MeasureZoneOverheadNs(uint32_t iterations)
+{
+    // Run in batches smaller than the ring so no record is dropped, which would make a zone look cheaper.
+    constexpr uint32_t BatchSize = PerfZoneRingBuffer::CAPACITY / 2;
+    PerfThreadData* pThreadData = GetThreadData();
+    pThreadData->ring.Drain([](const PerfZoneRecord&) {});
+
+    uint64_t totalNs = 0;
+    uint32_t measuredCnt = 0;
+    while (measuredCnt < iterations)
+    {
+        const uint32_t batchCnt = std::min(BatchSize, iterations - measuredCnt);
+        const uint64_t startNs = NowNs();
+        for (uint32_t i = 0; i < batchCnt; i++)
+        {
+            PERF_ZONE("Zone Overhead Probe");
+        }
+        totalNs += NowNs() - startNs;
+        measuredCnt += batchCnt;
+        pThreadData->ring.Drain([](const PerfZoneRecord&) {});
+    }
+
+    m_zoneOverheadNs = iterations > 0 ? static_cast<float>(totalNs) / static_cast<float>(iterations) : 0.f;
+    return m_zoneOverheadNs;
+}
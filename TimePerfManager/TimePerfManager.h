@@ -1,25 +1,310 @@
 #pragma once
 #include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "../Utils/crc32.h"
+#include "GpuTimestampQueryPool.h"
 // https://learn.microsoft.com/en-us/windows/win32/direct3d12/queries
 
-class TimePerfManager
+// One finished zone instance. The timestamps are steady_clock nanoseconds.
+struct PerfZoneRecord
+{
+    uint32_t nameHash;
+    uint32_t depth;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+// Lock-free ring of the zone records. The single producer is the owning thread and the single consumer is the
+// per frame aggregation on the main thread. A record is dropped when the ring is full.
+class PerfZoneRingBuffer
 {
 public:
-    TimePerfManager() {}
-    ~TimePerfManager() {}
+    static constexpr uint32_t CAPACITY = 1 << 14;
+
+    PerfZoneRingBuffer()
+        : m_records(CAPACITY),
+          m_head(0),
+          m_tail(0),
+          m_droppedCnt(0)
+    {}
+
+    void Push(const PerfZoneRecord& record)
+    {
+        const uint64_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) >= CAPACITY)
+        {
+            m_droppedCnt.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        m_records[head & (CAPACITY - 1)] = record;
+        m_head.store(head + 1, std::memory_order_release);
+    }
+
+    template<typename Func>
+    void Drain(Func&& func)
+    {
+        const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        const uint64_t head = m_head.load(std::memory_order_acquire);
+        for (uint64_t i = tail; i < head; i++)
+        {
+            func(m_records[i & (CAPACITY - 1)]);
+        }
+        m_tail.store(head, std::memory_order_release);
+    }
+
+    bool Empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+    uint32_t GetDroppedCnt() const { return m_droppedCnt.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<PerfZoneRecord> m_records;
+    alignas(64) std::atomic<uint64_t> m_head;
+    alignas(64) std::atomic<uint64_t> m_tail;
+    std::atomic<uint32_t> m_droppedCnt;
+};
+
+// Profiling data owned by one thread at a time. It's recycled after its thread exits.
+struct PerfThreadData
+{
+    PerfZoneRingBuffer ring;
+    uint32_t           depth = 0;     // Current zone nesting. Only touched by the owning thread.
+    uint32_t           threadIdx = 0; // Registration order. Stable while the data is owned.
+    std::string        threadName;
+    std::atomic<bool>  released = false;
+};
+
+// Statistics over the recent frames. For a zone, the value of a frame is the total time of all its instances.
+struct PerfStats
+{
+    float    lastMs = 0.f;
+    float    minMs = 0.f;
+    float    avgMs = 0.f;
+    float    maxMs = 0.f;
+    float    p99Ms = 0.f;
+    uint32_t lastCallCnt = 0;
+};
+
+// A captured zone and the slot index of the thread that recorded it.
+struct PerfCaptureEvent
+{
+    PerfZoneRecord record;
+    uint32_t       threadIdx;
+};
 
-    static void Create() {}
-    static void Destroy() {}
+struct PerfZoneStats
+{
+    uint32_t    nameHash;
+    const char* pName;
+    bool        isGpu;
+    PerfStats   stats;
+};
+
+// Fixed size history of per frame values.
+class PerfHistory
+{
+public:
+    static constexpr uint32_t HISTORY_FRAME_CNT = 240;
+
+    void Add(float ms, uint32_t callCnt);
+    PerfStats Compute() const;
+
+private:
+    float    m_values[HISTORY_FRAME_CNT] = {};
+    uint32_t m_cnt = 0;
+    uint32_t m_next = 0;
+    uint32_t m_lastCallCnt = 0;
+};
+
+class TimePerfManager
+{
+public:
+    static void Create();
+    static void Destroy();
     static TimePerfManager* GetInstance() { return m_pThis; }
 
-    void NewFrameStart() {}
-    void GPUTimeStampStart() {}
-    void GPUTimeStampEnd() {}
+    static uint64_t NowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Called once per PERF_ZONE site. Works before Create().
+    static bool RegisterZoneName(const char* pName, uint32_t nameHash);
+    static const char* GetZoneName(uint32_t nameHash);
+
+    // The calling thread's profiling data. The thread is registered at the first call.
+    PerfThreadData* GetThreadData();
+    void SetCurrentThreadName(const std::string& name);
+
+    // Ends the previous frame, aggregates its zones and starts a new frame. Main thread only.
+    void NewFrameStart();
+    // Marks the end of the main thread CPU work of the current frame, which is before waiting for the GPU.
+    void CpuFrameEnd() { m_cpuFrameEndNs = NowNs(); }
+
+    // GPU zones. The source stays owned by the caller. The results show up in the zone stats once the GPU
+    // completed their frame, which is reported by GpuFrameCompleted().
+    static uint32_t GetRequiredGpuQueryCnt(uint32_t frameSlotCnt);
+    void InitGpuTimestamps(GpuTimestampSource* pSource, uint32_t frameSlotCnt);
+    void DeinitGpuTimestamps();
+    bool IsGpuTimestampsEnabled() const { return m_pGpuQueryPool != nullptr; }
+    void GpuFrameBegin(uint64_t frameSerial);
+    void GpuFrameEnd();
+    void GpuFrameCompleted(uint64_t frameSerial);
+    void GPUTimeStampStart(uint32_t nameHash);
+    void GPUTimeStampEnd();
+
+    const PerfStats& GetFrameStats() const { return m_frameStats; }
+    const PerfStats& GetCpuFrameStats() const { return m_cpuFrameStats; }
+    const PerfStats& GetGpuFrameStats() const { return m_gpuFrameStats; }
+    float GetFps() const { return m_frameStats.avgMs > 0.f ? 1000.f / m_frameStats.avgMs : 0.f; }
+    const std::vector<PerfZoneStats>& GetZoneStats() const { return m_zoneStats; } // Sorted by the average time.
+    float GetZoneOverheadNs() const { return m_zoneOverheadNs; }
+    uint32_t GetDroppedZoneCnt() const;
+
+    // Records all the zones of the next frameCnt frames and writes them as a Chrome trace JSON file, which can be
+    // opened in chrome://tracing or ui.perfetto.dev. The zones recorded before the request but not gathered yet are
+    // included, so a capture requested before loading a scene contains the loading. The file is written on a
+    // background thread. Returns false if a capture is still recording or writing.
+    bool RequestCapture(uint32_t frameCnt, const std::string& filePath);
+    bool IsCapturing() const { return m_captureFramesLeft > 0 || m_captureWriting.load(std::memory_order_acquire); }
+    const std::string& GetLastCapturePath() const { return m_capturePath; }
+
+    // Average cost of one empty zone in nanoseconds, measured on the calling thread. It drains the calling thread's
+    // ring, so call it outside of a frame.
+    float MeasureZoneOverheadNs(uint32_t iterations);
 
 private:
+    TimePerfManager();
+    ~TimePerfManager();
+
+    void FinishCapture();
+    static void WriteChromeTrace(const std::string& filePath,
+                                 const std::vector<PerfCaptureEvent>& events,
+                                 const std::vector<uint64_t>& frameStartNs,
+                                 const std::vector<std::pair<uint32_t, std::string>>& threadNames);
+
+    static constexpr uint32_t MAX_GPU_ZONES_PER_FRAME = 64;
+
+    struct ZoneAccumulator
+    {
+        bool        isGpu = false;
+        PerfHistory history;
+        uint64_t    frameNs = 0;
+        uint32_t    frameCallCnt = 0;
+    };
+
     static TimePerfManager* m_pThis;
-    std::chrono::high_resolution_clock::time_point m_cpuFrameStartTime;
-    std::chrono::high_resolution_clock::time_point m_cpuFrameEndTime;
-    uint64_t m_gpuTimeStampStart = 0;
-    uint64_t m_gpuTimeStampEnd = 0;
-};
\ No newline at end of file
+    static std::atomic<uint32_t> m_generation; // Lets the threads detect a recreated manager.
+
+    mutable std::mutex                           m_threadDataMutex; // Guards m_threadDatas. Threads register at any time.
+    std::vector<std::shared_ptr<PerfThreadData>> m_threadDatas;
+
+    std::unordered_map<uint32_t, ZoneAccumulator> m_zoneAccumulators;
+    std::vector<PerfZoneStats>                    m_zoneStats;
+
+    PerfHistory m_frameHistory;
+    PerfHistory m_cpuFrameHistory;
+    PerfStats   m_frameStats;
+    PerfStats   m_cpuFrameStats;
+    PerfStats   m_gpuFrameStats;
+
+    std::unique_ptr<GpuTimestampQueryPool> m_pGpuQueryPool;
+    std::vector<GpuZoneResult>             m_gpuZoneResults;
+
+    uint64_t m_frameStartNs;
+    uint64_t m_cpuFrameEndNs;
+    float    m_zoneOverheadNs;
+
+    // Capture
+    std::vector<PerfCaptureEvent> m_captureEvents;
+    std::vector<uint64_t>         m_captureFrameStartNs;
+    uint32_t                      m_captureFramesLeft;
+    std::string                   m_capturePath;
+    std::thread                   m_captureWriter;
+    std::atomic<bool>             m_captureWriting;
+};
+
+// Records the lifetime of the scope as a zone on the calling thread. Does nothing if the manager isn't created.
+class ScopedPerfZone
+{
+public:
+    explicit ScopedPerfZone(uint32_t nameHash)
+        : m_pThreadData(nullptr)
+    {
+        TimePerfManager* pManager = TimePerfManager::GetInstance();
+        if (pManager)
+        {
+            m_pThreadData = pManager->GetThreadData();
+            m_nameHash = nameHash;
+            m_depth = m_pThreadData->depth++;
+            m_startNs = TimePerfManager::NowNs();
+        }
+    }
+
+    ~ScopedPerfZone()
+    {
+        if (m_pThreadData)
+        {
+            const uint64_t endNs = TimePerfManager::NowNs();
+            m_pThreadData->depth--;
+            m_pThreadData->ring.Push(PerfZoneRecord{ m_nameHash, m_depth, m_startNs, endNs });
+        }
+    }
+
+private:
+    PerfThreadData* m_pThreadData;
+    uint32_t        m_nameHash;
+    uint32_t        m_depth;
+    uint64_t        m_startNs;
+};
+
+// Records the GPU commands recorded during the lifetime of the scope as a GPU zone.
+class ScopedGpuPerfZone
+{
+public:
+    explicit ScopedGpuPerfZone(uint32_t nameHash)
+        : m_pManager(TimePerfManager::GetInstance())
+    {
+        if (m_pManager && m_pManager->IsGpuTimestampsEnabled())
+        {
+            m_pManager->GPUTimeStampStart(nameHash);
+        }
+        else
+        {
+            m_pManager = nullptr;
+        }
+    }
+
+    ~ScopedGpuPerfZone()
+    {
+        if (m_pManager)
+        {
+            m_pManager->GPUTimeStampEnd();
+        }
+    }
+
+private:
+    TimePerfManager* m_pManager;
+};
+
+#define PERF_CONCAT_INNER(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+// PERF_ZONE("Name") profiles the rest of the enclosing scope. The name must be a string literal.
+#define PERF_ZONE(name) \
+    constexpr uint32_t PERF_CONCAT(perfZoneHash, __LINE__) = crc32(name); \
+    static const bool PERF_CONCAT(perfZoneRegistered, __LINE__) = TimePerfManager::RegisterZoneName(name, PERF_CONCAT(perfZoneHash, __LINE__)); \
+    (void)PERF_CONCAT(perfZoneRegistered, __LINE__); \
+    ScopedPerfZone PERF_CONCAT(perfZone, __LINE__)(PERF_CONCAT(perfZoneHash, __LINE__))
+
+// GPU_PERF_ZONE("Name") times the GPU work recorded in the rest of the enclosing scope.
+#define GPU_PERF_ZONE(name) \
+    constexpr uint32_t PERF_CONCAT(gpuPerfZoneHash, __LINE__) = crc32(name); \
+    static const bool PERF_CONCAT(gpuPerfZoneRegistered, __LINE__) = TimePerfManager::RegisterZoneName(name, PERF_CONCAT(gpuPerfZoneHash, __LINE__)); \
+    (void)PERF_CONCAT(gpuPerfZoneRegistered, __LINE__); \
+    ScopedGpuPerfZone PERF_CONCAT(gpuPerfZone, __LINE__)(PERF_CONCAT(gpuPerfZoneHash, __LINE__))
@@ -62,16 +62,12 @@ void UIManager::WindowResize(LPARAM lParam)
     m_windowHeight = (UINT)HIWORD(lParam);
 
     // Inform other systems that we are waiting for the GPU to be idle before resizing the swapchain.
-    HEventArguments args;
-    HEvent WaitGpuIdleEvent(args, "WaitGpuIdle");
-    m_pEventManager->SendEvent(WaitGpuIdleEvent);
+    m_pEventManager->SendEvent(WaitGpuIdleEvent());
 
-    HEventArguments resizeArgs;
-    resizeArgs[crc32("Width")] = (UINT)LOWORD(lParam);
-    resizeArgs[crc32("Height")] = (UINT)HIWORD(lParam);
-
-    HEvent ResizeEvent(resizeArgs, "ResizeSwapchain");
-    m_pEventManager->SendEvent(ResizeEvent);
+    ResizeSwapchainEvent resizeEvent = {};
+    resizeEvent.width = (UINT)LOWORD(lParam);
+    resizeEvent.height = (UINT)HIWORD(lParam);
+    m_pEventManager->SendEvent(resizeEvent);
 
     CleanupSwapchainRenderTargets();
     HRESULT result = m_pSwapChain->ResizeBuffers(0, (UINT)LOWORD(lParam), (UINT)HIWORD(lParam), DXGI_FORMAT_UNKNOWN, DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT);
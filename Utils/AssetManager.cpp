@@ -1,11 +1,160 @@
 #include "AssetManager.h"
 #include "DX12Utils.h"
 #include "../Scene/Mesh.h"
+#include "../TimePerfManager/TimePerfManager.h"
+#include "MemoryTracker.h"
+#include "TextureContainer.h"
+#include "TextureUtils.h"
+#include <algorithm>
+#include <iterator>
 #include <unordered_set>
 #include <cassert>
+#include <cstring>
+#include <iostream>
 
 extern ID3D12Device* g_pD3dDevice;
 
+namespace
+{
+    DXGI_FORMAT GetMaterialTexFormat(const ImgInfo& imgInfo)
+    {
+        switch (imgInfo.blockDesc.format)
+        {
+        case BlockFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+        case BlockFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+        case BlockFormat::BC4: return DXGI_FORMAT_BC4_UNORM;
+        case BlockFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+        case BlockFormat::BC7: return DXGI_FORMAT_BC7_UNORM;
+        default:               return DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+    }
+
+    // The BC4 and BC5 channels are read back where the shaders expect their source channels. E.g. the roughness and
+    // metallic in a BC5 red and green still sample as the green and blue.
+    UINT GetMaterialTexComponentMapping(const ImgInfo& imgInfo)
+    {
+        const BlockCompressDesc& desc = imgInfo.blockDesc;
+        if (desc.format != BlockFormat::BC4 && desc.format != BlockFormat::BC5)
+        {
+            return D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+        }
+
+        const uint32_t channelCnt = desc.format == BlockFormat::BC5 ? 2 : 1;
+        D3D12_SHADER_COMPONENT_MAPPING mappings[4] = { D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+                                                       D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+                                                       D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_0,
+                                                       D3D12_SHADER_COMPONENT_MAPPING_FORCE_VALUE_1 };
+        for (uint32_t k = 0; k < channelCnt; k++)
+        {
+            mappings[desc.srcChannels[k]] = static_cast<D3D12_SHADER_COMPONENT_MAPPING>(D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0 + k);
+        }
+        return D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(mappings[0], mappings[1], mappings[2], mappings[3]);
+    }
+
+    // The container levels go to the upload buffer straight from the file mapping.
+    void SendMaterialTexData(ImgInfo& imgInfo)
+    {
+        if (imgInfo.pContainer)
+        {
+            std::vector<const uint8_t*> levelData(imgInfo.pContainer->levels.size());
+            for (uint32_t level = 0; level < levelData.size(); level++)
+            {
+                levelData[level] = imgInfo.pContainer->levels[level].pData;
+            }
+            SendSubresourcesToTexture2D(g_pD3dDevice, imgInfo.gpuResource, levelData.data());
+        }
+        else
+        {
+            SendDataToTexture2D(g_pD3dDevice, imgInfo.gpuResource, imgInfo.dataVec.data(), static_cast<uint32_t>(imgInfo.dataVec.size()));
+        }
+    }
+
+    // The GPU texture is the same when the size, the format and the bytes of every level are. 0 is the unset key.
+    uint64_t HashMaterialTexContent(const ImgInfo& imgInfo, DXGI_FORMAT format)
+    {
+        uint64_t hash = (static_cast<uint64_t>(imgInfo.pixWidth) << 32) | imgInfo.pixHeight;
+        hash = HashTextureData(reinterpret_cast<const uint8_t*>(&format), sizeof(format), hash ^ imgInfo.mipCnt);
+        if (imgInfo.pContainer)
+        {
+            for (const TextureContainerLevel& level : imgInfo.pContainer->levels)
+            {
+                hash = HashTextureData(level.pData, level.bytes, hash);
+            }
+        }
+        else
+        {
+            hash = HashTextureData(imgInfo.dataVec.data(), imgInfo.dataVec.size(), hash);
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+    // The data and the bytes of each level, wherever they are. A plain texture is one run of all its levels.
+    void GetMaterialTexLevels(const ImgInfo& imgInfo, std::vector<std::pair<const uint8_t*, uint64_t>>& oLevels)
+    {
+        oLevels.clear();
+        if (imgInfo.pContainer)
+        {
+            for (const TextureContainerLevel& level : imgInfo.pContainer->levels)
+            {
+                oLevels.emplace_back(level.pData, level.bytes);
+            }
+        }
+        else
+        {
+            oLevels.emplace_back(imgInfo.dataVec.data(), imgInfo.dataVec.size());
+        }
+    }
+
+    // Tells a real duplicate from a hash collision by comparing what the hash covers. Textures stored differently are
+    // treated as different, which only costs a separate upload.
+    bool IsSameMaterialTexContent(const ImgInfo& cachedImgInfo, DXGI_FORMAT cachedFormat, const ImgInfo& imgInfo, DXGI_FORMAT format)
+    {
+        if (cachedFormat != format ||
+            cachedImgInfo.pixWidth != imgInfo.pixWidth ||
+            cachedImgInfo.pixHeight != imgInfo.pixHeight ||
+            cachedImgInfo.mipCnt != imgInfo.mipCnt)
+        {
+            return false;
+        }
+        if (&cachedImgInfo == &imgInfo)
+        {
+            return true;
+        }
+
+        std::vector<std::pair<const uint8_t*, uint64_t>> cachedLevels;
+        std::vector<std::pair<const uint8_t*, uint64_t>> levels;
+        GetMaterialTexLevels(cachedImgInfo, cachedLevels);
+        GetMaterialTexLevels(imgInfo, levels);
+        if (cachedLevels.size() != levels.size())
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < levels.size(); i++)
+        {
+            if (cachedLevels[i].second != levels[i].second ||
+                memcmp(cachedLevels[i].first, levels[i].first, levels[i].second) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+uint64_t ImgInfo::GetDataBytes() const
+{
+    if (pContainer)
+    {
+        uint64_t bytes = 0;
+        for (const TextureContainerLevel& level : pContainer->levels)
+        {
+            bytes += level.bytes;
+        }
+        return bytes;
+    }
+    return dataVec.size();
+}
+
 void AssetManager::Deinit()
 {
     for (const auto& itr : m_primitiveAssets)
@@ -15,11 +164,11 @@ void AssetManager::Deinit()
             if (primItr->m_gpuVertBuffer) { primItr->m_gpuVertBuffer->Release(); }
             if (primItr->m_gpuIndexBuffer) { primItr->m_gpuIndexBuffer->Release(); }
             if (primItr->m_pTexturesSrvHeap) { primItr->m_pTexturesSrvHeap->Release(); }
-            if (primItr->m_baseColorTex.isSentToGpu) { primItr->m_baseColorTex.gpuResource->Release(); }
-            if (primItr->m_metallicRoughnessTex.isSentToGpu) { primItr->m_metallicRoughnessTex.gpuResource->Release(); }
-            if (primItr->m_normalTex.isSentToGpu) { primItr->m_normalTex.gpuResource->Release(); }
-            if (primItr->m_occlusionTex.isSentToGpu) { primItr->m_occlusionTex.gpuResource->Release(); }
-            if (primItr->m_emissiveTex.isSentToGpu) { primItr->m_emissiveTex.gpuResource->Release(); }
+            if (primItr->m_baseColorTex.isSentToGpu) { ReleaseMaterialTexture(primItr->m_baseColorTex.contentHash); }
+            if (primItr->m_metallicRoughnessTex.isSentToGpu) { ReleaseMaterialTexture(primItr->m_metallicRoughnessTex.contentHash); }
+            if (primItr->m_normalTex.isSentToGpu) { ReleaseMaterialTexture(primItr->m_normalTex.contentHash); }
+            if (primItr->m_occlusionTex.isSentToGpu) { ReleaseMaterialTexture(primItr->m_occlusionTex.contentHash); }
+            if (primItr->m_emissiveTex.isSentToGpu) { ReleaseMaterialTexture(primItr->m_emissiveTex.contentHash); }
             if (primItr->m_materialMaskBuffer) { primItr->m_materialMaskBuffer->Release(); }
             if (primItr->m_pMaterialMaskCbvHeap) { primItr->m_pMaterialMaskCbvHeap->Release(); }
             if (primItr->m_blas) { primItr->m_blas->Release(); }
@@ -41,7 +190,10 @@ void AssetManager::LoadStaticMeshAssets(const std::string& modelName, StaticMesh
 {
     if (m_primitiveAssets.count(modelName) > 0)
     {
-        pStaticMesh->m_primitiveAssets = m_primitiveAssets[modelName];
+        for (const PrimitiveInstance& primInstance : m_primitiveInstances[modelName])
+        {
+            pStaticMesh->AddPrimitive(primInstance.pPrimAsset, primInstance.nodeMat);
+        }
     }
     else
     {
@@ -51,22 +203,49 @@ void AssetManager::LoadStaticMeshAssets(const std::string& modelName, StaticMesh
 
 void AssetManager::SaveModelPrimAssetAndCreateGpuRsrc(const std::string& name, PrimitiveAsset* pPrimitiveAsset)
 {
-    const uint32_t idxBufferSizeByte = pPrimitiveAsset->m_idxType ?
+    PERF_ZONE("Create Primitive Gpu Resources");
+    MEMORY_TAG_SCOPE(MemoryTag::AssetGeometry);
+    // The LOD indices follow the level 0's, in the same index type.
+    const uint32_t idxSizeByte = pPrimitiveAsset->m_idxType ? sizeof(uint32_t) : sizeof(uint16_t);
+    const uint32_t lod0IdxBufferSizeByte = pPrimitiveAsset->m_idxType ?
                                                    sizeof(uint32_t) * pPrimitiveAsset->m_idxDataUint32.size() :
                                                    sizeof(uint16_t) * pPrimitiveAsset->m_idxDataUint16.size();
+    const uint32_t idxBufferSizeByte = lod0IdxBufferSizeByte + idxSizeByte * static_cast<uint32_t>(pPrimitiveAsset->m_lodIdxData.size());
     const uint32_t vertCnt = pPrimitiveAsset->m_posData.size() / 3;
-    const uint32_t vertSizeFloat = VERT_SIZE_FLOAT; // Position(3) + Normal(3) + Tangent(4) + TexCoord(2).
-    const uint32_t vertSizeByte = sizeof(float) * vertSizeFloat;
-    const uint32_t vertexBufferSize = vertCnt * vertSizeByte;
-    pPrimitiveAsset->m_vertData.resize(vertCnt * vertSizeFloat);
+    pPrimitiveAsset->GenAABB();
 
-    for (uint32_t i = 0; i < vertCnt; i++)
+    // The compact one is quantized in the AABB, so it goes after it.
+    pPrimitiveAsset->m_vertFormat = m_vertexFormat;
+    uint32_t vertSizeByte = 0;
+    const void* pVertData = nullptr;
+    if (m_vertexFormat == VertexFormat::Compact)
     {
-        memcpy(&pPrimitiveAsset->m_vertData[i * vertSizeFloat], &pPrimitiveAsset->m_posData[i * 3], sizeof(float) * 3);
-        memcpy(&pPrimitiveAsset->m_vertData[i * vertSizeFloat + 3], &pPrimitiveAsset->m_normalData[i * 3], sizeof(float) * 3);
-        memcpy(&pPrimitiveAsset->m_vertData[i * vertSizeFloat + 6], &pPrimitiveAsset->m_tangentData[i * 4], sizeof(float) * 4);
-        memcpy(&pPrimitiveAsset->m_vertData[i * vertSizeFloat + 10], &pPrimitiveAsset->m_texCoordData[i * 2], sizeof(float) * 2);
+        vertSizeByte = COMPACT_VERT_SIZE_BYTE;
+        pPrimitiveAsset->m_compactVertData.resize(static_cast<size_t>(vertCnt) * COMPACT_VERT_SIZE_BYTE);
+        CompactVertexData(pPrimitiveAsset->m_posData.data(),
+                          pPrimitiveAsset->m_normalData.data(),
+                          pPrimitiveAsset->m_tangentData.data(),
+                          pPrimitiveAsset->m_texCoordData.data(),
+                          vertCnt,
+                          pPrimitiveAsset->m_aabbMin,
+                          pPrimitiveAsset->m_aabbMax,
+                          pPrimitiveAsset->m_compactVertData.data());
+        pVertData = pPrimitiveAsset->m_compactVertData.data();
     }
+    else
+    {
+        const uint32_t vertSizeFloat = VERT_SIZE_FLOAT; // Position(3) + Normal(3) + Tangent(4) + TexCoord(2).
+        vertSizeByte = sizeof(float) * vertSizeFloat;
+        pPrimitiveAsset->m_vertData.resize(vertCnt * vertSizeFloat);
+        InterleaveVertexData(pPrimitiveAsset->m_posData.data(),
+                             pPrimitiveAsset->m_normalData.data(),
+                             pPrimitiveAsset->m_tangentData.data(),
+                             pPrimitiveAsset->m_texCoordData.data(),
+                             vertCnt,
+                             pPrimitiveAsset->m_vertData.data());
+        pVertData = pPrimitiveAsset->m_vertData.data();
+    }
+    const uint32_t vertexBufferSize = vertCnt * vertSizeByte;
 
     D3D12_HEAP_PROPERTIES heapProperties{};
     {
@@ -116,7 +295,7 @@ void AssetManager::SaveModelPrimAssetAndCreateGpuRsrc(const std::string& name, P
     void* pVertexDataBegin;
     D3D12_RANGE readRange{ 0, 0 };        // We do not intend to read from this resource on the CPU.
     ThrowIfFailed(pPrimitiveAsset->m_gpuVertBuffer->Map(0, &readRange, &pVertexDataBegin));
-    memcpy(pVertexDataBegin, pPrimitiveAsset->m_vertData.data(), vertexBufferSize);
+    memcpy(pVertexDataBegin, pVertData, vertexBufferSize);
     pPrimitiveAsset->m_gpuVertBuffer->Unmap(0, nullptr);
 
     // Initialize the vertex buffer view.
@@ -129,11 +308,16 @@ void AssetManager::SaveModelPrimAssetAndCreateGpuRsrc(const std::string& name, P
     ThrowIfFailed(pPrimitiveAsset->m_gpuIndexBuffer->Map(0, &readRange, &pIdxDataBegin));
     if (pPrimitiveAsset->m_idxType)
     {
-        memcpy(pIdxDataBegin, pPrimitiveAsset->m_idxDataUint32.data(), idxBufferSizeByte);
+        memcpy(pIdxDataBegin, pPrimitiveAsset->m_idxDataUint32.data(), lod0IdxBufferSizeByte);
+        memcpy(static_cast<uint8_t*>(pIdxDataBegin) + lod0IdxBufferSizeByte, pPrimitiveAsset->m_lodIdxData.data(),
+               sizeof(uint32_t) * pPrimitiveAsset->m_lodIdxData.size());
     }
     else
     {
-        memcpy(pIdxDataBegin, pPrimitiveAsset->m_idxDataUint16.data(), idxBufferSizeByte);
+        memcpy(pIdxDataBegin, pPrimitiveAsset->m_idxDataUint16.data(), lod0IdxBufferSizeByte);
+        std::transform(pPrimitiveAsset->m_lodIdxData.begin(), pPrimitiveAsset->m_lodIdxData.end(),
+                       reinterpret_cast<uint16_t*>(static_cast<uint8_t*>(pIdxDataBegin) + lod0IdxBufferSizeByte),
+                       [](uint32_t idx) { return static_cast<uint16_t>(idx); });
     }
     pPrimitiveAsset->m_gpuIndexBuffer->Unmap(0, nullptr);
 
@@ -155,13 +339,120 @@ void AssetManager::SaveModelPrimAssetAndCreateGpuRsrc(const std::string& name, P
     }
 }
 
+void AssetManager::SaveModelPrimInstance(const std::string& modelName, const PrimitiveInstance& primInstance)
+{
+    m_primitiveInstances[modelName].push_back(primInstance);
+}
+
+uint64_t AssetManager::RecreateMaterialGpuRsrc(PrimitiveAsset* pPrimAsset)
+{
+    PERF_ZONE("Recreate Material Gpu Resources");
+    // The old references go after the new ones are taken, so a texture that stays keeps its shared GPU texture.
+    std::vector<uint64_t> oldTexHashes;
+    ImgInfo* pTexInfos[5] = { &pPrimAsset->m_baseColorTex, &pPrimAsset->m_metallicRoughnessTex, &pPrimAsset->m_normalTex, &pPrimAsset->m_occlusionTex, &pPrimAsset->m_emissiveTex };
+    for (ImgInfo* pTexInfo : pTexInfos)
+    {
+        if (pTexInfo->isSentToGpu)
+        {
+            oldTexHashes.push_back(pTexInfo->contentHash);
+            pTexInfo->gpuResource = nullptr;
+            pTexInfo->isSentToGpu = false;
+        }
+    }
+    if (pPrimAsset->m_pTexturesSrvHeap) { pPrimAsset->m_pTexturesSrvHeap->Release(); pPrimAsset->m_pTexturesSrvHeap = nullptr; }
+    if (pPrimAsset->m_materialMaskBuffer) { pPrimAsset->m_materialMaskBuffer->Release(); pPrimAsset->m_materialMaskBuffer = nullptr; }
+    if (pPrimAsset->m_pMaterialMaskCbvHeap) { pPrimAsset->m_pMaterialMaskCbvHeap->Release(); pPrimAsset->m_pMaterialMaskCbvHeap = nullptr; }
+
+    const uint64_t uploadedBytes = GenMaterialTexBuffer(pPrimAsset);
+    for (uint64_t oldTexHash : oldTexHashes)
+    {
+        ReleaseMaterialTexture(oldTexHash);
+    }
+    return uploadedBytes;
+}
+
+uint64_t AssetManager::AcquireMaterialTexture(ImgInfo& imgInfo, const D3D12_RESOURCE_DESC& textureDesc, const D3D12_HEAP_PROPERTIES& heapProperties, const wchar_t* pName)
+{
+    if (imgInfo.contentHash == 0)
+    {
+        imgInfo.contentHash = HashMaterialTexContent(imgInfo, textureDesc.Format);
+    }
+    imgInfo.isSentToGpu = true;
+
+    // A texture that dropped its data already matched its key's content. One with data is compared with the cached
+    // content, and a different texture under the same hash moves on to the next key.
+    auto itr = m_textureCache.find(imgInfo.contentHash);
+    while (itr != m_textureCache.end() && imgInfo.GetDataBytes() > 0 &&
+           !IsSameMaterialTexContent(*itr->second.pOwner, itr->second.format, imgInfo, textureDesc.Format))
+    {
+        imgInfo.contentHash = imgInfo.contentHash + 1 != 0 ? imgInfo.contentHash + 1 : 1;
+        itr = m_textureCache.find(imgInfo.contentHash);
+    }
+    if (itr != m_textureCache.end())
+    {
+        itr->second.refCnt++;
+        imgInfo.gpuResource = itr->second.pResource;
+        // The owner keeps its data for the comparisons, also when it takes its texture again.
+        if (imgInfo.GetDataBytes() > 0 && itr->second.pOwner != &imgInfo)
+        {
+            m_sharedTextureCnt++;
+            m_sharedTextureBytes += itr->second.bytes;
+            std::vector<uint8_t>().swap(imgInfo.dataVec);
+            imgInfo.pContainer = nullptr;
+        }
+        return 0;
+    }
+
+    assert(imgInfo.GetDataBytes() > 0 && "A duplicate texture dropped its data, so its shared texture must still be cached.");
+    ThrowIfFailed(g_pD3dDevice->CreateCommittedResource(
+        &heapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &textureDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&imgInfo.gpuResource)));
+
+    imgInfo.gpuResource->SetName(pName);
+
+    SendMaterialTexData(imgInfo);
+
+    const uint64_t bytes = imgInfo.GetDataBytes();
+    m_textureCache[imgInfo.contentHash] = { imgInfo.gpuResource, 1, bytes, &imgInfo, textureDesc.Format };
+    return bytes;
+}
+
+void AssetManager::ReleaseMaterialTexture(uint64_t contentHash)
+{
+    auto itr = m_textureCache.find(contentHash);
+    assert(itr != m_textureCache.end() && "Released a texture that isn't cached.");
+    if (--itr->second.refCnt == 0)
+    {
+        itr->second.pResource->Release();
+        m_textureCache.erase(itr);
+    }
+}
+
+void AssetManager::PrintTextureCacheStats() const
+{
+    uint64_t cachedBytes = 0;
+    for (const auto& itr : m_textureCache)
+    {
+        cachedBytes += itr.second.bytes;
+    }
+    std::cout << "Texture cache: " << m_textureCache.size() << " textures, " << cachedBytes / (1024.0 * 1024.0) << " MB. "
+              << m_sharedTextureCnt << " duplicates shared them instead, " << m_sharedTextureBytes / (1024.0 * 1024.0)
+              << " MB of duplicate uploads eliminated." << std::endl;
+}
+
 void AssetManager::CreateVertIdxBuffer(PrimitiveAsset* pPrimAsset)
 {
 
 }
 
-void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
+uint64_t AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
 {
+    PERF_ZONE("Create Material Textures");
+    MEMORY_TAG_SCOPE(MemoryTag::Textures);
     const uint32_t cbvSrvUavDescHandleOffset = g_pD3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
     
     // Describe and create a Texture2D.
@@ -204,27 +495,19 @@ void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
         descHeapPtr = pPrimAsset->m_pTexturesSrvHeap->GetCPUDescriptorHandleForHeapStart();
     }
 
+    uint64_t uploadedBytes = 0;
     uint32_t texHeapOffset = 0;
     if (pPrimAsset->m_baseColorTex.pixWidth > 1)
     {
-        pPrimAsset->m_baseColorTex.isSentToGpu = true;
         textureDesc.Width = pPrimAsset->m_baseColorTex.pixWidth;
         textureDesc.Height = pPrimAsset->m_baseColorTex.pixHeight;
+        textureDesc.MipLevels = static_cast<UINT16>(pPrimAsset->m_baseColorTex.mipCnt);
+        srvDesc.Texture2D.MipLevels = pPrimAsset->m_baseColorTex.mipCnt;
+        textureDesc.Format = GetMaterialTexFormat(pPrimAsset->m_baseColorTex);
+        srvDesc.Format = textureDesc.Format;
+        srvDesc.Shader4ComponentMapping = GetMaterialTexComponentMapping(pPrimAsset->m_baseColorTex);
 
-        ThrowIfFailed(g_pD3dDevice->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&pPrimAsset->m_baseColorTex.gpuResource)));
-
-        pPrimAsset->m_baseColorTex.gpuResource->SetName(L"BaseColorTexture");
-
-        SendDataToTexture2D(g_pD3dDevice,
-            pPrimAsset->m_baseColorTex.gpuResource,
-            pPrimAsset->m_baseColorTex.dataVec.data(),
-            pPrimAsset->m_baseColorTex.dataVec.size());
+        uploadedBytes += AcquireMaterialTexture(pPrimAsset->m_baseColorTex, textureDesc, heapProperties, L"BaseColorTexture");
 
         g_pD3dDevice->CreateShaderResourceView(pPrimAsset->m_baseColorTex.gpuResource,
             &srvDesc,
@@ -237,24 +520,15 @@ void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
 
     if (pPrimAsset->m_metallicRoughnessTex.pixWidth > 1)
     {
-        pPrimAsset->m_metallicRoughnessTex.isSentToGpu = true;
         textureDesc.Width = pPrimAsset->m_metallicRoughnessTex.pixWidth;
         textureDesc.Height = pPrimAsset->m_metallicRoughnessTex.pixHeight;
+        textureDesc.MipLevels = static_cast<UINT16>(pPrimAsset->m_metallicRoughnessTex.mipCnt);
+        srvDesc.Texture2D.MipLevels = pPrimAsset->m_metallicRoughnessTex.mipCnt;
+        textureDesc.Format = GetMaterialTexFormat(pPrimAsset->m_metallicRoughnessTex);
+        srvDesc.Format = textureDesc.Format;
+        srvDesc.Shader4ComponentMapping = GetMaterialTexComponentMapping(pPrimAsset->m_metallicRoughnessTex);
 
-        ThrowIfFailed(g_pD3dDevice->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&pPrimAsset->m_metallicRoughnessTex.gpuResource)));
-
-        pPrimAsset->m_metallicRoughnessTex.gpuResource->SetName(L"MetallicRoughnessTexture");
-
-        SendDataToTexture2D(g_pD3dDevice,
-                            pPrimAsset->m_metallicRoughnessTex.gpuResource,
-                            pPrimAsset->m_metallicRoughnessTex.dataVec.data(),
-                            pPrimAsset->m_metallicRoughnessTex.dataVec.size());
+        uploadedBytes += AcquireMaterialTexture(pPrimAsset->m_metallicRoughnessTex, textureDesc, heapProperties, L"MetallicRoughnessTexture");
 
         g_pD3dDevice->CreateShaderResourceView(pPrimAsset->m_metallicRoughnessTex.gpuResource,
                                                &srvDesc,
@@ -267,24 +541,15 @@ void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
 
     if (pPrimAsset->m_normalTex.pixWidth > 1)
     {
-        pPrimAsset->m_normalTex.isSentToGpu = true;
         textureDesc.Width = pPrimAsset->m_normalTex.pixWidth;
         textureDesc.Height = pPrimAsset->m_normalTex.pixHeight;
+        textureDesc.MipLevels = static_cast<UINT16>(pPrimAsset->m_normalTex.mipCnt);
+        srvDesc.Texture2D.MipLevels = pPrimAsset->m_normalTex.mipCnt;
+        textureDesc.Format = GetMaterialTexFormat(pPrimAsset->m_normalTex);
+        srvDesc.Format = textureDesc.Format;
+        srvDesc.Shader4ComponentMapping = GetMaterialTexComponentMapping(pPrimAsset->m_normalTex);
 
-        ThrowIfFailed(g_pD3dDevice->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&pPrimAsset->m_normalTex.gpuResource)));
-
-        pPrimAsset->m_normalTex.gpuResource->SetName(L"NormalTexture");
-
-        SendDataToTexture2D(g_pD3dDevice,
-                            pPrimAsset->m_normalTex.gpuResource,
-                            pPrimAsset->m_normalTex.dataVec.data(),
-                            pPrimAsset->m_normalTex.dataVec.size());
+        uploadedBytes += AcquireMaterialTexture(pPrimAsset->m_normalTex, textureDesc, heapProperties, L"NormalTexture");
 
         g_pD3dDevice->CreateShaderResourceView(pPrimAsset->m_normalTex.gpuResource,
                                                &srvDesc,
@@ -297,24 +562,15 @@ void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
 
     if (pPrimAsset->m_occlusionTex.pixWidth > 1)
     {
-        pPrimAsset->m_occlusionTex.isSentToGpu = true;
         textureDesc.Width = pPrimAsset->m_occlusionTex.pixWidth;
         textureDesc.Height = pPrimAsset->m_occlusionTex.pixHeight;
+        textureDesc.MipLevels = static_cast<UINT16>(pPrimAsset->m_occlusionTex.mipCnt);
+        srvDesc.Texture2D.MipLevels = pPrimAsset->m_occlusionTex.mipCnt;
+        textureDesc.Format = GetMaterialTexFormat(pPrimAsset->m_occlusionTex);
+        srvDesc.Format = textureDesc.Format;
+        srvDesc.Shader4ComponentMapping = GetMaterialTexComponentMapping(pPrimAsset->m_occlusionTex);
 
-        ThrowIfFailed(g_pD3dDevice->CreateCommittedResource(
-            &heapProperties,
-            D3D12_HEAP_FLAG_NONE,
-            &textureDesc,
-            D3D12_RESOURCE_STATE_COPY_DEST,
-            nullptr,
-            IID_PPV_ARGS(&pPrimAsset->m_occlusionTex.gpuResource)));
-
-        pPrimAsset->m_occlusionTex.gpuResource->SetName(L"OcclusionTexture");
-
-        SendDataToTexture2D(g_pD3dDevice,
-                            pPrimAsset->m_occlusionTex.gpuResource,
-                            pPrimAsset->m_occlusionTex.dataVec.data(),
-                            pPrimAsset->m_occlusionTex.dataVec.size());
+        uploadedBytes += AcquireMaterialTexture(pPrimAsset->m_occlusionTex, textureDesc, heapProperties, L"OcclusionTexture");
 
         g_pD3dDevice->CreateShaderResourceView(pPrimAsset->m_occlusionTex.gpuResource,
                                                &srvDesc,
@@ -328,10 +584,12 @@ void AssetManager::GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset)
 
     pPrimAsset->GenMaterialMask();
     GenPrimAssetMaterialBuffer(pPrimAsset);
+    return uploadedBytes;
 }
 
 void AssetManager::GenPrimAssetMaterialBuffer(PrimitiveAsset* pPrimAsset)
 {
+    PERF_ZONE("Create Material Buffer");
     pPrimAsset->GenMaterialMask();
     constexpr uint32_t CnstBufferSize = sizeof(float) * 64;
 
@@ -413,7 +671,18 @@ std::vector<PrimitiveAsset*> AssetManager::GenSceneVertIdxBuffer(std::vector<flo
     for (auto prim : prims)
     {
         sceneVertBuffer.insert(sceneVertBuffer.end(), prim->m_vertData.begin(), prim->m_vertData.end());
-        sceneIdxBuffer.insert(sceneIdxBuffer.end(), prim->m_idxDataUint16.begin(), prim->m_idxDataUint16.end());
+        if (prim->m_idxType)
+        {
+            if (prim->FitsUint16Indices())
+            {
+                std::transform(prim->m_idxDataUint32.begin(), prim->m_idxDataUint32.begin() + prim->m_idxCnt,
+                               std::back_inserter(sceneIdxBuffer), [](uint32_t idx) { return static_cast<uint16_t>(idx); });
+            }
+        }
+        else
+        {
+            sceneIdxBuffer.insert(sceneIdxBuffer.end(), prim->m_idxDataUint16.begin(), prim->m_idxDataUint16.begin() + prim->m_idxCnt);
+        }
     }
 
     return prims;
@@ -2,7 +2,12 @@
 #include <unordered_map>
 #include <string>
 #include <vector>
+#include <memory>
+#include <cfloat>
+#include <cstdint>
 #include <d3d12.h>
+#include "MeshUtils.h"
+#include "BlockCompression.h"
 
 /*
 * Make sure heavy data is only stored one time and managed by the AssetManager.
@@ -18,8 +23,6 @@ const uint32_t EMISSIVE_MASK          = 16;
 const uint32_t DIELECTRIC_MASK        = 32;
 const uint32_t DOUBLE_FACE_MASK       = 64;
 
-constexpr int VERT_SIZE_FLOAT = (3 + 3 + 4 + 2); // Position(3) + Normal(3) + Tangent(4) + TexCoord(2).
-
 enum class TexWrapMode
 {
     REPEAT,
@@ -28,18 +31,29 @@ enum class TexWrapMode
     CLAMP_TO_BORDER
 };
 
+struct TextureContainer;
+
 struct ImgInfo
 {
     uint32_t             pixWidth;
     uint32_t             pixHeight;
     uint32_t             componentCnt;
-    std::vector<uint8_t> dataVec;
+    std::vector<uint8_t> dataVec;           // All the mip levels, tightly packed from the level 0.
+    uint32_t             mipCnt = 1;
+    BlockCompressDesc    blockDesc = { BlockFormat::None }; // The dataVec holds the encoded blocks unless None.
+    // The levels of a KTX2/DDS texture stay in its file mapping instead of the dataVec, until they are uploaded.
+    std::shared_ptr<const TextureContainer> pContainer;
+    std::string          sourceUri;             // The image file, or the glTF and its image index. Empty for the defaults.
+    uint64_t             contentHash = 0;       // The texture cache key. Set when it's first sent to the GPU.
     uint32_t             componentType;
     ID3D12Resource*      gpuResource;
     bool                 isSentToGpu;
     uint32_t             srvHeapIdx;
     TexWrapMode          wrapModeVertical;
     TexWrapMode          wrapModeHorizontal;
+
+    // The bytes of all the levels, wherever they are.
+    uint64_t GetDataBytes() const;
 };
 
 struct TextureAsset
@@ -54,7 +68,9 @@ struct EnvMapAsset
 
 struct PrimitiveAsset
 {
-    std::vector<float> m_vertData;
+    std::vector<float> m_vertData; // The VERT_SIZE_FLOAT layout. Empty with the Compact vertex format.
+    std::vector<uint8_t> m_compactVertData; // The COMPACT_VERT_SIZE_BYTE layout. Empty with the Float vertex format.
+    VertexFormat m_vertFormat = VertexFormat::Float;
     std::vector<float> m_posData;
     std::vector<float> m_normalData;
     std::vector<float> m_tangentData;
@@ -65,6 +81,18 @@ struct PrimitiveAsset
     std::vector<uint16_t> m_idxDataUint16;
     std::vector<uint32_t> m_idxDataUint32;
 
+    // The levels after the level 0, from the finest. The m_idxCnt and the index data above stay the level 0, so the
+    // ray tracing and the occlusion culling see the full mesh. Only the GPU index buffer has the m_lodIdxData too.
+    std::vector<MeshLod>  m_lods;
+    std::vector<uint32_t> m_lodIdxData;
+
+    // The level 0 in meshlets, in the triangle order of the index data above. Empty unless the loader builds them. The
+    // local vertices and triangles are kept for the mesh shaders, though only the bounds are used by the forward path.
+    std::vector<Meshlet>       m_meshlets;
+    std::vector<MeshletBounds> m_meshletBounds;
+    std::vector<uint32_t>      m_meshletVerts;
+    std::vector<uint8_t>       m_meshletTris;
+
     ID3D12Resource*          m_gpuVertBuffer;
     ID3D12Resource*          m_gpuIndexBuffer;
     D3D12_VERTEX_BUFFER_VIEW m_vertexBufferView;
@@ -84,6 +112,10 @@ struct PrimitiveAsset
 
     ID3D12Resource* m_blas;
 
+    // Local space bounding box. Used by the CPU culling, and as the position dequantization of the compact vertices.
+    float m_aabbMin[3];
+    float m_aabbMax[3];
+
     uint32_t TextureCnt() const
     {
         uint32_t texCnt = 0;
@@ -104,6 +136,35 @@ struct PrimitiveAsset
         if(m_occlusionTex.pixWidth > 1) { m_materialMask |= AO_MASK; }
         if(m_emissiveTex.pixWidth > 1) { m_materialMask |= EMISSIVE_MASK; }
     }
+
+    void GenAABB()
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            m_aabbMin[i] = FLT_MAX;
+            m_aabbMax[i] = -FLT_MAX;
+        }
+
+        for (uint32_t i = 0; i < m_posData.size(); i++)
+        {
+            const uint32_t axis = i % 3;
+            m_aabbMin[axis] = m_posData[i] < m_aabbMin[axis] ? m_posData[i] : m_aabbMin[axis];
+            m_aabbMax[axis] = m_posData[i] > m_aabbMax[axis] ? m_posData[i] : m_aabbMax[axis];
+        }
+    }
+
+    // The path tracer reads the scene indices as uint16, so it only takes the primitives whose vertices they address.
+    bool FitsUint16Indices() const
+    {
+        return m_vertData.size() / VERT_SIZE_FLOAT <= UINT16_MAX + 1;
+    }
+};
+
+// A primitive placed in its asset by a glTF node. The primitives of a mesh are placed once per node referencing it.
+struct PrimitiveInstance
+{
+    PrimitiveAsset* pPrimAsset;
+    float           nodeMat[16]; // The node's world matrix in the asset, laid out like the model matrices.
 };
 
 class AssetManager
@@ -114,10 +175,23 @@ public:
 
     void Deinit();
 
+    // The layout of the vertex buffers created from now on. The path tracer needs the Float one.
+    void SetVertexFormat(VertexFormat format) { m_vertexFormat = format; }
+    VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+
     void SaveModelPrimAssetAndCreateGpuRsrc(const std::string& modelName, PrimitiveAsset* pPrimitiveAsset);
+    // Record a placement of a saved primitive, so the later meshes of the model get it from LoadStaticMeshAssets().
+    void SaveModelPrimInstance(const std::string& modelName, const PrimitiveInstance& primInstance);
+    // Release the primitive's texture and material resources and create them again from its current ImgInfos. Used to
+    // swap the streamed textures in for the placeholders. The GPU must not be using the old resources anymore. Returns
+    // the uploaded texture bytes, which don't count the textures shared from the cache.
+    uint64_t RecreateMaterialGpuRsrc(PrimitiveAsset* pPrimitiveAsset);
     void LoadAssets();
     void UnloadAssets();
 
+    // The material textures shared by the content between the primitives and the models.
+    void PrintTextureCacheStats() const;
+
     bool IsStaticMeshAssetLoaded(const std::string& modelName) const
     {
         return m_primitiveAssets.find(modelName) != m_primitiveAssets.end();
@@ -142,13 +216,36 @@ public:
         }
     }
 
-    // Used by the DXR render backend for the scene information.
+    // Used by the DXR render backend for the scene information. The uint32_t indices are narrowed to the uint16_t ones,
+    // and the primitives that don't FitsUint16Indices() get no indices here.
     std::vector<PrimitiveAsset*> GenSceneVertIdxBuffer(std::vector<float>& sceneVertBuffer, std::vector<uint16_t>& sceneIdxBuffer);
 
 private:
     void CreateVertIdxBuffer(PrimitiveAsset* pPrimAsset);
-    void GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset);
+    uint64_t GenMaterialTexBuffer(PrimitiveAsset* pPrimAsset); // Returns the uploaded bytes.
     void GenPrimAssetMaterialBuffer(PrimitiveAsset* pPrimAsset);
 
+    // Points the texture to the cached GPU texture of the same content, or creates and uploads it. A hit is compared
+    // byte by byte with the cached one before sharing. A duplicate drops its CPU copy, since the first one keeps the
+    // shared data. Returns the uploaded bytes.
+    uint64_t AcquireMaterialTexture(ImgInfo& imgInfo, const D3D12_RESOURCE_DESC& textureDesc, const D3D12_HEAP_PROPERTIES& heapProperties, const wchar_t* pName);
+    // Drops a reference. The GPU texture is released with the last one.
+    void ReleaseMaterialTexture(uint64_t contentHash);
+
+    struct CachedTexture
+    {
+        ID3D12Resource* pResource;
+        uint32_t        refCnt;
+        uint64_t        bytes;
+        const ImgInfo*  pOwner; // The texture that uploaded it. It keeps its data, so a hit can be compared with it.
+        DXGI_FORMAT     format;
+    };
+
     std::unordered_map<std::string, std::vector<PrimitiveAsset*>> m_primitiveAssets;
+    std::unordered_map<std::string, std::vector<PrimitiveInstance>> m_primitiveInstances;
+    // By the ImgInfo::contentHash. A texture whose hash is taken by a different content moves on to the next free key.
+    std::unordered_map<uint64_t, CachedTexture>                   m_textureCache;
+    uint64_t                                                      m_sharedTextureCnt = 0;
+    uint64_t                                                      m_sharedTextureBytes = 0;
+    VertexFormat                                                  m_vertexFormat = VertexFormat::Float;
 };
\ No newline at end of file
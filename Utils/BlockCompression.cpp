@@ -0,0 +1,952 @@
+#include "BlockCompression.h"
+#include "../JobSystem/JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define BLOCK_COMPRESSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // The block rows per job.
+    constexpr uint32_t BLOCK_ROW_GRAIN_SIZE = 4;
+
+    // The power iterations for the principal axis of a block. The 4x4 covariance converges in a few.
+    constexpr uint32_t AXIS_ITERATION_CNT = 8;
+
+    // The BC7 4 bits index weights, out of 64.
+    constexpr uint32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // The BC1 palette is color0, color1 and the two colors between, so the positions along the line map to the
+    // indices out of order.
+    constexpr uint8_t BC1_IDX_OF_POS[4] = { 0, 2, 3, 1 };
+    constexpr float   BC1_POS_WEIGHTS[4] = { 0.f, 1.f / 3.f, 2.f / 3.f, 1.f };
+
+    // The 16 texels of a block as floats in both layouts. The channels a format drops are 0, so they add no error.
+    struct BlockTexels
+    {
+        alignas(16) float texels[16][4];   // For the errors against a palette.
+        alignas(16) float channels[4][16]; // For the projections onto an endpoint line.
+    };
+
+    // A block's index positions along its endpoint line and the squared error they give.
+    struct LineFit
+    {
+        uint8_t pos[16];
+        float   error = std::numeric_limits<float>::max();
+    };
+
+    void LoadBlock(const uint8_t* pRgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t oBlock[64])
+    {
+        for (uint32_t y = 0; y < 4; y++)
+        {
+            const uint32_t srcY = std::min(blockY * 4 + y, height - 1);
+            for (uint32_t x = 0; x < 4; x++)
+            {
+                const uint32_t srcX = std::min(blockX * 4 + x, width - 1);
+                memcpy(&oBlock[(y * 4 + x) * 4], &pRgba[(static_cast<uint64_t>(srcY) * width + srcX) * 4], 4);
+            }
+        }
+    }
+
+    void StoreBlock(const uint8_t block[64], uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t* pRgba)
+    {
+        for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+        {
+            for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+            {
+                memcpy(&pRgba[(static_cast<uint64_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4], &block[(y * 4 + x) * 4], 4);
+            }
+        }
+    }
+
+    void ToBlockTexels(const uint8_t block[64], uint32_t channelCnt, BlockTexels& oTexels)
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                const float value = c < channelCnt ? static_cast<float>(block[i * 4 + c]) : 0.f;
+                oTexels.texels[i][c] = value;
+                oTexels.channels[c][i] = value;
+            }
+        }
+    }
+
+    // The principal axis of the texels through their mean, by the power iteration on their covariance. The axis is 0
+    // for a flat block.
+    void FitLine(const BlockTexels& texels, float oMean[4], float oAxis[4])
+    {
+        // The covariance is symmetric, so its rows double as the columns in the products below.
+        alignas(16) float covariance[4][4];
+#ifdef BLOCK_COMPRESSION_SSE
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            sum = _mm_add_ps(sum, _mm_load_ps(texels.texels[i]));
+        }
+        const __m128 mean = _mm_mul_ps(sum, _mm_set1_ps(1.f / 16.f));
+        _mm_storeu_ps(oMean, mean);
+
+        __m128 rows[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const __m128 diff = _mm_sub_ps(_mm_load_ps(texels.texels[i]), mean);
+            rows[0] = _mm_add_ps(rows[0], _mm_mul_ps(diff, _mm_shuffle_ps(diff, diff, _MM_SHUFFLE(0, 0, 0, 0))));
+            rows[1] = _mm_add_ps(rows[1], _mm_mul_ps(diff, _mm_shuffle_ps(diff, diff, _MM_SHUFFLE(1, 1, 1, 1))));
+            rows[2] = _mm_add_ps(rows[2], _mm_mul_ps(diff, _mm_shuffle_ps(diff, diff, _MM_SHUFFLE(2, 2, 2, 2))));
+            rows[3] = _mm_add_ps(rows[3], _mm_mul_ps(diff, _mm_shuffle_ps(diff, diff, _MM_SHUFFLE(3, 3, 3, 3))));
+        }
+        for (uint32_t a = 0; a < 4; a++)
+        {
+            _mm_store_ps(covariance[a], rows[a]);
+        }
+#else
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            float sum = 0.f;
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                sum += texels.channels[c][i];
+            }
+            oMean[c] = sum / 16.f;
+        }
+
+        memset(covariance, 0, sizeof(covariance));
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float diff[4];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                diff[c] = texels.texels[i][c] - oMean[c];
+            }
+            for (uint32_t a = 0; a < 4; a++)
+            {
+                for (uint32_t b = 0; b < 4; b++)
+                {
+                    covariance[a][b] += diff[a] * diff[b];
+                }
+            }
+        }
+#endif
+
+        // Start from the row of the widest channel. It can't be orthogonal to the principal axis.
+        uint32_t widestChannel = 0;
+        for (uint32_t a = 1; a < 4; a++)
+        {
+            widestChannel = covariance[a][a] > covariance[widestChannel][widestChannel] ? a : widestChannel;
+        }
+        float axis[4];
+        memcpy(axis, covariance[widestChannel], sizeof(axis));
+
+        // Only the direction matters, so each step just rescales by its largest component against the overflow.
+        for (uint32_t iter = 0; iter < AXIS_ITERATION_CNT; iter++)
+        {
+            float next[4];
+#ifdef BLOCK_COMPRESSION_SSE
+            __m128 product = _mm_mul_ps(_mm_load_ps(covariance[0]), _mm_set1_ps(axis[0]));
+            for (uint32_t b = 1; b < 4; b++)
+            {
+                product = _mm_add_ps(product, _mm_mul_ps(_mm_load_ps(covariance[b]), _mm_set1_ps(axis[b])));
+            }
+            _mm_storeu_ps(next, product);
+#else
+            for (uint32_t a = 0; a < 4; a++)
+            {
+                next[a] = covariance[0][a] * axis[0] + covariance[1][a] * axis[1] + covariance[2][a] * axis[2] + covariance[3][a] * axis[3];
+            }
+#endif
+            const float maxComponent = std::max(std::max(fabsf(next[0]), fabsf(next[1])), std::max(fabsf(next[2]), fabsf(next[3])));
+            if (maxComponent < 1e-6f)
+            {
+                memset(oAxis, 0, sizeof(float) * 4);
+                return;
+            }
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                axis[c] = next[c] / maxComponent;
+            }
+        }
+
+        const float len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            oAxis[c] = axis[c] / len;
+        }
+    }
+
+    // The ends of the texels' projections onto the line, clamped to the 8 bits range.
+    void LineExtents(const BlockTexels& texels, const float mean[4], const float axis[4], float oEnd0[4], float oEnd1[4])
+    {
+        alignas(16) float proj[16];
+#ifdef BLOCK_COMPRESSION_SSE
+        for (uint32_t i = 0; i < 16; i += 4)
+        {
+            __m128 t = _mm_setzero_ps();
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&texels.channels[c][i]), _mm_set1_ps(mean[c])), _mm_set1_ps(axis[c])));
+            }
+            _mm_store_ps(&proj[i], t);
+        }
+#else
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            proj[i] = 0.f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                proj[i] += (texels.channels[c][i] - mean[c]) * axis[c];
+            }
+        }
+#endif
+        const auto [minItr, maxItr] = std::minmax_element(proj, proj + 16);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            oEnd0[c] = std::clamp(mean[c] + *minItr * axis[c], 0.f, 255.f);
+            oEnd1[c] = std::clamp(mean[c] + *maxItr * axis[c], 0.f, 255.f);
+        }
+    }
+
+    // The nearest of the posCnt evenly spaced positions from p0 to p1 for each texel. The rounded projection is the
+    // nearest point, since the palette lies on the line.
+    void ProjectPositions(const BlockTexels& texels, const float p0[4], const float p1[4], uint32_t posCnt, uint8_t oPos[16])
+    {
+        float dir[4];
+        float len2 = 0.f;
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            dir[c] = p1[c] - p0[c];
+            len2 += dir[c] * dir[c];
+        }
+        if (len2 < 1e-6f)
+        {
+            memset(oPos, 0, 16);
+            return;
+        }
+        const float scale = static_cast<float>(posCnt - 1) / len2;
+
+#ifdef BLOCK_COMPRESSION_SSE
+        const __m128 maxPos = _mm_set1_ps(static_cast<float>(posCnt - 1));
+        for (uint32_t i = 0; i < 16; i += 4)
+        {
+            __m128 t = _mm_setzero_ps();
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&texels.channels[c][i]), _mm_set1_ps(p0[c])), _mm_set1_ps(dir[c])));
+            }
+            t = _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(scale)), _mm_set1_ps(0.5f));
+            t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), maxPos);
+            alignas(16) int32_t pos[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(pos), _mm_cvttps_epi32(t));
+            for (uint32_t k = 0; k < 4; k++)
+            {
+                oPos[i + k] = static_cast<uint8_t>(pos[k]);
+            }
+        }
+#else
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            float t = 0.f;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                t += (texels.channels[c][i] - p0[c]) * dir[c];
+            }
+            oPos[i] = static_cast<uint8_t>(std::clamp(t * scale + 0.5f, 0.f, static_cast<float>(posCnt - 1)));
+        }
+#endif
+    }
+
+    // The squared error of the texels against their palette entries. The palette is in the position order.
+    float PaletteError(const BlockTexels& texels, const float (*pPalette)[4], const uint8_t pos[16])
+    {
+#ifdef BLOCK_COMPRESSION_SSE
+        __m128 acc = _mm_setzero_ps();
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const __m128 diff = _mm_sub_ps(_mm_load_ps(texels.texels[i]), _mm_loadu_ps(pPalette[pos[i]]));
+            acc = _mm_add_ps(acc, _mm_mul_ps(diff, diff));
+        }
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, acc);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+        float error = 0.f;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                const float diff = texels.texels[i][c] - pPalette[pos[i]][c];
+                error += diff * diff;
+            }
+        }
+        return error;
+#endif
+    }
+
+    // The least squares endpoints for the texels at their current positions. posWeights is the weight of the end1
+    // at each position. Fails when all texels sit at one position.
+    bool RefineEndpoints(const BlockTexels& texels, const float* pPosWeights, const uint8_t pos[16], float oEnd0[4], float oEnd1[4])
+    {
+        float a00 = 0.f;
+        float a01 = 0.f;
+        float a11 = 0.f;
+        float b0[4] = {};
+        float b1[4] = {};
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const float w1 = pPosWeights[pos[i]];
+            const float w0 = 1.f - w1;
+            a00 += w0 * w0;
+            a01 += w0 * w1;
+            a11 += w1 * w1;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                b0[c] += w0 * texels.texels[i][c];
+                b1[c] += w1 * texels.texels[i][c];
+            }
+        }
+
+        const float det = a00 * a11 - a01 * a01;
+        if (fabsf(det) < 1e-6f)
+        {
+            return false;
+        }
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            oEnd0[c] = std::clamp((a11 * b0[c] - a01 * b1[c]) / det, 0.f, 255.f);
+            oEnd1[c] = std::clamp((a00 * b1[c] - a01 * b0[c]) / det, 0.f, 255.f);
+        }
+        return true;
+    }
+
+    // ============================================================================================================
+    // BC1
+    // ============================================================================================================
+    struct Bc1Block
+    {
+        uint16_t color0;
+        uint16_t color1;
+        LineFit  fit;
+    };
+
+    uint16_t QuantizeRgb565(const float color[4])
+    {
+        const uint32_t r = static_cast<uint32_t>(color[0] * (31.f / 255.f) + 0.5f);
+        const uint32_t g = static_cast<uint32_t>(color[1] * (63.f / 255.f) + 0.5f);
+        const uint32_t b = static_cast<uint32_t>(color[2] * (31.f / 255.f) + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void ExpandRgb565(uint16_t color, int32_t oRgb[3])
+    {
+        const int32_t r = color >> 11;
+        const int32_t g = (color >> 5) & 63;
+        const int32_t b = color & 31;
+        oRgb[0] = (r << 3) | (r >> 2);
+        oRgb[1] = (g << 2) | (g >> 4);
+        oRgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // The RGBA palette in the index order. The BC3 color block always has the 4 colors.
+    void BuildBc1Palette(uint16_t color0, uint16_t color1, bool alwaysFourColors, int32_t oPalette[4][4])
+    {
+        ExpandRgb565(color0, oPalette[0]);
+        ExpandRgb565(color1, oPalette[1]);
+        oPalette[0][3] = 255;
+        oPalette[1][3] = 255;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            if (alwaysFourColors || color0 > color1)
+            {
+                oPalette[2][c] = (2 * oPalette[0][c] + oPalette[1][c] + 1) / 3;
+                oPalette[3][c] = (oPalette[0][c] + 2 * oPalette[1][c] + 1) / 3;
+            }
+            else
+            {
+                oPalette[2][c] = (oPalette[0][c] + oPalette[1][c] + 1) / 2;
+                oPalette[3][c] = 0;
+            }
+        }
+        oPalette[2][3] = 255;
+        oPalette[3][3] = (alwaysFourColors || color0 > color1) ? 255 : 0;
+    }
+
+    void TryBc1Endpoints(const BlockTexels& texels, const float end0[4], const float end1[4], Bc1Block& ioBest)
+    {
+        Bc1Block candidate;
+        candidate.color0 = QuantizeRgb565(end0);
+        candidate.color1 = QuantizeRgb565(end1);
+        // The color0 above the color1 selects the 4 colors mode. Equal ones leave all texels at the color0.
+        if (candidate.color0 < candidate.color1)
+        {
+            std::swap(candidate.color0, candidate.color1);
+        }
+
+        int32_t palette[4][4];
+        BuildBc1Palette(candidate.color0, candidate.color1, true, palette);
+        float posPalette[4][4];
+        for (uint32_t p = 0; p < 4; p++)
+        {
+            for (uint32_t c = 0; c < 3; c++)
+            {
+                posPalette[p][c] = static_cast<float>(palette[BC1_IDX_OF_POS[p]][c]);
+            }
+            posPalette[p][3] = 0.f;
+        }
+
+        if (candidate.color0 == candidate.color1)
+        {
+            memset(candidate.fit.pos, 0, 16);
+        }
+        else
+        {
+            ProjectPositions(texels, posPalette[0], posPalette[3], 4, candidate.fit.pos);
+        }
+        candidate.fit.error = PaletteError(texels, posPalette, candidate.fit.pos);
+        if (candidate.fit.error < ioBest.fit.error)
+        {
+            ioBest = candidate;
+        }
+    }
+
+    void EncodeBc1Block(const uint8_t block[64], uint8_t* pDst)
+    {
+        BlockTexels texels;
+        ToBlockTexels(block, 3, texels);
+
+        float mean[4];
+        float axis[4];
+        float end0[4];
+        float end1[4];
+        FitLine(texels, mean, axis);
+        LineExtents(texels, mean, axis, end0, end1);
+
+        Bc1Block best;
+        TryBc1Endpoints(texels, end0, end1, best);
+        if (RefineEndpoints(texels, BC1_POS_WEIGHTS, best.fit.pos, end0, end1))
+        {
+            TryBc1Endpoints(texels, end0, end1, best);
+        }
+
+        uint32_t indices = 0;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            indices |= static_cast<uint32_t>(best.color0 == best.color1 ? 0 : BC1_IDX_OF_POS[best.fit.pos[i]]) << (i * 2);
+        }
+        pDst[0] = static_cast<uint8_t>(best.color0);
+        pDst[1] = static_cast<uint8_t>(best.color0 >> 8);
+        pDst[2] = static_cast<uint8_t>(best.color1);
+        pDst[3] = static_cast<uint8_t>(best.color1 >> 8);
+        for (uint32_t b = 0; b < 4; b++)
+        {
+            pDst[4 + b] = static_cast<uint8_t>(indices >> (b * 8));
+        }
+    }
+
+    void DecodeBc1Block(const uint8_t* pSrc, bool alwaysFourColors, uint8_t oBlock[64])
+    {
+        const uint16_t color0 = static_cast<uint16_t>(pSrc[0] | (pSrc[1] << 8));
+        const uint16_t color1 = static_cast<uint16_t>(pSrc[2] | (pSrc[3] << 8));
+        const uint32_t indices = pSrc[4] | (pSrc[5] << 8) | (pSrc[6] << 16) | (static_cast<uint32_t>(pSrc[7]) << 24);
+
+        int32_t palette[4][4];
+        BuildBc1Palette(color0, color1, alwaysFourColors, palette);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const uint32_t idx = (indices >> (i * 2)) & 3;
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                oBlock[i * 4 + c] = static_cast<uint8_t>(palette[idx][c]);
+            }
+        }
+    }
+
+    // ============================================================================================================
+    // BC4. Also the BC3 alpha and the two halves of the BC5.
+    // ============================================================================================================
+    void BuildBc4Palette(uint8_t value0, uint8_t value1, int32_t oPalette[8])
+    {
+        oPalette[0] = value0;
+        oPalette[1] = value1;
+        if (value0 > value1)
+        {
+            for (int32_t i = 2; i < 8; i++)
+            {
+                oPalette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+            }
+        }
+        else
+        {
+            for (int32_t i = 2; i < 6; i++)
+            {
+                oPalette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+            }
+            oPalette[6] = 0;
+            oPalette[7] = 255;
+        }
+    }
+
+    // The 8 values mode between the block's min and max. The palette is evenly spaced, so the rounded position is the
+    // nearest entry.
+    void EncodeBc4Block(const uint8_t values[16], uint8_t* pDst)
+    {
+        const auto [minItr, maxItr] = std::minmax_element(values, values + 16);
+        const uint8_t value0 = *maxItr;
+        const uint8_t value1 = *minItr;
+
+        uint64_t indices = 0;
+        if (value0 > value1)
+        {
+            const float scale = 7.f / static_cast<float>(value0 - value1);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                // The position 0 is the value1 and 7 is the value0. The ones between count down from the index 7.
+                const uint32_t pos = static_cast<uint32_t>(static_cast<float>(values[i] - value1) * scale + 0.5f);
+                const uint64_t idx = pos == 7 ? 0 : (pos == 0 ? 1 : 8 - pos);
+                indices |= idx << (i * 3);
+            }
+        }
+
+        pDst[0] = value0;
+        pDst[1] = value1;
+        for (uint32_t b = 0; b < 6; b++)
+        {
+            pDst[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+        }
+    }
+
+    void DecodeBc4Block(const uint8_t* pSrc, uint8_t oValues[16])
+    {
+        int32_t palette[8];
+        BuildBc4Palette(pSrc[0], pSrc[1], palette);
+        uint64_t indices = 0;
+        for (uint32_t b = 0; b < 6; b++)
+        {
+            indices |= static_cast<uint64_t>(pSrc[2 + b]) << (b * 8);
+        }
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            oValues[i] = static_cast<uint8_t>(palette[(indices >> (i * 3)) & 7]);
+        }
+    }
+
+    // ============================================================================================================
+    // BC7 mode 6. 7 bits RGBA endpoints with a p-bit each and 4 bits indices.
+    // ============================================================================================================
+    struct Bc7Block
+    {
+        uint8_t endpoints[2][4]; // The 8 bits values, with the p-bit as the lowest bit.
+        LineFit fit;
+    };
+
+    struct BitWriter
+    {
+        uint8_t* pDst;
+        uint32_t bitPos;
+
+        void Write(uint32_t value, uint32_t bitCnt)
+        {
+            for (uint32_t b = 0; b < bitCnt; b++, bitPos++)
+            {
+                pDst[bitPos >> 3] |= static_cast<uint8_t>(((value >> b) & 1) << (bitPos & 7));
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const uint8_t* pSrc;
+        uint32_t       bitPos;
+
+        uint32_t Read(uint32_t bitCnt)
+        {
+            uint32_t value = 0;
+            for (uint32_t b = 0; b < bitCnt; b++, bitPos++)
+            {
+                value |= static_cast<uint32_t>((pSrc[bitPos >> 3] >> (bitPos & 7)) & 1) << b;
+            }
+            return value;
+        }
+    };
+
+    void BuildBc7Palette(const uint8_t endpoints[2][4], int32_t oPalette[16][4])
+    {
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                oPalette[i][c] = static_cast<int32_t>(((64 - BC7_WEIGHTS4[i]) * endpoints[0][c] + BC7_WEIGHTS4[i] * endpoints[1][c] + 32) >> 6);
+            }
+        }
+    }
+
+    // The same palette as floats for the encoder's searches. The 16 bits lanes hold the products exactly.
+    void BuildBc7FloatPalette(const uint8_t endpoints[2][4], float oPalette[16][4])
+    {
+#ifdef BLOCK_COMPRESSION_SSE
+        const __m128i end0 = _mm_set_epi16(endpoints[0][3], endpoints[0][2], endpoints[0][1], endpoints[0][0],
+                                           endpoints[0][3], endpoints[0][2], endpoints[0][1], endpoints[0][0]);
+        const __m128i end1 = _mm_set_epi16(endpoints[1][3], endpoints[1][2], endpoints[1][1], endpoints[1][0],
+                                           endpoints[1][3], endpoints[1][2], endpoints[1][1], endpoints[1][0]);
+        const __m128i total = _mm_set1_epi16(64);
+        const __m128i half = _mm_set1_epi16(32);
+        for (uint32_t i = 0; i < 16; i += 2)
+        {
+            const short weight0 = static_cast<short>(BC7_WEIGHTS4[i]);
+            const short weight1 = static_cast<short>(BC7_WEIGHTS4[i + 1]);
+            const __m128i weights = _mm_set_epi16(weight1, weight1, weight1, weight1, weight0, weight0, weight0, weight0);
+            __m128i values = _mm_add_epi16(_mm_mullo_epi16(_mm_sub_epi16(total, weights), end0), _mm_mullo_epi16(weights, end1));
+            values = _mm_srli_epi16(_mm_add_epi16(values, half), 6);
+            _mm_storeu_ps(oPalette[i], _mm_cvtepi32_ps(_mm_unpacklo_epi16(values, _mm_setzero_si128())));
+            _mm_storeu_ps(oPalette[i + 1], _mm_cvtepi32_ps(_mm_unpackhi_epi16(values, _mm_setzero_si128())));
+        }
+#else
+        int32_t palette[16][4];
+        BuildBc7Palette(endpoints, palette);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                oPalette[i][c] = static_cast<float>(palette[i][c]);
+            }
+        }
+#endif
+    }
+
+    // Tries the 4 p-bit pairs on the endpoints.
+    void TryBc7Endpoints(const BlockTexels& texels, const float end0[4], const float end1[4], Bc7Block& ioBest)
+    {
+        for (uint32_t pBit0 = 0; pBit0 < 2; pBit0++)
+        {
+            for (uint32_t pBit1 = 0; pBit1 < 2; pBit1++)
+            {
+                Bc7Block candidate;
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    const uint32_t q0 = static_cast<uint32_t>(std::clamp((end0[c] - pBit0) * 0.5f + 0.5f, 0.f, 127.f));
+                    const uint32_t q1 = static_cast<uint32_t>(std::clamp((end1[c] - pBit1) * 0.5f + 0.5f, 0.f, 127.f));
+                    candidate.endpoints[0][c] = static_cast<uint8_t>((q0 << 1) | pBit0);
+                    candidate.endpoints[1][c] = static_cast<uint8_t>((q1 << 1) | pBit1);
+                }
+
+                float palette[16][4];
+                BuildBc7FloatPalette(candidate.endpoints, palette);
+                ProjectPositions(texels, palette[0], palette[15], 16, candidate.fit.pos);
+                candidate.fit.error = PaletteError(texels, palette, candidate.fit.pos);
+                if (candidate.fit.error < ioBest.fit.error)
+                {
+                    ioBest = candidate;
+                }
+            }
+        }
+    }
+
+    void EncodeBc7Block(const uint8_t block[64], uint8_t* pDst)
+    {
+        BlockTexels texels;
+        ToBlockTexels(block, 4, texels);
+
+        float mean[4];
+        float axis[4];
+        float end0[4];
+        float end1[4];
+        FitLine(texels, mean, axis);
+        LineExtents(texels, mean, axis, end0, end1);
+
+        Bc7Block best;
+        TryBc7Endpoints(texels, end0, end1, best);
+
+        float posWeights[16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            posWeights[i] = BC7_WEIGHTS4[i] / 64.f;
+        }
+        if (RefineEndpoints(texels, posWeights, best.fit.pos, end0, end1))
+        {
+            TryBc7Endpoints(texels, end0, end1, best);
+        }
+
+        // The index of the texel 0 drops its top bit, so it must be below 8. The weights are symmetric, and swapping
+        // the endpoints with the mirrored indices gives the same colors.
+        if (best.fit.pos[0] >= 8)
+        {
+            std::swap(best.endpoints[0], best.endpoints[1]);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                best.fit.pos[i] = static_cast<uint8_t>(15 - best.fit.pos[i]);
+            }
+        }
+
+        memset(pDst, 0, 16);
+        BitWriter writer{ pDst, 0 };
+        writer.Write(1 << 6, 7);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            writer.Write(best.endpoints[0][c] >> 1, 7);
+            writer.Write(best.endpoints[1][c] >> 1, 7);
+        }
+        writer.Write(best.endpoints[0][0] & 1, 1);
+        writer.Write(best.endpoints[1][0] & 1, 1);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            writer.Write(best.fit.pos[i], i == 0 ? 3 : 4);
+        }
+    }
+
+    void DecodeBc7Block(const uint8_t* pSrc, uint8_t oBlock[64])
+    {
+        if ((pSrc[0] & 0x7F) != (1 << 6))
+        {
+            assert(false && "Only the BC7 mode 6 blocks are decoded.");
+            memset(oBlock, 0, 64);
+            return;
+        }
+
+        BitReader reader{ pSrc, 7 };
+        uint8_t endpoints[2][4];
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoints[0][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+            endpoints[1][c] = static_cast<uint8_t>(reader.Read(7) << 1);
+        }
+        const uint32_t pBit0 = reader.Read(1);
+        const uint32_t pBit1 = reader.Read(1);
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            endpoints[0][c] |= pBit0;
+            endpoints[1][c] |= pBit1;
+        }
+
+        int32_t palette[16][4];
+        BuildBc7Palette(endpoints, palette);
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            const uint32_t idx = reader.Read(i == 0 ? 3 : 4);
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                oBlock[i * 4 + c] = static_cast<uint8_t>(palette[idx][c]);
+            }
+        }
+    }
+
+    // ============================================================================================================
+    void EncodeBlock(const uint8_t block[64], const BlockCompressDesc& desc, uint8_t* pDst)
+    {
+        uint8_t values[2][16];
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            values[0][i] = block[i * 4 + (desc.format == BlockFormat::BC3 ? 3 : desc.srcChannels[0])];
+            values[1][i] = block[i * 4 + desc.srcChannels[1]];
+        }
+
+        switch (desc.format)
+        {
+        case BlockFormat::BC1:
+            EncodeBc1Block(block, pDst);
+            break;
+        case BlockFormat::BC3:
+            EncodeBc4Block(values[0], pDst);
+            EncodeBc1Block(block, pDst + 8);
+            break;
+        case BlockFormat::BC4:
+            EncodeBc4Block(values[0], pDst);
+            break;
+        case BlockFormat::BC5:
+            EncodeBc4Block(values[0], pDst);
+            EncodeBc4Block(values[1], pDst + 8);
+            break;
+        case BlockFormat::BC7:
+            EncodeBc7Block(block, pDst);
+            break;
+        default:
+            assert(false && "Not a block format.");
+            break;
+        }
+    }
+
+    void DecodeBlock(const uint8_t* pSrc, const BlockCompressDesc& desc, uint8_t oBlock[64])
+    {
+        uint8_t values[2][16];
+        switch (desc.format)
+        {
+        case BlockFormat::BC1:
+            DecodeBc1Block(pSrc, false, oBlock);
+            return;
+        case BlockFormat::BC3:
+            DecodeBc1Block(pSrc + 8, true, oBlock);
+            DecodeBc4Block(pSrc, values[0]);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                oBlock[i * 4 + 3] = values[0][i];
+            }
+            return;
+        case BlockFormat::BC7:
+            DecodeBc7Block(pSrc, oBlock);
+            return;
+        default:
+            break;
+        }
+
+        const uint32_t channelCnt = desc.format == BlockFormat::BC5 ? 2 : 1;
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            oBlock[i * 4] = 0;
+            oBlock[i * 4 + 1] = 0;
+            oBlock[i * 4 + 2] = 0;
+            oBlock[i * 4 + 3] = 255;
+        }
+        for (uint32_t k = 0; k < channelCnt; k++)
+        {
+            DecodeBc4Block(pSrc + k * 8, values[k]);
+            for (uint32_t i = 0; i < 16; i++)
+            {
+                oBlock[i * 4 + desc.srcChannels[k]] = values[k][i];
+            }
+        }
+    }
+
+    uint32_t CalcBlockCnt(uint32_t size)
+    {
+        return (std::max(size, 1u) + 3) / 4;
+    }
+}
+
+// ================================================================================================================
+uint32_t GetBlockBytes(BlockFormat format)
+{
+    return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+// ================================================================================================================
+uint64_t CalcBlockCompressedBytes(uint32_t width, uint32_t height, uint32_t mipCnt, BlockFormat format)
+{
+    uint64_t bytes = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        bytes += static_cast<uint64_t>(CalcBlockCnt(width >> level)) * CalcBlockCnt(height >> level) * GetBlockBytes(format);
+    }
+    return bytes;
+}
+
+// ================================================================================================================
+void CompressMipChain(const uint8_t* pRgba, uint32_t width, uint32_t height, uint32_t mipCnt, const BlockCompressDesc& desc,
+                      std::vector<uint8_t>& oBlocks)
+{
+    assert(desc.format != BlockFormat::None && "Not a block format.");
+    oBlocks.resize(CalcBlockCompressedBytes(width, height, mipCnt, desc.format));
+    const uint32_t blockBytes = GetBlockBytes(desc.format);
+
+    uint64_t srcOffset = 0;
+    uint64_t dstOffset = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        const uint32_t levelWidth = std::max(width >> level, 1u);
+        const uint32_t levelHeight = std::max(height >> level, 1u);
+        const uint32_t blockCntX = CalcBlockCnt(levelWidth);
+        const uint8_t* pLevelSrc = pRgba + srcOffset;
+        uint8_t* pLevelDst = oBlocks.data() + dstOffset;
+
+        JobSystem::ParallelFor(0, CalcBlockCnt(levelHeight), BLOCK_ROW_GRAIN_SIZE, [&](uint32_t blockRowBegin, uint32_t blockRowEnd)
+        {
+            uint8_t block[64];
+            for (uint32_t blockY = blockRowBegin; blockY < blockRowEnd; blockY++)
+            {
+                for (uint32_t blockX = 0; blockX < blockCntX; blockX++)
+                {
+                    LoadBlock(pLevelSrc, levelWidth, levelHeight, blockX, blockY, block);
+                    EncodeBlock(block, desc, pLevelDst + (static_cast<uint64_t>(blockY) * blockCntX + blockX) * blockBytes);
+                }
+            }
+        });
+
+        srcOffset += static_cast<uint64_t>(levelWidth) * levelHeight * 4;
+        dstOffset += static_cast<uint64_t>(blockCntX) * CalcBlockCnt(levelHeight) * blockBytes;
+    }
+}
+
+// ================================================================================================================
+void DecompressMipChain(const uint8_t* pBlocks, uint32_t width, uint32_t height, uint32_t mipCnt, const BlockCompressDesc& desc,
+                        std::vector<uint8_t>& oRgba)
+{
+    uint64_t rgbaBytes = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        rgbaBytes += static_cast<uint64_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+    }
+    oRgba.resize(rgbaBytes);
+    const uint32_t blockBytes = GetBlockBytes(desc.format);
+
+    uint64_t srcOffset = 0;
+    uint64_t dstOffset = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        const uint32_t levelWidth = std::max(width >> level, 1u);
+        const uint32_t levelHeight = std::max(height >> level, 1u);
+        const uint32_t blockCntX = CalcBlockCnt(levelWidth);
+        const uint8_t* pLevelSrc = pBlocks + srcOffset;
+        uint8_t* pLevelDst = oRgba.data() + dstOffset;
+
+        JobSystem::ParallelFor(0, CalcBlockCnt(levelHeight), BLOCK_ROW_GRAIN_SIZE, [&](uint32_t blockRowBegin, uint32_t blockRowEnd)
+        {
+            uint8_t block[64];
+            for (uint32_t blockY = blockRowBegin; blockY < blockRowEnd; blockY++)
+            {
+                for (uint32_t blockX = 0; blockX < blockCntX; blockX++)
+                {
+                    DecodeBlock(pLevelSrc + (static_cast<uint64_t>(blockY) * blockCntX + blockX) * blockBytes, desc, block);
+                    StoreBlock(block, levelWidth, levelHeight, blockX, blockY, pLevelDst);
+                }
+            }
+        });
+
+        srcOffset += static_cast<uint64_t>(blockCntX) * CalcBlockCnt(levelHeight) * blockBytes;
+        dstOffset += static_cast<uint64_t>(levelWidth) * levelHeight * 4;
+    }
+}
+
+// ================================================================================================================
+uint32_t GetBlockChannelMask(const BlockCompressDesc& desc)
+{
+    switch (desc.format)
+    {
+    case BlockFormat::BC1:
+        return 0x7;
+    case BlockFormat::BC4:
+        return 1u << desc.srcChannels[0];
+    case BlockFormat::BC5:
+        return (1u << desc.srcChannels[0]) | (1u << desc.srcChannels[1]);
+    default:
+        return 0xF;
+    }
+}
+
+// ================================================================================================================
+double CalcPsnr(const uint8_t* pRefRgba, const uint8_t* pTestRgba, uint64_t texelCnt, uint32_t channelMask)
+{
+    uint64_t squaredErrorSum = 0;
+    uint64_t sampleCnt = 0;
+    for (uint64_t i = 0; i < texelCnt; i++)
+    {
+        for (uint32_t c = 0; c < 4; c++)
+        {
+            if (channelMask & (1u << c))
+            {
+                const int32_t diff = static_cast<int32_t>(pRefRgba[i * 4 + c]) - static_cast<int32_t>(pTestRgba[i * 4 + c]);
+                squaredErrorSum += static_cast<uint64_t>(diff * diff);
+                sampleCnt++;
+            }
+        }
+    }
+
+    if (squaredErrorSum == 0 || sampleCnt == 0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    const double mse = static_cast<double>(squaredErrorSum) / static_cast<double>(sampleCnt);
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// CPU side BCn block compression of R8G8B8A8 images. It doesn't depend on the D3D12, so it can run headless. Every
+// format decodes back on the CPU, so an encoded texture can be checked against its source.
+
+enum class BlockFormat
+{
+    None, // Uncompressed R8G8B8A8.
+    BC1,  // RGB, 4 bits per pixel. The alpha decodes to 255.
+    BC3,  // BC1 RGB and BC4 alpha, 8 bits per pixel.
+    BC4,  // One channel, 4 bits per pixel.
+    BC5,  // Two channels, 8 bits per pixel.
+    BC7   // RGBA, 8 bits per pixel. Only the mode 6, the single subset RGBA mode, is written and read back.
+};
+
+struct BlockCompressDesc
+{
+    BlockFormat format = BlockFormat::BC7;
+    // The source channels of the BC4 red and the BC5 red and green. E.g. { 1, 2 } for the glTF metallic roughness,
+    // which keeps the roughness and the metallic in the green and the blue.
+    uint32_t    srcChannels[2] = { 0, 1 };
+};
+
+uint32_t GetBlockBytes(BlockFormat format);
+
+// The encoded bytes of the first mipCnt levels, tightly packed one after another like CalcMipChainBytes().
+uint64_t CalcBlockCompressedBytes(uint32_t width, uint32_t height, uint32_t mipCnt, BlockFormat format);
+
+// Encodes an R8G8B8A8 mip chain in the CalcMipChainBytes() layout. The block rows of a level go in parallel when it's
+// called from a job thread. A partial block at the edge repeats the edge texels.
+void CompressMipChain(const uint8_t* pRgba, uint32_t width, uint32_t height, uint32_t mipCnt, const BlockCompressDesc& desc,
+                      std::vector<uint8_t>& oBlocks);
+
+// Decodes the blocks back into the layout of the source. The BC4 and BC5 channels go back to their srcChannels. The
+// channels a format doesn't keep are 0, except the alpha is 255.
+void DecompressMipChain(const uint8_t* pBlocks, uint32_t width, uint32_t height, uint32_t mipCnt, const BlockCompressDesc& desc,
+                        std::vector<uint8_t>& oRgba);
+
+// The channels a format keeps, as a bit per channel.
+uint32_t GetBlockChannelMask(const BlockCompressDesc& desc);
+
+// The peak signal to noise ratio in dB over the masked channels of two R8G8B8A8 buffers. Infinity when they match.
+double CalcPsnr(const uint8_t* pRefRgba, const uint8_t* pTestRgba, uint64_t texelCnt, uint32_t channelMask);
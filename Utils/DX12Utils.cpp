@@ -1,5 +1,6 @@
 #include "DX12Utils.h"
 #include <cassert>
+#include <vector>
 
 static void WaitGpuIdle(ID3D12Device* pDevice, ID3D12CommandQueue* pQueue)
 {
@@ -66,7 +67,29 @@ ID3D12Resource* CreateUploadBufferAndInit(ID3D12Device* pDevice, uint32_t sizeBy
 }
 
 // Assume the input texture is COPY DEST and the texture is PIXEL SHADER RESOURCE after copying.
+// The source data holds every subresource of the texture (e.g. all the mip levels) tightly packed in the subresource order.
 void SendDataToTexture2D(ID3D12Device* pDevice, ID3D12Resource* pDstTexture, void* pSrcData, uint32_t dataSizeBytes)
+{
+    const auto Desc = pDstTexture->GetDesc();
+    const uint32_t subresourceCnt = Desc.MipLevels * Desc.DepthOrArraySize;
+    std::vector<UINT64> rowSizesInBytes(subresourceCnt);
+    std::vector<UINT> numRows(subresourceCnt);
+    pDevice->GetCopyableFootprints(&Desc, 0, subresourceCnt, 0, nullptr, numRows.data(), rowSizesInBytes.data(), nullptr);
+
+    // The subresources follow each other in the data.
+    std::vector<const uint8_t*> subresourceData(subresourceCnt);
+    const uint8_t* pSrcBytes = static_cast<const uint8_t*>(pSrcData);
+    for (uint32_t i = 0; i < subresourceCnt; i++)
+    {
+        subresourceData[i] = pSrcBytes;
+        pSrcBytes += rowSizesInBytes[i] * numRows[i];
+    }
+    assert(pSrcBytes == static_cast<const uint8_t*>(pSrcData) + dataSizeBytes && "The data must hold every subresource of the texture.");
+
+    SendSubresourcesToTexture2D(pDevice, pDstTexture, subresourceData.data());
+}
+
+void SendSubresourcesToTexture2D(ID3D12Device* pDevice, ID3D12Resource* pDstTexture, const uint8_t* const* ppSubresourceData)
 {
     ID3D12CommandQueue* pUploadCmdQueue;
     {
@@ -87,33 +110,51 @@ void SendDataToTexture2D(ID3D12Device* pDevice, ID3D12Resource* pDstTexture, voi
     pUploadCmdList->SetName(L"Upload Command List");
 
     const auto Desc = pDstTexture->GetDesc();
-    D3D12_PLACED_SUBRESOURCE_FOOTPRINT layout;
-    UINT64 rowSizesInBytes;
-    UINT numRows;
+    const uint32_t subresourceCnt = Desc.MipLevels * Desc.DepthOrArraySize;
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCnt);
+    std::vector<UINT64> rowSizesInBytes(subresourceCnt);
+    std::vector<UINT> numRows(subresourceCnt);
     UINT64 requiredSize;
-    pDevice->GetCopyableFootprints(&Desc, 0, 1, 0, &layout, &numRows, &rowSizesInBytes, &requiredSize);
-    assert(requiredSize == dataSizeBytes, "Assume that the size of the texture is the same as the size of the data.");
+    pDevice->GetCopyableFootprints(&Desc, 0, subresourceCnt, 0, layouts.data(), numRows.data(), rowSizesInBytes.data(), &requiredSize);
 
-    ID3D12Resource* pUploadBuffer = CreateUploadBufferAndInit(pDevice, dataSizeBytes, pSrcData);
-    pUploadBuffer->SetName(L"Upload Buffer");
+    // The rows of the upload buffer are padded to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT, so they're copied one by one.
+    ID3D12Resource* pUploadBuffer = nullptr;
+    AllocateUploadBuffer(pDevice, requiredSize, &pUploadBuffer, L"Upload Buffer");
 
-    // Copy the data from the upload buffer to the texture.
-    
-    D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+    uint8_t* pUploadBegin;
+    D3D12_RANGE readRange{ 0, 0 };
+    ThrowIfFailed(pUploadBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pUploadBegin)));
+    for (uint32_t i = 0; i < subresourceCnt; i++)
     {
-        dstLocation.pResource = pDstTexture;
-        dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        dstLocation.SubresourceIndex = 0;
+        const uint8_t* pSrcBytes = ppSubresourceData[i];
+        for (UINT row = 0; row < numRows[i]; row++)
+        {
+            memcpy(pUploadBegin + layouts[i].Offset + static_cast<UINT64>(row) * layouts[i].Footprint.RowPitch, pSrcBytes, rowSizesInBytes[i]);
+            pSrcBytes += rowSizesInBytes[i];
+        }
     }
+    pUploadBuffer->Unmap(0, nullptr);
+
+    // Copy the data from the upload buffer to the texture.
     
-    D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+    for (uint32_t i = 0; i < subresourceCnt; i++)
     {
-        srcLocation.pResource = pUploadBuffer;
-        srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-        srcLocation.PlacedFootprint = layout;
+        D3D12_TEXTURE_COPY_LOCATION dstLocation = {};
+        {
+            dstLocation.pResource = pDstTexture;
+            dstLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+            dstLocation.SubresourceIndex = i;
+        }
+
+        D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+        {
+            srcLocation.pResource = pUploadBuffer;
+            srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+            srcLocation.PlacedFootprint = layouts[i];
+        }
+
+        pUploadCmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
     }
-    
-    pUploadCmdList->CopyTextureRegion(&dstLocation, 0, 0, 0, &srcLocation, nullptr);
 
     // Transfer the texture format from the copy dst to shader rsrc.
     D3D12_RESOURCE_BARRIER barrier = {};
@@ -280,6 +280,9 @@ inline void GpuQueueWaitIdle(ID3D12Device* pDevice, ID3D12CommandQueue* pCmdQueu
 }
 
 void SendDataToTexture2D(ID3D12Device* pDevice, ID3D12Resource* pDstTexture, void* pSrcData, uint32_t dataSizeBytes);
+// One pointer per subresource to its tightly packed rows, so the levels can come from anywhere. E.g. a mapped KTX2 file,
+// which stores the smallest level first.
+void SendSubresourcesToTexture2D(ID3D12Device* pDevice, ID3D12Resource* pDstTexture, const uint8_t* const* ppSubresourceData);
 ID3D12Resource* CreateUploadBufferAndInit(ID3D12Device* pDevice, uint32_t sizeBytes);
 
 
@@ -0,0 +1,118 @@
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+namespace
+{
+    uint8_t* AlignUp(uint8_t* ptr, size_t alignment)
+    {
+        const uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+        return reinterpret_cast<uint8_t*>((addr + alignment - 1) & ~(uintptr_t(alignment) - 1));
+    }
+
+    uint8_t* AllocateBlock(size_t size)
+    {
+        MEMORY_TAG_SCOPE(MemoryTag::Render);
+        return static_cast<uint8_t*>(::operator new(size));
+    }
+}
+
+// ================================================================================================================
+FrameArena::FrameArena(size_t blockSize)
+    : m_pBlock(nullptr),
+      m_blockSize(blockSize),
+      m_offset(0),
+      m_pOverflowBlocks(nullptr),
+      m_pOverflowCursor(nullptr),
+      m_pOverflowEnd(nullptr),
+      m_overflowBlockCnt(0),
+      m_overflowBytes(0),
+      m_usedBytes(0),
+      m_highWaterBytes(0)
+{
+    m_pBlock = AllocateBlock(m_blockSize);
+}
+
+// ================================================================================================================
+FrameArena::~FrameArena()
+{
+    ReleaseOverflowBlocks();
+    ::operator delete(m_pBlock);
+}
+
+// ================================================================================================================
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0 && "The alignment must be a power of 2.");
+    m_usedBytes += size;
+
+    uint8_t* pAligned = AlignUp(m_pBlock + m_offset, alignment);
+    if (pAligned + size <= m_pBlock + m_blockSize)
+    {
+        m_offset = static_cast<size_t>(pAligned + size - m_pBlock);
+        return pAligned;
+    }
+
+    return AllocateOverflow(size, alignment);
+}
+
+// ================================================================================================================
+void* FrameArena::AllocateOverflow(size_t size, size_t alignment)
+{
+    uint8_t* pAligned = m_pOverflowCursor ? AlignUp(m_pOverflowCursor, alignment) : nullptr;
+    if (pAligned == nullptr || pAligned + size > m_pOverflowEnd)
+    {
+        const size_t blockSize = std::max(sizeof(OverflowBlock) + size + alignment, m_blockSize);
+        OverflowBlock* pNewBlock = reinterpret_cast<OverflowBlock*>(AllocateBlock(blockSize));
+        pNewBlock->pNext = m_pOverflowBlocks;
+        pNewBlock->size = blockSize;
+        m_pOverflowBlocks = pNewBlock;
+        m_overflowBlockCnt++;
+
+        m_pOverflowCursor = reinterpret_cast<uint8_t*>(pNewBlock + 1);
+        m_pOverflowEnd = reinterpret_cast<uint8_t*>(pNewBlock) + blockSize;
+        pAligned = AlignUp(m_pOverflowCursor, alignment);
+    }
+
+    m_overflowBytes += size + alignment;
+    m_pOverflowCursor = pAligned + size;
+    return pAligned;
+}
+
+// ================================================================================================================
+void FrameArena::Reset()
+{
+    m_highWaterBytes = std::max(m_highWaterBytes, m_offset + m_overflowBytes);
+
+    if (m_pOverflowBlocks != nullptr)
+    {
+        // Regrow the main block so the next frame of the same size fits without overflow.
+        ReleaseOverflowBlocks();
+        ::operator delete(m_pBlock);
+        while (m_blockSize < m_highWaterBytes)
+        {
+            m_blockSize *= 2;
+        }
+        m_pBlock = AllocateBlock(m_blockSize);
+    }
+
+    m_offset = 0;
+    m_overflowBytes = 0;
+    m_usedBytes = 0;
+}
+
+// ================================================================================================================
+void FrameArena::ReleaseOverflowBlocks()
+{
+    while (m_pOverflowBlocks != nullptr)
+    {
+        OverflowBlock* pNext = m_pOverflowBlocks->pNext;
+        ::operator delete(m_pOverflowBlocks);
+        m_pOverflowBlocks = pNext;
+    }
+    m_pOverflowCursor = nullptr;
+    m_pOverflowEnd = nullptr;
+    m_overflowBlockCnt = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Linear allocator for the transient data of one frame. Allocate() bumps an offset and nothing is freed until Reset().
+// The owner keeps one arena per frame in flight and resets it after the frame's fence completes, so the memory handed
+// out during a frame stays valid until the GPU is done with that frame.
+// A request that doesn't fit in the current block goes to an overflow block. Reset() then regrows the main block to the
+// high water mark, so a steady state frame lives in one block and never touches the heap.
+// Not thread safe. Only the thread recording the frame should allocate from it.
+class FrameArena
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    explicit FrameArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* Allocate(size_t size, size_t alignment);
+    void Reset();
+
+    size_t GetUsedBytes() const { return m_usedBytes; }
+    size_t GetHighWaterBytes() const { return m_highWaterBytes; }
+    size_t GetBlockSize() const { return m_blockSize; }
+    uint32_t GetOverflowBlockCnt() const { return m_overflowBlockCnt; }
+
+private:
+    // Overflow blocks are chained through a header at their start.
+    struct OverflowBlock
+    {
+        OverflowBlock* pNext;
+        size_t         size;
+    };
+
+    void* AllocateOverflow(size_t size, size_t alignment);
+    void ReleaseOverflowBlocks();
+
+    uint8_t* m_pBlock;
+    size_t   m_blockSize;
+    size_t   m_offset;
+
+    OverflowBlock* m_pOverflowBlocks;
+    uint8_t*       m_pOverflowCursor;
+    uint8_t*       m_pOverflowEnd;
+    uint32_t       m_overflowBlockCnt;
+    size_t         m_overflowBytes;
+
+    size_t m_usedBytes;
+    size_t m_highWaterBytes;
+};
+
+// STL allocator adapter over a FrameArena. deallocate() is a no-op; the arena's Reset() releases everything at once.
+// The containers must not outlive the frame that created them.
+template<typename T>
+class FrameArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit FrameArenaAllocator(FrameArena* pArena) noexcept
+        : m_pArena(pArena)
+    {}
+
+    template<typename U>
+    FrameArenaAllocator(const FrameArenaAllocator<U>& other) noexcept
+        : m_pArena(other.GetArena())
+    {}
+
+    T* allocate(size_t cnt)
+    {
+        return static_cast<T*>(m_pArena->Allocate(cnt * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* GetArena() const { return m_pArena; }
+
+    template<typename U>
+    bool operator==(const FrameArenaAllocator<U>& other) const { return m_pArena == other.GetArena(); }
+
+    template<typename U>
+    bool operator!=(const FrameArenaAllocator<U>& other) const { return m_pArena != other.GetArena(); }
+
+private:
+    FrameArena* m_pArena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
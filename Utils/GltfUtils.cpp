@@ -1,5 +1,5 @@
 #include "GltfUtils.h"
-// #include "MathUtils.h"
+#include "MathUtils.h"
 #include <vector>
 
 // ================================================================================================================
@@ -28,7 +28,7 @@ uint32_t GetAComponentEleBytesCnt(
         aComponentEleBytesCnt = 1;
         break;
     default:
-        assert(false, "Invalid component type.");
+        assert(false && "Invalid component type.");
     }
     return aComponentEleBytesCnt;
 }
@@ -56,7 +56,7 @@ uint32_t GetComponentEleCnt(
         componentEleCnt = 16;
         break;
     default:
-        assert(false, "Invalid accessor type.");
+        assert(false && "Invalid accessor type.");
     }
 
     return componentEleCnt;
@@ -112,6 +112,116 @@ void ReadOutAccessorData(
     }
 }
 
+// ================================================================================================================
+void GetGltfNodeLocalMat(const tinygltf::Node& node, float* pResMat)
+{
+    if (node.matrix.size() == 16)
+    {
+        // The glTF matrix is column major.
+        for (uint32_t row = 0; row < 4; row++)
+        {
+            for (uint32_t col = 0; col < 4; col++)
+            {
+                pResMat[4 * row + col] = static_cast<float>(node.matrix[4 * col + row]);
+            }
+        }
+        return;
+    }
+
+    // T * R * S. The glTF quaternion is xyzw.
+    const double t[3] = { node.translation.size() == 3 ? node.translation[0] : 0.0,
+                          node.translation.size() == 3 ? node.translation[1] : 0.0,
+                          node.translation.size() == 3 ? node.translation[2] : 0.0 };
+    const double q[4] = { node.rotation.size() == 4 ? node.rotation[0] : 0.0,
+                          node.rotation.size() == 4 ? node.rotation[1] : 0.0,
+                          node.rotation.size() == 4 ? node.rotation[2] : 0.0,
+                          node.rotation.size() == 4 ? node.rotation[3] : 1.0 };
+    const double s[3] = { node.scale.size() == 3 ? node.scale[0] : 1.0,
+                          node.scale.size() == 3 ? node.scale[1] : 1.0,
+                          node.scale.size() == 3 ? node.scale[2] : 1.0 };
+
+    const double rot[9] = {
+        1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]), 2.0 * (q[0] * q[1] - q[2] * q[3]),       2.0 * (q[0] * q[2] + q[1] * q[3]),
+        2.0 * (q[0] * q[1] + q[2] * q[3]),       1.0 - 2.0 * (q[0] * q[0] + q[2] * q[2]), 2.0 * (q[1] * q[2] - q[0] * q[3]),
+        2.0 * (q[0] * q[2] - q[1] * q[3]),       2.0 * (q[1] * q[2] + q[0] * q[3]),       1.0 - 2.0 * (q[0] * q[0] + q[1] * q[1])
+    };
+
+    for (uint32_t row = 0; row < 3; row++)
+    {
+        for (uint32_t col = 0; col < 3; col++)
+        {
+            pResMat[4 * row + col] = static_cast<float>(rot[3 * row + col] * s[col]);
+        }
+        pResMat[4 * row + 3] = static_cast<float>(t[row]);
+    }
+    pResMat[12] = 0.f;
+    pResMat[13] = 0.f;
+    pResMat[14] = 0.f;
+    pResMat[15] = 1.f;
+}
+
+// ================================================================================================================
+void FlattenGltfNodes(const tinygltf::Model& model, int sceneIdx, GltfFlatNodes& oFlatNodes)
+{
+    oFlatNodes.nodeIdxs.clear();
+    oFlatNodes.parents.clear();
+    oFlatNodes.worldMats.clear();
+
+    const int sceneCnt = static_cast<int>(model.scenes.size());
+    if (sceneIdx < 0 || sceneIdx >= sceneCnt)
+    {
+        sceneIdx = (model.defaultScene >= 0 && model.defaultScene < sceneCnt) ? model.defaultScene : 0;
+    }
+    if (sceneIdx >= sceneCnt)
+    {
+        return;
+    }
+
+    const int nodeCnt = static_cast<int>(model.nodes.size());
+    oFlatNodes.nodeIdxs.reserve(nodeCnt);
+    oFlatNodes.parents.reserve(nodeCnt);
+    std::vector<uint8_t> isFlattened(nodeCnt, 0);
+    auto AddNode = [&](int nodeIdx, uint32_t parent)
+    {
+        if (nodeIdx >= 0 && nodeIdx < nodeCnt && !isFlattened[nodeIdx])
+        {
+            isFlattened[nodeIdx] = 1;
+            oFlatNodes.nodeIdxs.push_back(nodeIdx);
+            oFlatNodes.parents.push_back(parent);
+        }
+    };
+
+    // The flattened nodes are the queue of the breadth first walk.
+    for (int rootIdx : model.scenes[sceneIdx].nodes)
+    {
+        AddNode(rootIdx, UINT32_MAX);
+    }
+    for (uint32_t flatIdx = 0; flatIdx < oFlatNodes.nodeIdxs.size(); flatIdx++)
+    {
+        for (int childIdx : model.nodes[oFlatNodes.nodeIdxs[flatIdx]].children)
+        {
+            AddNode(childIdx, flatIdx);
+        }
+    }
+
+    oFlatNodes.worldMats.resize(16 * oFlatNodes.nodeIdxs.size());
+    for (uint32_t flatIdx = 0; flatIdx < oFlatNodes.nodeIdxs.size(); flatIdx++)
+    {
+        float* pWorldMat = &oFlatNodes.worldMats[16 * flatIdx];
+        const uint32_t parent = oFlatNodes.parents[flatIdx];
+        if (parent == UINT32_MAX)
+        {
+            GetGltfNodeLocalMat(model.nodes[oFlatNodes.nodeIdxs[flatIdx]], pWorldMat);
+        }
+        else
+        {
+            float localMat[16];
+            GetGltfNodeLocalMat(model.nodes[oFlatNodes.nodeIdxs[flatIdx]], localMat);
+            MatrixMul4x4(&oFlatNodes.worldMats[16 * parent], localMat, pWorldMat);
+        }
+    }
+}
+
 /*
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/quaternion.hpp>
@@ -146,7 +256,7 @@ namespace SharedLib
             aComponentEleBytesCnt = 1;
             break;
         default:
-            assert(false, "Invalid component type.");
+            assert(false && "Invalid component type.");
         }
         return aComponentEleBytesCnt;
     }
@@ -174,7 +284,7 @@ namespace SharedLib
             componentEleCnt = 16;
             break;
         default:
-            assert(false, "Invalid accessor type.");
+            assert(false && "Invalid accessor type.");
         }
 
         return componentEleCnt;
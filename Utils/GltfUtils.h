@@ -9,6 +9,23 @@ void ReadOutAccessorData(void*                              pDst,
                          const tinygltf::Accessor&          accessor,
                          std::vector<tinygltf::BufferView>& bufferViews,
                          std::vector<tinygltf::Buffer>&     buffers);
+
+// The nodes of a glTF scene, each parent before its children, with their world matrices.
+struct GltfFlatNodes
+{
+    std::vector<int>      nodeIdxs;  // Into the model's nodes.
+    std::vector<uint32_t> parents;   // Into the flattened nodes. UINT32_MAX for the scene's roots.
+    std::vector<float>    worldMats; // 16 floats each. Row major for the column vectors, like the model matrices.
+};
+
+// The node's local matrix from its matrix or its TRS, in the 16 floats of the model matrices.
+void GetGltfNodeLocalMat(const tinygltf::Node& node, float* pResMat);
+
+// Flattens the scene's node trees breadth first and chains the local matrices down into the world matrices, so a
+// parent's world matrix is ready before its children's. It's linear in the nodes and doesn't allocate per node, and the
+// output keeps its capacity for the next call. A negative sceneIdx takes the model's default scene, or its first one.
+// A node listed under a second parent, which the glTF forbids, stays under the first one, so a cycle can't hang it.
+void FlattenGltfNodes(const tinygltf::Model& model, int sceneIdx, GltfFlatNodes& oFlatNodes);
 /*
 namespace SharedLib
 {
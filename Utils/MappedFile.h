@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// A read only memory mapping of a whole file. The pages come in from the disk or the file cache on the first touch, so
+// the bytes never go through an intermediate buffer.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    const uint8_t* GetData() const { return m_pData; }
+    uint64_t GetSize() const { return m_size; }
+
+private:
+    const uint8_t* m_pData = nullptr;
+    uint64_t       m_size = 0;
+#ifdef _WIN32
+    void*          m_hFile = nullptr;
+    void*          m_hMapping = nullptr;
+#endif
+};
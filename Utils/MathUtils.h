@@ -1,9 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#include <cmath>
 #include <iostream>
 
+#ifndef M_PI
 #define M_PI 3.1415926535897932384626433832795
+#endif
 
 // TODO: Dim can be put into template for optimization.
 struct HFVec2
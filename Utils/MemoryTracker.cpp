@@ -0,0 +1,211 @@
+#include "MemoryTracker.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    constexpr uint32_t TAG_CNT = static_cast<uint32_t>(MemoryTag::Count);
+
+    // Constant initialized, so they are usable by the allocations made before main().
+    std::atomic<uint64_t> g_liveBytes[TAG_CNT] = {};
+    std::atomic<uint64_t> g_peakBytes[TAG_CNT] = {};
+    std::atomic<uint64_t> g_allocCnt[TAG_CNT] = {};
+    std::atomic<uint64_t> g_freeCnt[TAG_CNT] = {};
+
+    thread_local MemoryTag t_currentTag = MemoryTag::Untagged;
+
+    const char* const g_tagNames[TAG_CNT] = {
+        "Untagged",
+        "AssetGeometry",
+        "Textures",
+        "SceneObjects",
+        "LoaderScratch",
+        "Events",
+        "Render",
+        "Profiling",
+        "Jobs"
+    };
+}
+
+// ================================================================================================================
+MemoryTagStats MemoryTracker::GetStats(MemoryTag tag)
+{
+    const uint32_t idx = static_cast<uint32_t>(tag);
+    MemoryTagStats stats = {};
+    if (idx < TAG_CNT)
+    {
+        stats.liveBytes = g_liveBytes[idx].load(std::memory_order_relaxed);
+        stats.peakBytes = g_peakBytes[idx].load(std::memory_order_relaxed);
+        stats.allocCnt = g_allocCnt[idx].load(std::memory_order_relaxed);
+        stats.freeCnt = g_freeCnt[idx].load(std::memory_order_relaxed);
+    }
+    return stats;
+}
+
+// ================================================================================================================
+uint64_t MemoryTracker::GetTotalAllocCnt()
+{
+    uint64_t totalAllocCnt = 0;
+    for (uint32_t i = 0; i < TAG_CNT; i++)
+    {
+        totalAllocCnt += g_allocCnt[i].load(std::memory_order_relaxed);
+    }
+    return totalAllocCnt;
+}
+
+// ================================================================================================================
+const char* MemoryTracker::GetTagName(MemoryTag tag)
+{
+    const uint32_t idx = static_cast<uint32_t>(tag);
+    return idx < TAG_CNT ? g_tagNames[idx] : "Invalid";
+}
+
+// ================================================================================================================
+MemoryTag MemoryTracker::GetCurrentTag()
+{
+    return t_currentTag;
+}
+
+// ================================================================================================================
+void MemoryTracker::SetCurrentTag(MemoryTag tag)
+{
+    t_currentTag = tag;
+}
+
+// ================================================================================================================
+void MemoryTracker::OnAlloc(MemoryTag tag, size_t size)
+{
+    const uint32_t idx = static_cast<uint32_t>(tag);
+    const uint64_t live = g_liveBytes[idx].fetch_add(size, std::memory_order_relaxed) + size;
+    g_allocCnt[idx].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t peak = g_peakBytes[idx].load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes[idx].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+// ================================================================================================================
+void MemoryTracker::OnFree(MemoryTag tag, size_t size)
+{
+    const uint32_t idx = static_cast<uint32_t>(tag);
+    g_liveBytes[idx].fetch_sub(size, std::memory_order_relaxed);
+    g_freeCnt[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+// ================================================================================================================
+bool MemoryTracker::DumpJson(const std::string& path)
+{
+    // Plain stdio, so the dump itself doesn't allocate under the tracked tags.
+    FILE* pFile = fopen(path.c_str(), "w");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(pFile, "{\n  \"enabled\": %s,\n  \"tags\": [\n", IsEnabled() ? "true" : "false");
+    for (uint32_t i = 0; i < TAG_CNT; i++)
+    {
+        const MemoryTagStats stats = GetStats(static_cast<MemoryTag>(i));
+        fprintf(pFile,
+                "    { \"name\": \"%s\", \"liveBytes\": %llu, \"peakBytes\": %llu, \"allocCnt\": %llu, \"freeCnt\": %llu }%s\n",
+                g_tagNames[i],
+                static_cast<unsigned long long>(stats.liveBytes),
+                static_cast<unsigned long long>(stats.peakBytes),
+                static_cast<unsigned long long>(stats.allocCnt),
+                static_cast<unsigned long long>(stats.freeCnt),
+                i + 1 < TAG_CNT ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+    return true;
+}
+
+#ifdef ENABLE_MEMORY_TRACKING
+// The global allocation hook. Each block is prefixed with a header that remembers the size and tag, so the free
+// is charged to the allocating tag. The header also stores the distance back to the malloc() base to support the
+// over-aligned allocations.
+namespace
+{
+    struct AllocHeader
+    {
+        uint64_t size;
+        uint32_t tag;
+        uint32_t baseOffset;
+    };
+    static_assert(sizeof(AllocHeader) == 16, "The header must keep the default 16 bytes alignment.");
+
+    void* TrackedAlloc(size_t size, size_t alignment)
+    {
+        if (alignment < sizeof(AllocHeader))
+        {
+            alignment = sizeof(AllocHeader);
+        }
+
+        const size_t padding = alignment == sizeof(AllocHeader) ? sizeof(AllocHeader) : sizeof(AllocHeader) + alignment;
+        void* pBase = malloc(size + padding);
+        if (pBase == nullptr)
+        {
+            return nullptr;
+        }
+
+        const uintptr_t baseAddr = reinterpret_cast<uintptr_t>(pBase);
+        const uintptr_t userAddr = (baseAddr + sizeof(AllocHeader) + alignment - 1) & ~(uintptr_t(alignment) - 1);
+
+        AllocHeader* pHeader = reinterpret_cast<AllocHeader*>(userAddr) - 1;
+        const MemoryTag tag = MemoryTracker::GetCurrentTag();
+        pHeader->size = size;
+        pHeader->tag = static_cast<uint32_t>(tag);
+        pHeader->baseOffset = static_cast<uint32_t>(userAddr - baseAddr);
+
+        MemoryTracker::OnAlloc(tag, size);
+        return reinterpret_cast<void*>(userAddr);
+    }
+
+    void* TrackedAllocOrThrow(size_t size, size_t alignment)
+    {
+        void* ptr = TrackedAlloc(size, alignment);
+        if (ptr == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+
+    void TrackedFree(void* ptr)
+    {
+        if (ptr == nullptr)
+        {
+            return;
+        }
+
+        AllocHeader* pHeader = static_cast<AllocHeader*>(ptr) - 1;
+        MemoryTracker::OnFree(static_cast<MemoryTag>(pHeader->tag), pHeader->size);
+        free(static_cast<uint8_t*>(ptr) - pHeader->baseOffset);
+    }
+}
+
+void* operator new(size_t size) { return TrackedAllocOrThrow(size, 0); }
+void* operator new[](size_t size) { return TrackedAllocOrThrow(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return TrackedAllocOrThrow(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return TrackedAllocOrThrow(size, static_cast<size_t>(al)); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return TrackedAlloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return TrackedAlloc(size, static_cast<size_t>(al)); }
+
+void operator delete(void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { TrackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(ptr); }
+#endif
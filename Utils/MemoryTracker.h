@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Per subsystem heap accounting. When ENABLE_MEMORY_TRACKING is defined, the global operator new/delete are replaced
+// and every allocation is charged to the tag that is current on the allocating thread. The free is charged back to
+// the same tag, even if it happens on another thread or under another tag. The third party libraries (TinyGltf,
+// YamlCpp) allocate internally, so a scoped tag is the only way to attribute their memory.
+// Without ENABLE_MEMORY_TRACKING, MEMORY_TAG_SCOPE compiles to nothing and the stats stay zero.
+enum class MemoryTag : uint32_t
+{
+    Untagged = 0,
+    AssetGeometry,
+    Textures,
+    SceneObjects,
+    LoaderScratch,
+    Events,
+    Render,
+    Profiling,
+    Jobs,
+    Count
+};
+
+struct MemoryTagStats
+{
+    uint64_t liveBytes;
+    uint64_t peakBytes;
+    uint64_t allocCnt;
+    uint64_t freeCnt;
+};
+
+class MemoryTracker
+{
+public:
+    static constexpr bool IsEnabled()
+    {
+#ifdef ENABLE_MEMORY_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static MemoryTagStats GetStats(MemoryTag tag);
+    // Sum of the allocation counts of all tags. The delta across a frame is that frame's heap allocation count.
+    static uint64_t GetTotalAllocCnt();
+    static const char* GetTagName(MemoryTag tag);
+
+    static MemoryTag GetCurrentTag();
+    static void SetCurrentTag(MemoryTag tag);
+
+    // Used by the allocation hook.
+    static void OnAlloc(MemoryTag tag, size_t size);
+    static void OnFree(MemoryTag tag, size_t size);
+
+    // Write all tags' stats to a json file. Returns false if the file cannot be opened.
+    static bool DumpJson(const std::string& path);
+};
+
+// Set the current thread's tag for the scope and restore the previous tag at the end.
+class MemoryTagScope
+{
+public:
+    explicit MemoryTagScope(MemoryTag tag)
+        : m_prevTag(MemoryTracker::GetCurrentTag())
+    {
+        MemoryTracker::SetCurrentTag(tag);
+    }
+
+    ~MemoryTagScope()
+    {
+        MemoryTracker::SetCurrentTag(m_prevTag);
+    }
+
+    MemoryTagScope(const MemoryTagScope&) = delete;
+    MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+private:
+    MemoryTag m_prevTag;
+};
+
+#define MEMORY_TAG_CONCAT_IMPL(a, b) a##b
+#define MEMORY_TAG_CONCAT(a, b) MEMORY_TAG_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_MEMORY_TRACKING
+#define MEMORY_TAG_SCOPE(tag) MemoryTagScope MEMORY_TAG_CONCAT(memTagScope_, __LINE__)(tag)
+#else
+#define MEMORY_TAG_SCOPE(tag) ((void)0)
+#endif
@@ -0,0 +1,2142 @@
+#include "MeshUtils.h"
+#include "../JobSystem/JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+    // The Forsyth's vertex scoring. The simulated LRU cache is larger than the real ones, so the order stays good on
+    // any of them.
+    constexpr uint32_t FORSYTH_CACHE_SIZE   = 32;
+    constexpr float    CACHE_DECAY_POWER    = 1.5f;
+    constexpr float    LAST_TRI_SCORE       = 0.75f;
+    constexpr float    VALENCE_BOOST_SCALE  = 2.0f;
+    constexpr float    VALENCE_BOOST_POWER  = 0.5f;
+    constexpr uint32_t VALENCE_TABLE_SIZE   = 64;
+
+    struct ForsythScoreTables
+    {
+        float cachePosScores[FORSYTH_CACHE_SIZE];
+        float valenceScores[VALENCE_TABLE_SIZE];
+
+        ForsythScoreTables()
+        {
+            for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++)
+            {
+                // The last triangle's vertices score the same, so the winding doesn't change the choice.
+                if (i < 3)
+                {
+                    cachePosScores[i] = LAST_TRI_SCORE;
+                }
+                else
+                {
+                    const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    cachePosScores[i] = powf(1.0f - (i - 3) * scale, CACHE_DECAY_POWER);
+                }
+            }
+
+            valenceScores[0] = 0.0f;
+            for (uint32_t i = 1; i < VALENCE_TABLE_SIZE; i++)
+            {
+                valenceScores[i] = VALENCE_BOOST_SCALE * powf(float(i), -VALENCE_BOOST_POWER);
+            }
+        }
+    };
+
+    float ForsythVertexScore(const ForsythScoreTables& tables, int32_t cachePos, uint32_t liveTriCnt)
+    {
+        if (liveTriCnt == 0)
+        {
+            // Nothing left to draw with it.
+            return -1.0f;
+        }
+
+        float score = cachePos < 0 ? 0.0f : tables.cachePosScores[cachePos];
+        score += liveTriCnt < VALENCE_TABLE_SIZE ? tables.valenceScores[liveTriCnt] :
+                                                   VALENCE_BOOST_SCALE * powf(float(liveTriCnt), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // A FIFO cache simulation by the insertion time stamps. A vertex is cached while less than cacheSize vertices came
+    // in after it.
+    struct FifoCacheSim
+    {
+        std::vector<uint32_t> insertTimes;
+        uint32_t              cacheSize;
+        uint32_t              time;
+
+        FifoCacheSim(uint32_t vertCnt, uint32_t size)
+            : insertTimes(vertCnt, 0), cacheSize(size), time(size)
+        {}
+
+        // Returns whether the vertex was a miss.
+        bool Access(uint32_t vert)
+        {
+            if (time - insertTimes[vert] >= cacheSize)
+            {
+                insertTimes[vert] = ++time;
+                return true;
+            }
+            return false;
+        }
+
+        void Flush()
+        {
+            time += cacheSize;
+        }
+    };
+
+    // The plane quadrics of the mesh simplification. In double, since the error is a difference of large terms.
+    struct Quadric
+    {
+        double a00, a11, a22, a01, a02, a12; // The symmetric matrix of the plane normals.
+        double b0, b1, b2;                   // The normals times the plane offsets.
+        double c;                            // The squared plane offsets.
+        double weight;                       // The triangle areas, so the error is an area weighted mean.
+
+        void AddPlane(const double* pNormal, double offset, double area)
+        {
+            a00 += area * pNormal[0] * pNormal[0];
+            a11 += area * pNormal[1] * pNormal[1];
+            a22 += area * pNormal[2] * pNormal[2];
+            a01 += area * pNormal[0] * pNormal[1];
+            a02 += area * pNormal[0] * pNormal[2];
+            a12 += area * pNormal[1] * pNormal[2];
+            b0 += area * pNormal[0] * offset;
+            b1 += area * pNormal[1] * offset;
+            b2 += area * pNormal[2] * offset;
+            c += area * offset * offset;
+            weight += area;
+        }
+
+        void Add(const Quadric& other)
+        {
+            a00 += other.a00; a11 += other.a11; a22 += other.a22;
+            a01 += other.a01; a02 += other.a02; a12 += other.a12;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // The mean squared distance of the position to the planes.
+        double Error(const double* pPos) const
+        {
+            if (weight <= 0.0)
+            {
+                return 0.0;
+            }
+
+            const double x = pPos[0];
+            const double y = pPos[1];
+            const double z = pPos[2];
+            const double error = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                                 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::max(error, 0.0) / weight;
+        }
+    };
+
+    // Collapses the fromVert onto the toVert. It's stale once either vertex changed after the push.
+    struct EdgeCollapse
+    {
+        double   error;
+        uint32_t fromVert;
+        uint32_t toVert;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const EdgeCollapse& other) const { return error > other.error; }
+    };
+
+    void TriangleNormal(const double* pPos0, const double* pPos1, const double* pPos2, double* pNormal)
+    {
+        const double e0[3] = { pPos1[0] - pPos0[0], pPos1[1] - pPos0[1], pPos1[2] - pPos0[2] };
+        const double e1[3] = { pPos2[0] - pPos0[0], pPos2[1] - pPos0[1], pPos2[2] - pPos0[2] };
+        pNormal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+        pNormal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+        pNormal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+    }
+
+    // The triangles BuildMeshlets() looks through, from the first unused one in the index order, for the nearest to a
+    // meshlet that has no connected triangle left to take.
+    constexpr uint32_t MESHLET_SEED_SEARCH_CNT = 64;
+    // A cone whose normals spread past about 84 degrees from its axis could only cull from a sliver of the views.
+    constexpr double   MESHLET_CONE_MIN_DOT    = 0.1;
+    constexpr uint8_t  MESHLET_NO_LOCAL_VERT   = 0xff;
+
+    // GenerateNormals() and GenerateTangents() run their triangles and vertices in ranges of these on the JobSystem.
+    constexpr uint32_t VERT_FRAME_TRI_GRAIN_SIZE  = 4096;
+    constexpr uint32_t VERT_FRAME_VERT_GRAIN_SIZE = 8192;
+    // GenerateNormals() takes the triangles whose doubled area is below this times their largest coordinate and edge as
+    // slivers. A few float roundings of their corners could flip them.
+    constexpr double   NORMAL_SLIVER_EPSILON      = 4.0 * FLT_EPSILON;
+
+    // The triangle flags of the GenerateNormals() and GenerateTangents().
+    constexpr uint8_t TRI_DEGENERATE        = 1; // Two corners on the same welded vertex.
+    constexpr uint8_t TRI_ORIENT_PRESERVING = 2; // The texture isn't mirrored.
+    constexpr uint8_t TRI_NO_TEXTURE_AREA   = 4;
+
+    // Any unit tangent perpendicular to the normal, from the axis least aligned with it.
+    void PerpendicularTangent(const float* pNormal, float* pTangent)
+    {
+        const float ax = fabsf(pNormal[0]);
+        const float ay = fabsf(pNormal[1]);
+        const float az = fabsf(pNormal[2]);
+        const float axis[3] = { ax <= ay && ax <= az ? 1.0f : 0.0f, ay < ax && ay <= az ? 1.0f : 0.0f, az < ax && az < ay ? 1.0f : 0.0f };
+        // axis - n * dot(n, axis).
+        const float dot = pNormal[0] * axis[0] + pNormal[1] * axis[1] + pNormal[2] * axis[2];
+        float tangent[3] = { axis[0] - pNormal[0] * dot, axis[1] - pNormal[1] * dot, axis[2] - pNormal[2] * dot };
+        const float len = sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+        if (len <= FLT_MIN)
+        {
+            tangent[0] = 1.0f;
+            tangent[1] = 0.0f;
+            tangent[2] = 0.0f;
+        }
+        else
+        {
+            tangent[0] /= len;
+            tangent[1] /= len;
+            tangent[2] /= len;
+        }
+        memcpy(pTangent, tangent, sizeof(tangent));
+    }
+
+    // The vector minus its part along the unit normal, normalized. It stays zero when nothing is left.
+    void ProjectOntoPlane(const float* pNormal, const float* pVec, float* pDst)
+    {
+        const float dot = pNormal[0] * pVec[0] + pNormal[1] * pVec[1] + pNormal[2] * pVec[2];
+        float projected[3] = { pVec[0] - pNormal[0] * dot, pVec[1] - pNormal[1] * dot, pVec[2] - pNormal[2] * dot };
+        const float len = sqrtf(projected[0] * projected[0] + projected[1] * projected[1] + projected[2] * projected[2]);
+        const float scale = len > FLT_MIN ? 1.0f / len : 0.0f;
+        pDst[0] = projected[0] * scale;
+        pDst[1] = projected[1] * scale;
+        pDst[2] = projected[2] * scale;
+    }
+
+    uint32_t FindCornerGroup(std::vector<uint32_t>& groups, uint32_t corner)
+    {
+        while (groups[corner] != corner)
+        {
+            groups[corner] = groups[groups[corner]];
+            corner = groups[corner];
+        }
+        return corner;
+    }
+
+    uint32_t NextCorner(uint32_t corner) { return corner - corner % 3 + (corner + 1) % 3; }
+    uint32_t PrevCorner(uint32_t corner) { return corner - corner % 3 + (corner + 2) % 3; }
+
+    // Welds the vertices whose values are equal in all the streams, so -0 and 0 weld and NaN never does. Each vertex
+    // points at the first one equal to it.
+    void WeldEqualVertices(const float* const* ppStreams, const uint32_t* pComponentCnts, uint32_t streamCnt, uint32_t vertCnt,
+                        std::vector<uint32_t>& oWeldVerts)
+    {
+        auto isSameVert = [=](uint32_t v0, uint32_t v1)
+        {
+            for (uint32_t s = 0; s < streamCnt; s++)
+            {
+                for (uint32_t i = 0; i < pComponentCnts[s]; i++)
+                {
+                    if (ppStreams[s][v0 * pComponentCnts[s] + i] != ppStreams[s][v1 * pComponentCnts[s] + i])
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        };
+
+        uint32_t tableSize = 1;
+        while (tableSize < vertCnt * 2)
+        {
+            tableSize *= 2;
+        }
+        std::vector<uint32_t> table(tableSize, UINT32_MAX);
+        oWeldVerts.resize(vertCnt);
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            // FNV-1a over the words, with -0 hashed as 0.
+            uint32_t hash = 2166136261u;
+            for (uint32_t s = 0; s < streamCnt; s++)
+            {
+                for (uint32_t i = 0; i < pComponentCnts[s]; i++)
+                {
+                    uint32_t word;
+                    memcpy(&word, &ppStreams[s][v * pComponentCnts[s] + i], sizeof(word));
+                    word = word == 0x80000000u ? 0 : word;
+                    hash = (hash ^ word) * 16777619u;
+                }
+            }
+
+            // The mantissas of the round numbers end in zeros, which the FNV leaves in its low bits, so the high bits
+            // are mixed down before the mask.
+            hash ^= hash >> 16;
+            hash *= 0x85ebca6bu;
+            hash ^= hash >> 13;
+
+            uint32_t slot = hash & (tableSize - 1);
+            while (table[slot] != UINT32_MAX && !isSameVert(table[slot], v))
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == UINT32_MAX)
+            {
+                table[slot] = v;
+            }
+            oWeldVerts[v] = table[slot];
+        }
+    }
+
+    // The corners around each welded vertex, without the degenerate triangles'.
+    struct VertexFans
+    {
+        std::vector<uint32_t> offsets; // Into the corners, by the welded vertex. One past the last vertex too.
+        std::vector<uint32_t> corners;
+    };
+
+    void BuildVertexFans(const uint32_t* pIndices, const std::vector<uint8_t>& triFlags, const std::vector<uint32_t>& weldVerts, VertexFans& oFans)
+    {
+        const uint32_t vertCnt = static_cast<uint32_t>(weldVerts.size());
+        const uint32_t cornerCnt = static_cast<uint32_t>(triFlags.size() * 3);
+        oFans.offsets.assign(size_t(vertCnt) + 1, 0);
+        for (uint32_t c = 0; c < cornerCnt; c++)
+        {
+            if ((triFlags[c / 3] & TRI_DEGENERATE) == 0)
+            {
+                oFans.offsets[weldVerts[pIndices[c]] + 1]++;
+            }
+        }
+        for (uint32_t v = 0; v < vertCnt; v++)
+        {
+            oFans.offsets[v + 1] += oFans.offsets[v];
+        }
+
+        oFans.corners.resize(oFans.offsets[vertCnt]);
+        std::vector<uint32_t> fills(oFans.offsets.begin(), oFans.offsets.end() - 1);
+        for (uint32_t c = 0; c < cornerCnt; c++)
+        {
+            if ((triFlags[c / 3] & TRI_DEGENERATE) == 0)
+            {
+                oFans.corners[fills[weldVerts[pIndices[c]]]++] = c;
+            }
+        }
+    }
+
+    // Groups the corners of each fan over the edges where exactly one triangle goes out and one comes back, when
+    // canJoin(outCorner, inCorner) agrees. Each group adds up the 3 floats of its corners into its first corner, which
+    // oCornerGroups points its corners at. The corners out of the fans stay UINT32_MAX. The fans go in parallel.
+    template <typename CanJoin>
+    void GroupFanCorners(const uint32_t* pIndices, const std::vector<uint32_t>& weldVerts, const VertexFans& fans, const CanJoin& canJoin,
+                         std::vector<float>& ioCornerVecs, std::vector<uint32_t>& oCornerGroups)
+    {
+        oCornerGroups.assign(ioCornerVecs.size() / 3, UINT32_MAX);
+        const uint32_t vertCnt = static_cast<uint32_t>(weldVerts.size());
+        JobSystem::ParallelFor(0, vertCnt, VERT_FRAME_VERT_GRAIN_SIZE, [&](uint32_t vertBegin, uint32_t vertEnd)
+        {
+            struct FanEdge
+            {
+                uint32_t vert; // The welded vertex at the other end.
+                uint32_t slot; // The corner's place in the fan.
+
+                bool operator<(const FanEdge& other) const { return vert < other.vert; }
+            };
+            std::vector<FanEdge>  outEdges;
+            std::vector<FanEdge>  inEdges;
+            std::vector<uint32_t> slotGroups;
+            for (uint32_t v = vertBegin; v < vertEnd; v++)
+            {
+                const uint32_t fanSize = fans.offsets[v + 1] - fans.offsets[v];
+                if (fanSize == 0)
+                {
+                    continue;
+                }
+                const uint32_t* pFan = &fans.corners[fans.offsets[v]];
+
+                outEdges.resize(fanSize);
+                inEdges.resize(fanSize);
+                slotGroups.resize(fanSize);
+                for (uint32_t slot = 0; slot < fanSize; slot++)
+                {
+                    outEdges[slot] = { weldVerts[pIndices[NextCorner(pFan[slot])]], slot };
+                    inEdges[slot] = { weldVerts[pIndices[PrevCorner(pFan[slot])]], slot };
+                    slotGroups[slot] = slot;
+                }
+                std::sort(outEdges.begin(), outEdges.end());
+                std::sort(inEdges.begin(), inEdges.end());
+
+                for (uint32_t outIdx = 0, inIdx = 0; outIdx < fanSize && inIdx < fanSize;)
+                {
+                    if (outEdges[outIdx].vert != inEdges[inIdx].vert)
+                    {
+                        outEdges[outIdx].vert < inEdges[inIdx].vert ? outIdx++ : inIdx++;
+                        continue;
+                    }
+
+                    uint32_t outEnd = outIdx + 1;
+                    uint32_t inEnd = inIdx + 1;
+                    while (outEnd < fanSize && outEdges[outEnd].vert == outEdges[outIdx].vert)
+                    {
+                        outEnd++;
+                    }
+                    while (inEnd < fanSize && inEdges[inEnd].vert == inEdges[inIdx].vert)
+                    {
+                        inEnd++;
+                    }
+                    const uint32_t outSlot = outEdges[outIdx].slot;
+                    const uint32_t inSlot = inEdges[inIdx].slot;
+                    if (outEnd - outIdx == 1 && inEnd - inIdx == 1 && canJoin(pFan[outSlot], pFan[inSlot]))
+                    {
+                        const uint32_t group0 = FindCornerGroup(slotGroups, outSlot);
+                        const uint32_t group1 = FindCornerGroup(slotGroups, inSlot);
+                        slotGroups[std::max(group0, group1)] = std::min(group0, group1);
+                    }
+                    outIdx = outEnd;
+                    inIdx = inEnd;
+                }
+
+                // The root is the group's first slot, so it adds up its later ones into itself.
+                for (uint32_t slot = 0; slot < fanSize; slot++)
+                {
+                    const uint32_t rootCorner = pFan[FindCornerGroup(slotGroups, slot)];
+                    oCornerGroups[pFan[slot]] = rootCorner;
+                    if (rootCorner != pFan[slot])
+                    {
+                        for (uint32_t i = 0; i < 3; i++)
+                        {
+                            ioCornerVecs[size_t(rootCorner) * 3 + i] += ioCornerVecs[size_t(pFan[slot]) * 3 + i];
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // Gives each corner group of a vertex its own vertex. The vertex keeps its first group, and the others are appended
+    // with ioSrcVerts pointing back at it. A corner out of the groups keeps its vertex, so it takes the vertex's first
+    // group. The groups that add up to zero have no direction of their own, so they share the vertex's group instead of
+    // a split. oVertGroups is UINT32_MAX for the vertices without a group.
+    void SplitVertexGroups(uint32_t* pIndices, const std::vector<uint32_t>& cornerGroups, const std::vector<float>& cornerVecs,
+                           std::vector<uint32_t>& ioSrcVerts, std::vector<uint32_t>& oVertGroups)
+    {
+        auto isEmptyGroup = [&cornerVecs](uint32_t group)
+        {
+            const float* pSum = &cornerVecs[size_t(group) * 3];
+            return pSum[0] == 0.0f && pSum[1] == 0.0f && pSum[2] == 0.0f;
+        };
+
+        oVertGroups.assign(ioSrcVerts.size(), UINT32_MAX);
+        std::unordered_map<uint64_t, uint32_t> splitVerts;
+        for (uint32_t c = 0; c < cornerGroups.size(); c++)
+        {
+            const uint32_t group = cornerGroups[c];
+            const uint32_t vert = pIndices[c];
+            if (group == UINT32_MAX || oVertGroups[vert] == group)
+            {
+                continue;
+            }
+
+            if (oVertGroups[vert] == UINT32_MAX || isEmptyGroup(oVertGroups[vert]))
+            {
+                oVertGroups[vert] = group;
+                continue;
+            }
+            if (isEmptyGroup(group))
+            {
+                continue;
+            }
+            const auto [splitItr, isNew] = splitVerts.try_emplace((uint64_t(vert) << 32) | group, static_cast<uint32_t>(ioSrcVerts.size()));
+            if (isNew)
+            {
+                ioSrcVerts.push_back(vert);
+                oVertGroups.push_back(group);
+            }
+            pIndices[c] = splitItr->second;
+        }
+    }
+}
+
+// ================================================================================================================
+void InterleaveVertexData(const float* pPosData,
+                          const float* pNormalData,
+                          const float* pTangentData,
+                          const float* pTexCoordData,
+                          uint32_t     vertCnt,
+                          float*       pDst)
+{
+    for (uint32_t i = 0; i < vertCnt; i++)
+    {
+        float* pVert = pDst + i * VERT_SIZE_FLOAT;
+        memcpy(pVert, &pPosData[i * 3], sizeof(float) * 3);
+        memcpy(pVert + 3, &pNormalData[i * 3], sizeof(float) * 3);
+        memcpy(pVert + 6, &pTangentData[i * 4], sizeof(float) * 4);
+        memcpy(pVert + 10, &pTexCoordData[i * 2], sizeof(float) * 2);
+    }
+}
+
+// ================================================================================================================
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t absBits = bits & 0x7fffffff;
+
+    if (absBits >= 0x7f800000)
+    {
+        // Inf stays inf, and NaN stays a quiet NaN.
+        return sign | (absBits > 0x7f800000 ? 0x7e00 : 0x7c00);
+    }
+    if (absBits >= 0x477ff000)
+    {
+        // Rounds past the largest half. Clamp instead of going to inf, since the vertex data should stay finite.
+        return sign | 0x7bff;
+    }
+    if (absBits < 0x38800000)
+    {
+        // A half denormal, or zero. Shift the mantissa with its implicit bit into place, rounding to the nearest even.
+        if (absBits < 0x33000000)
+        {
+            return sign;
+        }
+        const uint32_t exponent = absBits >> 23;
+        const uint32_t mantissa = (absBits & 0x7fffff) | 0x800000;
+        const uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+        {
+            half++;
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+
+    // Rebias the exponent and round the mantissa to the nearest even. A carry correctly bumps the exponent.
+    uint32_t half = ((absBits - 0x38000000) >> 13);
+    const uint32_t rest = absBits & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    {
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+// ================================================================================================================
+float HalfToFloat(uint16_t half)
+{
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else
+    {
+        // Zero or a denormal, which is exact as a float.
+        const float value = mantissa * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// ================================================================================================================
+void EncodeOctahedral(const float* pDir, int16_t* pOct)
+{
+    const float l1Norm = fabsf(pDir[0]) + fabsf(pDir[1]) + fabsf(pDir[2]);
+    if (l1Norm <= 0.0f)
+    {
+        pOct[0] = 0;
+        pOct[1] = 0;
+        return;
+    }
+
+    float x = pDir[0] / l1Norm;
+    float y = pDir[1] / l1Norm;
+    if (pDir[2] < 0.0f)
+    {
+        // Fold the lower hemisphere over the diagonals.
+        const float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    pOct[0] = static_cast<int16_t>(lroundf(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+    pOct[1] = static_cast<int16_t>(lroundf(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+}
+
+// ================================================================================================================
+void DecodeOctahedral(const int16_t* pOct, float* pDir)
+{
+    // The D3D12 SNORM conversion.
+    const float x = std::max(pOct[0] / 32767.0f, -1.0f);
+    const float y = std::max(pOct[1] / 32767.0f, -1.0f);
+
+    float dir[3] = { x, y, 1.0f - fabsf(x) - fabsf(y) };
+    const float fold = std::clamp(-dir[2], 0.0f, 1.0f);
+    dir[0] += dir[0] >= 0.0f ? -fold : fold;
+    dir[1] += dir[1] >= 0.0f ? -fold : fold;
+
+    const float len = sqrtf(dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2]);
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        pDir[i] = dir[i] / len;
+    }
+}
+
+// ================================================================================================================
+void CompactVertexData(const float* pPosData,
+                       const float* pNormalData,
+                       const float* pTangentData,
+                       const float* pTexCoordData,
+                       uint32_t     vertCnt,
+                       const float* pAabbMin,
+                       const float* pAabbMax,
+                       uint8_t*     pDst)
+{
+    // A flat axis quantizes to 0 and decodes back to its AABB min.
+    float posScales[3];
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        const float extent = pAabbMax[axis] - pAabbMin[axis];
+        posScales[axis] = extent > 0.0f ? 65535.0f / extent : 0.0f;
+    }
+
+    for (uint32_t i = 0; i < vertCnt; i++)
+    {
+        uint16_t pos[4];
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            const float unorm = (pPosData[i * 3 + axis] - pAabbMin[axis]) * posScales[axis];
+            pos[axis] = static_cast<uint16_t>(lroundf(std::clamp(unorm, 0.0f, 65535.0f)));
+        }
+        pos[3] = pTangentData[i * 4 + 3] < 0.0f ? 0 : 65535;
+
+        int16_t normal[2];
+        int16_t tangent[2];
+        EncodeOctahedral(&pNormalData[i * 3], normal);
+        EncodeOctahedral(&pTangentData[i * 4], tangent);
+
+        const uint16_t texCoord[2] = { FloatToHalf(pTexCoordData[i * 2]), FloatToHalf(pTexCoordData[i * 2 + 1]) };
+
+        uint8_t* pVert = pDst + static_cast<size_t>(i) * COMPACT_VERT_SIZE_BYTE;
+        memcpy(pVert, pos, sizeof(pos));
+        memcpy(pVert + 8, normal, sizeof(normal));
+        memcpy(pVert + 12, tangent, sizeof(tangent));
+        memcpy(pVert + 16, texCoord, sizeof(texCoord));
+    }
+}
+
+// ================================================================================================================
+void DecodeCompactVertexData(const uint8_t* pSrc, uint32_t vertCnt, const float* pAabbMin, const float* pAabbMax, float* pDst)
+{
+    for (uint32_t i = 0; i < vertCnt; i++)
+    {
+        const uint8_t* pVert = pSrc + static_cast<size_t>(i) * COMPACT_VERT_SIZE_BYTE;
+        uint16_t pos[4];
+        int16_t  normal[2];
+        int16_t  tangent[2];
+        uint16_t texCoord[2];
+        memcpy(pos, pVert, sizeof(pos));
+        memcpy(normal, pVert + 8, sizeof(normal));
+        memcpy(tangent, pVert + 12, sizeof(tangent));
+        memcpy(texCoord, pVert + 16, sizeof(texCoord));
+
+        float* pOut = pDst + static_cast<size_t>(i) * VERT_SIZE_FLOAT;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            pOut[axis] = pAabbMin[axis] + (pos[axis] / 65535.0f) * (pAabbMax[axis] - pAabbMin[axis]);
+        }
+        DecodeOctahedral(normal, pOut + 3);
+        DecodeOctahedral(tangent, pOut + 6);
+        pOut[9] = pos[3] != 0 ? 1.0f : -1.0f;
+        pOut[10] = HalfToFloat(texCoord[0]);
+        pOut[11] = HalfToFloat(texCoord[1]);
+    }
+}
+
+// ================================================================================================================
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt, uint32_t cacheSize)
+{
+    VertexCacheStats stats = { 0.0, 0.0 };
+    const uint32_t triCnt = idxCnt / 3;
+    if (triCnt == 0)
+    {
+        return stats;
+    }
+
+    FifoCacheSim         cache(vertCnt, cacheSize);
+    std::vector<uint8_t> isReferenced(vertCnt, 0);
+    uint32_t             missCnt = 0;
+    uint32_t             referencedCnt = 0;
+    for (uint32_t i = 0; i < triCnt * 3; i++)
+    {
+        const uint32_t vert = pIndices[i];
+        missCnt += cache.Access(vert) ? 1 : 0;
+        if (isReferenced[vert] == 0)
+        {
+            isReferenced[vert] = 1;
+            referencedCnt++;
+        }
+    }
+
+    stats.acmr = double(missCnt) / triCnt;
+    stats.atvr = double(missCnt) / referencedCnt;
+    return stats;
+}
+
+// ================================================================================================================
+void OptimizeVertexCache(uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt)
+{
+    const uint32_t triCnt = idxCnt / 3;
+    if (triCnt == 0)
+    {
+        return;
+    }
+
+    static const ForsythScoreTables tables;
+
+    // The triangles of each vertex. The first liveTriCnts[v] ones of its range aren't emitted yet.
+    std::vector<uint32_t> triOffsets(vertCnt + 1, 0);
+    for (uint32_t i = 0; i < triCnt * 3; i++)
+    {
+        triOffsets[pIndices[i] + 1]++;
+    }
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        triOffsets[v + 1] += triOffsets[v];
+    }
+
+    std::vector<uint32_t> vertTris(triCnt * 3);
+    std::vector<uint32_t> liveTriCnts(vertCnt, 0);
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t vert = pIndices[t * 3 + k];
+            vertTris[triOffsets[vert] + liveTriCnts[vert]++] = t;
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertCnt, -1);
+    std::vector<float>   vertScores(vertCnt);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        vertScores[v] = ForsythVertexScore(tables, -1, liveTriCnts[v]);
+    }
+
+    std::vector<float> triScores(triCnt);
+    int64_t            bestTri = -1;
+    float              bestScore = -FLT_MAX;
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        const uint32_t* pTri = &pIndices[t * 3];
+        triScores[t] = vertScores[pTri[0]] + vertScores[pTri[1]] + vertScores[pTri[2]];
+        if (triScores[t] > bestScore)
+        {
+            bestScore = triScores[t];
+            bestTri = t;
+        }
+    }
+
+    std::vector<uint8_t>  isTriEmitted(triCnt, 0);
+    std::vector<uint32_t> output(triCnt * 3);
+    uint32_t              cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t              cacheCnt = 0;
+    uint32_t              nextInputTri = 0;
+
+    for (uint32_t outTri = 0; outTri < triCnt; outTri++)
+    {
+        if (bestTri < 0)
+        {
+            // Nothing in the cache has triangles left. Go on with the first one left in the input order.
+            while (isTriEmitted[nextInputTri])
+            {
+                nextInputTri++;
+            }
+            bestTri = nextInputTri;
+        }
+
+        const uint32_t* pTri = &pIndices[bestTri * 3];
+        memcpy(&output[outTri * 3], pTri, sizeof(uint32_t) * 3);
+        isTriEmitted[bestTri] = 1;
+
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t vert = pTri[k];
+            uint32_t*      pVertTris = &vertTris[triOffsets[vert]];
+            for (uint32_t i = 0; i < liveTriCnts[vert]; i++)
+            {
+                if (pVertTris[i] == bestTri)
+                {
+                    pVertTris[i] = pVertTris[liveTriCnts[vert] - 1];
+                    liveTriCnts[vert]--;
+                    break;
+                }
+            }
+        }
+
+        // The triangle's vertices go to the front of the LRU cache.
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        uint32_t newCacheCnt = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            if (std::find(newCache, newCache + newCacheCnt, pTri[k]) == newCache + newCacheCnt)
+            {
+                newCache[newCacheCnt++] = pTri[k];
+            }
+        }
+        for (uint32_t i = 0; i < cacheCnt; i++)
+        {
+            if (cache[i] != pTri[0] && cache[i] != pTri[1] && cache[i] != pTri[2])
+            {
+                newCache[newCacheCnt++] = cache[i];
+            }
+        }
+
+        // Rescore the touched vertices and their triangles. The evicted ones first lose their cache score.
+        for (uint32_t i = 0; i < newCacheCnt; i++)
+        {
+            const uint32_t vert = newCache[i];
+            const int32_t  cachePos = i < FORSYTH_CACHE_SIZE ? int32_t(i) : -1;
+            cachePositions[vert] = cachePos;
+
+            const float score = ForsythVertexScore(tables, cachePos, liveTriCnts[vert]);
+            const float scoreDelta = score - vertScores[vert];
+            vertScores[vert] = score;
+
+            const uint32_t* pVertTris = &vertTris[triOffsets[vert]];
+            for (uint32_t j = 0; j < liveTriCnts[vert]; j++)
+            {
+                triScores[pVertTris[j]] += scoreDelta;
+            }
+        }
+
+        cacheCnt = std::min(newCacheCnt, FORSYTH_CACHE_SIZE);
+        memcpy(cache, newCache, sizeof(uint32_t) * cacheCnt);
+
+        // The next one is the best triangle using a cached vertex.
+        bestTri = -1;
+        bestScore = -FLT_MAX;
+        for (uint32_t i = 0; i < cacheCnt; i++)
+        {
+            const uint32_t  vert = cache[i];
+            const uint32_t* pVertTris = &vertTris[triOffsets[vert]];
+            for (uint32_t j = 0; j < liveTriCnts[vert]; j++)
+            {
+                if (triScores[pVertTris[j]] > bestScore)
+                {
+                    bestScore = triScores[pVertTris[j]];
+                    bestTri = pVertTris[j];
+                }
+            }
+        }
+    }
+
+    memcpy(pIndices, output.data(), sizeof(uint32_t) * triCnt * 3);
+}
+
+// ================================================================================================================
+void OptimizeOverdraw(uint32_t* pIndices, uint32_t idxCnt, const float* pPosData, uint32_t vertCnt, float threshold)
+{
+    const uint32_t triCnt = idxCnt / 3;
+    if (triCnt < 2)
+    {
+        return;
+    }
+
+    // The hard boundaries are where all three vertices miss, so the cache run starts over there anyway.
+    std::vector<uint32_t> triMisses(triCnt);
+    std::vector<uint32_t> hardStarts;
+    {
+        FifoCacheSim cache(vertCnt, VERTEX_CACHE_SIM_SIZE);
+        for (uint32_t t = 0; t < triCnt; t++)
+        {
+            triMisses[t] = 0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                triMisses[t] += cache.Access(pIndices[t * 3 + k]) ? 1 : 0;
+            }
+            if (triMisses[t] == 3)
+            {
+                hardStarts.push_back(t);
+            }
+        }
+    }
+    hardStarts.push_back(triCnt);
+
+    // The soft boundaries split a hard run once the cluster's ACMR, with a cold cache, is close enough to the run's.
+    std::vector<uint32_t> clusterStarts;
+    {
+        FifoCacheSim cache(vertCnt, VERTEX_CACHE_SIM_SIZE);
+        for (uint32_t h = 0; h + 1 < hardStarts.size(); h++)
+        {
+            const uint32_t runBegin = hardStarts[h];
+            const uint32_t runEnd = hardStarts[h + 1];
+            uint32_t       runMisses = 0;
+            for (uint32_t t = runBegin; t < runEnd; t++)
+            {
+                runMisses += triMisses[t];
+            }
+            const float maxAcmr = threshold * float(runMisses) / float(runEnd - runBegin);
+
+            cache.Flush();
+            uint32_t clusterBegin = runBegin;
+            uint32_t clusterMisses = 0;
+            clusterStarts.push_back(runBegin);
+            for (uint32_t t = runBegin; t < runEnd; t++)
+            {
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    clusterMisses += cache.Access(pIndices[t * 3 + k]) ? 1 : 0;
+                }
+
+                if (t + 1 < runEnd && float(clusterMisses) <= maxAcmr * float(t + 1 - clusterBegin))
+                {
+                    cache.Flush();
+                    clusterBegin = t + 1;
+                    clusterMisses = 0;
+                    clusterStarts.push_back(clusterBegin);
+                }
+            }
+        }
+    }
+    const uint32_t clusterCnt = uint32_t(clusterStarts.size());
+    clusterStarts.push_back(triCnt);
+
+    // The area weighted centroid and normal of each cluster.
+    std::vector<float> clusterData(clusterCnt * 7, 0.0f); // Centroid(3) + Normal(3) + Area(1).
+    float              meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float              meshArea = 0.0f;
+    for (uint32_t c = 0; c < clusterCnt; c++)
+    {
+        float* pCluster = &clusterData[c * 7];
+        for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const float* p0 = &pPosData[pIndices[t * 3] * 3];
+            const float* p1 = &pPosData[pIndices[t * 3 + 1] * 3];
+            const float* p2 = &pPosData[pIndices[t * 3 + 2] * 3];
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+                                 e1[2] * e2[0] - e1[0] * e2[2],
+                                 e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                pCluster[i] += (p0[i] + p1[i] + p2[i]) * (area / 3.0f);
+                pCluster[3 + i] += n[i];
+            }
+            pCluster[6] += area;
+        }
+
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            meshCentroid[i] += pCluster[i];
+        }
+        meshArea += pCluster[6];
+    }
+
+    if (meshArea <= 0.0f)
+    {
+        // All degenerate. There's no facing to sort by.
+        return;
+    }
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        meshCentroid[i] /= meshArea;
+    }
+
+    // Outward facing clusters, by their offset from the mesh center along their normal, are drawn first.
+    std::vector<float> sortKeys(clusterCnt, 0.0f);
+    for (uint32_t c = 0; c < clusterCnt; c++)
+    {
+        const float* pCluster = &clusterData[c * 7];
+        const float  normalLen = sqrtf(pCluster[3] * pCluster[3] + pCluster[4] * pCluster[4] + pCluster[5] * pCluster[5]);
+        if (pCluster[6] <= 0.0f || normalLen <= 0.0f)
+        {
+            continue;
+        }
+
+        float key = 0.0f;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            key += (pCluster[i] / pCluster[6] - meshCentroid[i]) * (pCluster[3 + i] / normalLen);
+        }
+        sortKeys[c] = key;
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCnt);
+    for (uint32_t c = 0; c < clusterCnt; c++)
+    {
+        clusterOrder[c] = c;
+    }
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(triCnt * 3);
+    for (uint32_t c : clusterOrder)
+    {
+        output.insert(output.end(), pIndices + clusterStarts[c] * 3, pIndices + clusterStarts[c + 1] * 3);
+    }
+    memcpy(pIndices, output.data(), sizeof(uint32_t) * triCnt * 3);
+}
+
+// ================================================================================================================
+uint32_t OptimizeVertexFetchRemap(uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt, std::vector<uint32_t>& oRemap)
+{
+    oRemap.assign(vertCnt, UINT32_MAX);
+    uint32_t newVertCnt = 0;
+    for (uint32_t i = 0; i < idxCnt; i++)
+    {
+        uint32_t& newVert = oRemap[pIndices[i]];
+        if (newVert == UINT32_MAX)
+        {
+            newVert = newVertCnt++;
+        }
+        pIndices[i] = newVert;
+    }
+    return newVertCnt;
+}
+
+// ================================================================================================================
+void RemapVertexStream(std::vector<float>& ioStream, uint32_t componentCnt, const std::vector<uint32_t>& remap, uint32_t newVertCnt)
+{
+    if (ioStream.empty())
+    {
+        return;
+    }
+
+    std::vector<float> remapped(size_t(newVertCnt) * componentCnt, 0.0f);
+    const size_t       oldVertCnt = std::min(remap.size(), ioStream.size() / componentCnt);
+    for (size_t v = 0; v < oldVertCnt; v++)
+    {
+        if (remap[v] != UINT32_MAX)
+        {
+            memcpy(&remapped[size_t(remap[v]) * componentCnt], &ioStream[v * componentCnt], sizeof(float) * componentCnt);
+        }
+    }
+    ioStream.swap(remapped);
+}
+
+// ================================================================================================================
+float SimplifyMesh(const uint32_t* pIndices,
+                   uint32_t        idxCnt,
+                   const float*    pPosData,
+                   const float*    pNormalData,
+                   const float*    pTexCoordData,
+                   uint32_t        vertCnt,
+                   uint32_t        targetIdxCnt,
+                   float           maxError,
+                   std::vector<uint32_t>& oIndices)
+{
+    const uint32_t triCnt = idxCnt / 3;
+    oIndices.assign(pIndices, pIndices + triCnt * 3);
+    if (triCnt * 3 <= targetIdxCnt || vertCnt == 0)
+    {
+        return 0.0f;
+    }
+
+    // The positions relative to the largest extent, so the errors don't depend on the mesh scale.
+    float aabbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float aabbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < vertCnt * 3; i++)
+    {
+        aabbMin[i % 3] = std::min(aabbMin[i % 3], pPosData[i]);
+        aabbMax[i % 3] = std::max(aabbMax[i % 3], pPosData[i]);
+    }
+    const float extent = std::max({ aabbMax[0] - aabbMin[0], aabbMax[1] - aabbMin[1], aabbMax[2] - aabbMin[2] });
+    if (extent <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    std::vector<double> positions(size_t(vertCnt) * 3);
+    for (uint32_t i = 0; i < vertCnt * 3; i++)
+    {
+        positions[i] = double(pPosData[i] - aabbMin[i % 3]) / extent;
+    }
+
+    std::vector<uint8_t> isReferenced(vertCnt, 0);
+    for (uint32_t i = 0; i < triCnt * 3; i++)
+    {
+        isReferenced[pIndices[i]] = 1;
+    }
+
+    // Weld the referenced vertices by the position, then by the attributes within each position. The topology and the
+    // quadrics live on the first vertex of each position, and the triangles refer to the first vertex of each wedge.
+    struct SortedVert
+    {
+        float    pos[3];
+        uint32_t vert;
+    };
+    std::vector<SortedVert> sortedVerts(vertCnt);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        sortedVerts[v] = { { pPosData[v * 3], pPosData[v * 3 + 1], pPosData[v * 3 + 2] }, v };
+    }
+    std::sort(sortedVerts.begin(), sortedVerts.end(), [](const SortedVert& a, const SortedVert& b) {
+        return std::lexicographical_compare(a.pos, a.pos + 3, b.pos, b.pos + 3);
+    });
+
+    const float creaseCos = cosf(SIMPLIFY_CREASE_DEGREES * 3.14159265f / 180.0f);
+    const float texCoordEpsilon = 1e-6f;
+    std::vector<uint32_t> posVerts(vertCnt);
+    std::vector<uint32_t> wedgeVerts(vertCnt);
+    std::vector<uint8_t>  isLocked(vertCnt, 0);
+    std::vector<uint32_t> posWedges;
+    for (uint32_t runBegin = 0; runBegin < vertCnt;)
+    {
+        uint32_t runEnd = runBegin + 1;
+        while (runEnd < vertCnt && memcmp(sortedVerts[runEnd].pos, sortedVerts[runBegin].pos, sizeof(float) * 3) == 0)
+        {
+            runEnd++;
+        }
+
+        posWedges.clear();
+        for (uint32_t i = runBegin; i < runEnd; i++)
+        {
+            const uint32_t vert = sortedVerts[i].vert;
+            posVerts[vert] = sortedVerts[runBegin].vert;
+            wedgeVerts[vert] = vert;
+            if (!isReferenced[vert])
+            {
+                continue;
+            }
+
+            for (uint32_t wedge : posWedges)
+            {
+                bool isSame = true;
+                if (pTexCoordData)
+                {
+                    isSame = fabsf(pTexCoordData[vert * 2] - pTexCoordData[wedge * 2]) <= texCoordEpsilon &&
+                             fabsf(pTexCoordData[vert * 2 + 1] - pTexCoordData[wedge * 2 + 1]) <= texCoordEpsilon;
+                }
+                if (isSame && pNormalData)
+                {
+                    const float* pN0 = pNormalData + vert * 3;
+                    const float* pN1 = pNormalData + wedge * 3;
+                    const float  dot = pN0[0] * pN1[0] + pN0[1] * pN1[1] + pN0[2] * pN1[2];
+                    const float  lenSq = (pN0[0] * pN0[0] + pN0[1] * pN0[1] + pN0[2] * pN0[2]) *
+                                         (pN1[0] * pN1[0] + pN1[1] * pN1[1] + pN1[2] * pN1[2]);
+                    isSame = dot > 0.0f && dot * dot >= creaseCos * creaseCos * lenSq;
+                }
+                if (isSame)
+                {
+                    wedgeVerts[vert] = wedge;
+                    break;
+                }
+            }
+            if (wedgeVerts[vert] == vert)
+            {
+                posWedges.push_back(vert);
+            }
+        }
+
+        // A seam stays in place.
+        if (posWedges.size() > 1)
+        {
+            isLocked[sortedVerts[runBegin].vert] = 1;
+        }
+        runBegin = runEnd;
+    }
+
+    std::vector<uint32_t> tris(triCnt * 3);
+    std::vector<uint8_t>  isTriAlive(triCnt, 1);
+    uint32_t liveTriCnt = 0;
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            tris[t * 3 + k] = wedgeVerts[pIndices[t * 3 + k]];
+        }
+        const uint32_t p0 = posVerts[tris[t * 3]];
+        const uint32_t p1 = posVerts[tris[t * 3 + 1]];
+        const uint32_t p2 = posVerts[tris[t * 3 + 2]];
+        if (p0 == p1 || p1 == p2 || p2 == p0)
+        {
+            isTriAlive[t] = 0;
+            continue;
+        }
+        liveTriCnt++;
+    }
+
+    // Lock the ends of the edges that aren't shared by exactly two triangles in the opposite directions.
+    std::vector<uint64_t> edgeKeys;
+    edgeKeys.reserve(size_t(liveTriCnt) * 3);
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        if (!isTriAlive[t])
+        {
+            continue;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t a = posVerts[tris[t * 3 + k]];
+            const uint32_t b = posVerts[tris[t * 3 + (k + 1) % 3]];
+            // The lowest bit is the direction.
+            edgeKeys.push_back((uint64_t(std::min(a, b)) << 33) | (uint64_t(std::max(a, b)) << 1) | (a < b ? 1 : 0));
+        }
+    }
+    std::sort(edgeKeys.begin(), edgeKeys.end());
+    for (size_t runBegin = 0; runBegin < edgeKeys.size();)
+    {
+        size_t runEnd = runBegin + 1;
+        while (runEnd < edgeKeys.size() && (edgeKeys[runEnd] >> 1) == (edgeKeys[runBegin] >> 1))
+        {
+            runEnd++;
+        }
+        if (runEnd - runBegin != 2 || (edgeKeys[runBegin] & 1) == (edgeKeys[runBegin + 1] & 1))
+        {
+            isLocked[uint32_t(edgeKeys[runBegin] >> 33)] = 1;
+            isLocked[uint32_t((edgeKeys[runBegin] >> 1) & 0xffffffff)] = 1;
+        }
+        runBegin = runEnd;
+    }
+
+    // The triangles around each position, and the quadrics of their planes.
+    std::vector<uint32_t> vertTriCnts(vertCnt, 0);
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        for (uint32_t k = 0; isTriAlive[t] && k < 3; k++)
+        {
+            vertTriCnts[posVerts[tris[t * 3 + k]]]++;
+        }
+    }
+    std::vector<std::vector<uint32_t>> vertTris(vertCnt);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        vertTris[v].reserve(vertTriCnts[v]);
+    }
+    std::vector<Quadric> quadrics(vertCnt, Quadric{});
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        if (!isTriAlive[t])
+        {
+            continue;
+        }
+
+        const uint32_t p0 = posVerts[tris[t * 3]];
+        const uint32_t p1 = posVerts[tris[t * 3 + 1]];
+        const uint32_t p2 = posVerts[tris[t * 3 + 2]];
+        double normal[3];
+        TriangleNormal(&positions[p0 * 3], &positions[p1 * 3], &positions[p2 * 3], normal);
+        const double normalLen = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (normalLen > 0.0)
+        {
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                normal[i] /= normalLen;
+            }
+            const double offset = -(normal[0] * positions[p0 * 3] + normal[1] * positions[p0 * 3 + 1] + normal[2] * positions[p0 * 3 + 2]);
+            for (uint32_t p : { p0, p1, p2 })
+            {
+                quadrics[p].AddPlane(normal, offset, 0.5 * normalLen);
+            }
+        }
+
+        vertTris[p0].push_back(t);
+        vertTris[p1].push_back(t);
+        vertTris[p2].push_back(t);
+    }
+
+    std::vector<uint32_t> versions(vertCnt, 0);
+    std::vector<uint8_t>  isRemoved(vertCnt, 0);
+    std::priority_queue<EdgeCollapse, std::vector<EdgeCollapse>, std::greater<EdgeCollapse>> collapses;
+    auto pushEdge = [&](uint32_t a, uint32_t b)
+    {
+        Quadric merged = quadrics[a];
+        merged.Add(quadrics[b]);
+        EdgeCollapse collapse = { DBL_MAX, 0, 0, 0, 0 };
+        if (!isLocked[a])
+        {
+            collapse = { merged.Error(&positions[b * 3]), a, b, versions[a], versions[b] };
+        }
+        if (!isLocked[b])
+        {
+            const double error = merged.Error(&positions[a * 3]);
+            if (error < collapse.error)
+            {
+                collapse = { error, b, a, versions[b], versions[a] };
+            }
+        }
+        if (collapse.error != DBL_MAX)
+        {
+            collapses.push(collapse);
+        }
+    };
+
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        if (!isTriAlive[t])
+        {
+            continue;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            // The other triangle on the edge has it the other way around.
+            const uint32_t a = posVerts[tris[t * 3 + k]];
+            const uint32_t b = posVerts[tris[t * 3 + (k + 1) % 3]];
+            if (a < b)
+            {
+                pushEdge(a, b);
+            }
+        }
+    }
+
+    // Marks the neighbors of a position. Each use takes two new values, so the array is never cleared.
+    std::vector<uint32_t> neighborMarks(vertCnt, 0);
+    uint32_t markBase = 0;
+    const double errorLimit = double(maxError) * maxError;
+    double collapsedError = 0.0;
+    while (liveTriCnt * 3 > targetIdxCnt && !collapses.empty())
+    {
+        const EdgeCollapse collapse = collapses.top();
+        collapses.pop();
+        const uint32_t from = collapse.fromVert;
+        const uint32_t to = collapse.toVert;
+        if (isRemoved[from] || isRemoved[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion)
+        {
+            continue;
+        }
+        if (collapse.error > errorLimit)
+        {
+            break;
+        }
+
+        std::vector<uint32_t>& fromTris = vertTris[from];
+        fromTris.erase(std::remove_if(fromTris.begin(), fromTris.end(), [&isTriAlive](uint32_t t) { return !isTriAlive[t]; }),
+                       fromTris.end());
+
+        // The edge's triangles pick the wedge of the toVert that the others move to. A position between two wedges of
+        // a seam can't move onto it.
+        markBase += 2;
+        uint32_t toWedge = UINT32_MAX;
+        uint32_t edgeTriCnt = 0;
+        bool isValid = true;
+        for (uint32_t t : fromTris)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t p = posVerts[tris[t * 3 + k]];
+                if (p == to)
+                {
+                    isValid &= (toWedge == UINT32_MAX || toWedge == tris[t * 3 + k]);
+                    toWedge = tris[t * 3 + k];
+                    edgeTriCnt++;
+                }
+                else if (p != from)
+                {
+                    neighborMarks[p] = markBase;
+                }
+            }
+        }
+        if (!isValid || edgeTriCnt == 0)
+        {
+            continue;
+        }
+
+        // The link condition. More shared neighbors than the edge's triangles would pinch the surface.
+        uint32_t sharedNeighborCnt = 0;
+        for (uint32_t t : vertTris[to])
+        {
+            if (!isTriAlive[t])
+            {
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t p = posVerts[tris[t * 3 + k]];
+                if (neighborMarks[p] == markBase)
+                {
+                    neighborMarks[p] = markBase + 1;
+                    sharedNeighborCnt++;
+                }
+            }
+        }
+        if (sharedNeighborCnt > edgeTriCnt)
+        {
+            continue;
+        }
+
+        // No moved triangle may flip or collapse to a line.
+        for (uint32_t t = 0; isValid && t < fromTris.size(); t++)
+        {
+            const uint32_t* pTri = &tris[fromTris[t] * 3];
+            double oldPos[3][3];
+            double newPos[3][3];
+            bool hasTo = false;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t p = posVerts[pTri[k]];
+                hasTo |= (p == to);
+                memcpy(oldPos[k], &positions[p * 3], sizeof(double) * 3);
+                memcpy(newPos[k], &positions[(p == from ? to : p) * 3], sizeof(double) * 3);
+            }
+            if (hasTo)
+            {
+                continue;
+            }
+
+            double oldNormal[3];
+            double newNormal[3];
+            TriangleNormal(oldPos[0], oldPos[1], oldPos[2], oldNormal);
+            TriangleNormal(newPos[0], newPos[1], newPos[2], newNormal);
+            isValid = oldNormal[0] * newNormal[0] + oldNormal[1] * newNormal[1] + oldNormal[2] * newNormal[2] > 0.0;
+        }
+        if (!isValid)
+        {
+            continue;
+        }
+
+        // Collapse. The edge's triangles go away and the others move to the toVert.
+        for (uint32_t t : fromTris)
+        {
+            uint32_t* pTri = &tris[t * 3];
+            if (posVerts[pTri[0]] == to || posVerts[pTri[1]] == to || posVerts[pTri[2]] == to)
+            {
+                isTriAlive[t] = 0;
+                liveTriCnt--;
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                if (posVerts[pTri[k]] == from)
+                {
+                    pTri[k] = toWedge;
+                }
+            }
+            vertTris[to].push_back(t);
+        }
+        fromTris = std::vector<uint32_t>();
+        quadrics[to].Add(quadrics[from]);
+        isRemoved[from] = 1;
+        versions[to]++;
+        collapsedError = std::max(collapsedError, collapse.error);
+
+        // The toVert's edges cost more now.
+        markBase += 2;
+        for (uint32_t t : vertTris[to])
+        {
+            if (!isTriAlive[t])
+            {
+                continue;
+            }
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t p = posVerts[tris[t * 3 + k]];
+                if (p != to && neighborMarks[p] != markBase)
+                {
+                    neighborMarks[p] = markBase;
+                    pushEdge(p, to);
+                }
+            }
+        }
+    }
+
+    oIndices.clear();
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        if (isTriAlive[t])
+        {
+            oIndices.insert(oIndices.end(), &tris[t * 3], &tris[t * 3 + 3]);
+        }
+    }
+    return static_cast<float>(sqrt(collapsedError));
+}
+
+// ================================================================================================================
+void BuildMeshlets(uint32_t*              pIndices,
+                   uint32_t               idxCnt,
+                   const float*           pPosData,
+                   uint32_t               vertCnt,
+                   std::vector<Meshlet>&  oMeshlets,
+                   std::vector<uint32_t>& oMeshletVerts,
+                   std::vector<uint8_t>&  oMeshletTris)
+{
+    oMeshlets.clear();
+    oMeshletVerts.clear();
+    oMeshletTris.clear();
+
+    const uint32_t triCnt = idxCnt / 3;
+    if (triCnt == 0)
+    {
+        return;
+    }
+
+    // The triangles around each vertex.
+    std::vector<uint32_t> vertTriOffsets(vertCnt + 1, 0);
+    for (uint32_t i = 0; i < triCnt * 3; i++)
+    {
+        vertTriOffsets[pIndices[i] + 1]++;
+    }
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        vertTriOffsets[v + 1] += vertTriOffsets[v];
+    }
+    std::vector<uint32_t> vertTris(triCnt * 3);
+    {
+        std::vector<uint32_t> cursors(vertTriOffsets.begin(), vertTriOffsets.end() - 1);
+        for (uint32_t i = 0; i < triCnt * 3; i++)
+        {
+            vertTris[cursors[pIndices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<float> triCentroids(triCnt * 3);
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            triCentroids[t * 3 + k] = (pPosData[pIndices[t * 3] * 3 + k] + pPosData[pIndices[t * 3 + 1] * 3 + k] +
+                                       pPosData[pIndices[t * 3 + 2] * 3 + k]) / 3.0f;
+        }
+    }
+
+    std::vector<uint8_t>  isTriUsed(triCnt, 0);
+    std::vector<uint8_t>  localVerts(vertCnt, MESHLET_NO_LOCAL_VERT);
+    std::vector<uint32_t> candidateMarks(triCnt, 0); // The meshlet count plus 1 once it's the current one's candidate.
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> triOrder;
+    triOrder.reserve(triCnt);
+    oMeshletTris.reserve(triCnt * 3);
+
+    Meshlet meshlet = { 0, 0, 0, 0 };
+    float vertPosSum[3] = { 0.0f, 0.0f, 0.0f };
+    uint32_t firstUnusedTri = 0;
+
+    auto newVertCnt = [&](uint32_t t)
+    {
+        return static_cast<uint32_t>(localVerts[pIndices[t * 3]] == MESHLET_NO_LOCAL_VERT) +
+               static_cast<uint32_t>(localVerts[pIndices[t * 3 + 1]] == MESHLET_NO_LOCAL_VERT) +
+               static_cast<uint32_t>(localVerts[pIndices[t * 3 + 2]] == MESHLET_NO_LOCAL_VERT);
+    };
+
+    auto closeMeshlet = [&]()
+    {
+        for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+        {
+            localVerts[oMeshletVerts[meshlet.vertOffset + i]] = MESHLET_NO_LOCAL_VERT;
+        }
+        oMeshlets.push_back(meshlet);
+        meshlet = { static_cast<uint32_t>(oMeshletVerts.size()), static_cast<uint32_t>(triOrder.size()), 0, 0 };
+        vertPosSum[0] = vertPosSum[1] = vertPosSum[2] = 0.0f;
+        candidates.clear();
+    };
+
+    while (triOrder.size() < triCnt)
+    {
+        // The connected triangle with the fewest new vertices. On a tie, the one found first, which is the nearest to
+        // where the meshlet started, so it grows round.
+        uint32_t bestTri = UINT32_MAX;
+        uint32_t bestNewVertCnt = UINT32_MAX;
+        uint32_t keptCandidateCnt = 0;
+        for (uint32_t t : candidates)
+        {
+            if (isTriUsed[t])
+            {
+                continue;
+            }
+            candidates[keptCandidateCnt++] = t;
+
+            const uint32_t newCnt = newVertCnt(t);
+            if (meshlet.vertCnt + newCnt > MESHLET_MAX_VERT_CNT)
+            {
+                continue;
+            }
+            if (newCnt < bestNewVertCnt)
+            {
+                bestTri = t;
+                bestNewVertCnt = newCnt;
+            }
+        }
+        candidates.resize(keptCandidateCnt);
+
+        if (bestTri == UINT32_MAX)
+        {
+            while (isTriUsed[firstUnusedTri])
+            {
+                firstUnusedTri++;
+            }
+
+            float bestDistSq = FLT_MAX;
+            const uint32_t searchEnd = std::min(triCnt, firstUnusedTri + MESHLET_SEED_SEARCH_CNT);
+            for (uint32_t t = firstUnusedTri; t < searchEnd; t++)
+            {
+                if (isTriUsed[t])
+                {
+                    continue;
+                }
+                if (meshlet.vertCnt == 0)
+                {
+                    bestTri = t;
+                    break;
+                }
+                if (meshlet.vertCnt + newVertCnt(t) > MESHLET_MAX_VERT_CNT)
+                {
+                    continue;
+                }
+
+                float distSq = 0.0f;
+                for (uint32_t k = 0; k < 3; k++)
+                {
+                    const float d = triCentroids[t * 3 + k] - vertPosSum[k] / meshlet.vertCnt;
+                    distSq += d * d;
+                }
+                if (distSq < bestDistSq)
+                {
+                    bestDistSq = distSq;
+                    bestTri = t;
+                }
+            }
+        }
+
+        if (bestTri == UINT32_MAX)
+        {
+            closeMeshlet();
+            continue;
+        }
+
+        isTriUsed[bestTri] = 1;
+        triOrder.push_back(bestTri);
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t v = pIndices[bestTri * 3 + k];
+            if (localVerts[v] == MESHLET_NO_LOCAL_VERT)
+            {
+                localVerts[v] = static_cast<uint8_t>(meshlet.vertCnt++);
+                oMeshletVerts.push_back(v);
+                vertPosSum[0] += pPosData[v * 3];
+                vertPosSum[1] += pPosData[v * 3 + 1];
+                vertPosSum[2] += pPosData[v * 3 + 2];
+            }
+            oMeshletTris.push_back(localVerts[v]);
+
+            for (uint32_t i = vertTriOffsets[v]; i < vertTriOffsets[v + 1]; i++)
+            {
+                const uint32_t t = vertTris[i];
+                if (!isTriUsed[t] && candidateMarks[t] != oMeshlets.size() + 1)
+                {
+                    candidateMarks[t] = static_cast<uint32_t>(oMeshlets.size() + 1);
+                    candidates.push_back(t);
+                }
+            }
+        }
+        meshlet.triCnt++;
+
+        if (meshlet.triCnt == MESHLET_MAX_TRI_CNT)
+        {
+            closeMeshlet();
+        }
+    }
+    if (meshlet.triCnt > 0)
+    {
+        closeMeshlet();
+    }
+
+    std::vector<uint32_t> srcIndices(pIndices, pIndices + triCnt * 3);
+    for (uint32_t i = 0; i < triCnt; i++)
+    {
+        memcpy(&pIndices[i * 3], &srcIndices[triOrder[i] * 3], 3 * sizeof(uint32_t));
+    }
+}
+
+// ================================================================================================================
+void ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* pMeshletVerts, const uint8_t* pMeshletTris, const float* pPosData, MeshletBounds& oBounds)
+{
+    const uint32_t* pVerts = &pMeshletVerts[meshlet.vertOffset];
+    const uint8_t* pTris = &pMeshletTris[meshlet.triOffset * 3];
+
+    float boxMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boxMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            boxMin[k] = std::min(boxMin[k], pPosData[pVerts[i] * 3 + k]);
+            boxMax[k] = std::max(boxMax[k], pPosData[pVerts[i] * 3 + k]);
+        }
+    }
+
+    double center[3];
+    double radiusSq = 0.0;
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        // The radius is measured from the float center that's stored.
+        center[k] = static_cast<float>(0.5 * (static_cast<double>(boxMin[k]) + boxMax[k]));
+    }
+    for (uint32_t i = 0; i < meshlet.vertCnt; i++)
+    {
+        const float* pPos = &pPosData[pVerts[i] * 3];
+        const double d[3] = { pPos[0] - center[0], pPos[1] - center[1], pPos[2] - center[2] };
+        radiusSq = std::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+    }
+
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        oBounds.center[k] = static_cast<float>(center[k]);
+        oBounds.coneApex[k] = static_cast<float>(center[k]);
+        oBounds.coneAxis[k] = 0.0f;
+    }
+    // Round up, so the float sphere still holds the vertices.
+    oBounds.radius = static_cast<float>(sqrt(radiusSq)) * (1.0f + FLT_EPSILON * 4.0f);
+    oBounds.coneAxis[2] = 1.0f;
+    oBounds.coneCutoff = 2.0f;
+
+    // The unit normals. The degenerate triangles don't rasterize, so they don't count.
+    std::vector<double> triNormals(meshlet.triCnt * 3, 0.0);
+    std::vector<uint8_t> hasNormal(meshlet.triCnt, 0);
+    double axis[3] = { 0.0, 0.0, 0.0 };
+    for (uint32_t t = 0; t < meshlet.triCnt; t++)
+    {
+        double triPos[3][3];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                triPos[i][k] = pPosData[pVerts[pTris[t * 3 + i]] * 3 + k];
+            }
+        }
+        double* pNormal = &triNormals[t * 3];
+        TriangleNormal(triPos[0], triPos[1], triPos[2], pNormal);
+        const double len = sqrt(pNormal[0] * pNormal[0] + pNormal[1] * pNormal[1] + pNormal[2] * pNormal[2]);
+        if (len <= 0.0)
+        {
+            continue;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            pNormal[k] /= len;
+            axis[k] += pNormal[k];
+        }
+        hasNormal[t] = 1;
+    }
+
+    const double axisLen = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (axisLen <= 0.0)
+    {
+        return;
+    }
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        axis[k] /= axisLen;
+    }
+
+    double minDot = 1.0;
+    for (uint32_t t = 0; t < meshlet.triCnt; t++)
+    {
+        if (hasNormal[t])
+        {
+            const double* pNormal = &triNormals[t * 3];
+            minDot = std::min(minDot, axis[0] * pNormal[0] + axis[1] * pNormal[1] + axis[2] * pNormal[2]);
+        }
+    }
+    if (minDot <= MESHLET_CONE_MIN_DOT)
+    {
+        return;
+    }
+
+    // Slide the apex back along the axis until it's behind every triangle's plane. A view in the cone then sees the
+    // back of each triangle, since no normal is more than 90 degrees from the cone's directions.
+    double maxT = 0.0;
+    for (uint32_t t = 0; t < meshlet.triCnt; t++)
+    {
+        if (hasNormal[t])
+        {
+            const double* pNormal = &triNormals[t * 3];
+            const float* pPos0 = &pPosData[pVerts[pTris[t * 3]] * 3];
+            const double toCenterDot = (center[0] - pPos0[0]) * pNormal[0] + (center[1] - pPos0[1]) * pNormal[1] +
+                                       (center[2] - pPos0[2]) * pNormal[2];
+            const double axisDot = axis[0] * pNormal[0] + axis[1] * pNormal[1] + axis[2] * pNormal[2];
+            maxT = std::max(maxT, toCenterDot / axisDot);
+        }
+    }
+
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        oBounds.coneApex[k] = static_cast<float>(center[k] - axis[k] * maxT);
+        oBounds.coneAxis[k] = static_cast<float>(axis[k]);
+    }
+    oBounds.coneCutoff = static_cast<float>(sqrt(1.0 - minDot * minDot));
+}
+
+// ================================================================================================================
+uint32_t GenerateNormals(uint32_t*              pIndices,
+                         uint32_t               idxCnt,
+                         const float*           pPosData,
+                         uint32_t               vertCnt,
+                         float                  creaseDegrees,
+                         std::vector<float>&    oNormalData,
+                         std::vector<uint32_t>& oSrcVerts)
+{
+    const uint32_t triCnt = idxCnt / 3;
+    oSrcVerts.resize(vertCnt);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        oSrcVerts[v] = v;
+    }
+
+    // The unreferenced vertices keep the fallback.
+    oNormalData.resize(size_t(vertCnt) * 3);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        oNormalData[v * 3] = 0.0f;
+        oNormalData[v * 3 + 1] = 0.0f;
+        oNormalData[v * 3 + 2] = 1.0f;
+    }
+    if (triCnt == 0)
+    {
+        return vertCnt;
+    }
+
+    // The smoothing goes across the texture seams, so only the positions weld.
+    std::vector<uint32_t> weldVerts;
+    const uint32_t posComponentCnt = 3;
+    WeldEqualVertices(&pPosData, &posComponentCnt, 1, vertCnt, weldVerts);
+
+    // Each corner's share of its face normal, weighted by the corner angle. A triangle without an area has a zero normal,
+    // so it joins no smooth group.
+    std::vector<float>   faceNormals(size_t(triCnt) * 3);
+    std::vector<float>   cornerNormals(size_t(triCnt) * 9);
+    std::vector<uint8_t> triFlags(triCnt);
+    JobSystem::ParallelFor(0, triCnt, VERT_FRAME_TRI_GRAIN_SIZE, [&](uint32_t triBegin, uint32_t triEnd)
+    {
+        for (uint32_t t = triBegin; t < triEnd; t++)
+        {
+            const uint32_t* pTri = &pIndices[t * 3];
+            triFlags[t] = (weldVerts[pTri[0]] == weldVerts[pTri[1]] || weldVerts[pTri[1]] == weldVerts[pTri[2]] ||
+                           weldVerts[pTri[2]] == weldVerts[pTri[0]]) ? TRI_DEGENERATE : 0;
+
+            const float* pCornerPos[3] = { &pPosData[pTri[0] * 3], &pPosData[pTri[1] * 3], &pPosData[pTri[2] * 3] };
+            double faceNormal[3];
+            const double pos[3][3] = { { pCornerPos[0][0], pCornerPos[0][1], pCornerPos[0][2] },
+                                       { pCornerPos[1][0], pCornerPos[1][1], pCornerPos[1][2] },
+                                       { pCornerPos[2][0], pCornerPos[2][1], pCornerPos[2][2] } };
+            TriangleNormal(pos[0], pos[1], pos[2], faceNormal);
+            const double faceNormalLen = sqrt(faceNormal[0] * faceNormal[0] + faceNormal[1] * faceNormal[1] + faceNormal[2] * faceNormal[2]);
+
+            // A sliver thinner than the rounding of its float positions has no reliable side, and its wide corners would
+            // outweigh its neighbors, so it counts as having no area.
+            double maxCoord = 0.0;
+            double maxEdgeLenSq = 0.0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const double* pNextPos = pos[(k + 1) % 3];
+                const double edge[3] = { pNextPos[0] - pos[k][0], pNextPos[1] - pos[k][1], pNextPos[2] - pos[k][2] };
+                maxEdgeLenSq = std::max(maxEdgeLenSq, edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+                maxCoord = std::max({ maxCoord, fabs(pos[k][0]), fabs(pos[k][1]), fabs(pos[k][2]) });
+            }
+            const bool hasArea = faceNormalLen > NORMAL_SLIVER_EPSILON * maxCoord * sqrt(maxEdgeLenSq);
+
+            float* pFaceNormal = &faceNormals[size_t(t) * 3];
+            for (uint32_t i = 0; i < 3; i++)
+            {
+                pFaceNormal[i] = hasArea ? static_cast<float>(faceNormal[i] / faceNormalLen) : 0.0f;
+            }
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const float* pPos = pCornerPos[k];
+                const float* pNextPos = pCornerPos[(k + 1) % 3];
+                const float* pPrevPos = pCornerPos[(k + 2) % 3];
+                const float e1[3] = { pNextPos[0] - pPos[0], pNextPos[1] - pPos[1], pNextPos[2] - pPos[2] };
+                const float e2[3] = { pPrevPos[0] - pPos[0], pPrevPos[1] - pPos[1], pPrevPos[2] - pPos[2] };
+                const float lenSq = (e1[0] * e1[0] + e1[1] * e1[1] + e1[2] * e1[2]) * (e2[0] * e2[0] + e2[1] * e2[1] + e2[2] * e2[2]);
+                const float cosAngle = lenSq > FLT_MIN ? (e1[0] * e2[0] + e1[1] * e2[1] + e1[2] * e2[2]) / sqrtf(lenSq) : 1.0f;
+                const float angle = acosf(std::clamp(cosAngle, -1.0f, 1.0f));
+
+                float* pCornerNormal = &cornerNormals[size_t(t) * 9 + k * 3];
+                pCornerNormal[0] = pFaceNormal[0] * angle;
+                pCornerNormal[1] = pFaceNormal[1] * angle;
+                pCornerNormal[2] = pFaceNormal[2] * angle;
+            }
+        }
+    });
+
+    // The smooth groups are the corners connected over the edges whose faces bend less than the crease angle.
+    VertexFans fans;
+    BuildVertexFans(pIndices, triFlags, weldVerts, fans);
+    const float creaseCos = cosf(std::clamp(creaseDegrees, 0.0f, 180.0f) * 3.14159265f / 180.0f);
+    std::vector<uint32_t> cornerGroups;
+    GroupFanCorners(pIndices, weldVerts, fans, [&faceNormals, creaseCos](uint32_t outCorner, uint32_t inCorner)
+    {
+        const float* pN0 = &faceNormals[size_t(outCorner / 3) * 3];
+        const float* pN1 = &faceNormals[size_t(inCorner / 3) * 3];
+        return pN0[0] * pN1[0] + pN0[1] * pN1[1] + pN0[2] * pN1[2] >= creaseCos;
+    }, cornerNormals, cornerGroups);
+
+    std::vector<uint32_t> vertGroups;
+    SplitVertexGroups(pIndices, cornerGroups, cornerNormals, oSrcVerts, vertGroups);
+
+    const uint32_t newVertCnt = static_cast<uint32_t>(oSrcVerts.size());
+    oNormalData.resize(size_t(newVertCnt) * 3);
+    JobSystem::ParallelFor(0, newVertCnt, VERT_FRAME_VERT_GRAIN_SIZE, [&](uint32_t vertBegin, uint32_t vertEnd)
+    {
+        for (uint32_t v = vertBegin; v < vertEnd; v++)
+        {
+            // A vertex only on the degenerate triangles, like a pole of a UV sphere, takes a group of its position.
+            uint32_t group = vertGroups[v];
+            if (group == UINT32_MAX && fans.offsets[weldVerts[v]] != fans.offsets[weldVerts[v] + 1])
+            {
+                group = cornerGroups[fans.corners[fans.offsets[weldVerts[v]]]];
+            }
+            if (group == UINT32_MAX)
+            {
+                continue;
+            }
+
+            const float* pSum = &cornerNormals[size_t(group) * 3];
+            const float len = sqrtf(pSum[0] * pSum[0] + pSum[1] * pSum[1] + pSum[2] * pSum[2]);
+            if (len > FLT_MIN)
+            {
+                oNormalData[size_t(v) * 3] = pSum[0] / len;
+                oNormalData[size_t(v) * 3 + 1] = pSum[1] / len;
+                oNormalData[size_t(v) * 3 + 2] = pSum[2] / len;
+            }
+        }
+    });
+    return newVertCnt;
+}
+
+// ================================================================================================================
+uint32_t GenerateTangents(uint32_t*              pIndices,
+                          uint32_t               idxCnt,
+                          const float*           pPosData,
+                          const float*           pNormalData,
+                          const float*           pTexCoordData,
+                          uint32_t               vertCnt,
+                          std::vector<float>&    oTangentData,
+                          std::vector<uint32_t>& oSrcVerts)
+{
+    const uint32_t triCnt = idxCnt / 3;
+    oSrcVerts.resize(vertCnt);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        oSrcVerts[v] = v;
+    }
+
+    // The unreferenced vertices keep the fallback.
+    oTangentData.resize(size_t(vertCnt) * 4);
+    for (uint32_t v = 0; v < vertCnt; v++)
+    {
+        PerpendicularTangent(&pNormalData[v * 3], &oTangentData[v * 4]);
+        oTangentData[v * 4 + 3] = 1.0f;
+    }
+    if (triCnt == 0)
+    {
+        return vertCnt;
+    }
+
+    // Weld the equal vertices, like the MikkTSpace does.
+    std::vector<uint32_t> weldVerts;
+    const float* const weldStreams[3] = { pPosData, pNormalData, pTexCoordData };
+    const uint32_t weldComponentCnts[3] = { 3, 3, 2 };
+    WeldEqualVertices(weldStreams, weldComponentCnts, 3, vertCnt, weldVerts);
+
+    // Each corner's share of the triangle's texture u direction. The triangles with a zero texture area only connect
+    // their neighbors, and the ones with two corners on the same vertex are left out.
+    std::vector<float>   cornerTangents(size_t(triCnt) * 9);
+    std::vector<uint8_t> triFlags(triCnt);
+    JobSystem::ParallelFor(0, triCnt, VERT_FRAME_TRI_GRAIN_SIZE, [&](uint32_t triBegin, uint32_t triEnd)
+    {
+        for (uint32_t t = triBegin; t < triEnd; t++)
+        {
+            const uint32_t* pTri = &pIndices[t * 3];
+            uint8_t flags = 0;
+            if (weldVerts[pTri[0]] == weldVerts[pTri[1]] || weldVerts[pTri[1]] == weldVerts[pTri[2]] ||
+                weldVerts[pTri[2]] == weldVerts[pTri[0]])
+            {
+                flags |= TRI_DEGENERATE;
+            }
+
+            const float* pP0 = &pPosData[pTri[0] * 3];
+            const float* pP1 = &pPosData[pTri[1] * 3];
+            const float* pP2 = &pPosData[pTri[2] * 3];
+            const float* pT0 = &pTexCoordData[pTri[0] * 2];
+            const float* pT1 = &pTexCoordData[pTri[1] * 2];
+            const float* pT2 = &pTexCoordData[pTri[2] * 2];
+            const float d1[3] = { pP1[0] - pP0[0], pP1[1] - pP0[1], pP1[2] - pP0[2] };
+            const float d2[3] = { pP2[0] - pP0[0], pP2[1] - pP0[1], pP2[2] - pP0[2] };
+            const float t21x = pT1[0] - pT0[0];
+            const float t21y = pT1[1] - pT0[1];
+            const float t31x = pT2[0] - pT0[0];
+            const float t31y = pT2[1] - pT0[1];
+
+            // The position derivative along u, times the signed texture area.
+            const float signedTexArea = t21x * t31y - t21y * t31x;
+            float tangent[3] = { t31y * d1[0] - t21y * d2[0], t31y * d1[1] - t21y * d2[1], t31y * d1[2] - t21y * d2[2] };
+            if (signedTexArea > 0.0f)
+            {
+                flags |= TRI_ORIENT_PRESERVING;
+            }
+            const float tangentLen = sqrtf(tangent[0] * tangent[0] + tangent[1] * tangent[1] + tangent[2] * tangent[2]);
+            if (fabsf(signedTexArea) <= FLT_MIN || tangentLen <= FLT_MIN)
+            {
+                flags |= TRI_NO_TEXTURE_AREA;
+                tangent[0] = tangent[1] = tangent[2] = 0.0f;
+            }
+            else if (signedTexArea < 0.0f)
+            {
+                tangent[0] = -tangent[0];
+                tangent[1] = -tangent[1];
+                tangent[2] = -tangent[2];
+            }
+            triFlags[t] = flags;
+
+            const float* pCornerPos[3] = { pP0, pP1, pP2 };
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const float* pNormal = &pNormalData[pTri[k] * 3];
+                const float* pPos = pCornerPos[k];
+                const float* pNextPos = pCornerPos[(k + 1) % 3];
+                const float* pPrevPos = pCornerPos[(k + 2) % 3];
+                const float e1[3] = { pNextPos[0] - pPos[0], pNextPos[1] - pPos[1], pNextPos[2] - pPos[2] };
+                const float e2[3] = { pPrevPos[0] - pPos[0], pPrevPos[1] - pPos[1], pPrevPos[2] - pPos[2] };
+
+                // The angle between the edges in the plane of the normal.
+                float dir1[3];
+                float dir2[3];
+                ProjectOntoPlane(pNormal, e1, dir1);
+                ProjectOntoPlane(pNormal, e2, dir2);
+                const float angle = acosf(std::clamp(dir1[0] * dir2[0] + dir1[1] * dir2[1] + dir1[2] * dir2[2], -1.0f, 1.0f));
+
+                float* pCornerTangent = &cornerTangents[size_t(t) * 9 + k * 3];
+                ProjectOntoPlane(pNormal, tangent, pCornerTangent);
+                pCornerTangent[0] *= angle;
+                pCornerTangent[1] *= angle;
+                pCornerTangent[2] *= angle;
+            }
+        }
+    });
+
+    VertexFans fans;
+    BuildVertexFans(pIndices, triFlags, weldVerts, fans);
+
+    // A triangle without a texture area mirrors the texture like the first neighbor that reaches it.
+    auto findNeighborTri = [&](uint32_t corner)
+    {
+        // The neighbor's edge runs the other way, into its corner at the same vertex.
+        const uint32_t vert = weldVerts[pIndices[corner]];
+        const uint32_t nextVert = weldVerts[pIndices[NextCorner(corner)]];
+        for (uint32_t i = fans.offsets[vert]; i < fans.offsets[vert + 1]; i++)
+        {
+            if (weldVerts[pIndices[PrevCorner(fans.corners[i])]] == nextVert)
+            {
+                return fans.corners[i] / 3;
+            }
+        }
+        return UINT32_MAX;
+    };
+    std::vector<uint32_t> triQueue;
+    for (uint32_t t = 0; t < triCnt; t++)
+    {
+        if ((triFlags[t] & (TRI_NO_TEXTURE_AREA | TRI_DEGENERATE)) != TRI_NO_TEXTURE_AREA)
+        {
+            continue;
+        }
+        uint32_t firstNeighborTri = UINT32_MAX;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t neighborTri = findNeighborTri(t * 3 + k);
+            if (neighborTri < firstNeighborTri && (triFlags[neighborTri] & TRI_NO_TEXTURE_AREA) == 0)
+            {
+                firstNeighborTri = neighborTri;
+            }
+        }
+        if (firstNeighborTri != UINT32_MAX)
+        {
+            triFlags[t] = (triFlags[t] & ~(TRI_NO_TEXTURE_AREA | TRI_ORIENT_PRESERVING)) | (triFlags[firstNeighborTri] & TRI_ORIENT_PRESERVING);
+            triQueue.push_back(t);
+        }
+    }
+    for (size_t i = 0; i < triQueue.size(); i++)
+    {
+        const uint32_t t = triQueue[i];
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t neighborTri = findNeighborTri(t * 3 + k);
+            if (neighborTri != UINT32_MAX && (triFlags[neighborTri] & TRI_NO_TEXTURE_AREA) != 0)
+            {
+                triFlags[neighborTri] = (triFlags[neighborTri] & ~(TRI_NO_TEXTURE_AREA | TRI_ORIENT_PRESERVING)) | (triFlags[t] & TRI_ORIENT_PRESERVING);
+                triQueue.push_back(neighborTri);
+            }
+        }
+    }
+
+    // The groups are the corners connected over the edges between the triangles that mirror the same way.
+    std::vector<uint32_t> cornerGroups;
+    GroupFanCorners(pIndices, weldVerts, fans, [&triFlags](uint32_t outCorner, uint32_t inCorner)
+    {
+        return ((triFlags[outCorner / 3] ^ triFlags[inCorner / 3]) & TRI_ORIENT_PRESERVING) == 0;
+    }, cornerTangents, cornerGroups);
+
+    std::vector<uint32_t> vertGroups;
+    SplitVertexGroups(pIndices, cornerGroups, cornerTangents, oSrcVerts, vertGroups);
+
+    const uint32_t newVertCnt = static_cast<uint32_t>(oSrcVerts.size());
+    oTangentData.resize(size_t(newVertCnt) * 4);
+    JobSystem::ParallelFor(0, newVertCnt, VERT_FRAME_VERT_GRAIN_SIZE, [&](uint32_t vertBegin, uint32_t vertEnd)
+    {
+        for (uint32_t v = vertBegin; v < vertEnd; v++)
+        {
+            const uint32_t group = vertGroups[v];
+            if (group == UINT32_MAX)
+            {
+                continue;
+            }
+
+            float* pTangent = &oTangentData[size_t(v) * 4];
+            const float* pSum = &cornerTangents[size_t(group) * 3];
+            const float len = sqrtf(pSum[0] * pSum[0] + pSum[1] * pSum[1] + pSum[2] * pSum[2]);
+            if (len > FLT_MIN)
+            {
+                pTangent[0] = pSum[0] / len;
+                pTangent[1] = pSum[1] / len;
+                pTangent[2] = pSum[2] / len;
+            }
+            else
+            {
+                PerpendicularTangent(&pNormalData[oSrcVerts[v] * 3], pTangent);
+            }
+            // The texture v goes down in the glTF, so an orientation preserving triangle flips the bitangent.
+            pTangent[3] = (triFlags[group / 3] & TRI_ORIENT_PRESERVING) ? -1.0f : 1.0f;
+        }
+    });
+    return newVertCnt;
+}
+
+// ================================================================================================================
+void ExpandVertexStream(std::vector<float>& ioStream, uint32_t componentCnt, const std::vector<uint32_t>& srcVerts)
+{
+    if (ioStream.empty())
+    {
+        return;
+    }
+
+    const size_t oldVertCnt = ioStream.size() / componentCnt;
+    ioStream.resize(srcVerts.size() * componentCnt);
+    for (size_t v = oldVertCnt; v < srcVerts.size(); v++)
+    {
+        memcpy(&ioStream[v * componentCnt], &ioStream[size_t(srcVerts[v]) * componentCnt], sizeof(float) * componentCnt);
+    }
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// CPU side mesh processing. It doesn't depend on the D3D12, so it can run headless.
+
+constexpr int VERT_SIZE_FLOAT = (3 + 3 + 4 + 2); // Position(3) + Normal(3) + Tangent(4) + TexCoord(2).
+
+// Interleaves the separate attribute streams into the VERT_SIZE_FLOAT vertex layout:
+// Position(3) + Normal(3) + Tangent(4) + TexCoord(2).
+void InterleaveVertexData(const float* pPosData,
+                          const float* pNormalData,
+                          const float* pTangentData,
+                          const float* pTexCoordData,
+                          uint32_t     vertCnt,
+                          float*       pDst);
+
+// The optional compact vertex layout, COMPACT_VERT_SIZE_BYTE instead of the 48 bytes of the VERT_SIZE_FLOAT one:
+// Position R16G16B16A16_UNORM: The xyz in the primitive's AABB. The w is the tangent handedness, 1 for +1 and 0 for -1.
+// Normal   R16G16_SNORM: Octahedral.
+// Tangent  R16G16_SNORM: Octahedral.
+// TexCoord R16G16_FLOAT.
+// The PBRShaders.hlsl decodes it under the COMPACT_VERTICES define.
+constexpr int COMPACT_VERT_SIZE_BYTE = 8 + 4 + 4 + 4;
+
+enum class VertexFormat
+{
+    Float,  // VERT_SIZE_FLOAT floats.
+    Compact // COMPACT_VERT_SIZE_BYTE bytes.
+};
+
+// The worst decode errors of the compact layout. The position error is per axis, in the AABB extents. The normal and
+// tangent ones are the angles of the unit vectors. The texture coordinates keep the half float precision, which is
+// relative to their magnitude.
+constexpr float COMPACT_POS_MAX_ERROR         = 0.5f / 65535.0f;
+constexpr float COMPACT_DIR_MAX_ERROR_DEGREES = 0.005f;
+constexpr float COMPACT_UV_MAX_RELATIVE_ERROR = 1.0f / 2048.0f;
+
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
+
+// The unit vector folded onto the octahedron, in the snorm16 grid. A zero vector comes back as the +z.
+void EncodeOctahedral(const float* pDir, int16_t* pOct);
+void DecodeOctahedral(const int16_t* pOct, float* pDir);
+
+// Packs the separate attribute streams into the compact layout. The positions are quantized in the AABB, which the
+// vertex shader takes back as the dequantization scale and offset.
+void CompactVertexData(const float* pPosData,
+                       const float* pNormalData,
+                       const float* pTangentData,
+                       const float* pTexCoordData,
+                       uint32_t     vertCnt,
+                       const float* pAabbMin,
+                       const float* pAabbMax,
+                       uint8_t*     pDst);
+
+// Unpacks the compact layout into the VERT_SIZE_FLOAT one, the same way the vertex shader does.
+void DecodeCompactVertexData(const uint8_t* pSrc, uint32_t vertCnt, const float* pAabbMin, const float* pAabbMax, float* pDst);
+
+// Post-transform vertex cache behavior of an index buffer, simulated with a FIFO cache of cacheSize vertices.
+// ACMR is the cache misses per triangle (0.5 at best for the large regular meshes, 3 at worst) and ATVR is the misses
+// per referenced vertex (1 at best).
+struct VertexCacheStats
+{
+    double acmr;
+    double atvr;
+};
+
+constexpr uint32_t VERTEX_CACHE_SIM_SIZE = 16;
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt, uint32_t cacheSize = VERTEX_CACHE_SIM_SIZE);
+
+// Reorders the triangles in place for the post-transform vertex cache with the Forsyth's linear-speed algorithm. The
+// triangle winding is kept.
+void OptimizeVertexCache(uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt);
+
+// Reorders the clusters of a vertex cache optimized index buffer, so the triangles facing out of the mesh center come
+// first and the hidden ones behind them fail the depth test. A cluster is split off when its ACMR gets within the
+// threshold ratio of its cache run, so threshold 1.05 lets the ACMR grow by about 5%. The pPosData is 3 floats per
+// vertex.
+void OptimizeOverdraw(uint32_t* pIndices, uint32_t idxCnt, const float* pPosData, uint32_t vertCnt, float threshold = 1.05f);
+
+// Renumbers the vertices in the order the index buffer first uses them, so the vertex fetch walks the buffers forward.
+// The unreferenced vertices are dropped. oRemap maps the old vertex to the new one, or UINT32_MAX for the dropped.
+// Returns the new vertex count.
+uint32_t OptimizeVertexFetchRemap(uint32_t* pIndices, uint32_t idxCnt, uint32_t vertCnt, std::vector<uint32_t>& oRemap);
+
+// Moves the componentCnt floats of each vertex to its remapped place. Empty streams are left alone.
+void RemapVertexStream(std::vector<float>& ioStream, uint32_t componentCnt, const std::vector<uint32_t>& remap, uint32_t newVertCnt);
+
+// A coarser level of a primitive's mesh. It indexes the same vertices.
+struct MeshLod
+{
+    uint32_t idxOffset; // Into the GPU index buffer, after the level 0.
+    uint32_t idxCnt;
+    float    error;     // In the local space. The simplification errors of the levels up to it, added up.
+};
+
+constexpr uint32_t MAX_MESH_LOD_CNT = 8; // With the level 0.
+// The LOD chain stops before its error passes this much of the largest AABB extent. Coarser would only fit a few pixels.
+constexpr float MESH_LOD_MAX_ERROR = 0.05f;
+
+// The normals at the same position within this angle are welded by the mesh simplification, so the flat shaded meshes
+// still simplify. The harder edges are kept as seams.
+constexpr float SIMPLIFY_CREASE_DEGREES = 30.0f;
+
+// Simplifies the triangles toward targetIdxCnt indices with the quadric error metric. Each step collapses the cheapest
+// edge onto one of its vertices, so oIndices indexes the same vertex buffer. The vertices at the same position are
+// welded unless their texture coordinates differ or their normals are more than SIMPLIFY_CREASE_DEGREES apart; such
+// seams, the open borders and the non-manifold edges stay in place. A collapse that flips a triangle is skipped, and it
+// stops at the first one over maxError. The pNormalData and pTexCoordData can be null. Returns the largest collapse
+// error, as the area weighted RMS distance to the merged triangles' planes over the largest extent of the AABB.
+float SimplifyMesh(const uint32_t* pIndices,
+                   uint32_t        idxCnt,
+                   const float*    pPosData,
+                   const float*    pNormalData,
+                   const float*    pTexCoordData,
+                   uint32_t        vertCnt,
+                   uint32_t        targetIdxCnt,
+                   float           maxError,
+                   std::vector<uint32_t>& oIndices);
+
+// A cluster of the level 0 triangles for the cluster culling and the mesh shaders. BuildMeshlets() puts the meshlet's
+// triangles in a contiguous range of the index buffer, so the forward path can draw the visible runs as they are.
+struct Meshlet
+{
+    uint32_t vertOffset; // Into the meshlet vertices.
+    uint32_t triOffset;  // Into the meshlet triangles, which is also the first triangle in the index buffer.
+    uint32_t vertCnt;
+    uint32_t triCnt;
+};
+
+// The mesh shader friendly limits. 124 triangles keep the 3 byte local indices of a meshlet in 372 bytes.
+constexpr uint32_t MESHLET_MAX_VERT_CNT = 64;
+constexpr uint32_t MESHLET_MAX_TRI_CNT  = 124;
+
+// In the local space. All the triangles face away from a viewer at v when dot(normalize(coneApex - v), coneAxis) is
+// at least the coneCutoff, which is over 1 when the triangles face too many ways for the test.
+struct MeshletBounds
+{
+    float center[3];
+    float radius;
+    float coneApex[3];
+    float coneAxis[3];
+    float coneCutoff;
+};
+
+// Splits the triangles into meshlets of up to MESHLET_MAX_VERT_CNT vertices and MESHLET_MAX_TRI_CNT triangles. A meshlet
+// grows over its shared vertices and takes the nearest of the next triangles in the index order when none of them fit,
+// so the vertex cache order in the input keeps them compact. The triangles are reordered in place into the meshlets'
+// order with their winding. oMeshletVerts maps the meshlets' local vertices to the vertex buffer, and oMeshletTris has
+// the 3 local indices of each triangle. The pPosData is 3 floats per vertex.
+void BuildMeshlets(uint32_t*              pIndices,
+                   uint32_t               idxCnt,
+                   const float*           pPosData,
+                   uint32_t               vertCnt,
+                   std::vector<Meshlet>&  oMeshlets,
+                   std::vector<uint32_t>& oMeshletVerts,
+                   std::vector<uint8_t>&  oMeshletTris);
+
+// The sphere is around the box of the meshlet's vertices. The cone is the average of its triangles' normals, widened to
+// all of them, with the apex behind every triangle's plane.
+void ComputeMeshletBounds(const Meshlet& meshlet, const uint32_t* pMeshletVerts, const uint8_t* pMeshletTris, const float* pPosData, MeshletBounds& oBounds);
+
+// Generates the smooth vertex normals from the positions. A vertex adds up the face normals of the triangles around it
+// that are connected through the edges, weighted by the corner angles. An edge whose faces bend more than creaseDegrees
+// is a hard edge, so a crease of 0 gives flat shading and 180 smooths everything. The vertices with the same position
+// count as one. A vertex on a hard edge is split like GenerateTangents() splits: the input vertices keep their place,
+// the split ones are appended, oSrcVerts maps each output vertex to the input one it copies, and the indices are
+// rewritten in place. A vertex without any face area gets +z. The triangles go in parallel on the JobSystem. Returns
+// the new vertex count.
+uint32_t GenerateNormals(uint32_t*              pIndices,
+                         uint32_t               idxCnt,
+                         const float*           pPosData,
+                         uint32_t               vertCnt,
+                         float                  creaseDegrees,
+                         std::vector<float>&    oNormalData,
+                         std::vector<uint32_t>& oSrcVerts);
+
+// Generates the normal mapping tangents the way the MikkTSpace does, so the normal maps baked against it match. A
+// triangle's tangent is its texture u direction. A vertex adds them up over the triangles around it that are connected
+// through the edges and mirror the texture the same way, projected onto its normal and weighted by the corner angles.
+// The vertices with the same position, normal and texture coordinates count as one. The w is the bitangent sign of the
+// glTF, bitangent = cross(normal, tangent) * w, with the texture v going down. A vertex where the mirrored triangles
+// meet, or whose triangle fans only touch at it, is split: the input vertices keep their place, the split ones are
+// appended, and oSrcVerts maps each output vertex to the input one it copies. The indices are rewritten in place. A
+// vertex without a texture direction gets any tangent perpendicular to its normal. The triangles go in parallel on
+// the JobSystem. Returns the new vertex count.
+uint32_t GenerateTangents(uint32_t*              pIndices,
+                          uint32_t               idxCnt,
+                          const float*           pPosData,
+                          const float*           pNormalData,
+                          const float*           pTexCoordData,
+                          uint32_t               vertCnt,
+                          std::vector<float>&    oTangentData,
+                          std::vector<uint32_t>& oSrcVerts);
+
+// Appends the vertices of srcVerts past the stream's end as copies of their source vertices, for the vertices split
+// by GenerateTangents(). Empty streams are left alone.
+void ExpandVertexStream(std::vector<float>& ioStream, uint32_t componentCnt, const std::vector<uint32_t>& srcVerts);
@@ -0,0 +1,342 @@
+#include "TextureContainer.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+    constexpr uint32_t KTX2_HEADER_BYTES = 80;
+    constexpr uint32_t KTX2_LEVEL_INDEX_ENTRY_BYTES = 24;
+
+    constexpr uint32_t DDS_MAGIC_BYTES = 4;
+    constexpr uint32_t DDS_HEADER_BYTES = 124;
+    constexpr uint32_t DDS_DX10_HEADER_BYTES = 20;
+    constexpr uint32_t DDSD_CAPS = 0x1;
+    constexpr uint32_t DDSD_HEIGHT = 0x2;
+    constexpr uint32_t DDSD_WIDTH = 0x4;
+    constexpr uint32_t DDSD_PIXELFORMAT = 0x1000;
+    constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    constexpr uint32_t DDSD_LINEARSIZE = 0x80000;
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDPF_RGB = 0x40;
+    constexpr uint32_t DDSCAPS_COMPLEX = 0x8;
+    constexpr uint32_t DDSCAPS_TEXTURE = 0x1000;
+    constexpr uint32_t DDSCAPS_MIPMAP = 0x400000;
+    constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+    constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+    constexpr uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+    constexpr uint32_t MakeFourCC(char c0, char c1, char c2, char c3)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(c0)) | (static_cast<uint32_t>(static_cast<uint8_t>(c1)) << 8) |
+               (static_cast<uint32_t>(static_cast<uint8_t>(c2)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(c3)) << 24);
+    }
+
+    // The formats the renderer samples. The values match the DXGI_FORMAT and the VkFormat enums.
+    struct FormatMapping
+    {
+        uint32_t    dxgiFormat;
+        uint32_t    vkFormat;
+        uint32_t    vkSRgbFormat;
+        BlockFormat format;
+    };
+    constexpr FormatMapping FORMAT_MAPPINGS[] = { { 28, 37, 43, BlockFormat::None },
+                                                  { 71, 131, 132, BlockFormat::BC1 }, // The RGB BC1.
+                                                  { 71, 133, 134, BlockFormat::BC1 }, // The RGBA BC1.
+                                                  { 77, 137, 138, BlockFormat::BC3 },
+                                                  { 80, 139, 139, BlockFormat::BC4 },
+                                                  { 83, 141, 141, BlockFormat::BC5 },
+                                                  { 98, 145, 146, BlockFormat::BC7 } };
+
+    uint32_t ReadU32(const uint8_t* pBytes)
+    {
+        uint32_t value;
+        memcpy(&value, pBytes, sizeof(value));
+        return value;
+    }
+
+    uint64_t ReadU64(const uint8_t* pBytes)
+    {
+        uint64_t value;
+        memcpy(&value, pBytes, sizeof(value));
+        return value;
+    }
+
+    uint64_t CalcLevelBytes(uint32_t width, uint32_t height, uint32_t level, BlockFormat format)
+    {
+        const uint64_t levelWidth = std::max(width >> level, 1u);
+        const uint64_t levelHeight = std::max(height >> level, 1u);
+        if (format == BlockFormat::None)
+        {
+            return levelWidth * levelHeight * 4;
+        }
+        return ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * GetBlockBytes(format);
+    }
+
+    bool CheckTextureSize(uint32_t width, uint32_t height, uint32_t mipCnt, BlockFormat format, std::string& oErr)
+    {
+        if (width == 0 || height == 0)
+        {
+            oErr = "Only the 2D textures are supported.";
+            return false;
+        }
+        if (format != BlockFormat::None && (width % 4 != 0 || height % 4 != 0))
+        {
+            oErr = "The block compressed level 0 must be a multiple of 4 in both sizes.";
+            return false;
+        }
+        if (mipCnt > 32 || (std::max(width, height) >> (mipCnt - 1)) == 0)
+        {
+            oErr = "There are more levels than the size allows.";
+            return false;
+        }
+        return true;
+    }
+
+    // ============================================================================================================
+    bool ParseKtx2(const uint8_t* pBytes, uint64_t byteCnt, TextureContainer& oContainer, std::string& oErr)
+    {
+        if (byteCnt < KTX2_HEADER_BYTES)
+        {
+            oErr = "The KTX2 header is truncated.";
+            return false;
+        }
+
+        const uint32_t vkFormat = ReadU32(pBytes + 12);
+        const uint32_t width = ReadU32(pBytes + 20);
+        const uint32_t height = ReadU32(pBytes + 24);
+        const uint32_t depth = ReadU32(pBytes + 28);
+        const uint32_t layerCnt = ReadU32(pBytes + 32);
+        const uint32_t faceCnt = ReadU32(pBytes + 36);
+        const uint32_t levelCnt = std::max(ReadU32(pBytes + 40), 1u);
+        const uint32_t supercompressionScheme = ReadU32(pBytes + 44);
+
+        if (vkFormat == 0 || supercompressionScheme != 0)
+        {
+            oErr = "The Basis Universal and the supercompressed KTX2 files need a transcoder.";
+            return false;
+        }
+        if (depth > 1 || layerCnt > 1 || faceCnt != 1)
+        {
+            oErr = "Only the single 2D image KTX2 files are supported.";
+            return false;
+        }
+
+        const FormatMapping* pMapping = std::find_if(std::begin(FORMAT_MAPPINGS), std::end(FORMAT_MAPPINGS), [vkFormat](const FormatMapping& mapping)
+        {
+            return mapping.vkFormat == vkFormat || mapping.vkSRgbFormat == vkFormat;
+        });
+        if (pMapping == std::end(FORMAT_MAPPINGS))
+        {
+            oErr = "The KTX2 VkFormat " + std::to_string(vkFormat) + " isn't supported.";
+            return false;
+        }
+        if (!CheckTextureSize(width, height, levelCnt, pMapping->format, oErr))
+        {
+            return false;
+        }
+        if (byteCnt < KTX2_HEADER_BYTES + static_cast<uint64_t>(levelCnt) * KTX2_LEVEL_INDEX_ENTRY_BYTES)
+        {
+            oErr = "The KTX2 level index is truncated.";
+            return false;
+        }
+
+        // The index lists the level 0 first, although the file stores the smallest level first.
+        oContainer.levels.resize(levelCnt);
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            const uint8_t* pEntry = pBytes + KTX2_HEADER_BYTES + level * KTX2_LEVEL_INDEX_ENTRY_BYTES;
+            const uint64_t offset = ReadU64(pEntry);
+            const uint64_t bytes = ReadU64(pEntry + 8);
+            if (bytes != CalcLevelBytes(width, height, level, pMapping->format) || offset > byteCnt || bytes > byteCnt - offset)
+            {
+                oErr = "The KTX2 level " + std::to_string(level) + " doesn't match its format and size.";
+                return false;
+            }
+            oContainer.levels[level] = { pBytes + offset, bytes };
+        }
+
+        oContainer.width = width;
+        oContainer.height = height;
+        oContainer.format = pMapping->format;
+        return true;
+    }
+
+    // ============================================================================================================
+    bool ParseDds(const uint8_t* pBytes, uint64_t byteCnt, TextureContainer& oContainer, std::string& oErr)
+    {
+        if (byteCnt < DDS_MAGIC_BYTES + DDS_HEADER_BYTES || ReadU32(pBytes + 4) != DDS_HEADER_BYTES)
+        {
+            oErr = "The DDS header is truncated.";
+            return false;
+        }
+
+        const uint8_t* pHeader = pBytes + DDS_MAGIC_BYTES;
+        const uint32_t height = ReadU32(pHeader + 8);
+        const uint32_t width = ReadU32(pHeader + 12);
+        const uint32_t levelCnt = std::max(ReadU32(pHeader + 24), 1u);
+        const uint32_t pixelFormatFlags = ReadU32(pHeader + 76);
+        const uint32_t fourCC = ReadU32(pHeader + 80);
+        const uint32_t rgbBitCnt = ReadU32(pHeader + 84);
+        const uint32_t caps2 = ReadU32(pHeader + 108);
+        if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+        {
+            oErr = "Only the 2D DDS files are supported.";
+            return false;
+        }
+
+        uint64_t dataOffset = DDS_MAGIC_BYTES + DDS_HEADER_BYTES;
+        bool isFormatKnown = true;
+        BlockFormat format = BlockFormat::None;
+        if ((pixelFormatFlags & DDPF_FOURCC) && fourCC == MakeFourCC('D', 'X', '1', '0'))
+        {
+            if (byteCnt < dataOffset + DDS_DX10_HEADER_BYTES)
+            {
+                oErr = "The DDS DX10 header is truncated.";
+                return false;
+            }
+            const uint8_t* pDx10Header = pBytes + dataOffset;
+            const uint32_t dxgiFormat = ReadU32(pDx10Header);
+            if (ReadU32(pDx10Header + 4) != DDS_DIMENSION_TEXTURE2D || (ReadU32(pDx10Header + 8) & DDS_MISC_TEXTURECUBE) ||
+                ReadU32(pDx10Header + 12) > 1)
+            {
+                oErr = "Only the single 2D image DDS files are supported.";
+                return false;
+            }
+
+            // The sRGB DXGI formats are the UNORM ones plus 1.
+            const FormatMapping* pMapping = std::find_if(std::begin(FORMAT_MAPPINGS), std::end(FORMAT_MAPPINGS), [dxgiFormat](const FormatMapping& mapping)
+            {
+                return mapping.dxgiFormat == dxgiFormat || (mapping.vkFormat != mapping.vkSRgbFormat && mapping.dxgiFormat + 1 == dxgiFormat);
+            });
+            isFormatKnown = pMapping != std::end(FORMAT_MAPPINGS);
+            format = isFormatKnown ? pMapping->format : BlockFormat::None;
+            dataOffset += DDS_DX10_HEADER_BYTES;
+        }
+        else if (pixelFormatFlags & DDPF_FOURCC)
+        {
+            switch (fourCC)
+            {
+            case MakeFourCC('D', 'X', 'T', '1'): format = BlockFormat::BC1; break;
+            case MakeFourCC('D', 'X', 'T', '5'): format = BlockFormat::BC3; break;
+            case MakeFourCC('A', 'T', 'I', '1'):
+            case MakeFourCC('B', 'C', '4', 'U'): format = BlockFormat::BC4; break;
+            case MakeFourCC('A', 'T', 'I', '2'):
+            case MakeFourCC('B', 'C', '5', 'U'): format = BlockFormat::BC5; break;
+            default:                             isFormatKnown = false; break;
+            }
+        }
+        else
+        {
+            // The legacy uncompressed header only matches the R8G8B8A8 byte order.
+            isFormatKnown = (pixelFormatFlags & DDPF_RGB) && rgbBitCnt == 32 && ReadU32(pHeader + 88) == 0x000000FF &&
+                            ReadU32(pHeader + 92) == 0x0000FF00 && ReadU32(pHeader + 96) == 0x00FF0000;
+        }
+
+        if (!isFormatKnown)
+        {
+            oErr = "The DDS pixel format isn't supported.";
+            return false;
+        }
+        if (!CheckTextureSize(width, height, levelCnt, format, oErr))
+        {
+            return false;
+        }
+
+        // The levels follow each other from the level 0.
+        oContainer.levels.resize(levelCnt);
+        for (uint32_t level = 0; level < levelCnt; level++)
+        {
+            const uint64_t bytes = CalcLevelBytes(width, height, level, format);
+            if (dataOffset > byteCnt || bytes > byteCnt - dataOffset)
+            {
+                oErr = "The DDS level " + std::to_string(level) + " is truncated.";
+                return false;
+            }
+            oContainer.levels[level] = { pBytes + dataOffset, bytes };
+            dataOffset += bytes;
+        }
+
+        oContainer.width = width;
+        oContainer.height = height;
+        oContainer.format = format;
+        return true;
+    }
+}
+
+// ================================================================================================================
+bool IsTextureContainer(const uint8_t* pBytes, uint64_t byteCnt)
+{
+    return (byteCnt >= sizeof(KTX2_IDENTIFIER) && memcmp(pBytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) ||
+           (byteCnt >= DDS_MAGIC_BYTES && ReadU32(pBytes) == MakeFourCC('D', 'D', 'S', ' '));
+}
+
+// ================================================================================================================
+bool ParseTextureContainer(const uint8_t* pBytes, uint64_t byteCnt, TextureContainer& oContainer, std::string& oErr)
+{
+    if (byteCnt >= sizeof(KTX2_IDENTIFIER) && memcmp(pBytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0)
+    {
+        return ParseKtx2(pBytes, byteCnt, oContainer, oErr);
+    }
+    if (byteCnt >= DDS_MAGIC_BYTES && ReadU32(pBytes) == MakeFourCC('D', 'D', 'S', ' '))
+    {
+        return ParseDds(pBytes, byteCnt, oContainer, oErr);
+    }
+    oErr = "Neither a KTX2 nor a DDS file.";
+    return false;
+}
+
+// ================================================================================================================
+std::shared_ptr<TextureContainer> OpenTextureContainer(const std::string& path, std::string& oErr)
+{
+    std::shared_ptr<TextureContainer> pContainer = std::make_shared<TextureContainer>();
+    if (!pContainer->file.Open(path))
+    {
+        oErr = "Cannot map " + path + ".";
+        return nullptr;
+    }
+    if (!ParseTextureContainer(pContainer->file.GetData(), pContainer->file.GetSize(), *pContainer, oErr))
+    {
+        oErr = path + ": " + oErr;
+        return nullptr;
+    }
+    return pContainer;
+}
+
+// ================================================================================================================
+bool WriteDdsFile(const std::string& path, const uint8_t* pData, uint32_t width, uint32_t height, uint32_t mipCnt, BlockFormat format)
+{
+    const FormatMapping* pMapping = std::find_if(std::begin(FORMAT_MAPPINGS), std::end(FORMAT_MAPPINGS), [format](const FormatMapping& mapping)
+    {
+        return mapping.format == format;
+    });
+
+    uint32_t header[(DDS_MAGIC_BYTES + DDS_HEADER_BYTES + DDS_DX10_HEADER_BYTES) / 4] = {};
+    header[0] = MakeFourCC('D', 'D', 'S', ' ');
+    header[1] = DDS_HEADER_BYTES;
+    header[2] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header[3] = height;
+    header[4] = width;
+    header[5] = static_cast<uint32_t>(CalcLevelBytes(width, height, 0, format));
+    header[7] = mipCnt;
+    header[19] = 32; // The pixel format size.
+    header[20] = DDPF_FOURCC;
+    header[21] = MakeFourCC('D', 'X', '1', '0');
+    header[27] = DDSCAPS_TEXTURE | (mipCnt > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+    header[32] = pMapping->dxgiFormat;
+    header[33] = DDS_DIMENSION_TEXTURE2D;
+    header[35] = 1; // The array size.
+
+    uint64_t dataBytes = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        dataBytes += CalcLevelBytes(width, height, level, format);
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(pData), static_cast<std::streamsize>(dataBytes));
+    return file.good();
+}
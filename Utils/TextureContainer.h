@@ -0,0 +1,40 @@
+#pragma once
+#include "BlockCompression.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// KTX2 and DDS texture containers. The levels are used in place from the file mapping, so a pre-compressed texture
+// skips the decode, the mip generation and the block compression of the PNG/JPEG path, and its bytes are copied only
+// once, into the upload buffer.
+
+struct TextureContainerLevel
+{
+    const uint8_t* pData; // Tightly packed rows, or block rows.
+    uint64_t       bytes;
+};
+
+struct TextureContainer
+{
+    MappedFile                         file;
+    uint32_t                           width = 0;
+    uint32_t                           height = 0;
+    BlockFormat                        format = BlockFormat::None; // None is the R8G8B8A8.
+    std::vector<TextureContainerLevel> levels;                     // From the level 0.
+};
+
+// Whether the bytes start like a KTX2 or a DDS file.
+bool IsTextureContainer(const uint8_t* pBytes, uint64_t byteCnt);
+
+// Finds the levels of a KTX2 or DDS image in memory. Only the 2D single image R8G8B8A8 and BC1/BC3/BC4/BC5/BC7 files
+// without a supercompression are taken, since there's no transcoder. The sRGB variants load as their UNORM formats,
+// like the PNG/JPEG textures do. The D3D12 needs the block formats at the level 0 sizes of 4 multiples.
+bool ParseTextureContainer(const uint8_t* pBytes, uint64_t byteCnt, TextureContainer& oContainer, std::string& oErr);
+
+// Maps the file and parses it. Returns null with the reason in oErr on failure.
+std::shared_ptr<TextureContainer> OpenTextureContainer(const std::string& path, std::string& oErr);
+
+// Writes a tightly packed mip chain in the TextureUtils or BlockCompression layout into a DDS file with the DX10 header.
+bool WriteDdsFile(const std::string& path, const uint8_t* pData, uint32_t width, uint32_t height, uint32_t mipCnt, BlockFormat format);
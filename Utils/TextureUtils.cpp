@@ -0,0 +1,500 @@
+#include "TextureUtils.h"
+#include "../JobSystem/JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define TEXTURE_UTILS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // The destination rows per job.
+    constexpr uint32_t MIP_ROW_GRAIN_SIZE = 16;
+
+    // The Kaiser half width in the destination texels and the window shape. The usual offline mip filter settings.
+    constexpr float KAISER_HALF_WIDTH = 3.f;
+    constexpr float KAISER_ALPHA = 4.f;
+
+    // Fine enough that the darkest sRGB codes, where the curve is steepest, still round to the right value.
+    constexpr uint32_t SRGB_ENCODE_LUT_SIZE = 16384;
+
+    struct SRgbTables
+    {
+        float   decode[256];
+        uint8_t encode[SRGB_ENCODE_LUT_SIZE];
+    };
+
+    const SRgbTables& GetSRgbTables()
+    {
+        static const SRgbTables tables = []()
+        {
+            SRgbTables newTables;
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                const float srgb = i / 255.f;
+                newTables.decode[i] = srgb <= 0.04045f ? srgb / 12.92f : powf((srgb + 0.055f) / 1.055f, 2.4f);
+            }
+            for (uint32_t i = 0; i < SRGB_ENCODE_LUT_SIZE; i++)
+            {
+                const float linear = i / static_cast<float>(SRGB_ENCODE_LUT_SIZE - 1);
+                const float srgb = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.f / 2.4f) - 0.055f;
+                newTables.encode[i] = static_cast<uint8_t>(srgb * 255.f + 0.5f);
+            }
+            return newTables;
+        }();
+        return tables;
+    }
+
+    // The source texels and weights of each destination texel along one axis.
+    struct FilterTaps
+    {
+        std::vector<uint32_t> tapBegin; // The taps of the texel i are [tapBegin[i], tapBegin[i + 1]).
+        std::vector<uint32_t> srcIdx;
+        std::vector<float>    weights;
+    };
+
+    float BesselI0(float x)
+    {
+        // The power series. It converges well within the terms for the arguments up to KAISER_ALPHA.
+        const float quarterX2 = x * x * 0.25f;
+        float term = 1.f;
+        float sum = 1.f;
+        for (uint32_t k = 1; k < 16; k++)
+        {
+            term *= quarterX2 / static_cast<float>(k * k);
+            sum += term;
+        }
+        return sum;
+    }
+
+    // x is in the destination texels.
+    float KaiserSinc(float x)
+    {
+        if (fabsf(x) >= KAISER_HALF_WIDTH)
+        {
+            return 0.f;
+        }
+        const float t = x / KAISER_HALF_WIDTH;
+        const float window = BesselI0(KAISER_ALPHA * sqrtf(1.f - t * t)) / BesselI0(KAISER_ALPHA);
+        const float piX = 3.14159265f * x;
+        const float sinc = fabsf(piX) < 1e-5f ? 1.f : sinf(piX) / piX;
+        return sinc * window;
+    }
+
+    uint32_t AddressTexel(int32_t idx, uint32_t size, bool wrap)
+    {
+        const int32_t signedSize = static_cast<int32_t>(size);
+        if (wrap)
+        {
+            return static_cast<uint32_t>(((idx % signedSize) + signedSize) % signedSize);
+        }
+        return static_cast<uint32_t>(std::clamp(idx, 0, signedSize - 1));
+    }
+
+    void BuildFilterTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter, bool wrap, FilterTaps& oTaps)
+    {
+        oTaps.tapBegin.clear();
+        oTaps.srcIdx.clear();
+        oTaps.weights.clear();
+
+        const float scale = static_cast<float>(srcSize) / static_cast<float>(dstSize);
+        for (uint32_t i = 0; i < dstSize; i++)
+        {
+            const uint32_t firstTap = static_cast<uint32_t>(oTaps.srcIdx.size());
+            oTaps.tapBegin.push_back(firstTap);
+
+            // An axis that's already 1 texel wide only copies through.
+            if (filter == MipFilter::Box || srcSize == dstSize)
+            {
+                // The overlap of the destination texel's footprint with each source texel.
+                const float footprintBegin = static_cast<float>(i) * scale;
+                const float footprintEnd = static_cast<float>(i + 1) * scale;
+                for (uint32_t j = static_cast<uint32_t>(footprintBegin); j < srcSize && static_cast<float>(j) < footprintEnd; j++)
+                {
+                    const float overlap = std::min(footprintEnd, j + 1.f) - std::max(footprintBegin, static_cast<float>(j));
+                    if (overlap > 1e-6f)
+                    {
+                        oTaps.srcIdx.push_back(j);
+                        oTaps.weights.push_back(overlap / scale);
+                    }
+                }
+            }
+            else
+            {
+                const float center = (static_cast<float>(i) + 0.5f) * scale;
+                const float radius = KAISER_HALF_WIDTH * scale;
+                const int32_t first = static_cast<int32_t>(floorf(center - radius));
+                const int32_t last = static_cast<int32_t>(ceilf(center + radius));
+                float weightSum = 0.f;
+                for (int32_t j = first; j <= last; j++)
+                {
+                    const float weight = KaiserSinc((static_cast<float>(j) + 0.5f - center) / scale);
+                    if (weight != 0.f)
+                    {
+                        oTaps.srcIdx.push_back(AddressTexel(j, srcSize, wrap));
+                        oTaps.weights.push_back(weight);
+                        weightSum += weight;
+                    }
+                }
+
+                // Normalize, so a flat area keeps its value.
+                for (uint32_t t = firstTap; t < oTaps.weights.size(); t++)
+                {
+                    oTaps.weights[t] /= weightSum;
+                }
+            }
+        }
+        oTaps.tapBegin.push_back(static_cast<uint32_t>(oTaps.srcIdx.size()));
+    }
+
+    void DecodeRow(const uint8_t* pSrc, uint32_t texelCnt, MipContent content, float* pDst)
+    {
+        constexpr float inv255 = 1.f / 255.f;
+        const float* pSRgbDecode = GetSRgbTables().decode;
+        for (uint32_t i = 0; i < texelCnt * 4; i += 4)
+        {
+            switch (content)
+            {
+            case MipContent::SRgb:
+                pDst[i] = pSRgbDecode[pSrc[i]];
+                pDst[i + 1] = pSRgbDecode[pSrc[i + 1]];
+                pDst[i + 2] = pSRgbDecode[pSrc[i + 2]];
+                break;
+            case MipContent::Normal:
+                pDst[i] = pSrc[i] * (2.f * inv255) - 1.f;
+                pDst[i + 1] = pSrc[i + 1] * (2.f * inv255) - 1.f;
+                pDst[i + 2] = pSrc[i + 2] * (2.f * inv255) - 1.f;
+                break;
+            default:
+                pDst[i] = pSrc[i] * inv255;
+                pDst[i + 1] = pSrc[i + 1] * inv255;
+                pDst[i + 2] = pSrc[i + 2] * inv255;
+                break;
+            }
+            pDst[i + 3] = pSrc[i + 3] * inv255;
+        }
+    }
+
+    uint8_t EncodeUnorm(float value)
+    {
+        return static_cast<uint8_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+    }
+
+    void EncodeRow(float* pSrc, uint32_t texelCnt, MipContent content, uint8_t* pDst)
+    {
+        const uint8_t* pSRgbEncode = GetSRgbTables().encode;
+        for (uint32_t i = 0; i < texelCnt * 4; i += 4)
+        {
+            switch (content)
+            {
+            case MipContent::SRgb:
+                for (uint32_t c = 0; c < 3; c++)
+                {
+                    const float lutPos = std::clamp(pSrc[i + c], 0.f, 1.f) * static_cast<float>(SRGB_ENCODE_LUT_SIZE - 1);
+                    pDst[i + c] = pSRgbEncode[static_cast<uint32_t>(lutPos + 0.5f)];
+                }
+                break;
+            case MipContent::Normal:
+            {
+                // The average of the diverging normals is shorter than 1. Opposite ones cancel out to the flat normal.
+                float x = pSrc[i];
+                float y = pSrc[i + 1];
+                float z = pSrc[i + 2];
+                const float len = sqrtf(x * x + y * y + z * z);
+                if (len > 1e-6f)
+                {
+                    x /= len;
+                    y /= len;
+                    z /= len;
+                }
+                else
+                {
+                    x = 0.f;
+                    y = 0.f;
+                    z = 1.f;
+                }
+                pDst[i] = EncodeUnorm(x * 0.5f + 0.5f);
+                pDst[i + 1] = EncodeUnorm(y * 0.5f + 0.5f);
+                pDst[i + 2] = EncodeUnorm(z * 0.5f + 0.5f);
+                break;
+            }
+            default:
+                pDst[i] = EncodeUnorm(pSrc[i]);
+                pDst[i + 1] = EncodeUnorm(pSrc[i + 1]);
+                pDst[i + 2] = EncodeUnorm(pSrc[i + 2]);
+                break;
+            }
+            pDst[i + 3] = EncodeUnorm(pSrc[i + 3]);
+        }
+    }
+
+    // One RGBA texel is one SSE register.
+    void FilterRowHorizontal(const float* pSrcRow, const FilterTaps& taps, uint32_t dstWidth, float* pDstRow)
+    {
+        for (uint32_t x = 0; x < dstWidth; x++)
+        {
+#ifdef TEXTURE_UTILS_SSE
+            __m128 acc = _mm_setzero_ps();
+            for (uint32_t t = taps.tapBegin[x]; t < taps.tapBegin[x + 1]; t++)
+            {
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(taps.weights[t]), _mm_loadu_ps(&pSrcRow[taps.srcIdx[t] * 4])));
+            }
+            _mm_storeu_ps(&pDstRow[x * 4], acc);
+#else
+            float acc[4] = {};
+            for (uint32_t t = taps.tapBegin[x]; t < taps.tapBegin[x + 1]; t++)
+            {
+                const float* pTexel = &pSrcRow[taps.srcIdx[t] * 4];
+                for (uint32_t c = 0; c < 4; c++)
+                {
+                    acc[c] += taps.weights[t] * pTexel[c];
+                }
+            }
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                pDstRow[x * 4 + c] = acc[c];
+            }
+#endif
+        }
+    }
+
+    void AccumulateRow(const float* pSrcRow, float weight, uint32_t width, float* pAccRow)
+    {
+#ifdef TEXTURE_UTILS_SSE
+        const __m128 weights = _mm_set1_ps(weight);
+        for (uint32_t i = 0; i < width * 4; i += 4)
+        {
+            _mm_storeu_ps(&pAccRow[i], _mm_add_ps(_mm_loadu_ps(&pAccRow[i]), _mm_mul_ps(weights, _mm_loadu_ps(&pSrcRow[i]))));
+        }
+#else
+        for (uint32_t i = 0; i < width * 4; i++)
+        {
+            pAccRow[i] += weight * pSrcRow[i];
+        }
+#endif
+    }
+
+    // The box filter of an even sized level, which is the 2x2 average of every power of two texture.
+    void GenerateHalfSizeBoxLevel(const uint8_t* pSrc, uint32_t srcWidth, uint8_t* pDst, uint32_t dstWidth, uint32_t dstHeight,
+                                  MipContent content)
+    {
+        JobSystem::ParallelFor(0, dstHeight, MIP_ROW_GRAIN_SIZE, [&](uint32_t rowBegin, uint32_t rowEnd)
+        {
+            // The rows don't call into the job system, so another band can't reenter the thread's scratch.
+            thread_local std::vector<float> t_decodedRows;
+            thread_local std::vector<float> t_accRow;
+            t_decodedRows.resize(srcWidth * 8);
+            t_accRow.resize(dstWidth * 4);
+            float* pTopRow = t_decodedRows.data();
+            float* pBottomRow = pTopRow + srcWidth * 4;
+            float* pAccRow = t_accRow.data();
+
+            for (uint32_t y = rowBegin; y < rowEnd; y++)
+            {
+                const uint8_t* pSrcTop = pSrc + static_cast<uint64_t>(y) * 2 * srcWidth * 4;
+                DecodeRow(pSrcTop, srcWidth, content, pTopRow);
+                DecodeRow(pSrcTop + srcWidth * 4, srcWidth, content, pBottomRow);
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    const uint32_t srcIdx = x * 8;
+#ifdef TEXTURE_UTILS_SSE
+                    const __m128 top = _mm_add_ps(_mm_loadu_ps(&pTopRow[srcIdx]), _mm_loadu_ps(&pTopRow[srcIdx + 4]));
+                    const __m128 bottom = _mm_add_ps(_mm_loadu_ps(&pBottomRow[srcIdx]), _mm_loadu_ps(&pBottomRow[srcIdx + 4]));
+                    _mm_storeu_ps(&pAccRow[x * 4], _mm_mul_ps(_mm_add_ps(top, bottom), _mm_set1_ps(0.25f)));
+#else
+                    for (uint32_t c = 0; c < 4; c++)
+                    {
+                        pAccRow[x * 4 + c] = (pTopRow[srcIdx + c] + pTopRow[srcIdx + 4 + c] + pBottomRow[srcIdx + c] + pBottomRow[srcIdx + 4 + c]) * 0.25f;
+                    }
+#endif
+                }
+                EncodeRow(pAccRow, dstWidth, content, pDst + static_cast<uint64_t>(y) * dstWidth * 4);
+            }
+        });
+    }
+
+    void GenerateMipLevel(const uint8_t* pSrc, uint32_t srcWidth, uint32_t srcHeight,
+                          uint8_t* pDst, uint32_t dstWidth, uint32_t dstHeight, const MipGenDesc& desc)
+    {
+        if (desc.filter == MipFilter::Box && srcWidth == dstWidth * 2 && srcHeight == dstHeight * 2)
+        {
+            GenerateHalfSizeBoxLevel(pSrc, srcWidth, pDst, dstWidth, dstHeight, desc.content);
+            return;
+        }
+
+        FilterTaps horizontalTaps;
+        FilterTaps verticalTaps;
+        BuildFilterTaps(srcWidth, dstWidth, desc.filter, desc.wrapHorizontal, horizontalTaps);
+        BuildFilterTaps(srcHeight, dstHeight, desc.filter, desc.wrapVertical, verticalTaps);
+
+        // Each band of destination rows filters the source rows it reads horizontally once, and then vertically.
+        JobSystem::ParallelFor(0, dstHeight, MIP_ROW_GRAIN_SIZE, [&](uint32_t rowBegin, uint32_t rowEnd)
+        {
+            // The band doesn't call into the job system, so another band can't reenter the thread's scratch.
+            thread_local std::vector<int32_t>  t_bandSlotOfSrcRow;
+            thread_local std::vector<uint32_t> t_bandSrcRows;
+            thread_local std::vector<float>    t_decodedRow;
+            thread_local std::vector<float>    t_bandRows;
+            thread_local std::vector<float>    t_accRow;
+
+            // The wrapped taps can read the rows on the other side, so the band's rows aren't always contiguous.
+            t_bandSlotOfSrcRow.assign(srcHeight, -1);
+            t_bandSrcRows.clear();
+            for (uint32_t t = verticalTaps.tapBegin[rowBegin]; t < verticalTaps.tapBegin[rowEnd]; t++)
+            {
+                const uint32_t srcRow = verticalTaps.srcIdx[t];
+                if (t_bandSlotOfSrcRow[srcRow] < 0)
+                {
+                    t_bandSlotOfSrcRow[srcRow] = static_cast<int32_t>(t_bandSrcRows.size());
+                    t_bandSrcRows.push_back(srcRow);
+                }
+            }
+
+            const uint32_t dstRowFloats = dstWidth * 4;
+            t_decodedRow.resize(srcWidth * 4);
+            t_bandRows.resize(t_bandSrcRows.size() * dstRowFloats);
+            t_accRow.resize(dstRowFloats);
+
+            for (uint32_t slot = 0; slot < t_bandSrcRows.size(); slot++)
+            {
+                DecodeRow(pSrc + static_cast<uint64_t>(t_bandSrcRows[slot]) * srcWidth * 4, srcWidth, desc.content, t_decodedRow.data());
+                FilterRowHorizontal(t_decodedRow.data(), horizontalTaps, dstWidth, &t_bandRows[slot * dstRowFloats]);
+            }
+
+            for (uint32_t y = rowBegin; y < rowEnd; y++)
+            {
+                std::fill(t_accRow.begin(), t_accRow.end(), 0.f);
+                for (uint32_t t = verticalTaps.tapBegin[y]; t < verticalTaps.tapBegin[y + 1]; t++)
+                {
+                    const uint32_t slot = static_cast<uint32_t>(t_bandSlotOfSrcRow[verticalTaps.srcIdx[t]]);
+                    AccumulateRow(&t_bandRows[slot * dstRowFloats], verticalTaps.weights[t], dstWidth, t_accRow.data());
+                }
+                EncodeRow(t_accRow.data(), dstWidth, desc.content, pDst + static_cast<uint64_t>(y) * dstWidth * 4);
+            }
+        });
+    }
+
+    // The xxHash64 primes and round. Four independent lanes keep the multipliers busy on the long texel runs.
+    constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t HASH_PRIME_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t HASH_PRIME_5 = 0x27D4EB2F165667C5ull;
+
+    inline uint64_t RotateLeft(uint64_t value, uint32_t bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    inline uint64_t ReadU64(const uint8_t* pData)
+    {
+        uint64_t value;
+        memcpy(&value, pData, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t HashRound(uint64_t acc, uint64_t input)
+    {
+        acc += input * HASH_PRIME_2;
+        return RotateLeft(acc, 31) * HASH_PRIME_1;
+    }
+
+    inline uint64_t HashMergeRound(uint64_t acc, uint64_t lane)
+    {
+        acc ^= HashRound(0, lane);
+        return acc * HASH_PRIME_1 + HASH_PRIME_4;
+    }
+}
+
+// ================================================================================================================
+uint32_t CalcMipLevelCnt(uint32_t width, uint32_t height)
+{
+    uint32_t mipCnt = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+    {
+        mipCnt++;
+    }
+    return mipCnt;
+}
+
+// ================================================================================================================
+uint64_t CalcMipChainBytes(uint32_t width, uint32_t height, uint32_t mipCnt)
+{
+    uint64_t bytes = 0;
+    for (uint32_t level = 0; level < mipCnt; level++)
+    {
+        bytes += static_cast<uint64_t>(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * 4;
+    }
+    return bytes;
+}
+
+// ================================================================================================================
+uint32_t GenerateMipChain(std::vector<uint8_t>& ioData, uint32_t width, uint32_t height, const MipGenDesc& desc)
+{
+    assert(ioData.size() == static_cast<uint64_t>(width) * height * 4 && "The input must be the R8G8B8A8 level 0 alone.");
+    const uint32_t mipCnt = CalcMipLevelCnt(width, height);
+    ioData.resize(CalcMipChainBytes(width, height, mipCnt));
+
+    uint64_t srcOffset = 0;
+    for (uint32_t level = 1; level < mipCnt; level++)
+    {
+        const uint32_t srcWidth = std::max(width >> (level - 1), 1u);
+        const uint32_t srcHeight = std::max(height >> (level - 1), 1u);
+        const uint32_t dstWidth = std::max(width >> level, 1u);
+        const uint32_t dstHeight = std::max(height >> level, 1u);
+        const uint64_t dstOffset = srcOffset + static_cast<uint64_t>(srcWidth) * srcHeight * 4;
+        GenerateMipLevel(ioData.data() + srcOffset, srcWidth, srcHeight, ioData.data() + dstOffset, dstWidth, dstHeight, desc);
+        srcOffset = dstOffset;
+    }
+    return mipCnt;
+}
+
+// ================================================================================================================
+uint64_t HashTextureData(const uint8_t* pData, uint64_t byteCnt, uint64_t seed)
+{
+    const uint8_t* pEnd = pData + byteCnt;
+    uint64_t hash;
+    if (byteCnt >= 32)
+    {
+        uint64_t lanes[4] = { seed + HASH_PRIME_1 + HASH_PRIME_2, seed + HASH_PRIME_2, seed, seed - HASH_PRIME_1 };
+        for (; pData + 32 <= pEnd; pData += 32)
+        {
+            lanes[0] = HashRound(lanes[0], ReadU64(pData));
+            lanes[1] = HashRound(lanes[1], ReadU64(pData + 8));
+            lanes[2] = HashRound(lanes[2], ReadU64(pData + 16));
+            lanes[3] = HashRound(lanes[3], ReadU64(pData + 24));
+        }
+        hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+        for (uint64_t lane : lanes)
+        {
+            hash = HashMergeRound(hash, lane);
+        }
+    }
+    else
+    {
+        hash = seed + HASH_PRIME_5;
+    }
+    hash += byteCnt;
+
+    for (; pData + 8 <= pEnd; pData += 8)
+    {
+        hash ^= HashRound(0, ReadU64(pData));
+        hash = RotateLeft(hash, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+    }
+    for (; pData < pEnd; pData++)
+    {
+        hash ^= *pData * HASH_PRIME_5;
+        hash = RotateLeft(hash, 11) * HASH_PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// CPU side texture processing. It doesn't depend on the D3D12, so it can run headless.
+
+// How the texels of a level are averaged into the next one.
+enum class MipContent
+{
+    Linear, // Metallic roughness, occlusion and the other data textures.
+    SRgb,   // Base color. The rgb is averaged in the linear light. The alpha is linear.
+    Normal  // Tangent space normals in the rgb, renormalized after the averaging. The alpha is linear.
+};
+
+enum class MipFilter
+{
+    Box,   // The 2x2 average, or the exact area average across an odd size.
+    Kaiser // Kaiser windowed sinc. Sharper minified detail than the box, at several times its cost.
+};
+
+struct MipGenDesc
+{
+    MipContent content = MipContent::Linear;
+    MipFilter  filter = MipFilter::Box;
+    // The taps wrap around the edges of a repeating texture, so the small levels tile without seams. Otherwise clamp.
+    bool       wrapHorizontal = true;
+    bool       wrapVertical = true;
+};
+
+// The level count of the full pyramid down to 1x1.
+uint32_t CalcMipLevelCnt(uint32_t width, uint32_t height);
+
+// The bytes of the first mipCnt levels of an R8G8B8A8 image, tightly packed one after another.
+uint64_t CalcMipChainBytes(uint32_t width, uint32_t height, uint32_t mipCnt);
+
+// Appends the full mip chain of an R8G8B8A8 image after its level 0 in ioData, in the CalcMipChainBytes() layout.
+// Each level is filtered from the one above it. The rows of a level go in parallel when it's called from a job
+// thread. Returns the level count.
+uint32_t GenerateMipChain(std::vector<uint8_t>& ioData, uint32_t width, uint32_t height, const MipGenDesc& desc);
+
+// A fast 64 bit content hash of the texel or block bytes, for finding the duplicated textures. Chain the levels through
+// the seed. It's not a cryptographic hash, so the equal hashes are trusted to be the equal contents.
+uint64_t HashTextureData(const uint8_t* pData, uint64_t byteCnt, uint64_t seed);
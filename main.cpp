@@ -12,6 +12,13 @@ int main(int argc, char** argv)
     args::CompletionFlag completion(parser, { "complete" });
 
     args::ValueFlag<int> inputSceneId(parser, "", "The render scene idx.", { 's', "scene" });
+    args::ValueFlag<int> inputTraceFrameCnt(parser, "", "Capture the scene loading and the first N frames into StartupTrace.json.", { 't', "trace" });
+    args::Flag inputStreamScene(parser, "stream", "Render right away and stream the meshes and textures in afterwards.", { "stream" });
+    args::ValueFlag<std::string> inputTexCompression(parser, "", "Block compress the material textures: quality (BC7 base color) or size (BC1/BC3 base color).", { "compress-textures" });
+    args::ValueFlag<std::string> inputMeshOptimization(parser, "", "Reorder the mesh buffers as they load: cache (vertex cache) or overdraw (vertex cache, then front to back clusters).", { "optimize-meshes" });
+    args::Flag inputCompactVertices(parser, "compact", "Quantize the vertices into 20 bytes instead of 48. The path tracer ignores it.", { "compact-vertices" });
+    args::ValueFlag<int> inputMeshLodCnt(parser, "", "Simplify each mesh into up to N levels of detail, with the full mesh, for the rasterizer.", { "mesh-lods" });
+    args::Flag inputMeshlets(parser, "meshlets", "Split the meshes into meshlets as they load, so the rasterizer culls them by their bounds and normal cones.", { "meshlets" });
 
     try
     {
@@ -47,8 +54,58 @@ int main(int argc, char** argv)
         return 0;
     }
     
+    RendererInitOptions initOptions;
+    if (inputTexCompression)
+    {
+        if (inputTexCompression.Get() == "quality")
+        {
+            initOptions.textureCompression = TextureCompression::Quality;
+        }
+        else if (inputTexCompression.Get() == "size")
+        {
+            initOptions.textureCompression = TextureCompression::Size;
+        }
+        else
+        {
+            std::cerr << "Unknown texture compression: " << inputTexCompression.Get() << std::endl;
+            return 1;
+        }
+    }
+
+    if (inputMeshOptimization)
+    {
+        if (inputMeshOptimization.Get() == "cache")
+        {
+            initOptions.meshOptimization = MeshOptimization::VertexCache;
+        }
+        else if (inputMeshOptimization.Get() == "overdraw")
+        {
+            initOptions.meshOptimization = MeshOptimization::Overdraw;
+        }
+        else
+        {
+            std::cerr << "Unknown mesh optimization: " << inputMeshOptimization.Get() << std::endl;
+            return 1;
+        }
+    }
+
+    if (inputMeshLodCnt)
+    {
+        if (inputMeshLodCnt.Get() < 1 || inputMeshLodCnt.Get() > static_cast<int>(MAX_MESH_LOD_CNT))
+        {
+            std::cerr << "The mesh LOD count must be from 1 to " << MAX_MESH_LOD_CNT << ": " << inputMeshLodCnt.Get() << std::endl;
+            return 1;
+        }
+        initOptions.meshLodCnt = static_cast<uint32_t>(inputMeshLodCnt.Get());
+    }
+
+    initOptions.startupTraceFrameCnt = (inputTraceFrameCnt && inputTraceFrameCnt.Get() > 0) ? static_cast<uint32_t>(inputTraceFrameCnt.Get()) : 0;
+    initOptions.streamScene = inputStreamScene.Get();
+    initOptions.vertexFormat = inputCompactVertices.Get() ? VertexFormat::Compact : VertexFormat::Float;
+    initOptions.buildMeshlets = inputMeshlets.Get();
+
     DX12MiniRenderer renderer;
-    renderer.Init(sceneYmlFilePath);
+    renderer.Init(sceneYmlFilePath, initOptions);
     renderer.Run();
     renderer.Finalize();
 